@@ -0,0 +1,202 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Binary asset cache.
+
+
+    Entry Layout -
+        magic 'BRAC', cache version, source size, source modification time, source path, variant, payload size, payload hash, payload
+
+        The entry file name is the hash of source + variant. The full strings are stored too so a hash collision reads as a miss instead of
+        returning the wrong asset. A source whose size or modification time differs from the stamp makes the entry stale.
+
+        Results that aren't built from a file (program binaries, built from sources in memory) use cache_load_key / cache_store_key with a key
+        that already changes whenever their input does, and an empty stamp.
+
+        Entries are written to a temporary file and renamed into place so a crash halfway through a write never leaves a truncated entry
+        behind under the real name.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "asset_cache.h"
+#include "serialize.h"
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <system_error>
+#include <thread>
+
+namespace br
+{
+    static const uint32_t CACHE_MAGIC = 0x43415242;     //"BRAC"
+
+    //64 bit FNV-1a, used for entry names and payload checksums
+    uint64_t hash_bytes(const void* data, size_t size, uint64_t hash)
+    {
+        const uint8_t* p = (const uint8_t*)data;
+        for(size_t i = 0; i < size; i++)
+        {
+            hash ^= p[i];
+            hash *= 0x100000001b3ull;
+        }
+
+        return hash;
+    }
+
+    static std::string entry_path(const asset_cache& cache, const std::string& source, const std::string& variant)
+    {
+        uint64_t h = hash_bytes(source.data(), source.size());
+        h = hash_bytes("\0", 1, h);
+        h = hash_bytes(variant.data(), variant.size(), h);
+
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)h);
+        return cache.directory + "/" + name;
+    }
+
+    //Size and modification time of the source file
+    static bool source_stamp(const std::string& source, uint64_t& size, int64_t& time)
+    {
+        std::error_code error;
+        size = (uint64_t)std::filesystem::file_size(source, error);
+        if(error)
+            return false;
+
+        std::filesystem::file_time_type t = std::filesystem::last_write_time(source, error);
+        if(error)
+            return false;
+
+        time = (int64_t)t.time_since_epoch().count();
+        return true;
+    }
+
+    static bool read_file(const std::string& path, std::vector<uint8_t>& data)
+    {
+        FILE* file = fopen(path.c_str(), "rb");
+        if(!file)
+            return false;
+
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        bool ok = size >= 0;
+        if(ok)
+        {
+            data.resize((size_t)size);
+            ok = fread(data.data(), 1, data.size(), file) == data.size();
+        }
+
+        fclose(file);
+        return ok;
+    }
+
+    //Reads an entry and checks it against the expected stamp
+    static bool load_entry(const asset_cache& cache, const std::string& source, const std::string& variant, uint64_t size, int64_t time,
+                           std::vector<uint8_t>& payload)
+    {
+        std::vector<uint8_t> file;
+        if(!read_file(entry_path(cache, source, variant), file))
+            return false;
+
+        byte_reader r = { file.data(), file.size() };
+
+        uint32_t magic = 0, version = 0;
+        uint64_t stored_size = 0, payload_hash = 0;
+        int64_t stored_time = 0;
+        std::string stored_source, stored_variant;
+
+        read_pod(r, magic);
+        read_pod(r, version);
+        read_pod(r, stored_size);
+        read_pod(r, stored_time);
+        read_string(r, stored_source);
+        read_string(r, stored_variant);
+        read_pod(r, payload_hash);
+        read_vector(r, payload);
+
+        if(!r.ok || magic != CACHE_MAGIC || version != ASSET_CACHE_VERSION)
+            return false;
+
+        if(stored_size != size || stored_time != time || stored_source != source || stored_variant != variant)
+            return false;
+
+        return hash_bytes(payload.data(), payload.size()) == payload_hash;
+    }
+
+    static bool store_entry(const asset_cache& cache, const std::string& source, const std::string& variant, uint64_t size, int64_t time,
+                            const std::vector<uint8_t>& payload)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(cache.directory, error);
+
+        std::vector<uint8_t> file;
+        file.reserve(payload.size() + 256);
+        byte_writer w = { &file };
+
+        write_pod(w, CACHE_MAGIC);
+        write_pod(w, ASSET_CACHE_VERSION);
+        write_pod(w, size);
+        write_pod(w, time);
+        write_string(w, source);
+        write_string(w, variant);
+        write_pod(w, hash_bytes(payload.data(), payload.size()));
+        write_vector(w, payload);
+
+        std::string path = entry_path(cache, source, variant);
+        //Unique per thread so two workers importing the same source don't write into the same temporary file
+        std::string temp = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+        FILE* out = fopen(temp.c_str(), "wb");
+        if(!out)
+            return false;
+
+        bool ok = fwrite(file.data(), 1, file.size(), out) == file.size();
+        ok = fclose(out) == 0 && ok;
+
+        if(ok)
+            std::filesystem::rename(temp, path, error);
+
+        if(!ok || error)
+        {
+            std::filesystem::remove(temp, error);
+            return false;
+        }
+
+        return true;
+    }
+
+    //Reads the cached payload for source + variant
+    //@return false if there is no entry, it is from an older version, the source file changed since it was written or the entry is corrupt
+    bool cache_load(const asset_cache& cache, const std::string& source, const std::string& variant, std::vector<uint8_t>& payload)
+    {
+        uint64_t size = 0;
+        int64_t time = 0;
+        if(!source_stamp(source, size, time))
+            return false;
+
+        return load_entry(cache, source, variant, size, time, payload);
+    }
+
+    //Writes (or replaces) the entry for source + variant
+    //@return false if the entry couldn't be written
+    bool cache_store(const asset_cache& cache, const std::string& source, const std::string& variant, const std::vector<uint8_t>& payload)
+    {
+        uint64_t size = 0;
+        int64_t time = 0;
+        if(!source_stamp(source, size, time))
+            return false;
+
+        return store_entry(cache, source, variant, size, time, payload);
+    }
+
+    //Entries that don't come from a file, stored with an empty stamp
+    bool cache_load_key(const asset_cache& cache, const std::string& key, const std::string& variant, std::vector<uint8_t>& payload)
+    {
+        return load_entry(cache, key, variant, 0, 0, payload);
+    }
+
+    bool cache_store_key(const asset_cache& cache, const std::string& key, const std::string& variant, const std::vector<uint8_t>& payload)
+    {
+        return store_entry(cache, key, variant, 0, 0, payload);
+    }
+}
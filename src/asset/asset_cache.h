@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace br
+{
+    //Directory of binary import results so expensive import steps (compression, normal generation, ...) only run again when the source file
+    //changes. Entries are keyed by the source path plus a variant string that names the import step and its settings.
+    struct asset_cache
+    {
+        std::string directory = "./cache";
+    };
+
+    //Bump when the entry layout or any import step's output changes so old entries are ignored
+    static const uint32_t ASSET_CACHE_VERSION = 1;
+
+    //Reads the cached payload for source + variant
+    //@return false if there is no entry, it is from an older version, the source file changed since it was written or the entry is corrupt
+    bool cache_load(const asset_cache& cache, const std::string& source, const std::string& variant, std::vector<uint8_t>& payload);
+
+    //Writes (or replaces) the entry for source + variant
+    //@return false if the entry couldn't be written
+    bool cache_store(const asset_cache& cache, const std::string& source, const std::string& variant, const std::vector<uint8_t>& payload);
+
+    //Same for results that aren't imported from a file. The key has to change whenever the input does (a hash of it, usually), nothing else
+    //makes these entries stale.
+    bool cache_load_key(const asset_cache& cache, const std::string& key, const std::string& variant, std::vector<uint8_t>& payload);
+    bool cache_store_key(const asset_cache& cache, const std::string& key, const std::string& variant, const std::vector<uint8_t>& payload);
+
+    //64 bit FNV-1a, used for entry names and payload checksums
+    uint64_t hash_bytes(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull);
+}
@@ -0,0 +1,583 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Import steps for assets. These are the expensive CPU parts of loading (parsing, simplification, clustering, mip generation) and are
+                safe to run on worker threads since they only touch the asset being built.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "asset_load.h"
+#include "../mesh/simplify.h"
+#include "../mesh/normals.h"
+#include "../image/image_io.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace br
+{
+    template<typename T>
+    static uint64_t vector_bytes(const std::vector<T>& v)
+    {
+        return (uint64_t)v.capacity() * sizeof(T);
+    }
+
+    //Variant of the mesh import in the cache, names every step that changes the result
+    static const char* MESH_IMPORT_VARIANT = "mesh smooth-normals mikktspace lods meshlets compact materials";
+
+    //Loads an OBJ with its materials and runs the import steps (smooth normals if the file has none, tangents if it has uvs, LODs, meshlets,
+    //vertex packing). Material textures aren't loaded except for atlas pages, see load_material_textures. The result is stored in the cache
+    //so later loads of the same (unchanged) file skip all of them.
+    //@param cache optional, null always runs the import
+    //@param js optional job system for normal and tangent generation
+    //@param atlas optional, packs small material textures into atlas pages (build_material_atlas). The pages are part of the cache entry,
+    //       which only follows the OBJ's stamp: edited images need the entry removed.
+    //@return false if the file couldn't be loaded
+    bool load_mesh_asset(mesh_asset& asset, const char* path, const asset_cache* cache, job_system* js, const atlas_settings* atlas)
+    {
+        std::vector<uint8_t> payload;
+
+        std::string variant = MESH_IMPORT_VARIANT;
+        if(atlas)
+        {
+            variant += " atlas " + std::to_string(atlas->max_size) + " " + std::to_string(atlas->max_texture_size) + " " + std::to_string(atlas->mip_levels) +
+                       " " + std::to_string(atlas->padding);
+        }
+
+        if(cache && cache_load(*cache, path, variant.c_str(), payload))
+        {
+            byte_reader r = { payload.data(), payload.size() };
+            if(read_mesh_asset(r, asset))
+                return true;
+        }
+
+        asset.materials = material_library();
+        if(!load_obj(asset.m, path, &asset.materials))
+            return false;
+
+        //Before tangents: the remap only scales and moves the uvs, but the tangents should come from the uvs the mesh ends up with
+        if(atlas)
+        {
+            load_material_textures(asset.materials, js);
+            build_material_atlas(asset.materials, asset.m, *atlas);
+        }
+
+        if(asset.m.normals.empty())
+            generate_normals(asset.m, NORMALS_SMOOTH, js);
+
+        generate_tangents(asset.m, js);
+        generate_lods(asset.m);
+
+        const mesh& m = asset.m;
+        asset.meshlets.assign(m.lods.size(), meshlet_set());
+        asset.lod_index_base.resize(m.lods.size());
+        asset.cluster_indices.clear();
+
+        for(size_t l = 0; l < m.lods.size(); l++)
+        {
+            build_meshlets(asset.meshlets[l], m, &m.indices[m.lods[l].index_offset], m.lods[l].index_count);
+            asset.lod_index_base[l] = (uint32_t)asset.cluster_indices.size();
+            asset.cluster_indices.insert(asset.cluster_indices.end(), asset.meshlets[l].indices.begin(), asset.meshlets[l].indices.end());
+        }
+
+        pack_vertices(asset.vertices, m, VERTEX_FORMAT_COMPACT);
+
+        if(cache)
+        {
+            payload.clear();
+            byte_writer w = { &payload };
+            write_mesh_asset(w, asset);
+            cache_store(*cache, path, variant.c_str(), payload);
+        }
+
+        return true;
+    }
+
+    //Binary form of a mesh_asset for the asset cache
+    void write_mesh_asset(byte_writer& w, const mesh_asset& asset)
+    {
+        const mesh& m = asset.m;
+        write_vector(w, m.positions);
+        write_vector(w, m.normals);
+        write_vector(w, m.uvs);
+        write_vector(w, m.tangents);
+        write_vector(w, m.materials);
+        write_vector(w, m.indices);
+        write_vector(w, m.lods);
+        write_pod(w, m.bounds_min);
+        write_pod(w, m.bounds_max);
+        write_pod(w, m.center);
+        write_pod(w, m.radius);
+
+        write_pod(w, (uint64_t)asset.meshlets.size());
+        for(const meshlet_set& set : asset.meshlets)
+        {
+            write_vector(w, set.meshlets);
+            write_vector(w, set.vertices);
+            write_vector(w, set.triangles);
+            write_vector(w, set.indices);
+        }
+
+        write_vector(w, asset.lod_index_base);
+        write_vector(w, asset.cluster_indices);
+
+        write_pod(w, asset.vertices.layout);
+        write_vector(w, asset.vertices.data);
+        write_pod(w, asset.vertices.position_offset);
+        write_pod(w, asset.vertices.position_scale);
+
+        write_material_library(w, asset.materials);
+    }
+
+    static bool indices_in_range(const std::vector<uint32_t>& indices, uint32_t count)
+    {
+        for(uint32_t i : indices)
+        {
+            if(i >= count)
+                return false;
+        }
+
+        return true;
+    }
+
+    //@return false if the data is truncated or inconsistent
+    bool read_mesh_asset(byte_reader& r, mesh_asset& asset)
+    {
+        mesh& m = asset.m;
+        read_vector(r, m.positions);
+        read_vector(r, m.normals);
+        read_vector(r, m.uvs);
+        read_vector(r, m.tangents);
+        read_vector(r, m.materials);
+        read_vector(r, m.indices);
+        read_vector(r, m.lods);
+        read_pod(r, m.bounds_min);
+        read_pod(r, m.bounds_max);
+        read_pod(r, m.center);
+        read_pod(r, m.radius);
+
+        uint64_t set_count = 0;
+        if(!read_pod(r, set_count) || set_count != m.lods.size())
+            return false;
+
+        asset.meshlets.assign(set_count, meshlet_set());
+        for(meshlet_set& set : asset.meshlets)
+        {
+            read_vector(r, set.meshlets);
+            read_vector(r, set.vertices);
+            read_vector(r, set.triangles);
+            read_vector(r, set.indices);
+        }
+
+        read_vector(r, asset.lod_index_base);
+        read_vector(r, asset.cluster_indices);
+
+        read_pod(r, asset.vertices.layout);
+        read_vector(r, asset.vertices.data);
+        read_pod(r, asset.vertices.position_offset);
+        read_pod(r, asset.vertices.position_scale);
+
+        if(!read_material_library(r, asset.materials) || r.position != r.size)
+            return false;
+
+        //Every array has to agree with the vertex count and every index has to stay inside it, so nothing drawn from the asset can read out
+        //of bounds
+        uint32_t vertex_count = mesh_vertex_count(m);
+        if(m.positions.size() % 3 != 0 || m.lods.empty() || asset.lod_index_base.size() != m.lods.size())
+            return false;
+
+        if((!m.normals.empty() && m.normals.size() != (size_t)vertex_count * 3) || (!m.uvs.empty() && m.uvs.size() != (size_t)vertex_count * 2) ||
+           (!m.tangents.empty() && m.tangents.size() != (size_t)vertex_count * 4) || (!m.materials.empty() && m.materials.size() != vertex_count))
+            return false;
+
+        if(!indices_in_range(m.materials, material_count(asset.materials)))
+            return false;
+
+        if(!indices_in_range(m.indices, vertex_count) || !indices_in_range(asset.cluster_indices, vertex_count))
+            return false;
+
+        for(size_t l = 0; l < m.lods.size(); l++)
+        {
+            const mesh_lod& lod = m.lods[l];
+            const meshlet_set& set = asset.meshlets[l];
+
+            if((uint64_t)lod.index_offset + lod.index_count > m.indices.size() || !indices_in_range(set.vertices, vertex_count) ||
+               !indices_in_range(set.indices, vertex_count) || (uint64_t)asset.lod_index_base[l] + set.indices.size() > asset.cluster_indices.size())
+                return false;
+
+            for(const meshlet& ml : set.meshlets)
+            {
+                uint64_t corners = (uint64_t)ml.triangle_count * 3;
+                if((uint64_t)ml.vertex_offset + ml.vertex_count > set.vertices.size() || ml.triangle_offset + corners > set.triangles.size() ||
+                   ml.index_offset + corners > set.indices.size())
+                    return false;
+
+                for(uint64_t c = 0; c < corners; c++)
+                {
+                    if(set.triangles[ml.triangle_offset + c] >= ml.vertex_count)
+                        return false;
+                }
+            }
+        }
+
+        //The packed vertices have to be exactly what pack_vertices would lay out for this mesh
+        const vertex_layout& layout = asset.vertices.layout;
+        vertex_layout expected = make_vertex_layout(m, layout.format);
+        if(memcmp(&layout, &expected, sizeof(layout)) != 0 || asset.vertices.data.size() != (size_t)vertex_count * layout.stride)
+            return false;
+
+        return true;
+    }
+
+    //Binary form of a material library. Only what the .mtl files describe and generated textures, loaded images aren't part of it.
+    void write_material_library(byte_writer& w, const material_library& lib)
+    {
+        write_pod(w, (uint64_t)lib.names.size());
+        for(const std::string& name : lib.names)
+        {
+            write_string(w, name);
+        }
+
+        write_vector(w, lib.params);
+        write_vector(w, lib.texture_refs);
+
+        write_pod(w, (uint64_t)lib.textures.size());
+        for(const material_texture& t : lib.textures)
+        {
+            write_string(w, t.path);
+            write_pod(w, (uint8_t)t.generated);
+            if(t.generated)
+                write_texture(w, t.image);
+        }
+    }
+
+    //@return false if the data is truncated or inconsistent
+    bool read_material_library(byte_reader& r, material_library& lib)
+    {
+        lib = material_library();
+
+        uint64_t name_count = 0;
+        if(!read_pod(r, name_count) || name_count > r.size - r.position)
+            return false;
+
+        lib.names.resize(name_count);
+        for(std::string& name : lib.names)
+        {
+            read_string(r, name);
+        }
+
+        read_vector(r, lib.params);
+        read_vector(r, lib.texture_refs);
+
+        uint64_t texture_count = 0;
+        if(!read_pod(r, texture_count) || texture_count > r.size - r.position)
+            return false;
+
+        lib.textures.resize(texture_count);
+        for(material_texture& t : lib.textures)
+        {
+            uint8_t generated = 0;
+            read_string(r, t.path);
+            read_pod(r, generated);
+
+            t.generated = generated != 0;
+            if(t.generated)
+            {
+                if(!read_texture(r, t.image))
+                    return false;
+
+                t.width = t.image.levels[0].width;
+                t.height = t.image.levels[0].height;
+            }
+        }
+
+        if(!r.ok || lib.params.size() != lib.names.size() || lib.texture_refs.size() != lib.params.size() * MATERIAL_TEXTURE_SLOTS)
+            return false;
+
+        for(int32_t ref : lib.texture_refs)
+        {
+            if(ref < -1 || ref >= (int64_t)lib.textures.size())
+                return false;
+        }
+
+        for(uint32_t m = 0; m < lib.names.size(); m++)
+        {
+            lib.by_name.emplace(lib.names[m], m);
+        }
+
+        for(uint32_t t = 0; t < lib.textures.size(); t++)
+        {
+            lib.texture_by_path.emplace(lib.textures[t].path, t);
+        }
+
+        return true;
+    }
+
+    //Loads every image the library's materials reference that isn't loaded yet and groups them into texture arrays (build_material_arrays).
+    //Images that don't load leave their slots empty.
+    //@param js optional, images are loaded in parallel on it
+    void load_material_textures(material_library& lib, job_system* js)
+    {
+        parallel_for(js, (uint32_t)lib.textures.size(), 1, [&](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t t = begin; t < end; t++)
+            {
+                material_texture& tex = lib.textures[t];
+                if(tex.width != 0)
+                    continue;
+
+                if(load_texture_asset(tex.image, tex.path.c_str()))
+                {
+                    tex.width = tex.image.levels[0].width;
+                    tex.height = tex.image.levels[0].height;
+                }
+                else
+                {
+                    tex.image = texture();
+                    tex.width = tex.height = 0;
+                }
+            }
+        });
+
+        for(const material_texture& tex : lib.textures)
+        {
+            if(tex.width == 0)
+                std::cerr << "Materials: couldn't load " << tex.path << std::endl;
+        }
+
+        build_material_arrays(lib);
+    }
+
+    static const char* SLOT_NAMES[MATERIAL_TEXTURE_SLOTS] = { "diffuse", "normal", "specular" };
+
+    //Packs the small textures of every material whose uvs stay inside [0, 1] into atlas pages, a set of pages per texture slot all with the
+    //same layout, and moves those materials' uvs onto the pages. The source textures are dropped from the library. Needs the textures
+    //loaded (load_material_textures).
+    //@param layout optional, receives the packing (for its efficiency)
+    //@return the number of materials moved into the atlas
+    uint32_t build_material_atlas(material_library& lib, mesh& m, const atlas_settings& settings, atlas_layout* layout)
+    {
+        uint32_t count = material_count(lib);
+        uint32_t vertex_count = mesh_vertex_count(m);
+        if(m.materials.size() != vertex_count || m.uvs.size() != (size_t)vertex_count * 2)
+            return 0;
+
+        //uv range of each material's vertices. Anything outside [0, 1] repeats the texture, which an atlas can't.
+        std::vector<float> uv_min((size_t)count * 2, INFINITY), uv_max((size_t)count * 2, -INFINITY);
+        for(uint32_t v = 0; v < vertex_count; v++)
+        {
+            uint32_t material = m.materials[v];
+            for(int k = 0; k < 2; k++)
+            {
+                float uv = m.uvs[(v * 2) + k];
+                uv_min[(material * 2) + k] = uv < uv_min[(material * 2) + k] ? uv : uv_min[(material * 2) + k];
+                uv_max[(material * 2) + k] = uv > uv_max[(material * 2) + k] ? uv : uv_max[(material * 2) + k];
+            }
+        }
+
+        //Materials with the same textures share one rect. Every texture of a material has to be loaded and of the same size, since they all
+        //go to the same place on their slot's pages.
+        const uint32_t NO_GROUP = 0xFFFFFFFF;
+        const float UV_EPSILON = 1e-4f;
+        std::vector<uint32_t> material_group(count, NO_GROUP);
+        std::vector<int32_t> group_refs;
+        std::vector<uint32_t> widths, heights;
+
+        for(uint32_t material = 0; material < count; material++)
+        {
+            const int32_t* refs = &lib.texture_refs[(size_t)material * MATERIAL_TEXTURE_SLOTS];
+            uint32_t width = 0, height = 0;
+            bool eligible = uv_min[material * 2] >= -UV_EPSILON && uv_min[(material * 2) + 1] >= -UV_EPSILON &&
+                            uv_max[material * 2] <= 1.0f + UV_EPSILON && uv_max[(material * 2) + 1] <= 1.0f + UV_EPSILON;
+
+            for(uint32_t s = 0; s < MATERIAL_TEXTURE_SLOTS && eligible; s++)
+            {
+                if(refs[s] < 0)
+                    continue;
+
+                const material_texture& tex = lib.textures[refs[s]];
+                eligible = tex.width != 0 && !tex.generated && (width == 0 || (tex.width == width && tex.height == height));
+                width = tex.width;
+                height = tex.height;
+            }
+
+            if(!eligible || width == 0 || width > settings.max_texture_size || height > settings.max_texture_size)
+                continue;
+
+            uint32_t group = 0;
+            for(; group < widths.size(); group++)
+            {
+                if(memcmp(&group_refs[(size_t)group * MATERIAL_TEXTURE_SLOTS], refs, sizeof(int32_t) * MATERIAL_TEXTURE_SLOTS) == 0)
+                    break;
+            }
+
+            if(group == widths.size())
+            {
+                group_refs.insert(group_refs.end(), refs, refs + MATERIAL_TEXTURE_SLOTS);
+                widths.push_back(width);
+                heights.push_back(height);
+            }
+
+            material_group[material] = group;
+        }
+
+        uint32_t group_count = (uint32_t)widths.size();
+        atlas_layout packed;
+        if(group_count == 0 || !atlas_pack(packed, widths.data(), heights.data(), group_count, settings))
+            return 0;
+
+        //Compose every page before adding any, adding them moves the source textures
+        std::vector<material_texture> pages;
+        std::vector<int32_t> page_refs((size_t)MATERIAL_TEXTURE_SLOTS * packed.page_count, -1);
+        std::vector<const texture*> sources(group_count);
+
+        for(uint32_t s = 0; s < MATERIAL_TEXTURE_SLOTS; s++)
+        {
+            bool used = false;
+            for(uint32_t g = 0; g < group_count; g++)
+            {
+                int32_t ref = group_refs[((size_t)g * MATERIAL_TEXTURE_SLOTS) + s];
+                sources[g] = ref >= 0 ? &lib.textures[ref].image : nullptr;
+                used |= ref >= 0;
+            }
+
+            for(uint32_t p = 0; p < packed.page_count && used; p++)
+            {
+                material_texture page;
+                page.path = std::string("atlas/") + SLOT_NAMES[s] + "/" + std::to_string(p);
+                page.generated = true;
+                atlas_compose(page.image, packed, p, sources.data(), settings);
+                page.width = packed.page_width;
+                page.height = packed.page_height;
+
+                page_refs[((size_t)s * packed.page_count) + p] = (int32_t)(lib.textures.size() + pages.size());
+                pages.push_back(std::move(page));
+            }
+        }
+
+        for(material_texture& page : pages)
+        {
+            lib.texture_by_path.emplace(page.path, (uint32_t)lib.textures.size());
+            lib.textures.push_back(std::move(page));
+        }
+
+        uint32_t moved = 0;
+        for(uint32_t material = 0; material < count; material++)
+        {
+            uint32_t group = material_group[material];
+            if(group == NO_GROUP)
+                continue;
+
+            for(uint32_t s = 0; s < MATERIAL_TEXTURE_SLOTS; s++)
+            {
+                int32_t& ref = lib.texture_refs[((size_t)material * MATERIAL_TEXTURE_SLOTS) + s];
+                ref = ref >= 0 ? page_refs[((size_t)s * packed.page_count) + packed.rects[group].page] : -1;
+            }
+            moved++;
+        }
+
+        for(uint32_t v = 0; v < vertex_count; v++)
+        {
+            uint32_t group = material_group[m.materials[v]];
+            if(group == NO_GROUP)
+                continue;
+
+            float scale[2], offset[2];
+            atlas_uv_transform(packed, group, scale, offset);
+            m.uvs[v * 2] = (m.uvs[v * 2] * scale[0]) + offset[0];
+            m.uvs[(v * 2) + 1] = (m.uvs[(v * 2) + 1] * scale[1]) + offset[1];
+        }
+
+        material_compact_textures(lib);
+        build_material_arrays(lib);
+
+        if(layout)
+            *layout = std::move(packed);
+        return moved;
+    }
+
+    //Loads a PPM image into a tiled texture with a box filtered mip chain
+    //@return false if the file couldn't be loaded
+    bool load_texture_asset(texture& t, const char* path)
+    {
+        uint32_t width = 0, height = 0;
+        std::vector<uint32_t> pixels;
+
+        if(!read_ppm(path, width, height, pixels))
+            return false;
+
+        texture_create(t, width, height, pixels.data(), TEXTURE_TILED, MIP_BOX);
+        return true;
+    }
+
+    static const char* bc_format_name(bc_format format)
+    {
+        switch(format)
+        {
+            case BC1: return "bc1";
+            case BC3: return "bc3";
+            case BC5: return "bc5";
+        }
+
+        return "?";
+    }
+
+    //Loads a PPM image, builds a Kaiser filtered mip chain and block compresses it. The compressed result is stored in the cache so later
+    //loads of the same (unchanged) image skip the filtering and encoding.
+    //@param cache optional, null always runs the import
+    //@param js optional job system for the encoder
+    //@return false if the file couldn't be loaded
+    bool load_compressed_texture_asset(compressed_texture& t, const char* path, bc_format format, const asset_cache* cache, job_system* js)
+    {
+        std::string variant = std::string(bc_format_name(format)) + " kaiser";
+        std::vector<uint8_t> payload;
+
+        if(cache && cache_load(*cache, path, variant, payload))
+        {
+            byte_reader r = { payload.data(), payload.size() };
+            if(read_compressed_texture(r, t) && t.format == format)
+                return true;
+        }
+
+        uint32_t width = 0, height = 0;
+        std::vector<uint32_t> pixels;
+
+        if(!read_ppm(path, width, height, pixels))
+            return false;
+
+        //Linear layout, the source levels are only read back row by row by the encoder
+        texture source;
+        texture_create(source, width, height, pixels.data(), TEXTURE_LINEAR, MIP_KAISER);
+        compress_texture(t, source, format, js);
+
+        if(cache)
+        {
+            payload.clear();
+            byte_writer w = { &payload };
+            write_compressed_texture(w, t);
+            cache_store(*cache, path, variant, payload);
+        }
+
+        return true;
+    }
+
+    //Approximate memory held by an asset (sum of its buffers)
+    uint64_t mesh_asset_bytes(const mesh_asset& asset)
+    {
+        const mesh& m = asset.m;
+        uint64_t bytes = vector_bytes(m.positions) + vector_bytes(m.normals) + vector_bytes(m.uvs) + vector_bytes(m.tangents) + vector_bytes(m.materials) + vector_bytes(m.indices) +
+                         vector_bytes(m.lods) + vector_bytes(asset.materials.params);
+
+        for(const meshlet_set& set : asset.meshlets)
+        {
+            bytes += vector_bytes(set.meshlets) + vector_bytes(set.vertices) + vector_bytes(set.triangles) + vector_bytes(set.indices);
+        }
+
+        return bytes + vector_bytes(asset.lod_index_base) + vector_bytes(asset.cluster_indices) + vector_bytes(asset.vertices.data);
+    }
+
+    uint64_t texture_bytes(const texture& t)
+    {
+        return vector_bytes(t.texels) + vector_bytes(t.levels);
+    }
+}
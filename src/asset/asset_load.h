@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../mesh/mesh.h"
+#include "../mesh/meshlet.h"
+#include "../mesh/vertex_format.h"
+#include "../scene/material.h"
+#include "../texture/texture.h"
+#include "../texture/bc.h"
+#include "../texture/atlas.h"
+#include "../core/job.h"
+#include "asset_cache.h"
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    //Everything the renderers need for one model, built at import time
+    struct mesh_asset
+    {
+        mesh m;
+
+        //Meshlets of each LOD. cluster_indices holds the meshlet ordered indices of all LODs back to back, lod_index_base[l] is where LOD l starts.
+        std::vector<meshlet_set> meshlets;
+        std::vector<uint32_t> lod_index_base;
+        std::vector<uint32_t> cluster_indices;
+
+        //Quantized interleaved vertices for GPU upload
+        packed_vertices vertices;
+
+        //Materials of the model's .mtl files, mesh.materials (only filled if there were any) indexes it
+        material_library materials;
+    };
+
+    //Loads an OBJ with its materials and runs the import steps (smooth normals if the file has none, tangents if it has uvs, LODs, meshlets,
+    //vertex packing). Material textures aren't loaded except for atlas pages, see load_material_textures. The result is stored in the cache
+    //so later loads of the same (unchanged) file skip all of them.
+    //@param cache optional, null always runs the import
+    //@param js optional job system for normal and tangent generation
+    //@param atlas optional, packs small material textures into atlas pages (build_material_atlas). The pages are part of the cache entry,
+    //       which only follows the OBJ's stamp: edited images need the entry removed.
+    //@return false if the file couldn't be loaded
+    bool load_mesh_asset(mesh_asset& asset, const char* path, const asset_cache* cache = nullptr, job_system* js = nullptr,
+                         const atlas_settings* atlas = nullptr);
+
+    //Binary form of a mesh_asset for the asset cache
+    void write_mesh_asset(byte_writer& w, const mesh_asset& asset);
+
+    //@return false if the data is truncated or inconsistent
+    bool read_mesh_asset(byte_reader& r, mesh_asset& asset);
+
+    //Binary form of a material library. Only what the .mtl files describe and generated textures, loaded images aren't part of it.
+    void write_material_library(byte_writer& w, const material_library& lib);
+
+    //@return false if the data is truncated or inconsistent
+    bool read_material_library(byte_reader& r, material_library& lib);
+
+    //Loads every image the library's materials reference that isn't loaded yet and groups them into texture arrays (build_material_arrays).
+    //Images that don't load leave their slots empty.
+    //@param js optional, images are loaded in parallel on it
+    void load_material_textures(material_library& lib, job_system* js = nullptr);
+
+    //Packs the small textures of every material whose uvs stay inside [0, 1] into atlas pages, a set of pages per texture slot all with the
+    //same layout, and moves those materials' uvs onto the pages. The source textures are dropped from the library. Needs the textures
+    //loaded (load_material_textures).
+    //@param layout optional, receives the packing (for its efficiency)
+    //@return the number of materials moved into the atlas
+    uint32_t build_material_atlas(material_library& lib, mesh& m, const atlas_settings& settings, atlas_layout* layout = nullptr);
+
+    //Loads a PPM image into a tiled texture with a box filtered mip chain
+    //@return false if the file couldn't be loaded
+    bool load_texture_asset(texture& t, const char* path);
+
+    //Loads a PPM image, builds a Kaiser filtered mip chain and block compresses it. The compressed result is stored in the cache so later
+    //loads of the same (unchanged) image skip the filtering and encoding.
+    //@param cache optional, null always runs the import
+    //@param js optional job system for the encoder
+    //@return false if the file couldn't be loaded
+    bool load_compressed_texture_asset(compressed_texture& t, const char* path, bc_format format, const asset_cache* cache = nullptr, job_system* js = nullptr);
+
+    //Approximate memory held by an asset (sum of its buffers)
+    uint64_t mesh_asset_bytes(const mesh_asset& asset);
+    uint64_t texture_bytes(const texture& t);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace br
+{
+    //Appends plain data to a byte buffer. Everything is written in host byte order, the cache is per machine.
+    struct byte_writer
+    {
+        std::vector<uint8_t>* out;
+    };
+
+    template<typename T>
+    inline void write_pod(byte_writer& w, const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "write_pod needs a trivially copyable type");
+
+        const uint8_t* p = (const uint8_t*)&value;
+        w.out->insert(w.out->end(), p, p + sizeof(T));
+    }
+
+    //Element count followed by the raw elements
+    template<typename T>
+    inline void write_vector(byte_writer& w, const std::vector<T>& v)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "write_vector needs a trivially copyable element type");
+
+        write_pod(w, (uint64_t)v.size());
+        const uint8_t* p = (const uint8_t*)v.data();
+        w.out->insert(w.out->end(), p, p + (v.size() * sizeof(T)));
+    }
+
+    inline void write_string(byte_writer& w, const std::string& s)
+    {
+        write_pod(w, (uint64_t)s.size());
+        w.out->insert(w.out->end(), s.begin(), s.end());
+    }
+
+    //Reads back what byte_writer wrote. Every read is bounds checked and a failed read sets ok to false (and keeps failing) instead of
+    //reading past the end, so a truncated or corrupt file can be detected once at the end.
+    struct byte_reader
+    {
+        const uint8_t* data;
+        size_t size;
+        size_t position = 0;
+        bool ok = true;
+    };
+
+    inline bool read_bytes(byte_reader& r, void* out, size_t count)
+    {
+        if(!r.ok || count > r.size - r.position)
+        {
+            r.ok = false;
+            return false;
+        }
+
+        memcpy(out, r.data + r.position, count);
+        r.position += count;
+        return true;
+    }
+
+    template<typename T>
+    inline bool read_pod(byte_reader& r, T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "read_pod needs a trivially copyable type");
+        return read_bytes(r, &value, sizeof(T));
+    }
+
+    template<typename T>
+    inline bool read_vector(byte_reader& r, std::vector<T>& v)
+    {
+        uint64_t count = 0;
+        if(!read_pod(r, count) || count > (r.size - r.position) / sizeof(T))
+        {
+            r.ok = false;
+            return false;
+        }
+
+        v.resize((size_t)count);
+        return read_bytes(r, v.data(), (size_t)count * sizeof(T));
+    }
+
+    inline bool read_string(byte_reader& r, std::string& s)
+    {
+        uint64_t count = 0;
+        if(!read_pod(r, count) || count > r.size - r.position)
+        {
+            r.ok = false;
+            return false;
+        }
+
+        s.assign((const char*)r.data + r.position, (size_t)count);
+        r.position += (size_t)count;
+        return true;
+    }
+}
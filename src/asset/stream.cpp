@@ -0,0 +1,347 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Asset streaming.
+
+
+    Flow -
+        stream_request   (main)    UNLOADED -> LOADING, queues a decode job
+        decode job       (worker)  reads and imports the file into the asset, then pushes the handle onto the decoded list
+        stream_update    (main)    LOADING -> DECODED when the handle shows up, then DECODED -> RESIDENT through the upload callback while the
+                                   frame's upload budget lasts
+        eviction         (main)    RESIDENT -> UNLOADED for the least recently used assets while over the memory budget
+
+        The asset's data is only written by the decode job while it is LOADING and only read by the main thread after the handle came through the
+        decoded list (under its mutex), so the asset itself needs no locking.
+
+
+    Budgets -
+        Uploads are the part that has to happen on the main thread (GL calls), so they get a time budget per frame instead of running all at once
+        when a batch of decodes finishes together. Memory is counted from the moment a decode is picked up, since the decoded data is in memory
+        whether or not it has been uploaded yet.
+
+        A decode is only started when its expected size fits in the memory budget next to what is decoded, resident and still decoding. The
+        expected size is what the asset took the last time it was loaded, or the average decode so far for one never seen. Requests that don't
+        fit wait in the load queue (QUEUED) and stream_update starts them after evicting room for the first one. Assets requested in the
+        current frame are never evicted, so a budget that is too small for one frame's working set overshoots instead of thrashing: with
+        nothing in flight the head of the queue starts whether it fits or not.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "stream.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace br
+{
+    static double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    //Runs on a worker. Only touches the asset it was given.
+    static void decode_asset(const streamer& s, stream_asset& a)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        if(a.type == ASSET_MESH)
+        {
+            a.decode_ok = load_mesh_asset(a.mesh_data, a.path.c_str(), s.cache, s.js);
+            a.bytes = a.decode_ok ? mesh_asset_bytes(a.mesh_data) : 0;
+        }
+        else
+        {
+            a.decode_ok = load_texture_asset(a.texture_data, a.path.c_str());
+            a.bytes = a.decode_ok ? texture_bytes(a.texture_data) : 0;
+        }
+
+        a.decode_ms = elapsed_ms(start);
+    }
+
+    //Bytes the budget holds for a decode of a before it has run
+    static uint64_t expected_size(const streamer& s, const stream_asset& a)
+    {
+        if(a.expected_bytes)
+            return a.expected_bytes;
+
+        return s.stats.decodes ? s.stats.bytes_streamed / s.stats.decodes : 0;
+    }
+
+    //Whether a decode of a can start without going over the memory budget
+    static bool fits_budget(const streamer& s, const stream_asset& a)
+    {
+        //Nothing to go by before the first decode, so those run one at a time
+        if(a.expected_bytes == 0 && s.stats.decodes == 0)
+            return s.loads_in_flight == 0;
+
+        return s.stats.bytes_resident + s.bytes_loading + expected_size(s, a) <= s.memory_budget;
+    }
+
+    static void free_asset_data(stream_asset& a)
+    {
+        //Swap with empty objects so the memory is actually returned
+        a.mesh_data = mesh_asset();
+        a.texture_data = texture();
+        a.bytes = 0;
+    }
+
+    //Adds an asset to the catalog without loading it
+    asset_handle stream_register(streamer& s, const std::string& path, asset_type type)
+    {
+        std::unique_ptr<stream_asset> a(new stream_asset());
+        a->path = path;
+        a->type = type;
+
+        s.assets.push_back(std::move(a));
+        return (asset_handle)(s.assets.size() - 1);
+    }
+
+    //Moves finished decodes to the upload queue
+    static void collect_decoded(streamer& s)
+    {
+        std::deque<asset_handle> finished;
+
+        {
+            std::lock_guard<std::mutex> guard(s.lock);
+            finished.swap(s.decoded);
+        }
+
+        for(asset_handle h : finished)
+        {
+            stream_asset& a = *s.assets[h];
+            s.loads_in_flight--;
+            s.bytes_loading -= a.reserved_bytes;
+            a.reserved_bytes = 0;
+
+            if(!a.decode_ok)
+            {
+                a.state = ASSET_FAILED;
+                s.stats.failures++;
+                free_asset_data(a);
+                continue;
+            }
+
+            a.state = ASSET_DECODED;
+            a.expected_bytes = a.bytes;
+            s.stats.decodes++;
+            s.stats.bytes_resident += a.bytes;
+            s.stats.bytes_streamed += a.bytes;
+            s.stats.peak_bytes_resident = std::max(s.stats.peak_bytes_resident, s.stats.bytes_resident);
+            s.upload_queue.push_back(h);
+        }
+    }
+
+    static void upload_asset(streamer& s, stream_asset& a)
+    {
+        if(!s.upload || s.upload(a))
+        {
+            a.state = ASSET_RESIDENT;
+            s.stats.uploads++;
+            return;
+        }
+
+        a.state = ASSET_FAILED;
+        s.stats.failures++;
+        s.stats.bytes_resident -= a.bytes;
+        free_asset_data(a);
+    }
+
+    static void start_load(streamer& s, asset_handle handle)
+    {
+        stream_asset* a = s.assets[handle].get();
+        a->state = ASSET_LOADING;
+        a->reserved_bytes = expected_size(s, *a);
+        s.loads_in_flight++;
+        s.bytes_loading += a->reserved_bytes;
+        s.stats.loads++;
+
+        auto job = [&s, a, handle]()
+        {
+            decode_asset(s, *a);
+
+            std::lock_guard<std::mutex> guard(s.lock);
+            s.decoded.push_back(handle);
+        };
+
+        if(s.js)
+            job_submit(*s.js, job, &s.loading);
+        else
+            job();
+    }
+
+    //Marks the asset as used this frame and starts loading it if it isn't in memory and fits the budget, queues it otherwise
+    //@return the asset if it is resident, null otherwise
+    const stream_asset* stream_request(streamer& s, asset_handle handle)
+    {
+        stream_asset& a = *s.assets[handle];
+        a.last_used = s.frame;
+
+        if(a.state == ASSET_UNLOADED)
+        {
+            if(s.load_queue.empty() && fits_budget(s, a))
+            {
+                start_load(s, handle);
+            }
+            else
+            {
+                a.state = ASSET_QUEUED;
+                s.load_queue.push_back(handle);
+                s.stats.held_loads++;
+            }
+        }
+
+        return a.state == ASSET_RESIDENT ? &a : nullptr;
+    }
+
+    //Like stream_request but blocks until the asset is resident (or failed). Time spent blocked is added to stats.stall_ms.
+    const stream_asset* stream_wait(streamer& s, asset_handle handle)
+    {
+        const stream_asset* resident = stream_request(s, handle);
+        if(resident)
+            return resident;
+
+        stream_asset& a = *s.assets[handle];
+        auto start = std::chrono::high_resolution_clock::now();
+
+        //Needed now, it doesn't wait for the budget
+        if(a.state == ASSET_QUEUED)
+        {
+            s.load_queue.erase(std::find(s.load_queue.begin(), s.load_queue.end(), handle));
+            start_load(s, handle);
+        }
+
+        while(a.state == ASSET_LOADING)
+        {
+            collect_decoded(s);
+
+            //Help with the decode work instead of sleeping
+            if(a.state == ASSET_LOADING && !(s.js && job_try_run(*s.js)))
+                std::this_thread::yield();
+        }
+
+        //Jump the upload queue, everything else keeps its budget
+        if(a.state == ASSET_DECODED)
+        {
+            s.upload_queue.erase(std::find(s.upload_queue.begin(), s.upload_queue.end(), handle));
+            upload_asset(s, a);
+        }
+
+        s.stats.stall_ms += elapsed_ms(start);
+
+        return a.state == ASSET_RESIDENT ? &a : nullptr;
+    }
+
+    //Evicts until the bytes in memory plus reserve fit the budget
+    static void evict(streamer& s, uint64_t reserve)
+    {
+        if(s.stats.bytes_resident + reserve <= s.memory_budget)
+            return;
+
+        std::vector<asset_handle> candidates;
+        for(asset_handle h = 0; h < s.assets.size(); h++)
+        {
+            const stream_asset& a = *s.assets[h];
+            if(a.state == ASSET_RESIDENT && a.last_used < s.frame)
+                candidates.push_back(h);
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [&s](asset_handle a, asset_handle b) { return s.assets[a]->last_used < s.assets[b]->last_used; });
+
+        for(asset_handle h : candidates)
+        {
+            if(s.stats.bytes_resident + reserve <= s.memory_budget)
+                break;
+
+            stream_asset& a = *s.assets[h];
+
+            if(s.release)
+                s.release(a);
+
+            s.stats.bytes_resident -= a.bytes;
+            s.stats.evictions++;
+
+            free_asset_data(a);
+            a.state = ASSET_UNLOADED;
+        }
+    }
+
+    //Starts queued loads in order while they fit, dropping the ones nobody asked for this frame
+    static void start_queued(streamer& s)
+    {
+        while(!s.load_queue.empty())
+        {
+            stream_asset& a = *s.assets[s.load_queue.front()];
+            if(a.last_used != s.frame)
+            {
+                a.state = ASSET_UNLOADED;
+                s.load_queue.pop_front();
+                continue;
+            }
+
+            if(!fits_budget(s, a) && s.loads_in_flight > 0)
+                break;
+
+            asset_handle h = s.load_queue.front();
+            s.load_queue.pop_front();
+            start_load(s, h);
+        }
+    }
+
+    //Per frame work: collects finished decodes, runs uploads within the time budget, evicts down to the memory budget and starts the
+    //queued loads that fit
+    void stream_update(streamer& s)
+    {
+        collect_decoded(s);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        bool first = true;
+
+        while(!s.upload_queue.empty() && (first || elapsed_ms(start) < s.upload_budget_ms))
+        {
+            asset_handle h = s.upload_queue.front();
+            s.upload_queue.pop_front();
+
+            upload_asset(s, *s.assets[h]);
+            first = false;
+        }
+
+        s.stats.upload_ms = elapsed_ms(start);
+
+        //Make room for the decodes in flight and the next one in the queue
+        uint64_t reserve = s.bytes_loading;
+        if(!s.load_queue.empty() && s.assets[s.load_queue.front()]->last_used == s.frame)
+            reserve += expected_size(s, *s.assets[s.load_queue.front()]);
+
+        evict(s, reserve);
+        start_queued(s);
+
+        s.frame++;
+    }
+
+    //Waits for loads in flight and releases every asset
+    void stream_shutdown(streamer& s)
+    {
+        if(s.js)
+            job_wait(*s.js, s.loading);
+
+        collect_decoded(s);
+        s.upload_queue.clear();
+
+        for(asset_handle h : s.load_queue)
+        {
+            s.assets[h]->state = ASSET_UNLOADED;
+        }
+        s.load_queue.clear();
+
+        for(std::unique_ptr<stream_asset>& a : s.assets)
+        {
+            if(a->state == ASSET_RESIDENT && s.release)
+                s.release(*a);
+
+            free_asset_data(*a);
+            a->state = ASSET_UNLOADED;
+        }
+
+        s.stats.bytes_resident = 0;
+    }
+}
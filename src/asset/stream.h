@@ -0,0 +1,150 @@
+#pragma once
+
+#include "asset_load.h"
+#include "../core/job.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace br
+{
+    typedef uint32_t asset_handle;
+    static const asset_handle INVALID_ASSET = 0xFFFFFFFF;
+
+    enum asset_type
+    {
+        ASSET_MESH,     //OBJ, imported into a mesh_asset
+        ASSET_TEXTURE   //PPM, imported into a texture
+    };
+
+    enum asset_state
+    {
+        ASSET_UNLOADED,
+        ASSET_QUEUED,       //Requested, the decode waits until the memory budget has room for it
+        ASSET_LOADING,      //Decode job queued or running on a worker
+        ASSET_DECODED,      //Waiting in the main thread upload queue
+        ASSET_RESIDENT,     //Uploaded and usable
+        ASSET_FAILED
+    };
+
+    struct stream_asset
+    {
+        std::string path;
+        asset_type type;
+        asset_state state = ASSET_UNLOADED;
+
+        //Only one of these is filled, depending on type
+        mesh_asset mesh_data;
+        texture texture_data;
+
+        //CPU memory of the decoded data, counted against the memory budget while decoded or resident
+        uint64_t bytes = 0;
+
+        //Size of the last decode, kept through eviction so a reload knows what it will take. While LOADING the budget holds reserved_bytes
+        //(this, or a guess for assets never decoded) for it.
+        uint64_t expected_bytes = 0;
+        uint64_t reserved_bytes = 0;
+
+        //Last frame the asset was requested. Eviction picks the smallest.
+        uint64_t last_used = 0;
+
+        //GL objects (or anything else) created by the upload callback, free for the callbacks to use
+        uint32_t gpu_names[3] = {};
+
+        //Set by the decode job
+        bool decode_ok = false;
+        double decode_ms = 0.0;
+    };
+
+    struct stream_stats
+    {
+        //Total time the main thread spent blocked in stream_wait
+        double stall_ms = 0.0;
+
+        //Time spent in upload callbacks during the last stream_update
+        double upload_ms = 0.0;
+
+        uint32_t loads = 0;
+        uint32_t decodes = 0;           //Successful ones
+        uint32_t held_loads = 0;        //Requests that had to wait in the load queue for memory
+        uint32_t uploads = 0;
+        uint32_t evictions = 0;
+        uint32_t failures = 0;
+
+        uint64_t bytes_resident = 0;
+        uint64_t peak_bytes_resident = 0;
+
+        //Total bytes decoded since startup (reloads after eviction count again)
+        uint64_t bytes_streamed = 0;
+    };
+
+    //Loads assets on the job system and hands them to the main thread for upload.
+    //All functions except the decode jobs run on the main thread (the one that owns the GL context).
+    struct streamer
+    {
+        //Null decodes on the calling thread inside stream_request
+        job_system* js = nullptr;
+
+        //Optional, meshes are imported through it so only the first load of a file pays for normal generation, LODs and meshlets
+        const asset_cache* cache = nullptr;
+
+        //unique_ptr so the decode jobs can hold on to an asset while more are registered
+        std::vector<std::unique_ptr<stream_asset>> assets;
+
+        //Finished decodes, pushed by the workers
+        std::mutex lock;
+        std::deque<asset_handle> decoded;
+        job_counter loading;
+
+        //Decoded assets waiting for the upload callback (main thread only)
+        std::deque<asset_handle> upload_queue;
+
+        //Time the upload callbacks may use per stream_update. At least one upload happens per update so big assets still make progress.
+        double upload_budget_ms = 2.0;
+
+        //Requested assets waiting for room in the memory budget, started by stream_update in request order
+        std::deque<asset_handle> load_queue;
+
+        //Decodes in flight and the bytes reserved for them, see stream_asset::reserved_bytes
+        uint32_t loads_in_flight = 0;
+        uint64_t bytes_loading = 0;
+
+        //Decoded + resident bytes are kept under this. A decode only starts when its expected size fits next to what is in memory and in
+        //flight, and least recently used assets not needed this frame are evicted to make room. The cap is still soft: an asset that was
+        //never loaded is reserved at the average decode so far (before the first decode only one load runs at a time) and can come out bigger, a frame that requests more than fits loads what it
+        //asked for (with nothing in flight the next queued decode starts anyway) and stream_wait always loads its asset right away.
+        uint64_t memory_budget = 256ull * 1024 * 1024;
+
+        uint64_t frame = 1;
+
+        //Called on the main thread to make a decoded asset usable (e.g. create GL buffers). Returning false marks the asset as failed.
+        //Null means the CPU data is used directly.
+        std::function<bool(stream_asset&)> upload;
+
+        //Called before an evicted asset's data is freed (e.g. delete GL objects)
+        std::function<void(stream_asset&)> release;
+
+        stream_stats stats;
+    };
+
+    //Adds an asset to the catalog without loading it
+    asset_handle stream_register(streamer& s, const std::string& path, asset_type type);
+
+    //Marks the asset as used this frame and starts loading it if it isn't in memory and fits the budget, queues it otherwise
+    //@return the asset if it is resident, null otherwise
+    const stream_asset* stream_request(streamer& s, asset_handle handle);
+
+    //Like stream_request but blocks until the asset is resident (or failed). Time spent blocked is added to stats.stall_ms.
+    const stream_asset* stream_wait(streamer& s, asset_handle handle);
+
+    //Per frame work: collects finished decodes, runs uploads within the time budget, evicts down to the memory budget and starts the
+    //queued loads that fit
+    void stream_update(streamer& s);
+
+    //Waits for loads in flight and releases every asset
+    void stream_shutdown(streamer& s);
+}
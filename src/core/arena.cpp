@@ -0,0 +1,207 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Linear arenas for data that only lives for a frame.
+
+
+    Why -
+        A frame builds a lot of short lived lists (visible objects, draw commands, sort keys, bins) whose sizes change a little every frame. With
+        std::vector each of them is a malloc and a free per frame, more with push_back growth, and every one is a trip into a shared heap that
+        other threads are also hitting. An arena hands out memory by bumping an offset and takes it all back with one reset, so the per frame cost
+        of an allocation is an add and a compare.
+
+
+    Growing -
+        An arena never fails an allocation. When it's full the allocation goes to an overflow block taken from the heap and the arena keeps
+        track of how much the frame wanted in total. The reset after that frees the overflow blocks and regrows the arena to the largest total
+        seen plus a quarter, so the heap only shows up in the first frames (and whenever a frame needs clearly more than any before it).
+        heap_allocations counts every block the arena takes, which is how a frame loop can show it settled.
+
+
+    Frames In Flight -
+        frame_allocator keeps frames_in_flight sets of per thread arenas and rotates through them. Data the GPU still reads from (upload staging,
+        per draw constants) stays put while the CPU builds the next frame in the other set, and gets reset only when its set comes around again.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "arena.h"
+#include <algorithm>
+
+namespace br
+{
+    //Arenas grow in pages of this size
+    static const size_t ARENA_GRANULARITY = 4096;
+
+    //Smallest overflow block, so an arena that starts empty doesn't take one block per allocation in its first frame
+    static const size_t ARENA_MIN_OVERFLOW = 64 * 1024;
+
+    static size_t align_up(size_t value, size_t align)
+    {
+        return (value + align - 1) & ~(align - 1);
+    }
+
+    static void free_overflow(arena& a)
+    {
+        while(a.overflow)
+        {
+            arena_block* next = a.overflow->next;
+            ::operator delete(a.overflow);
+            a.overflow = next;
+        }
+    }
+
+    void arena_init(arena& a, size_t capacity)
+    {
+        arena_release(a);
+
+        a.capacity = align_up(capacity, ARENA_GRANULARITY);
+        if(a.capacity)
+        {
+            a.base = (uint8_t*)::operator new(a.capacity);
+            a.stats.heap_allocations++;
+        }
+    }
+
+    void arena_release(arena& a)
+    {
+        free_overflow(a);
+        ::operator delete(a.base);
+
+        a.base = nullptr;
+        a.capacity = 0;
+        a.used = 0;
+        a.demand = 0;
+    }
+
+    //@param align power of two
+    void* arena_alloc(arena& a, size_t bytes, size_t align)
+    {
+        a.stats.allocations++;
+        a.stats.bytes += bytes;
+
+        //Aligning the address rather than the offset, so alignments past what operator new guarantees work too
+        if(a.base)
+        {
+            size_t start = align_up((size_t)(uintptr_t)(a.base + a.used), align) - (size_t)(uintptr_t)a.base;
+            if(start + bytes <= a.capacity)
+            {
+                a.demand += (start - a.used) + bytes;
+                a.used = start + bytes;
+                return a.base + start;
+            }
+        }
+
+        //Doesn't fit, spill into the newest overflow block or start another one at least as big as the arena
+        a.demand += bytes + align - 1;
+        a.stats.overflows++;
+
+        arena_block* block = a.overflow;
+        uint8_t* data = block ? (uint8_t*)(block + 1) : nullptr;
+        size_t start = block ? align_up((size_t)(uintptr_t)(data + block->used), align) - (size_t)(uintptr_t)data : 0;
+
+        if(!block || start + bytes > block->size)
+        {
+            size_t size = align_up(std::max(std::max(a.capacity, ARENA_MIN_OVERFLOW), bytes + align), ARENA_GRANULARITY);
+            block = (arena_block*)::operator new(sizeof(arena_block) + size);
+            block->next = a.overflow;
+            block->size = size;
+            block->used = 0;
+            a.overflow = block;
+            a.stats.heap_allocations++;
+
+            data = (uint8_t*)(block + 1);
+            start = align_up((size_t)(uintptr_t)data, align) - (size_t)(uintptr_t)data;
+        }
+
+        block->used = start + bytes;
+        return data + start;
+    }
+
+    //Forgets every allocation, frees the overflow blocks and, if there were any, grows the arena so the same frame fits next time with a
+    //quarter to spare
+    void arena_reset(arena& a)
+    {
+        a.stats.peak = std::max(a.stats.peak, a.demand);
+
+        if(a.overflow)
+        {
+            free_overflow(a);
+
+            ::operator delete(a.base);
+            a.capacity = align_up(a.stats.peak + (a.stats.peak / 4), ARENA_GRANULARITY);
+            a.base = (uint8_t*)::operator new(a.capacity);
+            a.stats.heap_allocations++;
+        }
+
+        a.used = 0;
+        a.demand = 0;
+        a.stats.allocations = 0;
+        a.stats.bytes = 0;
+    }
+
+    //@param thread_count threads that allocate, job_thread_count of the job system the frame runs on
+    //@param bytes_per_thread starting capacity of each arena, they grow to what the frames use
+    //@param frames_in_flight 2 keeps the previous frame's data alive while the next one is built (double buffering)
+    void frame_allocator_init(frame_allocator& fa, uint32_t thread_count, size_t bytes_per_thread, uint32_t frames_in_flight)
+    {
+        frame_allocator_release(fa);
+
+        fa.thread_count = thread_count ? thread_count : 1;
+        fa.frames_in_flight = frames_in_flight ? frames_in_flight : 1;
+        fa.arenas.resize((size_t)fa.thread_count * fa.frames_in_flight);
+
+        for(arena& a : fa.arenas)
+        {
+            arena_init(a, bytes_per_thread);
+        }
+    }
+
+    void frame_allocator_release(frame_allocator& fa)
+    {
+        for(arena& a : fa.arenas)
+        {
+            arena_release(a);
+        }
+
+        fa.arenas.clear();
+        fa.slot = 0;
+        fa.frame = 0;
+    }
+
+    //Moves to the next frame slot and resets its arenas. That slot was last filled frames_in_flight frames ago, so whatever read its data
+    //(the GPU included) has to be done with it: wait on that frame's fence before calling this.
+    void frame_begin(frame_allocator& fa)
+    {
+        if(fa.frame > 0)
+            fa.slot = (fa.slot + 1) % fa.frames_in_flight;
+
+        for(uint32_t t = 0; t < fa.thread_count; t++)
+        {
+            arena_reset(frame_arena(fa, t));
+        }
+
+        fa.frame++;
+    }
+
+    //allocations and bytes of the current frame summed over its threads, peak the largest of any arena, overflows and heap_allocations
+    //summed over every arena
+    arena_stats frame_allocator_stats(const frame_allocator& fa)
+    {
+        arena_stats total;
+
+        for(size_t i = 0; i < fa.arenas.size(); i++)
+        {
+            const arena_stats& s = fa.arenas[i].stats;
+            if(i / fa.thread_count == fa.slot)
+            {
+                total.allocations += s.allocations;
+                total.bytes += s.bytes;
+            }
+
+            total.peak = std::max(total.peak, s.peak);
+            total.overflows += s.overflows;
+            total.heap_allocations += s.heap_allocations;
+        }
+
+        return total;
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace br
+{
+    //Counters for one arena. allocations and bytes cover the allocations since the last reset, the rest add up over its lifetime.
+    struct arena_stats
+    {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+        size_t peak = 0;                //Most bytes (alignment included) one frame has asked for
+        uint64_t overflows = 0;         //Allocations that didn't fit and went to an overflow block
+        uint64_t heap_allocations = 0;  //Blocks the arena itself took from the heap: the first one, overflow blocks and regrowing
+    };
+
+    //Heap block an arena spilled into when it ran out, chained until the next reset
+    struct arena_block
+    {
+        arena_block* next;
+        size_t size;
+        size_t used;
+    };
+
+    //Linear (bump) allocator. Allocating moves a pointer forward, nothing is freed on its own, arena_reset drops everything at once.
+    //Running out doesn't fail: the allocation goes to an overflow block from the heap and the next reset grows the arena to the most a
+    //frame has needed, so after a few frames a loop that asks for about the same amount each frame never touches the heap again.
+    struct arena
+    {
+        uint8_t* base = nullptr;
+        size_t capacity = 0;
+        size_t used = 0;
+        size_t demand = 0;                  //Bytes asked for since the reset, overflow included
+        arena_block* overflow = nullptr;
+        arena_stats stats;
+    };
+
+    void arena_init(arena& a, size_t capacity);
+    void arena_release(arena& a);
+
+    //@param align power of two
+    void* arena_alloc(arena& a, size_t bytes, size_t align = alignof(std::max_align_t));
+
+    //Uninitialized storage for count objects of T, which have to be trivially destructible (nothing calls destructors)
+    template<typename T>
+    inline T* arena_alloc_array(arena& a, size_t count)
+    {
+        return (T*)arena_alloc(a, sizeof(T) * count, alignof(T));
+    }
+
+    //Forgets every allocation, frees the overflow blocks and, if there were any, grows the arena so the same frame fits next time with a
+    //quarter to spare
+    void arena_reset(arena& a);
+
+    //Allocator for standard containers backed by an arena. deallocate does nothing, the memory comes back with arena_reset, so a vector that
+    //grows leaves its old buffers behind until then: reserve what's known up front. Containers have to be gone (or never used again) before
+    //the arena resets.
+    template<typename T>
+    struct arena_allocator
+    {
+        typedef T value_type;
+
+        arena* source = nullptr;
+
+        arena_allocator() = default;
+        arena_allocator(arena& a) : source(&a) {}
+
+        template<typename U>
+        arena_allocator(const arena_allocator<U>& other) : source(other.source) {}
+
+        T* allocate(size_t count)
+        {
+            if(count > SIZE_MAX / sizeof(T))
+                throw std::bad_alloc();
+
+            return (T*)arena_alloc(*source, sizeof(T) * count, alignof(T));
+        }
+
+        void deallocate(T*, size_t) {}
+
+        template<typename U>
+        bool operator==(const arena_allocator<U>& other) const { return source == other.source; }
+
+        template<typename U>
+        bool operator!=(const arena_allocator<U>& other) const { return source != other.source; }
+    };
+
+    template<typename T>
+    using arena_vector = std::vector<T, arena_allocator<T>>;
+
+    //Frame scoped arenas, one per thread per frame in flight. Everything a frame builds on the side (visible lists, draw commands, bins, data
+    //waiting for the GPU to copy it) goes into the current frame's arenas and disappears frames_in_flight frames later, when the slot comes
+    //around again. Each thread only touches its own arena, so allocating needs no locks.
+    struct frame_allocator
+    {
+        std::vector<arena> arenas;      //frames_in_flight * thread_count, frame major
+        uint32_t thread_count = 0;
+        uint32_t frames_in_flight = 0;
+        uint32_t slot = 0;              //Frame slot being filled
+        uint64_t frame = 0;             //Frames begun
+    };
+
+    //@param thread_count threads that allocate, job_thread_count of the job system the frame runs on
+    //@param bytes_per_thread starting capacity of each arena, they grow to what the frames use
+    //@param frames_in_flight 2 keeps the previous frame's data alive while the next one is built (double buffering)
+    void frame_allocator_init(frame_allocator& fa, uint32_t thread_count, size_t bytes_per_thread, uint32_t frames_in_flight = 2);
+    void frame_allocator_release(frame_allocator& fa);
+
+    //Moves to the next frame slot and resets its arenas. That slot was last filled frames_in_flight frames ago, so whatever read its data
+    //(the GPU included) has to be done with it: wait on that frame's fence before calling this.
+    void frame_begin(frame_allocator& fa);
+
+    //The current frame's arena for a thread
+    //@param thread index from job_thread_index, below thread_count
+    inline arena& frame_arena(frame_allocator& fa, uint32_t thread)
+    {
+        return fa.arenas[((size_t)fa.slot * fa.thread_count) + thread];
+    }
+
+    //allocations and bytes of the current frame summed over its threads, peak the largest of any arena, overflows and heap_allocations
+    //summed over every arena
+    arena_stats frame_allocator_stats(const frame_allocator& fa);
+}
@@ -0,0 +1,206 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Small worker thread pool used to spread per-frame work (transform updates, culling, rasterization, etc.) across cores.
+
+
+    Design -
+        There is a single shared queue protected by a mutex. This is not the fastest possible design (work stealing deques would scale better) but the jobs we
+        submit are coarse (hundreds to thousands of items each) so the lock is not contended enough to matter.
+
+        Threads that wait on a counter do not sleep. They pull jobs off the queue and run them until the counter hits zero, which means the main thread is
+        also a worker while it waits and nested parallel_for calls from inside a job can not deadlock.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "job.h"
+
+namespace br
+{
+    //0 outside the pool, set once by each worker
+    static thread_local uint32_t thread_index = 0;
+
+    //Both with the lock held
+    static void queue_push(job_system& js, job_system::job&& j)
+    {
+        if(js.queued == js.queue.size())
+        {
+            //Unroll the ring into a bigger one, oldest job first
+            std::vector<job_system::job> grown(js.queue.size() ? js.queue.size() * 2 : 64);
+            for(size_t i = 0; i < js.queued; i++)
+            {
+                grown[i] = std::move(js.queue[(js.head + i) % js.queue.size()]);
+            }
+
+            js.queue.swap(grown);
+            js.head = 0;
+        }
+
+        js.queue[(js.head + js.queued) % js.queue.size()] = std::move(j);
+        js.queued++;
+    }
+
+    static job_system::job queue_pop(job_system& js)
+    {
+        job_system::job j = std::move(js.queue[js.head]);
+        js.queue[js.head] = job_system::job();
+        js.head = (js.head + 1) % js.queue.size();
+        js.queued--;
+        return j;
+    }
+
+    //Runs one job and signals its counter
+    static void run_job(job_system::job& j)
+    {
+        j.fn();
+
+        if(j.counter)
+            j.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    static void worker_loop(job_system* js, uint32_t index)
+    {
+        thread_index = index;
+
+        while(true)
+        {
+            job_system::job j;
+
+            {
+                std::unique_lock<std::mutex> guard(js->lock);
+                js->wake.wait(guard, [js]() { return js->quit || js->queued > 0; });
+
+                if(js->queued == 0)
+                    return;
+
+                j = queue_pop(*js);
+            }
+
+            run_job(j);
+        }
+    }
+
+    //Spins up the worker threads
+    //@param js job system to initialize
+    //@param thread_count number of workers (0 picks hardware_concurrency - 1)
+    void job_system_init(job_system& js, uint32_t thread_count)
+    {
+        if(thread_count == 0)
+        {
+            uint32_t hw = std::thread::hardware_concurrency();
+            thread_count = hw > 1 ? hw - 1 : 1;
+        }
+
+        js.quit = false;
+        js.workers.reserve(thread_count);
+
+        for(uint32_t i = 0; i < thread_count; i++)
+        {
+            js.workers.emplace_back(worker_loop, &js, i + 1);
+        }
+    }
+
+    //Finishes all queued jobs and joins the worker threads
+    void job_system_shutdown(job_system& js)
+    {
+        {
+            std::lock_guard<std::mutex> guard(js.lock);
+            js.quit = true;
+        }
+
+        js.wake.notify_all();
+
+        for(std::thread& t : js.workers)
+        {
+            t.join();
+        }
+
+        js.workers.clear();
+    }
+
+    //Queues a job to run on a worker thread
+    //@param counter optional counter that is incremented now and decremented when the job finishes
+    void job_submit(job_system& js, std::function<void()> fn, job_counter* counter)
+    {
+        if(counter)
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> guard(js.lock);
+            queue_push(js, { std::move(fn), counter });
+        }
+
+        js.wake.notify_one();
+    }
+
+    //Runs one queued job on the calling thread, if there is one
+    //@return false if the queue was empty
+    bool job_try_run(job_system& js)
+    {
+        job_system::job j;
+
+        {
+            std::lock_guard<std::mutex> guard(js.lock);
+            if(js.queued == 0)
+                return false;
+
+            j = queue_pop(js);
+        }
+
+        run_job(j);
+        return true;
+    }
+
+    //Blocks until counter drops to target (zero = the whole batch is done). The calling thread runs queued jobs while it waits
+    void job_wait(job_system& js, job_counter& counter, uint32_t target)
+    {
+        while(counter.pending.load(std::memory_order_acquire) > target)
+        {
+            if(!job_try_run(js))
+                std::this_thread::yield();
+        }
+    }
+
+    //Splits [0, count) into chunks of chunk_size and runs fn(begin, end) on each chunk in parallel.
+    //Returns once every chunk is finished. Passing a null job system runs everything on the calling thread.
+    void parallel_for(job_system* js, uint32_t count, uint32_t chunk_size, const std::function<void(uint32_t begin, uint32_t end)>& fn)
+    {
+        if(count == 0)
+            return;
+
+        if(chunk_size == 0)
+            chunk_size = 1;
+
+        //Not worth the queue traffic for a single chunk
+        if(js == nullptr || js->workers.empty() || count <= chunk_size)
+        {
+            fn(0, count);
+            return;
+        }
+
+        job_counter counter;
+
+        //Keep the first chunk for the calling thread
+        for(uint32_t begin = chunk_size; begin < count; begin += chunk_size)
+        {
+            uint32_t end = begin + chunk_size < count ? begin + chunk_size : count;
+            job_submit(*js, [&fn, begin, end]() { fn(begin, end); }, &counter);
+        }
+
+        fn(0, chunk_size);
+
+        job_wait(*js, counter);
+    }
+
+    //Number of threads that can run jobs (workers + the calling thread)
+    uint32_t job_thread_count(const job_system* js)
+    {
+        return js ? (uint32_t)js->workers.size() + 1 : 1;
+    }
+
+    //Index of the calling thread in [0, job_thread_count): workers are 1 and up, any thread outside the pool is 0. Meant for picking
+    //per thread storage (see frame_arena), so only one thread outside the pool should be running jobs at a time.
+    uint32_t job_thread_index()
+    {
+        return thread_index;
+    }
+}
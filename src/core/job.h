@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace br
+{
+    //Tracks how many jobs in a batch are still running so the caller can wait on them
+    struct job_counter
+    {
+        std::atomic<uint32_t> pending{0};
+    };
+
+    //State for the worker thread pool
+    //Plain struct + functions instead of a class so it can be embedded in other state structs
+    struct job_system
+    {
+        std::vector<std::thread> workers;
+
+        struct job
+        {
+            std::function<void()> fn;
+            job_counter* counter = nullptr;
+        };
+
+        //Ring buffer of queued jobs, queued of them starting at head. It only ever grows, so once it holds a frame's worth of jobs
+        //submitting doesn't allocate anymore (a deque frees and reallocates its blocks as the jobs cycle through).
+        std::vector<job> queue;
+        size_t head = 0;
+        size_t queued = 0;
+        std::mutex lock;
+        std::condition_variable wake;
+        bool quit = false;
+    };
+
+    //Spins up the worker threads
+    //@param js job system to initialize
+    //@param thread_count number of workers (0 picks hardware_concurrency - 1)
+    void job_system_init(job_system& js, uint32_t thread_count = 0);
+
+    //Finishes all queued jobs and joins the worker threads
+    void job_system_shutdown(job_system& js);
+
+    //Queues a job to run on a worker thread
+    //@param counter optional counter that is incremented now and decremented when the job finishes
+    void job_submit(job_system& js, std::function<void()> fn, job_counter* counter = nullptr);
+
+    //Runs one queued job on the calling thread, if there is one
+    //@return false if the queue was empty
+    bool job_try_run(job_system& js);
+
+    //Blocks until counter drops to target (zero = the whole batch is done). The calling thread runs queued jobs while it waits
+    void job_wait(job_system& js, job_counter& counter, uint32_t target = 0);
+
+    //Splits [0, count) into chunks of chunk_size and runs fn(begin, end) on each chunk in parallel.
+    //Returns once every chunk is finished. Passing a null job system runs everything on the calling thread.
+    void parallel_for(job_system* js, uint32_t count, uint32_t chunk_size, const std::function<void(uint32_t begin, uint32_t end)>& fn);
+
+    //Number of threads that can run jobs (workers + the calling thread)
+    uint32_t job_thread_count(const job_system* js);
+
+    //Index of the calling thread in [0, job_thread_count): workers are 1 and up, any thread outside the pool is 0. Meant for picking
+    //per thread storage (see frame_arena), so only one thread outside the pool should be running jobs at a time.
+    uint32_t job_thread_index();
+}
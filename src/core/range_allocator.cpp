@@ -0,0 +1,380 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Two level segregated fit allocator for ranges of a buffer.
+
+
+    Size Classes -
+        Free blocks are filed by size into RANGE_FL_COUNT power of two classes (the first level), each split into RANGE_SL_COUNT linear steps (the
+        second level), so a class never spans more than 1/16 of its size. Sizes below RANGE_SL_COUNT get a list each. One bit per non empty list
+        in sl_bitmap and one bit per first level with any non empty list in fl_bitmap turn finding a fitting list into two count trailing zeros.
+
+        An allocation rounds its size up to the next class boundary first, so any block in the list found is big enough and the search never
+        walks a list. That wastes at most 1/16 of the request in the choice of hole (not in the allocation, the block is still split to size).
+
+
+    Blocks -
+        Blocks are entries in one array linked by offset order (prev / next) and, while free, into their size class's list. Freeing merges a
+        block with its free neighbours straight away so two free blocks are never next to each other. Nothing in here touches the memory being
+        managed, which is what lets it sit in front of GPU buffers.
+
+
+    Defragmenting -
+        Allocations slide down over the holes in front of them in offset order, which keeps every move's destination below all later sources:
+        copying them one after another never overwrites data still to be copied. The block list is then rebuilt from the allocations with fresh
+        free blocks for whatever holes are left.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "range_allocator.h"
+#include <algorithm>
+#include <bit>
+
+namespace br
+{
+    //Size class of a free block of exactly size units
+    static void size_class(uint32_t size, uint32_t& fl, uint32_t& sl)
+    {
+        if(size < RANGE_SL_COUNT)
+        {
+            fl = 0;
+            sl = size;
+            return;
+        }
+
+        uint32_t log = 31 - std::countl_zero(size);
+        fl = log - RANGE_SL_BITS + 1;
+        sl = (size >> (log - RANGE_SL_BITS)) ^ RANGE_SL_COUNT;
+    }
+
+    static uint32_t new_block(range_allocator& ra)
+    {
+        if(!ra.unused.empty())
+        {
+            uint32_t b = ra.unused.back();
+            ra.unused.pop_back();
+            return b;
+        }
+
+        ra.blocks.push_back({});
+        return (uint32_t)ra.blocks.size() - 1;
+    }
+
+    static void insert_free(range_allocator& ra, uint32_t b)
+    {
+        range_block& block = ra.blocks[b];
+        uint32_t fl, sl;
+        size_class(block.size, fl, sl);
+
+        block.free = true;
+        block.prev_free = RANGE_NONE;
+        block.next_free = ra.heads[fl][sl];
+        if(block.next_free != RANGE_NONE)
+            ra.blocks[block.next_free].prev_free = b;
+
+        ra.heads[fl][sl] = b;
+        ra.sl_bitmap[fl] |= 1u << sl;
+        ra.fl_bitmap |= 1u << fl;
+        ra.free_block_count++;
+    }
+
+    static void remove_free(range_allocator& ra, uint32_t b)
+    {
+        range_block& block = ra.blocks[b];
+        uint32_t fl, sl;
+        size_class(block.size, fl, sl);
+
+        if(block.prev_free != RANGE_NONE)
+            ra.blocks[block.prev_free].next_free = block.next_free;
+        else
+            ra.heads[fl][sl] = block.next_free;
+
+        if(block.next_free != RANGE_NONE)
+            ra.blocks[block.next_free].prev_free = block.prev_free;
+
+        if(ra.heads[fl][sl] == RANGE_NONE)
+        {
+            ra.sl_bitmap[fl] &= ~(1u << sl);
+            if(ra.sl_bitmap[fl] == 0)
+                ra.fl_bitmap &= ~(1u << fl);
+        }
+
+        block.free = false;
+        ra.free_block_count--;
+    }
+
+    //Merges b's next neighbour into b, both already out of the free lists
+    static void absorb_next(range_allocator& ra, uint32_t b)
+    {
+        range_block& block = ra.blocks[b];
+        uint32_t n = block.next;
+
+        block.size += ra.blocks[n].size;
+        block.next = ra.blocks[n].next;
+        if(block.next != RANGE_NONE)
+            ra.blocks[block.next].prev = b;
+
+        ra.unused.push_back(n);
+    }
+
+    static void clear_lists(range_allocator& ra)
+    {
+        ra.fl_bitmap = 0;
+        for(uint32_t fl = 0; fl < RANGE_FL_COUNT; fl++)
+        {
+            ra.sl_bitmap[fl] = 0;
+            for(uint32_t sl = 0; sl < RANGE_SL_COUNT; sl++)
+            {
+                ra.heads[fl][sl] = RANGE_NONE;
+            }
+        }
+
+        ra.free_block_count = 0;
+    }
+
+    void range_allocator_init(range_allocator& ra, uint32_t capacity)
+    {
+        ra.blocks.clear();
+        ra.unused.clear();
+        clear_lists(ra);
+
+        ra.capacity = capacity;
+        ra.used = 0;
+        ra.allocation_count = 0;
+        ra.first = RANGE_NONE;
+
+        if(capacity == 0)
+            return;
+
+        ra.first = new_block(ra);
+        ra.blocks[ra.first] = { 0, capacity, RANGE_NONE, RANGE_NONE, RANGE_NONE, RANGE_NONE, false };
+        insert_free(ra, ra.first);
+    }
+
+    //@return RANGE_NONE if no free hole is big enough
+    range_handle range_alloc(range_allocator& ra, uint32_t size)
+    {
+        if(size == 0 || size > ra.capacity - ra.used)
+            return RANGE_NONE;
+
+        //Round up to the next class so the first block of the list found fits
+        uint64_t rounded = size;
+        if(size >= RANGE_SL_COUNT)
+        {
+            uint32_t log = 31 - std::countl_zero(size);
+            rounded += (1ull << (log - RANGE_SL_BITS)) - 1;
+        }
+
+        //Past the last class only a block in it could still fit, and nothing says which one does
+        if(rounded > 0xFFFFFFFFull)
+            return RANGE_NONE;
+
+        uint32_t fl, sl;
+        size_class((uint32_t)rounded, fl, sl);
+
+        uint32_t sl_map = ra.sl_bitmap[fl] & (~0u << sl);
+        if(sl_map == 0)
+        {
+            uint32_t fl_map = fl + 1 < RANGE_FL_COUNT ? ra.fl_bitmap & (~0u << (fl + 1)) : 0;
+            if(fl_map == 0)
+                return RANGE_NONE;
+
+            fl = std::countr_zero(fl_map);
+            sl_map = ra.sl_bitmap[fl];
+        }
+
+        sl = std::countr_zero(sl_map);
+        uint32_t b = ra.heads[fl][sl];
+        remove_free(ra, b);
+
+        //Give the rest back as a free block right behind
+        if(ra.blocks[b].size > size)
+        {
+            uint32_t rest = new_block(ra);
+            range_block& block = ra.blocks[b];
+            ra.blocks[rest] = { block.offset + size, block.size - size, b, block.next, RANGE_NONE, RANGE_NONE, false };
+
+            if(block.next != RANGE_NONE)
+                ra.blocks[block.next].prev = rest;
+
+            block.next = rest;
+            block.size = size;
+            insert_free(ra, rest);
+        }
+
+        ra.used += size;
+        ra.allocation_count++;
+        return b;
+    }
+
+    void range_free(range_allocator& ra, range_handle handle)
+    {
+        if(handle == RANGE_NONE)
+            return;
+
+        uint32_t b = handle;
+        ra.used -= ra.blocks[b].size;
+        ra.allocation_count--;
+
+        uint32_t next = ra.blocks[b].next;
+        if(next != RANGE_NONE && ra.blocks[next].free)
+        {
+            remove_free(ra, next);
+            absorb_next(ra, b);
+        }
+
+        uint32_t prev = ra.blocks[b].prev;
+        if(prev != RANGE_NONE && ra.blocks[prev].free)
+        {
+            remove_free(ra, prev);
+            absorb_next(ra, prev);
+            b = prev;
+        }
+
+        insert_free(ra, b);
+    }
+
+    //Adds units at the end, the caller has made the space behind them real (e.g. grown the buffer)
+    void range_grow(range_allocator& ra, uint32_t capacity)
+    {
+        if(capacity <= ra.capacity)
+            return;
+
+        if(ra.first == RANGE_NONE)
+        {
+            range_allocator_init(ra, capacity);
+            return;
+        }
+
+        uint32_t last = ra.first;
+        while(ra.blocks[last].next != RANGE_NONE)
+        {
+            last = ra.blocks[last].next;
+        }
+
+        uint32_t added = capacity - ra.capacity;
+        ra.capacity = capacity;
+
+        if(ra.blocks[last].free)
+        {
+            remove_free(ra, last);
+            ra.blocks[last].size += added;
+            insert_free(ra, last);
+            return;
+        }
+
+        uint32_t tail = new_block(ra);
+        ra.blocks[tail] = { capacity - added, added, last, RANGE_NONE, RANGE_NONE, RANGE_NONE, false };
+        ra.blocks[last].next = tail;
+        insert_free(ra, tail);
+    }
+
+    //Slides allocations down over the holes in front of them, lowest first, until max_units have moved (0 = no limit, and the first
+    //allocation moves even if it's bigger). Handles keep pointing at their allocations, only the offsets change.
+    //@param moves filled with the copies to make, neighbouring allocations that move together are merged into one
+    //@param scratch holds the allocations in offset order during the call, kept by the caller so defragmenting every frame doesn't allocate
+    //@return units moved
+    uint32_t range_defragment(range_allocator& ra, std::vector<range_move>& moves, std::vector<uint32_t>& scratch, uint32_t max_units)
+    {
+        moves.clear();
+        if(ra.first == RANGE_NONE || ra.free_block_count == 0)
+            return 0;
+
+        //Allocations in offset order, free blocks go back to the pool
+        std::vector<uint32_t>& live = scratch;
+        live.clear();
+        for(uint32_t b = ra.first; b != RANGE_NONE; b = ra.blocks[b].next)
+        {
+            if(ra.blocks[b].free)
+                ra.unused.push_back(b);
+            else
+                live.push_back(b);
+        }
+
+        uint32_t cursor = 0, moved = 0;
+        for(uint32_t b : live)
+        {
+            range_block& block = ra.blocks[b];
+            if(block.offset == cursor)
+            {
+                cursor += block.size;
+                continue;
+            }
+
+            //Out of budget, everything from here on stays put. An allocation bigger than the whole budget still moves when it's first,
+            //or it would block everything behind it for good.
+            if(max_units != 0 && moved != 0 && moved + block.size > max_units)
+                break;
+
+            if(!moves.empty() && moves.back().from + moves.back().size == block.offset && moves.back().to + moves.back().size == cursor)
+                moves.back().size += block.size;
+            else
+                moves.push_back({ block.offset, cursor, block.size });
+
+            block.offset = cursor;
+            cursor += block.size;
+            moved += block.size;
+        }
+
+        //Relink the allocations with a free block in every gap left between them
+        clear_lists(ra);
+        ra.first = RANGE_NONE;
+
+        uint32_t prev = RANGE_NONE, end = 0;
+        auto link = [&](uint32_t b)
+        {
+            ra.blocks[b].prev = prev;
+            ra.blocks[b].next = RANGE_NONE;
+            if(prev != RANGE_NONE)
+                ra.blocks[prev].next = b;
+            else
+                ra.first = b;
+
+            prev = b;
+            end = ra.blocks[b].offset + ra.blocks[b].size;
+        };
+
+        auto link_gap = [&](uint32_t until)
+        {
+            if(until == end)
+                return;
+
+            uint32_t gap = new_block(ra);
+            ra.blocks[gap] = { end, until - end, RANGE_NONE, RANGE_NONE, RANGE_NONE, RANGE_NONE, false };
+            link(gap);
+            insert_free(ra, gap);
+        };
+
+        for(uint32_t b : live)
+        {
+            link_gap(ra.blocks[b].offset);
+            link(b);
+        }
+
+        link_gap(ra.capacity);
+        return moved;
+    }
+
+    range_stats range_allocator_stats(const range_allocator& ra)
+    {
+        range_stats stats = {};
+        stats.capacity = ra.capacity;
+        stats.used = ra.used;
+        stats.allocations = ra.allocation_count;
+        stats.free_blocks = ra.free_block_count;
+
+        //The biggest hole is in the highest non empty list, which is short: every block in it is within a class of the others
+        if(ra.fl_bitmap)
+        {
+            uint32_t fl = 31 - std::countl_zero(ra.fl_bitmap);
+            uint32_t sl = 31 - std::countl_zero(ra.sl_bitmap[fl]);
+            for(uint32_t b = ra.heads[fl][sl]; b != RANGE_NONE; b = ra.blocks[b].next_free)
+            {
+                stats.largest_free = std::max(stats.largest_free, ra.blocks[b].size);
+            }
+        }
+
+        uint32_t free_units = ra.capacity - ra.used;
+        stats.fragmentation = free_units ? 1.0f - ((float)stats.largest_free / (float)free_units) : 0.0f;
+        return stats;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    //Second level subdivisions per power of two: 1 << RANGE_SL_BITS free lists per size class
+    const uint32_t RANGE_SL_BITS = 4;
+    const uint32_t RANGE_SL_COUNT = 1 << RANGE_SL_BITS;
+    const uint32_t RANGE_FL_COUNT = 32 - RANGE_SL_BITS + 1;
+
+    const uint32_t RANGE_NONE = 0xFFFFFFFF;
+
+    //Handle of an allocation, stays valid until it's freed (defragmenting moves the range, not the handle)
+    typedef uint32_t range_handle;
+
+    //A run of units, either one allocation or a free hole between them
+    struct range_block
+    {
+        uint32_t offset;
+        uint32_t size;
+        uint32_t prev;              //Neighbours by offset
+        uint32_t next;
+        uint32_t prev_free;         //Free list links, only while free
+        uint32_t next_free;
+        bool free;
+    };
+
+    //Two level segregated fit (TLSF) allocator for ranges inside something it doesn't own, like a GPU buffer. It only hands out offsets, in
+    //whatever unit the caller counts in (vertices, indices, bytes). Allocating and freeing are O(1): free holes sit in one list per size class,
+    //a pair of bitmaps finds the first non empty class big enough, and freed ranges merge with free neighbours right away.
+    struct range_allocator
+    {
+        uint32_t capacity = 0;
+
+        //Every block, live or free, by index. Indices of merged away blocks are reused.
+        std::vector<range_block> blocks;
+        std::vector<uint32_t> unused;
+        uint32_t first = RANGE_NONE;        //Block at offset 0
+
+        uint32_t fl_bitmap = 0;
+        uint32_t sl_bitmap[RANGE_FL_COUNT] = {};
+        uint32_t heads[RANGE_FL_COUNT][RANGE_SL_COUNT];
+
+        uint32_t used = 0;
+        uint32_t allocation_count = 0;
+        uint32_t free_block_count = 0;
+    };
+
+    struct range_stats
+    {
+        uint32_t capacity;
+        uint32_t used;
+        uint32_t allocations;
+        uint32_t free_blocks;
+        uint32_t largest_free;
+
+        //1 - largest_free / free units: 0 when the free space is one hole, close to 1 when it's crumbs no big allocation fits in
+        float fragmentation;
+    };
+
+    //One contiguous copy a defragmentation needs: units [from, from + size) move to [to, to + size). Apply them in order, a move's source may
+    //overlap its own destination but not an earlier move's.
+    struct range_move
+    {
+        uint32_t from;
+        uint32_t to;
+        uint32_t size;
+    };
+
+    void range_allocator_init(range_allocator& ra, uint32_t capacity);
+
+    //@return RANGE_NONE if no free hole is big enough
+    range_handle range_alloc(range_allocator& ra, uint32_t size);
+    void range_free(range_allocator& ra, range_handle handle);
+
+    inline uint32_t range_offset(const range_allocator& ra, range_handle handle) { return ra.blocks[handle].offset; }
+    inline uint32_t range_size(const range_allocator& ra, range_handle handle) { return ra.blocks[handle].size; }
+
+    //Adds units at the end, the caller has made the space behind them real (e.g. grown the buffer)
+    void range_grow(range_allocator& ra, uint32_t capacity);
+
+    //Slides allocations down over the holes in front of them, lowest first, until max_units have moved (0 = no limit, and the first
+    //allocation moves even if it's bigger). Handles keep pointing at their allocations, only the offsets change.
+    //@param moves filled with the copies to make, neighbouring allocations that move together are merged into one
+    //@param scratch holds the allocations in offset order during the call, kept by the caller so defragmenting every frame doesn't allocate
+    //@return units moved
+    uint32_t range_defragment(range_allocator& ra, std::vector<range_move>& moves, std::vector<uint32_t>& scratch, uint32_t max_units = 0);
+
+    range_stats range_allocator_stats(const range_allocator& ra);
+}
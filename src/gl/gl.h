@@ -0,0 +1,8 @@
+#pragma once
+
+//Single place that decides where the GL declarations come from
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include <glad/glad.h>
+#endif
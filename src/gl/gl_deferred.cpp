@@ -0,0 +1,366 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Deferred shading for the GL backend.
+
+
+    G-buffer -
+        A single GL_R32UI target holds the same packed texel the CPU path writes (octahedral view space normal in 12 + 12 bits, material index in
+        the top 8) next to a depth texture. The geometry pass takes the normal from the screen space derivatives of the view space position, so any
+        vertex layout works as long as the position is at location 0 (that gives faceted normals, like draw_mesh on the CPU).
+
+
+    Tiles -
+        GL 4.1 has no compute shaders, so the tile lists are built on the CPU with bin_lights and uploaded into a texture buffer every frame. Without
+        reading the depth buffer back, the lists only use the lights' screen rectangles (no per tile depth range like the CPU path); the radius test
+        in the light loop throws out the rest. The lighting pass is one full screen triangle, every pixel walks its own tile's list.
+
+        Texture buffers only have to be 64K texels on 4.1 drivers by the spec, real drivers allow hundreds of millions.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "gl_deferred.h"
+#include <iostream>
+
+namespace br
+{
+    static const char* GEOMETRY_VERTEX_SOURCE = "#version 410 core\n"
+    "layout(location = 0) in vec3 a_pos;\n"
+    "uniform mat4 model;\n"
+    "uniform mat4 view;\n"
+    "uniform mat4 projection;\n"
+    "out vec3 view_position;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 p = view * model * vec4(a_pos, 1.0);\n"
+    "    view_position = p.xyz;\n"
+    "    gl_Position = projection * p;\n"
+    "}\n";
+
+    static const char* GEOMETRY_FRAGMENT_SOURCE = "#version 410 core\n"
+    "in vec3 view_position;\n"
+    "uniform uint material;\n"
+    "layout(location = 0) out uint texel;\n"
+    "vec2 oct_encode(vec3 n)\n"
+    "{\n"
+    "    n /= abs(n.x) + abs(n.y) + abs(n.z);\n"
+    "    vec2 e = n.xy;\n"
+    "    if(n.z < 0.0)\n"
+    "        e = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);\n"
+    "    return e;\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "    vec3 n = normalize(cross(dFdx(view_position), dFdy(view_position)));\n"
+    "    uvec2 q = uvec2((oct_encode(n) + 1.0) * 2047.5 + 0.5);\n"
+    "    texel = q.x | (q.y << 12) | (material << 24);\n"
+    "}\n";
+
+    static const char* LIGHTING_VERTEX_SOURCE = "#version 410 core\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+    static const char* LIGHTING_FRAGMENT_SOURCE = "#version 410 core\n"
+    "uniform usampler2D gbuffer;\n"
+    "uniform sampler2D depth_buffer;\n"
+    "uniform samplerBuffer lights;\n"
+    "uniform samplerBuffer materials;\n"
+    "uniform usamplerBuffer tiles;\n"
+    "uniform mat4 inverse_projection;\n"
+    "uniform int light_count;\n"
+    "uniform int material_count;\n"
+    "uniform bool tiled;\n"
+    "uniform int tile_size;\n"
+    "uniform int tiles_x;\n"
+    "uniform int tile_count;\n"
+    "uniform float ambient;\n"
+    "uniform vec3 background;\n"
+    "out vec4 color;\n"
+    "vec3 oct_decode(vec2 e)\n"
+    "{\n"
+    "    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+    "    float t = max(-n.z, 0.0);\n"
+    "    n.x += n.x >= 0.0 ? -t : t;\n"
+    "    n.y += n.y >= 0.0 ? -t : t;\n"
+    "    return normalize(n);\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "    ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+    "    ivec2 size = textureSize(depth_buffer, 0);\n"
+    "    float depth = texelFetch(depth_buffer, pixel, 0).r;\n"
+    "    if(depth >= 1.0)\n"
+    "    {\n"
+    "        color = vec4(background, 1.0);\n"
+    "        return;\n"
+    "    }\n"
+    "    uint texel = texelFetch(gbuffer, pixel, 0).r;\n"
+    "    vec3 n = oct_decode(vec2(texel & 0xFFFu, (texel >> 12) & 0xFFFu) * (2.0 / 4095.0) - 1.0);\n"
+    "    int material = int(texel >> 24);\n"
+    "    vec3 albedo = texelFetch(materials, material < material_count ? material : 0).rgb;\n"
+    "    vec4 view = inverse_projection * vec4((gl_FragCoord.xy / vec2(size)) * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);\n"
+    "    vec3 p = view.xyz / view.w;\n"
+    "    int begin = 0;\n"
+    "    int end = light_count;\n"
+    "    if(tiled)\n"
+    "    {\n"
+    "        int tile = ((size.y - 1 - pixel.y) / tile_size) * tiles_x + (pixel.x / tile_size);\n"
+    "        begin = int(texelFetch(tiles, tile).r);\n"
+    "        end = int(texelFetch(tiles, tile + 1).r);\n"
+    "    }\n"
+    "    vec3 light = vec3(ambient);\n"
+    "    for(int i = begin; i < end; i++)\n"
+    "    {\n"
+    "        int l = tiled ? int(texelFetch(tiles, tile_count + 1 + i).r) : i;\n"
+    "        vec4 sphere = texelFetch(lights, l * 2);\n"
+    "        vec3 to_light = sphere.xyz - p;\n"
+    "        float d2 = dot(to_light, to_light);\n"
+    "        float r2 = sphere.w * sphere.w;\n"
+    "        if(d2 >= r2)\n"
+    "            continue;\n"
+    "        float falloff = 1.0 - d2 / r2;\n"
+    "        float n_dot_l = max(dot(n, to_light) * inversesqrt(max(d2, 1e-12)), 0.0);\n"
+    "        light += texelFetch(lights, l * 2 + 1).rgb * (n_dot_l * falloff * falloff);\n"
+    "    }\n"
+    "    color = vec4(albedo * light, 1.0);\n"
+    "}\n";
+
+    //Texture units of the lighting program
+    enum lighting_unit
+    {
+        UNIT_GBUFFER,
+        UNIT_DEPTH,
+        UNIT_LIGHTS,
+        UNIT_MATERIALS,
+        UNIT_TILES
+    };
+
+    static void create_texture_buffer(GLuint& buffer, GLuint& texture, GLenum format)
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    //Orphans the buffer and fills it (the previous frame's draw may still be reading the old storage)
+    static void upload_texture_buffer(GLuint buffer, const void* data, size_t size)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, size > 0 ? size : 16, nullptr, GL_STREAM_DRAW);
+        if(size > 0)
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    static void set_target_sampling()
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    //Creates the G-buffer targets and compiles both programs. Needs a current context.
+    //@param programs optional, the programs are loaded through it (and belong to it) instead of compiled here
+    //@return false if a shader didn't compile or the framebuffer is incomplete (details go to stderr)
+    bool gl_deferred_init(gl_deferred& d, uint32_t width, uint32_t height, gl_program_cache* programs)
+    {
+        d.programs = programs;
+
+        d.width = width;
+        d.height = height;
+
+        glGenTextures(1, &d.gbuffer);
+        glBindTexture(GL_TEXTURE_2D, d.gbuffer);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        set_target_sampling();
+
+        glGenTextures(1, &d.depth);
+        glBindTexture(GL_TEXTURE_2D, d.depth);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        set_target_sampling();
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &d.framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, d.framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, d.gbuffer, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, d.depth, 0);
+
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if(!complete)
+        {
+            std::cerr << "Deferred G-buffer framebuffer is incomplete" << std::endl;
+            return false;
+        }
+
+        create_texture_buffer(d.light_buffer, d.light_texture, GL_RGBA32F);
+        create_texture_buffer(d.material_buffer, d.material_texture, GL_RGBA32F);
+        create_texture_buffer(d.tile_buffer, d.tile_texture, GL_R32UI);
+
+        glGenVertexArrays(1, &d.empty_vao);
+
+        if(programs)
+        {
+            gl_program_handle geometry = gl_request_program(*programs, GEOMETRY_VERTEX_SOURCE, GEOMETRY_FRAGMENT_SOURCE);
+            gl_program_handle lighting = gl_request_program(*programs, LIGHTING_VERTEX_SOURCE, LIGHTING_FRAGMENT_SOURCE);
+            d.geometry_program = gl_program_wait(*programs, geometry);
+            d.lighting_program = gl_program_wait(*programs, lighting);
+        }
+        else
+        {
+            d.geometry_program = gl_link_program(GEOMETRY_VERTEX_SOURCE, GEOMETRY_FRAGMENT_SOURCE);
+            d.lighting_program = gl_link_program(LIGHTING_VERTEX_SOURCE, LIGHTING_FRAGMENT_SOURCE);
+        }
+        if(d.geometry_program == 0 || d.lighting_program == 0)
+            return false;
+
+        d.model_location = glGetUniformLocation(d.geometry_program, "model");
+        d.material_location = glGetUniformLocation(d.geometry_program, "material");
+
+        glUseProgram(d.lighting_program);
+        glUniform1i(glGetUniformLocation(d.lighting_program, "gbuffer"), UNIT_GBUFFER);
+        glUniform1i(glGetUniformLocation(d.lighting_program, "depth_buffer"), UNIT_DEPTH);
+        glUniform1i(glGetUniformLocation(d.lighting_program, "lights"), UNIT_LIGHTS);
+        glUniform1i(glGetUniformLocation(d.lighting_program, "materials"), UNIT_MATERIALS);
+        glUniform1i(glGetUniformLocation(d.lighting_program, "tiles"), UNIT_TILES);
+        glUseProgram(0);
+
+        return true;
+    }
+
+    void gl_deferred_shutdown(gl_deferred& d)
+    {
+        GLuint textures[] = { d.gbuffer, d.depth, d.light_texture, d.material_texture, d.tile_texture };
+        GLuint buffers[] = { d.light_buffer, d.material_buffer, d.tile_buffer };
+
+        glDeleteTextures(5, textures);
+        glDeleteBuffers(3, buffers);
+        glDeleteFramebuffers(1, &d.framebuffer);
+        glDeleteVertexArrays(1, &d.empty_vao);
+
+        if(!d.programs)
+        {
+            glDeleteProgram(d.geometry_program);
+            glDeleteProgram(d.lighting_program);
+        }
+
+        d = gl_deferred();
+    }
+
+    //Binds the G-buffer, clears it and sets up the geometry program. Draw the scene afterwards with position at attribute location 0, calling
+    //gl_deferred_set_object before each object.
+    void gl_deferred_begin_geometry(gl_deferred& d, const lnal::mat4& view, const lnal::mat4& projection)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, d.framebuffer);
+        glViewport(0, 0, d.width, d.height);
+        glEnable(GL_DEPTH_TEST);
+
+        GLuint clear_texel[4] = { 0, 0, 0, 0 };
+        glClearBufferuiv(GL_COLOR, 0, clear_texel);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        glUseProgram(d.geometry_program);
+        glUniformMatrix4fv(glGetUniformLocation(d.geometry_program, "view"), 1, GL_FALSE, view.data());
+        glUniformMatrix4fv(glGetUniformLocation(d.geometry_program, "projection"), 1, GL_FALSE, projection.data());
+    }
+
+    void gl_deferred_set_object(gl_deferred& d, const lnal::mat4& model, uint32_t material)
+    {
+        glUniformMatrix4fv(d.model_location, 1, GL_FALSE, model.data());
+        glUniform1ui(d.material_location, material);
+    }
+
+    //Lights the G-buffer into the default framebuffer with a full screen pass. Leaves depth testing off.
+    //@param lighting same description as the CPU path. The lights are binned into tiles here when lighting.tiled is set.
+    //@param tiles light lists, kept by the caller so they don't reallocate
+    void gl_deferred_light(gl_deferred& d, const deferred_lighting& lighting, light_tiles& tiles)
+    {
+        //Lights as (position, radius), (color, 0)
+        d.light_data.resize((size_t)lighting.light_count * 8);
+        for(uint32_t i = 0; i < lighting.light_count; i++)
+        {
+            const point_light& l = lighting.lights[i];
+            float* out = &d.light_data[(size_t)i * 8];
+            out[0] = l.position[0];
+            out[1] = l.position[1];
+            out[2] = l.position[2];
+            out[3] = l.radius;
+            out[4] = l.color[0];
+            out[5] = l.color[1];
+            out[6] = l.color[2];
+            out[7] = 0.0f;
+        }
+        upload_texture_buffer(d.light_buffer, d.light_data.data(), d.light_data.size() * sizeof(float));
+
+        //Albedo padded to RGBA
+        d.material_data.resize((size_t)lighting.material_count * 4);
+        for(uint32_t m = 0; m < lighting.material_count; m++)
+        {
+            float* out = &d.material_data[(size_t)m * 4];
+            const float* a = &lighting.albedo[m * lighting.albedo_stride];
+            out[0] = a[0];
+            out[1] = a[1];
+            out[2] = a[2];
+            out[3] = 1.0f;
+        }
+        upload_texture_buffer(d.material_buffer, d.material_data.data(), d.material_data.size() * sizeof(float));
+
+        tiles.tile_size = DEFERRED_TILE_SIZE;
+        if(lighting.tiled)
+        {
+            bin_lights(tiles, lighting.lights, lighting.light_count, lighting.projection, d.width, d.height);
+
+            d.tile_data.assign(tiles.offsets.begin(), tiles.offsets.end());
+            d.tile_data.insert(d.tile_data.end(), tiles.indices.begin(), tiles.indices.end());
+            upload_texture_buffer(d.tile_buffer, d.tile_data.data(), d.tile_data.size() * sizeof(uint32_t));
+        }
+
+        lnal::mat4 projection = lighting.projection;
+        lnal::mat4 inverse_projection = projection.inverse();
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, d.width, d.height);
+        glDisable(GL_DEPTH_TEST);
+
+        glActiveTexture(GL_TEXTURE0 + UNIT_GBUFFER);
+        glBindTexture(GL_TEXTURE_2D, d.gbuffer);
+        glActiveTexture(GL_TEXTURE0 + UNIT_DEPTH);
+        glBindTexture(GL_TEXTURE_2D, d.depth);
+        glActiveTexture(GL_TEXTURE0 + UNIT_LIGHTS);
+        glBindTexture(GL_TEXTURE_BUFFER, d.light_texture);
+        glActiveTexture(GL_TEXTURE0 + UNIT_MATERIALS);
+        glBindTexture(GL_TEXTURE_BUFFER, d.material_texture);
+        glActiveTexture(GL_TEXTURE0 + UNIT_TILES);
+        glBindTexture(GL_TEXTURE_BUFFER, d.tile_texture);
+        glActiveTexture(GL_TEXTURE0);
+
+        GLuint p = d.lighting_program;
+        glUseProgram(p);
+        glUniformMatrix4fv(glGetUniformLocation(p, "inverse_projection"), 1, GL_FALSE, inverse_projection.data());
+        glUniform1i(glGetUniformLocation(p, "light_count"), (GLint)lighting.light_count);
+        glUniform1i(glGetUniformLocation(p, "material_count"), (GLint)lighting.material_count);
+        glUniform1i(glGetUniformLocation(p, "tiled"), lighting.tiled ? 1 : 0);
+        glUniform1i(glGetUniformLocation(p, "tile_size"), (GLint)tiles.tile_size);
+        glUniform1i(glGetUniformLocation(p, "tiles_x"), (GLint)tiles.tiles_x);
+        glUniform1i(glGetUniformLocation(p, "tile_count"), (GLint)(tiles.tiles_x * tiles.tiles_y));
+        glUniform1f(glGetUniformLocation(p, "ambient"), lighting.ambient);
+        glUniform3f(glGetUniformLocation(p, "background"), (lighting.background & 0xFF) / 255.0f, ((lighting.background >> 8) & 0xFF) / 255.0f,
+                    ((lighting.background >> 16) & 0xFF) / 255.0f);
+
+        glBindVertexArray(d.empty_vao);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "gl.h"
+#include "gl_program.h"
+#include "../math/lnal.h"
+#include "../scene/light.h"
+#include "../raster/deferred.h"
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    //GL side of the deferred path. Same G-buffer texel layout, lighting model and tile lists as the CPU one (raster/deferred.h).
+    struct gl_deferred
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        GLuint framebuffer = 0;
+        GLuint gbuffer = 0;             //GL_R32UI packed texels
+        GLuint depth = 0;               //GL_DEPTH_COMPONENT24, read back as the position
+
+        GLuint geometry_program = 0;
+        GLuint lighting_program = 0;
+        gl_program_cache* programs = nullptr;      //Owns the programs if set
+        GLuint empty_vao = 0;           //The full screen triangle comes from gl_VertexID
+
+        //Texture buffers refilled every frame: 2 RGBA32F texels per light, RGBA32F albedo per material, R32UI tile offsets then indices
+        GLuint light_buffer = 0, light_texture = 0;
+        GLuint material_buffer = 0, material_texture = 0;
+        GLuint tile_buffer = 0, tile_texture = 0;
+
+        //Geometry program uniforms set per draw with gl_deferred_set_object
+        GLint model_location = -1;
+        GLint material_location = -1;
+
+        //Upload staging, kept so steady state frames don't allocate
+        std::vector<float> light_data;
+        std::vector<float> material_data;
+        std::vector<uint32_t> tile_data;
+    };
+
+    //Creates the G-buffer targets and compiles both programs. Needs a current context.
+    //@param programs optional, the programs are loaded through it (and belong to it) instead of compiled here
+    //@return false if a shader didn't compile or the framebuffer is incomplete (details go to stderr)
+    bool gl_deferred_init(gl_deferred& d, uint32_t width, uint32_t height, gl_program_cache* programs = nullptr);
+
+    void gl_deferred_shutdown(gl_deferred& d);
+
+    //Binds the G-buffer, clears it and sets up the geometry program. Draw the scene afterwards with position at attribute location 0, calling
+    //gl_deferred_set_object before each object.
+    void gl_deferred_begin_geometry(gl_deferred& d, const lnal::mat4& view, const lnal::mat4& projection);
+
+    void gl_deferred_set_object(gl_deferred& d, const lnal::mat4& model, uint32_t material);
+
+    //Lights the G-buffer into the default framebuffer with a full screen pass. Leaves depth testing off.
+    //@param lighting same description as the CPU path. The lights are binned into tiles here when lighting.tiled is set.
+    //@param tiles light lists, kept by the caller so they don't reallocate
+    void gl_deferred_light(gl_deferred& d, const deferred_lighting& lighting, light_tiles& tiles);
+}
@@ -0,0 +1,143 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Materials on the GPU.
+
+
+    Parameter Table -
+        The library's material_params vector goes into one buffer unchanged, read through an RGBA32UI texture buffer so every 16 byte row is one
+        texelFetch. The float rows come back with uintBitsToFloat, which keeps the bits exact (a float texture buffer would be free to touch the
+        texture slots, 0xFFFFFFFF is a NaN). A texture buffer has no practical size limit, a uniform block would cap the table at 16 KB (256
+        materials) on some drivers.
+
+
+    Texture Arrays -
+        GLSL only lets sampler arrays be indexed with constants, so sample_material picks the array with a chain of ifs. Corners of one triangle
+        can take different branches, where implicit derivatives are undefined, so the uv derivatives are taken before branching and passed to
+        textureGrad.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "gl_material.h"
+#include "gl_texture.h"
+#include <vector>
+
+namespace br
+{
+    //The sampler array size and the if chain have to match MATERIAL_MAX_ARRAYS
+    static_assert(MATERIAL_MAX_ARRAYS == 8, "MATERIAL_GLSL samples a fixed number of arrays");
+
+    const char* MATERIAL_GLSL =
+    "uniform usamplerBuffer material_table;\n"
+    "uniform sampler2DArray material_arrays[8];\n"
+    "\n"
+    "struct material\n"
+    "{\n"
+    "    vec4 diffuse;      //rgb, a = opacity\n"
+    "    vec4 specular;     //rgb, a = shininess\n"
+    "    vec4 emission;\n"
+    "    uvec4 textures;    //diffuse, normal, specular slot, w = illum\n"
+    "};\n"
+    "\n"
+    "material fetch_material(uint id)\n"
+    "{\n"
+    "    int row = int(id) * 4;\n"
+    "    material m;\n"
+    "    m.diffuse = uintBitsToFloat(texelFetch(material_table, row));\n"
+    "    m.specular = uintBitsToFloat(texelFetch(material_table, row + 1));\n"
+    "    m.emission = uintBitsToFloat(texelFetch(material_table, row + 2));\n"
+    "    m.textures = texelFetch(material_table, row + 3);\n"
+    "    return m;\n"
+    "}\n"
+    "\n"
+    "vec4 sample_material(uint slot, vec2 uv)\n"
+    "{\n"
+    "    vec2 dx = dFdx(uv), dy = dFdy(uv);\n"
+    "    if(slot == 0xFFFFFFFFu)\n"
+    "        return vec4(1.0);\n"
+    "\n"
+    "    uint array = slot >> 16;\n"
+    "    vec3 p = vec3(uv, float(slot & 0xFFFFu));\n"
+    "    if(array == 0u) return textureGrad(material_arrays[0], p, dx, dy);\n"
+    "    if(array == 1u) return textureGrad(material_arrays[1], p, dx, dy);\n"
+    "    if(array == 2u) return textureGrad(material_arrays[2], p, dx, dy);\n"
+    "    if(array == 3u) return textureGrad(material_arrays[3], p, dx, dy);\n"
+    "    if(array == 4u) return textureGrad(material_arrays[4], p, dx, dy);\n"
+    "    if(array == 5u) return textureGrad(material_arrays[5], p, dx, dy);\n"
+    "    if(array == 6u) return textureGrad(material_arrays[6], p, dx, dy);\n"
+    "    if(array == 7u) return textureGrad(material_arrays[7], p, dx, dy);\n"
+    "    return vec4(1.0);\n"
+    "}\n";
+
+    //Reuploads only the parameter block, e.g. after editing colors. The library's arrays must not have changed.
+    void gl_materials_update(gl_materials& gm, const material_library& lib)
+    {
+        if(gm.buffer == 0)
+        {
+            glGenBuffers(1, &gm.buffer);
+            glGenTextures(1, &gm.table);
+
+            glBindTexture(GL_TEXTURE_BUFFER, gm.table);
+            glBindBuffer(GL_TEXTURE_BUFFER, gm.buffer);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, gm.buffer);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+        }
+
+        //Never empty, a zero sized buffer store isn't allowed
+        size_t size = material_block_bytes(lib);
+        glBindBuffer(GL_TEXTURE_BUFFER, gm.buffer);
+        glBufferData(GL_TEXTURE_BUFFER, size > 0 ? size : sizeof(material_params), size > 0 ? lib.params.data() : nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        gm.material_count = material_count(lib);
+    }
+
+    //Uploads the parameter block and the library's texture arrays (load_material_textures has to have run for textures to show up).
+    //Uploading again replaces the previous contents. Needs a current context.
+    void gl_materials_upload(gl_materials& gm, const material_library& lib)
+    {
+        glDeleteTextures(gm.array_count, gm.arrays);
+        gm.array_count = 0;
+
+        std::vector<const texture*> layers;
+        for(const material_texture_array& array : lib.arrays)
+        {
+            layers.clear();
+            for(uint32_t t : array.layers)
+            {
+                layers.push_back(&lib.textures[t].image);
+            }
+
+            gm.arrays[gm.array_count++] = gl_upload_texture_array(layers.data(), (uint32_t)layers.size());
+        }
+
+        gl_materials_update(gm, lib);
+    }
+
+    //Binds the table and the arrays to texture units first_unit .. first_unit + MATERIAL_MAX_ARRAYS and points the program's material_table
+    //and material_arrays samplers (MATERIAL_GLSL) at them. The program has to be in use.
+    void gl_materials_bind(const gl_materials& gm, GLuint program, uint32_t first_unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + first_unit);
+        glBindTexture(GL_TEXTURE_BUFFER, gm.table);
+        glUniform1i(glGetUniformLocation(program, "material_table"), (GLint)first_unit);
+
+        GLint units[MATERIAL_MAX_ARRAYS];
+        for(uint32_t a = 0; a < MATERIAL_MAX_ARRAYS; a++)
+        {
+            units[a] = (GLint)(first_unit + 1 + a);
+            glActiveTexture(GL_TEXTURE0 + units[a]);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, a < gm.array_count ? gm.arrays[a] : 0);
+        }
+        glUniform1iv(glGetUniformLocation(program, "material_arrays"), MATERIAL_MAX_ARRAYS, units);
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void gl_materials_release(gl_materials& gm)
+    {
+        glDeleteTextures(gm.array_count, gm.arrays);
+        glDeleteTextures(1, &gm.table);
+        glDeleteBuffers(1, &gm.buffer);
+        gm = gl_materials();
+    }
+}
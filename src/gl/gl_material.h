@@ -0,0 +1,35 @@
+#pragma once
+
+#include "gl.h"
+#include "../scene/material.h"
+
+namespace br
+{
+    //A material library on the GPU: the parameter block as an RGBA32UI texture buffer (4 texels per material) and one texture array per
+    //size class. Everything a mesh with many materials needs for a single draw.
+    struct gl_materials
+    {
+        GLuint buffer = 0;
+        GLuint table = 0;                           //Texture buffer over buffer
+        GLuint arrays[MATERIAL_MAX_ARRAYS] = {};
+        uint32_t array_count = 0;
+        uint32_t material_count = 0;
+    };
+
+    //Uploads the parameter block and the library's texture arrays (load_material_textures has to have run for textures to show up).
+    //Uploading again replaces the previous contents. Needs a current context.
+    void gl_materials_upload(gl_materials& gm, const material_library& lib);
+
+    //Reuploads only the parameter block, e.g. after editing colors. The library's arrays must not have changed.
+    void gl_materials_update(gl_materials& gm, const material_library& lib);
+
+    //Binds the table and the arrays to texture units first_unit .. first_unit + MATERIAL_MAX_ARRAYS and points the program's material_table
+    //and material_arrays samplers (MATERIAL_GLSL) at them. The program has to be in use.
+    void gl_materials_bind(const gl_materials& gm, GLuint program, uint32_t first_unit);
+
+    void gl_materials_release(gl_materials& gm);
+
+    //GLSL declarations for shaders that read materials: the samplers, struct material, material fetch_material(uint id) and
+    //vec4 sample_material(uint slot, vec2 uv) which returns vec4(1.0) for empty slots. Needs #version 330 or later.
+    extern const char* MATERIAL_GLSL;
+}
@@ -0,0 +1,269 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Shared vertex and index buffers for many meshes.
+
+
+    Why -
+        A VBO, EBO and VAO per mesh means a VAO bind (and the driver validating it) per draw, and thousands of small buffer objects each with
+        their own bookkeeping in the driver. A pool keeps every mesh of one vertex layout in a single pair of buffers behind one VAO. Indices are
+        written as they are, relative to their mesh, and glDrawElementsBaseVertex adds the mesh's first vertex, so nothing has to be rewritten
+        when a mesh lands somewhere in the buffer. Meshes drawn together can go into one glMultiDrawElementsBaseVertex.
+
+
+    Ranges -
+        range_allocator (TLSF) hands out the vertex and index ranges. Vertex ranges are counted in whole vertices, which is what basevertex
+        wants, index ranges in indices. When no free range fits, the buffers are reallocated at twice the size and the old contents copied
+        over on the GPU with glCopyBufferSubData, and the VAO is pointed at the new buffers.
+
+
+    Defragmenting -
+        Streaming meshes in and out leaves holes. gl_mesh_pool_defragment slides meshes down over them with at most max_bytes of copies per
+        call, so it can run a little every frame. Each copy goes through a scratch buffer, a buffer can't be copied onto an overlapping part of
+        itself, and everything stays on the GPU.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "gl_mesh_pool.h"
+#include <algorithm>
+#include <vector>
+
+namespace br
+{
+    //Points the vertex attributes of the bound VAO at the interleaved buffer bound to GL_ARRAY_BUFFER
+    //Locations: 0 = position, 1 = normal, 2 = uv, 3 = tangent (xyz + bitangent sign), 4 = material id (uint, fetch_material in MATERIAL_GLSL)
+    void gl_bind_vertex_layout(const vertex_layout& layout)
+    {
+        if(layout.format & VERTEX_POSITION_UNORM16)
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, layout.stride, (void*)(size_t)layout.position_offset);
+        else
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.position_offset);
+        glEnableVertexAttribArray(0);
+
+        if(layout.normal_offset >= 0)
+        {
+            if(layout.format & VERTEX_NORMAL_OCT16)
+                glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, layout.stride, (void*)(size_t)layout.normal_offset);
+            else
+                glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.normal_offset);
+            glEnableVertexAttribArray(1);
+        }
+
+        if(layout.uv_offset >= 0)
+        {
+            if(layout.format & VERTEX_UV_HALF)
+                glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.uv_offset);
+            else
+                glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.uv_offset);
+            glEnableVertexAttribArray(2);
+        }
+
+        if(layout.tangent_offset >= 0)
+        {
+            if(layout.format & VERTEX_TANGENT_SNORM8)
+                glVertexAttribPointer(3, 4, GL_BYTE, GL_TRUE, layout.stride, (void*)(size_t)layout.tangent_offset);
+            else
+                glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.tangent_offset);
+            glEnableVertexAttribArray(3);
+        }
+
+        if(layout.material_offset >= 0)
+        {
+            glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, layout.stride, (void*)(size_t)layout.material_offset);
+            glEnableVertexAttribArray(4);
+        }
+    }
+
+    //Points the VAO at the pool's current buffers
+    static void attach_buffers(gl_mesh_pool& pool)
+    {
+        glBindVertexArray(pool.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, pool.vertex_buffer);
+        gl_bind_vertex_layout(pool.layout);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.index_buffer);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    //Replaces buffer with a bigger one holding the same first old_bytes. The copy targets leave the VAO's element binding alone.
+    static void grow_buffer(GLuint& buffer, uint64_t old_bytes, uint64_t new_bytes)
+    {
+        GLuint grown;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)new_bytes, nullptr, GL_STATIC_DRAW);
+
+        if(old_bytes)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)old_bytes);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+        buffer = grown;
+    }
+
+    //Allocates count units, doubling the allocator (and its buffer) until they fit
+    //@return RANGE_NONE past 2^32 units
+    static range_handle alloc_growing(gl_mesh_pool& pool, range_allocator& ra, GLuint& buffer, uint32_t unit_bytes, uint32_t count)
+    {
+        range_handle h = range_alloc(ra, count);
+        if(h != RANGE_NONE)
+            return h;
+
+        //Growing extends the free block at the end, so count more units always make room
+        uint64_t capacity = std::max((uint64_t)ra.capacity * 2, (uint64_t)ra.capacity + count);
+        if(capacity > 0xFFFFFFFFull)
+            capacity = (uint64_t)ra.capacity + count;
+        if(capacity > 0xFFFFFFFFull)
+            return RANGE_NONE;
+
+        grow_buffer(buffer, (uint64_t)ra.capacity * unit_bytes, capacity * unit_bytes);
+        range_grow(ra, (uint32_t)capacity);
+        attach_buffers(pool);
+        pool.grows++;
+
+        return range_alloc(ra, count);
+    }
+
+    //Copies moves of unit_bytes sized units inside buffer through the scratch buffer
+    static void apply_moves(gl_mesh_pool& pool, GLuint buffer, const std::vector<range_move>& moves, uint32_t unit_bytes)
+    {
+        for(const range_move& move : moves)
+        {
+            uint64_t bytes = (uint64_t)move.size * unit_bytes;
+            if(bytes > pool.scratch_bytes)
+            {
+                if(pool.scratch == 0)
+                    glGenBuffers(1, &pool.scratch);
+
+                pool.scratch_bytes = bytes;
+                glBindBuffer(GL_COPY_WRITE_BUFFER, pool.scratch);
+                glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)bytes, nullptr, GL_STREAM_COPY);
+            }
+
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, pool.scratch);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)move.from * unit_bytes, 0, (GLsizeiptr)bytes);
+
+            glBindBuffer(GL_COPY_READ_BUFFER, pool.scratch);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, (GLintptr)move.to * unit_bytes, (GLsizeiptr)bytes);
+        }
+
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    //Creates the VAO and both buffers. Needs a current context.
+    //@param vertex_capacity, index_capacity starting sizes, the pool grows past them
+    void gl_mesh_pool_init(gl_mesh_pool& pool, const vertex_layout& layout, uint32_t vertex_capacity, uint32_t index_capacity)
+    {
+        pool.layout = layout;
+        range_allocator_init(pool.vertices, vertex_capacity);
+        range_allocator_init(pool.indices, index_capacity);
+
+        glGenVertexArrays(1, &pool.vao);
+        glGenBuffers(1, &pool.vertex_buffer);
+        glGenBuffers(1, &pool.index_buffer);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.vertex_buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)((uint64_t)vertex_capacity * layout.stride), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.index_buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)(sizeof(uint32_t) * (uint64_t)index_capacity), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        attach_buffers(pool);
+    }
+
+    void gl_mesh_pool_release(gl_mesh_pool& pool)
+    {
+        glDeleteVertexArrays(1, &pool.vao);
+        glDeleteBuffers(1, &pool.vertex_buffer);
+        glDeleteBuffers(1, &pool.index_buffer);
+        if(pool.scratch)
+            glDeleteBuffers(1, &pool.scratch);
+
+        pool = gl_mesh_pool();
+    }
+
+    //Copies a mesh into the pool, growing the buffers if no free range is big enough
+    //@param vertex_data vertex_count vertices in the pool's layout
+    //@return false if the pool can't hold that many vertices or indices at all
+    bool gl_mesh_pool_add(gl_mesh_pool& pool, gl_pool_mesh& mesh, const void* vertex_data, uint32_t vertex_count, const uint32_t* index_data,
+                          uint32_t index_count)
+    {
+        mesh = gl_pool_mesh();
+        if(vertex_count == 0 || index_count == 0)
+            return false;
+
+        mesh.vertices = alloc_growing(pool, pool.vertices, pool.vertex_buffer, pool.layout.stride, vertex_count);
+        mesh.indices = mesh.vertices != RANGE_NONE ? alloc_growing(pool, pool.indices, pool.index_buffer, sizeof(uint32_t), index_count) : RANGE_NONE;
+        if(mesh.indices == RANGE_NONE)
+        {
+            gl_mesh_pool_remove(pool, mesh);
+            return false;
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.vertex_buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)range_offset(pool.vertices, mesh.vertices) * pool.layout.stride,
+                        (GLsizeiptr)((uint64_t)vertex_count * pool.layout.stride), vertex_data);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.index_buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(sizeof(uint32_t) * (uint64_t)range_offset(pool.indices, mesh.indices)),
+                        (GLsizeiptr)(sizeof(uint32_t) * (uint64_t)index_count), index_data);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return true;
+    }
+
+    //Frees the mesh's ranges, the data stays in the buffers until something else is put there
+    void gl_mesh_pool_remove(gl_mesh_pool& pool, gl_pool_mesh& mesh)
+    {
+        range_free(pool.vertices, mesh.vertices);
+        range_free(pool.indices, mesh.indices);
+        mesh = gl_pool_mesh();
+    }
+
+    //Compacts the buffers on the GPU by sliding meshes over the holes in front of them, vertices first, moving about max_bytes in total
+    //(0 = until there are no holes left, a single mesh bigger than the budget still moves). Meshes keep their handles, their base vertex and
+    //index offset change.
+    //@return bytes moved
+    uint64_t gl_mesh_pool_defragment(gl_mesh_pool& pool, uint64_t max_bytes)
+    {
+        std::vector<range_move>& moves = pool.moves;
+
+        uint32_t stride = pool.layout.stride;
+        uint64_t vertex_budget = max_bytes ? std::min(max_bytes / stride, (uint64_t)0xFFFFFFFF) : 0;
+        if(max_bytes && vertex_budget == 0)
+            return 0;
+
+        uint64_t moved = (uint64_t)range_defragment(pool.vertices, moves, pool.defragment_scratch, (uint32_t)vertex_budget) * stride;
+        apply_moves(pool, pool.vertex_buffer, moves, stride);
+
+        //The vertices can overshoot by one mesh, then the indices wait for the next call
+        uint64_t index_budget = max_bytes && moved < max_bytes ? std::min((max_bytes - moved) / sizeof(uint32_t), (uint64_t)0xFFFFFFFF) : 0;
+        if(!max_bytes || index_budget > 0)
+        {
+            moved += (uint64_t)range_defragment(pool.indices, moves, pool.defragment_scratch, (uint32_t)index_budget) * sizeof(uint32_t);
+            apply_moves(pool, pool.index_buffer, moves, sizeof(uint32_t));
+        }
+
+        pool.bytes_moved += moved;
+        return moved;
+    }
+
+    gl_mesh_pool_stats gl_mesh_pool_get_stats(const gl_mesh_pool& pool)
+    {
+        gl_mesh_pool_stats stats;
+        stats.vertices = range_allocator_stats(pool.vertices);
+        stats.indices = range_allocator_stats(pool.indices);
+        stats.bytes_used = ((uint64_t)stats.vertices.used * pool.layout.stride) + (sizeof(uint32_t) * (uint64_t)stats.indices.used);
+        stats.bytes_capacity = ((uint64_t)stats.vertices.capacity * pool.layout.stride) + (sizeof(uint32_t) * (uint64_t)stats.indices.capacity);
+        stats.grows = pool.grows;
+        stats.bytes_moved = pool.bytes_moved;
+        return stats;
+    }
+}
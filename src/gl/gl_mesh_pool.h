@@ -0,0 +1,89 @@
+#pragma once
+
+#include "gl.h"
+#include <cstddef>
+#include "../core/range_allocator.h"
+#include "../mesh/vertex_format.h"
+
+namespace br
+{
+    //Points the vertex attributes of the bound VAO at the interleaved buffer bound to GL_ARRAY_BUFFER
+    //Locations: 0 = position, 1 = normal, 2 = uv, 3 = tangent (xyz + bitangent sign), 4 = material id (uint, fetch_material in MATERIAL_GLSL)
+    void gl_bind_vertex_layout(const vertex_layout& layout);
+
+    //Many meshes of one vertex layout packed into a shared vertex buffer and index buffer behind one VAO. Indices stay relative to their own
+    //mesh and draws add the mesh's first vertex back with glDrawElementsBaseVertex, so a whole pool draws without a buffer or VAO change. The
+    //ranges come from range_allocators counting vertices and indices, the buffers double when they're full.
+    struct gl_mesh_pool
+    {
+        vertex_layout layout;
+        GLuint vao = 0;
+        GLuint vertex_buffer = 0;
+        GLuint index_buffer = 0;            //32 bit indices
+
+        //Staging for defragmentation, a buffer can't be copied onto an overlapping part of itself
+        GLuint scratch = 0;
+        uint64_t scratch_bytes = 0;
+
+        range_allocator vertices;           //In vertices of layout.stride bytes
+        range_allocator indices;            //In indices
+
+        //gl_mesh_pool_defragment's copy list and range_defragment scratch, kept so defragmenting every frame doesn't allocate
+        std::vector<range_move> moves;
+        std::vector<uint32_t> defragment_scratch;
+
+        uint32_t grows = 0;
+        uint64_t bytes_moved = 0;           //By defragmentation, over the pool's lifetime
+    };
+
+    //A mesh's ranges in a pool
+    struct gl_pool_mesh
+    {
+        range_handle vertices = RANGE_NONE;
+        range_handle indices = RANGE_NONE;
+    };
+
+    struct gl_mesh_pool_stats
+    {
+        range_stats vertices;               //In vertices
+        range_stats indices;                //In indices
+        uint64_t bytes_used;                //Both buffers
+        uint64_t bytes_capacity;
+        uint32_t grows;
+        uint64_t bytes_moved;
+    };
+
+    //Creates the VAO and both buffers. Needs a current context.
+    //@param vertex_capacity, index_capacity starting sizes, the pool grows past them
+    void gl_mesh_pool_init(gl_mesh_pool& pool, const vertex_layout& layout, uint32_t vertex_capacity, uint32_t index_capacity);
+    void gl_mesh_pool_release(gl_mesh_pool& pool);
+
+    //Copies a mesh into the pool, growing the buffers if no free range is big enough
+    //@param vertex_data vertex_count vertices in the pool's layout
+    //@return false if the pool can't hold that many vertices or indices at all
+    bool gl_mesh_pool_add(gl_mesh_pool& pool, gl_pool_mesh& mesh, const void* vertex_data, uint32_t vertex_count, const uint32_t* index_data,
+                          uint32_t index_count);
+
+    //Frees the mesh's ranges, the data stays in the buffers until something else is put there
+    void gl_mesh_pool_remove(gl_mesh_pool& pool, gl_pool_mesh& mesh);
+
+    //basevertex for the mesh's draws
+    inline GLint gl_pool_base_vertex(const gl_mesh_pool& pool, const gl_pool_mesh& mesh)
+    {
+        return (GLint)range_offset(pool.vertices, mesh.vertices);
+    }
+
+    //indices pointer for a draw starting at the mesh's index first
+    inline const void* gl_pool_index_offset(const gl_mesh_pool& pool, const gl_pool_mesh& mesh, uint32_t first = 0)
+    {
+        return (const void*)(sizeof(uint32_t) * ((size_t)range_offset(pool.indices, mesh.indices) + first));
+    }
+
+    //Compacts the buffers on the GPU by sliding meshes over the holes in front of them, vertices first, moving about max_bytes in total
+    //(0 = until there are no holes left, a single mesh bigger than the budget still moves). Meshes keep their handles, their base vertex and
+    //index offset change.
+    //@return bytes moved
+    uint64_t gl_mesh_pool_defragment(gl_mesh_pool& pool, uint64_t max_bytes = 0);
+
+    gl_mesh_pool_stats gl_mesh_pool_get_stats(const gl_mesh_pool& pool);
+}
@@ -0,0 +1,448 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                GL program cache.
+
+
+    Binaries -
+        Compiling and linking GLSL is by far the slowest thing a GL renderer does at startup, and with a few hundred programs it takes seconds.
+        A linked program can be read back with glGetProgramBinary and handed to glProgramBinary on the next run, which skips the compiler. The
+        binary only works with the exact driver that produced it, so cache entries are keyed by a hash of both sources and stored under the
+        driver's vendor, renderer and version strings (the variant in the asset cache). A driver can still refuse a binary (an update that
+        didn't change its version string); that shows up as a failed link status after glProgramBinary, and the program is compiled from source
+        and stored again.
+
+
+    Queue -
+        gl_request_program returns right away. The entry is read and checksummed on a worker, then each gl_program_cache_update on the main
+        thread turns finished reads into programs (glProgramBinary is fast) and moves misses to the compile queue.
+
+        GL calls have to stay on the thread that owns the context, so compiles can't simply run on a worker. Drivers with
+        KHR_parallel_shader_compile compile on their own threads as long as nobody asks for the result: up to max_compiles_in_flight programs
+        are handed over at once and only checked through GL_COMPLETION_STATUS_KHR, which never blocks. Without the extension, asking for the
+        link status waits for the compiler, so compiles are started and finished one at a time until the update's time budget is used up.
+
+        Finished binaries are written back to the cache on a worker.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "gl_program.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+//KHR_parallel_shader_compile isn't in the core 4.1 loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace br
+{
+    static double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    static std::string gl_string(GLenum name)
+    {
+        const GLubyte* s = glGetString(name);
+        return s ? (const char*)s : "";
+    }
+
+    static bool has_extension(const char* name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+        for(GLint i = 0; i < count; i++)
+        {
+            const GLubyte* e = glGetStringi(GL_EXTENSIONS, (GLuint)i);
+            if(e && strcmp((const char*)e, name) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    //Queries the driver. Needs a current context.
+    void gl_program_cache_init(gl_program_cache& c, job_system* js)
+    {
+        c.js = js;
+        c.driver = gl_string(GL_VENDOR) + " | " + gl_string(GL_RENDERER) + " | " + gl_string(GL_VERSION);
+
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        c.binaries = formats > 0;
+
+        c.parallel_compile = has_extension("GL_KHR_parallel_shader_compile") || has_extension("GL_ARB_parallel_shader_compile");
+    }
+
+    //Waits for cache writes and deletes every program
+    void gl_program_cache_shutdown(gl_program_cache& c)
+    {
+        if(c.js)
+            job_wait(*c.js, c.io);
+
+        for(const std::unique_ptr<gl_program>& p : c.programs)
+        {
+            glDeleteShader(p->shaders[0]);
+            glDeleteShader(p->shaders[1]);
+            glDeleteProgram(p->program);
+        }
+
+        c.programs.clear();
+        c.by_key.clear();
+        c.loaded.clear();
+        c.compile_queue.clear();
+        c.compiling.clear();
+    }
+
+    static GLuint compile_shader(GLenum type, const char* source)
+    {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        return shader;
+    }
+
+    //@return false (and prints the log) if the shader didn't compile
+    static bool check_shader(GLuint shader)
+    {
+        GLint success = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if(success)
+            return true;
+
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        std::cerr << "Shader compile failed: " << log << std::endl;
+        return false;
+    }
+
+    static bool check_program(GLuint program)
+    {
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if(success)
+            return true;
+
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        std::cerr << "Program link failed: " << log << std::endl;
+        return false;
+    }
+
+    //Compiles and links right away, without a cache. Errors go to stderr.
+    //@return the program, 0 if it didn't compile or link
+    GLuint gl_link_program(const char* vertex_source, const char* fragment_source)
+    {
+        GLuint vs = compile_shader(GL_VERTEX_SHADER, vertex_source);
+        GLuint fs = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+
+        bool vs_ok = check_shader(vs);
+        bool fs_ok = check_shader(fs);
+        if(!vs_ok || !fs_ok)
+        {
+            glDeleteShader(vs);
+            glDeleteShader(fs);
+            return 0;
+        }
+
+        GLuint program = glCreateProgram();
+        glAttachShader(program, vs);
+        glAttachShader(program, fs);
+        glLinkProgram(program);
+
+        glDetachShader(program, vs);
+        glDetachShader(program, fs);
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+
+        if(!check_program(program))
+        {
+            glDeleteProgram(program);
+            return 0;
+        }
+
+        return program;
+    }
+
+    //Runs on a worker. Only touches the program it was given.
+    static void read_entry(const gl_program_cache& c, gl_program& p)
+    {
+        if(c.binaries && cache_load_key(c.disk, p.key, c.driver, p.cached) && p.cached.size() > sizeof(uint32_t))
+            return;
+
+        p.cached.clear();
+    }
+
+    //Starts loading a program in the background. Requesting the same sources again returns the same handle.
+    gl_program_handle gl_request_program(gl_program_cache& c, const char* vertex_source, const char* fragment_source)
+    {
+        uint64_t h = hash_bytes(vertex_source, strlen(vertex_source));
+        h = hash_bytes("\0", 1, h);
+        h = hash_bytes(fragment_source, strlen(fragment_source), h);
+
+        char key[32];
+        snprintf(key, sizeof(key), "program %016llx", (unsigned long long)h);
+
+        auto found = c.by_key.find(key);
+        if(found != c.by_key.end())
+            return found->second;
+
+        std::unique_ptr<gl_program> program(new gl_program());
+        program->vertex_source = vertex_source;
+        program->fragment_source = fragment_source;
+        program->key = key;
+
+        gl_program* p = program.get();
+        gl_program_handle handle = (gl_program_handle)c.programs.size();
+        c.programs.push_back(std::move(program));
+        c.by_key.emplace(key, handle);
+
+        auto job = [&c, p, handle]()
+        {
+            read_entry(c, *p);
+
+            std::lock_guard<std::mutex> guard(c.lock);
+            c.loaded.push_back(handle);
+        };
+
+        if(c.js)
+            job_submit(*c.js, job, &c.io);
+        else
+            job();
+
+        return handle;
+    }
+
+    //@return the program if it is ready, 0 while it loads or if it failed. The program belongs to the cache.
+    GLuint gl_program_get(const gl_program_cache& c, gl_program_handle handle)
+    {
+        const gl_program& p = *c.programs[handle];
+        return p.state == PROGRAM_READY ? p.program : 0;
+    }
+
+    program_state gl_program_status(const gl_program_cache& c, gl_program_handle handle)
+    {
+        return c.programs[handle]->state;
+    }
+
+    //Blocks until the program is ready or failed
+    //@return the program, 0 if it failed
+    GLuint gl_program_wait(gl_program_cache& c, gl_program_handle handle)
+    {
+        gl_program& p = *c.programs[handle];
+
+        while(p.state != PROGRAM_READY && p.state != PROGRAM_FAILED)
+        {
+            gl_program_cache_update(c, 1e30);
+
+            //Still waiting on the read job, help the workers instead of spinning
+            if(p.state == PROGRAM_LOADING && !(c.js && job_try_run(*c.js)))
+                std::this_thread::yield();
+        }
+
+        return p.state == PROGRAM_READY ? p.program : 0;
+    }
+
+    //gl_request_program + gl_program_wait
+    GLuint gl_load_program(gl_program_cache& c, const char* vertex_source, const char* fragment_source)
+    {
+        return gl_program_wait(c, gl_request_program(c, vertex_source, fragment_source));
+    }
+
+    //Creates the program from its cached binary
+    //@return false if the driver refused the binary
+    static bool load_binary(gl_program_cache& c, gl_program& p)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        uint32_t format = 0;
+        memcpy(&format, p.cached.data(), sizeof(format));
+
+        p.program = glCreateProgram();
+        glProgramBinary(p.program, (GLenum)format, p.cached.data() + sizeof(format), (GLsizei)(p.cached.size() - sizeof(format)));
+
+        GLint success = 0;
+        glGetProgramiv(p.program, GL_LINK_STATUS, &success);
+        c.stats.binary_ms += elapsed_ms(start);
+
+        std::vector<uint8_t>().swap(p.cached);
+
+        if(!success)
+        {
+            glDeleteProgram(p.program);
+            p.program = 0;
+            return false;
+        }
+
+        p.state = PROGRAM_READY;
+        return true;
+    }
+
+    //Hands the sources to the driver without asking for the result
+    static void start_compile(gl_program_cache& c, gl_program& p)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        p.shaders[0] = compile_shader(GL_VERTEX_SHADER, p.vertex_source.c_str());
+        p.shaders[1] = compile_shader(GL_FRAGMENT_SHADER, p.fragment_source.c_str());
+
+        p.program = glCreateProgram();
+        glAttachShader(p.program, p.shaders[0]);
+        glAttachShader(p.program, p.shaders[1]);
+        if(c.binaries)
+            glProgramParameteri(p.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(p.program);
+
+        p.state = PROGRAM_COMPILING;
+        c.stats.compiles++;
+        c.stats.compile_ms += elapsed_ms(start);
+    }
+
+    //Reads the binary back and writes it to the cache (on a worker)
+    static void store_binary(gl_program_cache& c, const gl_program& p)
+    {
+        GLint length = 0;
+        glGetProgramiv(p.program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if(length <= 0)
+            return;
+
+        std::vector<uint8_t> payload(sizeof(uint32_t) + (size_t)length);
+
+        GLenum format = 0;
+        GLsizei written = 0;
+        glGetProgramBinary(p.program, length, &written, &format, payload.data() + sizeof(uint32_t));
+        if(written <= 0)
+            return;
+
+        uint32_t stored_format = (uint32_t)format;
+        memcpy(payload.data(), &stored_format, sizeof(stored_format));
+        payload.resize(sizeof(uint32_t) + (size_t)written);
+
+        auto job = [&c, key = p.key, payload = std::move(payload)]()
+        {
+            cache_store_key(c.disk, key, c.driver, payload);
+        };
+
+        if(c.js)
+            job_submit(*c.js, job, &c.io);
+        else
+            job();
+    }
+
+    //Checks a program the driver is done with, blocks until it is done without KHR_parallel_shader_compile
+    static void finish_compile(gl_program_cache& c, gl_program& p)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        bool vs_ok = check_shader(p.shaders[0]);
+        bool fs_ok = check_shader(p.shaders[1]);
+        bool linked = vs_ok && fs_ok && check_program(p.program);
+
+        glDetachShader(p.program, p.shaders[0]);
+        glDetachShader(p.program, p.shaders[1]);
+        glDeleteShader(p.shaders[0]);
+        glDeleteShader(p.shaders[1]);
+        p.shaders[0] = p.shaders[1] = 0;
+
+        if(linked)
+        {
+            p.state = PROGRAM_READY;
+            if(c.binaries)
+                store_binary(c, p);
+        }
+        else
+        {
+            glDeleteProgram(p.program);
+            p.program = 0;
+            p.state = PROGRAM_FAILED;
+            c.stats.failures++;
+        }
+
+        c.stats.compile_ms += elapsed_ms(start);
+    }
+
+    //Per frame work on the main thread: creates programs from finished cache reads, starts queued compiles and finishes the ones the driver
+    //is done with. Without KHR_parallel_shader_compile at least one queued compile finishes per call.
+    //@param budget_ms time compiles may take when the driver can't compile in the background
+    void gl_program_cache_update(gl_program_cache& c, double budget_ms)
+    {
+        std::deque<gl_program_handle> finished;
+
+        {
+            std::lock_guard<std::mutex> guard(c.lock);
+            finished.swap(c.loaded);
+        }
+
+        for(gl_program_handle h : finished)
+        {
+            gl_program& p = *c.programs[h];
+
+            if(!p.cached.empty())
+            {
+                if(load_binary(c, p))
+                {
+                    c.stats.cache_hits++;
+                    continue;
+                }
+
+                c.stats.binaries_rejected++;
+            }
+            else
+            {
+                c.stats.cache_misses++;
+            }
+
+            p.state = PROGRAM_QUEUED;
+            c.compile_queue.push_back(h);
+        }
+
+        if(c.parallel_compile)
+        {
+            //Only programs the driver reports complete are checked, so nothing here waits on the compiler
+            for(size_t i = 0; i < c.compiling.size();)
+            {
+                gl_program& p = *c.programs[c.compiling[i]];
+
+                GLint complete = 0;
+                glGetProgramiv(p.program, GL_COMPLETION_STATUS_KHR, &complete);
+                if(!complete)
+                {
+                    i++;
+                    continue;
+                }
+
+                finish_compile(c, p);
+                c.compiling[i] = c.compiling.back();
+                c.compiling.pop_back();
+            }
+
+            while(!c.compile_queue.empty() && c.compiling.size() < c.max_compiles_in_flight)
+            {
+                gl_program_handle h = c.compile_queue.front();
+                c.compile_queue.pop_front();
+
+                start_compile(c, *c.programs[h]);
+                c.compiling.push_back(h);
+            }
+
+            return;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        while(!c.compile_queue.empty())
+        {
+            gl_program_handle h = c.compile_queue.front();
+            c.compile_queue.pop_front();
+
+            start_compile(c, *c.programs[h]);
+            finish_compile(c, *c.programs[h]);
+
+            if(elapsed_ms(start) >= budget_ms)
+                break;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "gl.h"
+#include "../asset/asset_cache.h"
+#include "../core/job.h"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace br
+{
+    typedef uint32_t gl_program_handle;
+
+    enum program_state
+    {
+        PROGRAM_LOADING,        //Cache entry being read on a worker
+        PROGRAM_QUEUED,         //No usable binary, waiting for its compile to start
+        PROGRAM_COMPILING,      //Compile and link handed to the driver
+        PROGRAM_READY,
+        PROGRAM_FAILED
+    };
+
+    struct gl_program
+    {
+        std::string vertex_source;
+        std::string fragment_source;
+        std::string key;                //Cache key, the hash of both sources
+
+        program_state state = PROGRAM_LOADING;
+        GLuint program = 0;
+        GLuint shaders[2] = {};         //While compiling
+
+        //Filled by the read job: the cached binary format followed by the binary
+        std::vector<uint8_t> cached;
+    };
+
+    struct gl_program_stats
+    {
+        uint32_t cache_hits = 0;
+        uint32_t cache_misses = 0;
+        uint32_t binaries_rejected = 0;    //Entries the driver refused (usually a driver update the version string didn't show)
+        uint32_t compiles = 0;
+        uint32_t failures = 0;
+
+        //Main thread time spent in glProgramBinary and in compiling / linking
+        double binary_ms = 0.0;
+        double compile_ms = 0.0;
+    };
+
+    //Linked programs by source, backed by GL program binaries in an asset cache so a later run skips compiling. Entries are only used by the
+    //same driver (vendor, renderer and version string) that wrote them.
+    struct gl_program_cache
+    {
+        asset_cache disk = { "./cache/programs" };
+
+        //Optional, cache reads and writes run on it. Null does them on the calling thread.
+        job_system* js = nullptr;
+
+        //Filled by gl_program_cache_init
+        std::string driver;
+        bool binaries = false;          //The driver has at least one program binary format
+        bool parallel_compile = false;  //KHR_parallel_shader_compile, the driver compiles on its own threads
+
+        //Programs started at once when the driver compiles in parallel. Without it compiles are spread over updates by the time budget.
+        uint32_t max_compiles_in_flight = 8;
+
+        //unique_ptr so read jobs can hold on to a program while more are requested
+        std::vector<std::unique_ptr<gl_program>> programs;
+        std::unordered_map<std::string, gl_program_handle> by_key;
+
+        //Programs whose cache read finished, pushed by the read jobs
+        std::mutex lock;
+        std::deque<gl_program_handle> loaded;
+
+        //Main thread only
+        std::deque<gl_program_handle> compile_queue;
+        std::vector<gl_program_handle> compiling;
+
+        job_counter io;
+        gl_program_stats stats;
+    };
+
+    //Queries the driver. Needs a current context.
+    void gl_program_cache_init(gl_program_cache& c, job_system* js = nullptr);
+
+    //Waits for cache writes and deletes every program
+    void gl_program_cache_shutdown(gl_program_cache& c);
+
+    //Starts loading a program in the background. Requesting the same sources again returns the same handle.
+    gl_program_handle gl_request_program(gl_program_cache& c, const char* vertex_source, const char* fragment_source);
+
+    //@return the program if it is ready, 0 while it loads or if it failed. The program belongs to the cache.
+    GLuint gl_program_get(const gl_program_cache& c, gl_program_handle handle);
+
+    program_state gl_program_status(const gl_program_cache& c, gl_program_handle handle);
+
+    //Blocks until the program is ready or failed
+    //@return the program, 0 if it failed
+    GLuint gl_program_wait(gl_program_cache& c, gl_program_handle handle);
+
+    //gl_request_program + gl_program_wait
+    GLuint gl_load_program(gl_program_cache& c, const char* vertex_source, const char* fragment_source);
+
+    //Per frame work on the main thread: creates programs from finished cache reads, starts queued compiles and finishes the ones the driver
+    //is done with. Without KHR_parallel_shader_compile at least one queued compile finishes per call.
+    //@param budget_ms time compiles may take when the driver can't compile in the background
+    void gl_program_cache_update(gl_program_cache& c, double budget_ms = 2.0);
+
+    //Compiles and links right away, without a cache. Errors go to stderr.
+    //@return the program, 0 if it didn't compile or link
+    GLuint gl_link_program(const char* vertex_source, const char* fragment_source);
+}
@@ -0,0 +1,123 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Shader variants.
+
+
+    Permutations -
+        A material with an optional normal map, skinning or lighting model shouldn't need a hand written shader per combination. A library is one
+        source pair with #ifdef blocks per feature; a variant is a bit mask of features, and its source is the body with a #define for every set
+        bit injected after the #version line. With n features there are 2^n possible variants but only the ones actually asked for are ever built.
+
+
+    Lazy Compilation -
+        Variants go through the program cache (gl_program.h): the first gl_shader_library_get of a mask requests it and returns right away, a
+        later run finds its binary in the cache. Until it's ready the library answers with the best variant it already has, the one with the
+        most of the requested features and none that weren't asked for, so an object draws without its normal map for a few frames instead of
+        stalling the frame on the compiler. The base variant (no features) is loaded during init so there's always something to fall back to.
+
+        A variant that fails to compile keeps falling back for good, the error is printed once by the program cache.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "gl_shader_library.h"
+
+namespace br
+{
+    static uint32_t bit_count(uint32_t bits)
+    {
+        uint32_t count = 0;
+        for(; bits; bits &= bits - 1)
+        {
+            count++;
+        }
+        return count;
+    }
+
+    //Full vertex or fragment source of a variant: the version line, one #define per feature, the body
+    std::string gl_shader_variant_source(const gl_shader_library& lib, const std::string& body, uint32_t features)
+    {
+        std::string source = lib.version + "\n";
+
+        for(uint32_t i = 0; i < lib.features.size(); i++)
+        {
+            if(features & (1u << i))
+                source += "#define " + lib.features[i] + " 1\n";
+        }
+
+        //Keeps the body's line numbers in compile errors the same for every variant
+        source += "#line 1\n";
+        return source + body;
+    }
+
+    static gl_program_handle request_variant(gl_shader_library& lib, uint32_t features)
+    {
+        auto found = lib.variants.find(features);
+        if(found != lib.variants.end())
+            return found->second;
+
+        std::string vertex = gl_shader_variant_source(lib, lib.vertex_body, features);
+        std::string fragment = gl_shader_variant_source(lib, lib.fragment_body, features);
+
+        gl_program_handle handle = gl_request_program(*lib.programs, vertex.c_str(), fragment.c_str());
+        lib.variants.emplace(features, handle);
+        return handle;
+    }
+
+    //Sets up the library and loads the variant with no features, the fallback of last resort, before returning.
+    //@return false if the base variant didn't compile
+    bool gl_shader_library_init(gl_shader_library& lib, gl_program_cache& programs, const char* version, const char* vertex_body,
+                                const char* fragment_body, const std::vector<std::string>& features)
+    {
+        lib.programs = &programs;
+        lib.version = version;
+        lib.vertex_body = vertex_body;
+        lib.fragment_body = fragment_body;
+        lib.features.assign(features.begin(), features.begin() + (features.size() < SHADER_MAX_FEATURES ? features.size() : SHADER_MAX_FEATURES));
+        lib.variants.clear();
+
+        return gl_program_wait(programs, request_variant(lib, 0)) != 0;
+    }
+
+    //Starts compiling a variant in the background without using it (e.g. the variants a level's materials need, while it loads)
+    void gl_shader_library_request(gl_shader_library& lib, uint32_t features)
+    {
+        request_variant(lib, features);
+    }
+
+    //Never blocks. Starts the variant's compile the first time it's asked for, and until it's ready returns the ready variant with the most
+    //of the requested features (and no others).
+    //@param used optional, receives the feature mask of the program returned
+    //@return the program to draw with, owned by the program cache
+    GLuint gl_shader_library_get(gl_shader_library& lib, uint32_t features, uint32_t* used)
+    {
+        gl_program_handle handle = request_variant(lib, features);
+
+        GLuint program = gl_program_get(*lib.programs, handle);
+        uint32_t best = features;
+
+        //Best ready subset. The base variant is always ready, so there is one.
+        if(program == 0)
+        {
+            best = 0;
+            program = gl_program_get(*lib.programs, lib.variants[0]);
+
+            for(const auto& variant : lib.variants)
+            {
+                uint32_t candidate = variant.first;
+                if((candidate & ~features) != 0 || bit_count(candidate) <= bit_count(best))
+                    continue;
+
+                GLuint candidate_program = gl_program_get(*lib.programs, variant.second);
+                if(candidate_program != 0)
+                {
+                    best = candidate;
+                    program = candidate_program;
+                }
+            }
+        }
+
+        if(used)
+            *used = best;
+        return program;
+    }
+}
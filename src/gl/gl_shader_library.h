@@ -0,0 +1,52 @@
+#pragma once
+
+#include "gl.h"
+#include "gl_program.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace br
+{
+    //Most feature bits a library can have
+    static const uint32_t SHADER_MAX_FEATURES = 32;
+
+    //One vertex / fragment source pair with optional features switched on by #defines. Every combination of features (a variant) is its own
+    //program, compiled through the program cache the first time it's asked for.
+    struct gl_shader_library
+    {
+        gl_program_cache* programs = nullptr;
+
+        //Sources without the #version line, which has to come before the injected #defines
+        std::string version;
+        std::string vertex_body;
+        std::string fragment_body;
+
+        //Bit i of a feature mask defines features[i]
+        std::vector<std::string> features;
+
+        //Every variant requested so far, by feature mask
+        std::unordered_map<uint32_t, gl_program_handle> variants;
+    };
+
+    //Sets up the library and loads the variant with no features, the fallback of last resort, before returning.
+    //@param version the #version line, e.g. "#version 410 core"
+    //@param features names of the feature #defines, bit i of a mask is features[i]. Every combination has to compile: a variant with fewer
+    //features stands in for one that isn't ready yet.
+    //@return false if the base variant didn't compile
+    bool gl_shader_library_init(gl_shader_library& lib, gl_program_cache& programs, const char* version, const char* vertex_body,
+                                const char* fragment_body, const std::vector<std::string>& features);
+
+    //Starts compiling a variant in the background without using it (e.g. the variants a level's materials need, while it loads)
+    void gl_shader_library_request(gl_shader_library& lib, uint32_t features);
+
+    //Never blocks. Starts the variant's compile the first time it's asked for, and until it's ready returns the ready variant with the most
+    //of the requested features (and no others).
+    //@param used optional, receives the feature mask of the program returned
+    //@return the program to draw with, owned by the program cache
+    GLuint gl_shader_library_get(gl_shader_library& lib, uint32_t features, uint32_t* used = nullptr);
+
+    //Full vertex or fragment source of a variant: the version line, one #define per feature, the body
+    std::string gl_shader_variant_source(const gl_shader_library& lib, const std::string& body, uint32_t features);
+}
@@ -0,0 +1,157 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Texture upload for the GL backend.
+
+        The GPU has its own tiling so the levels are handed over as linear rows. The mip chain built on the CPU is uploaded as is (instead of calling
+        glGenerateMipmap) so both backends sample the same filtered levels.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "gl_texture.h"
+#include <vector>
+
+//S3TC is an extension, the core 4.1 loader doesn't define its enums
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace br
+{
+    static void set_sampling(uint32_t level_count, GLenum target = GL_TEXTURE_2D)
+    {
+        glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, (GLint)level_count - 1);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, level_count > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    }
+
+    //Uploads every level of the texture's mip chain (converted to linear rows) to a new GL_TEXTURE_2D with trilinear filtering and repeat wrapping.
+    //Needs a current context.
+    //@return the texture name, 0 on failure
+    GLuint gl_upload_texture(const texture& t)
+    {
+        if(t.levels.empty())
+            return 0;
+
+        GLuint name = 0;
+        glGenTextures(1, &name);
+        if(name == 0)
+            return 0;
+
+        glBindTexture(GL_TEXTURE_2D, name);
+
+        //Rows of odd sized levels aren't 4 byte aligned in general, but RGBA8 rows always are
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        std::vector<uint32_t> rows;
+        for(uint32_t level = 0; level < t.levels.size(); level++)
+        {
+            const texture_level& l = t.levels[level];
+            texture_read_level(t, level, rows);
+
+            //RGBA8 with R in the lowest byte is GL_RGBA / GL_UNSIGNED_BYTE on little endian machines
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, l.width, l.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rows.data());
+        }
+
+        set_sampling((uint32_t)t.levels.size());
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        return name;
+    }
+
+    //Uploads a block compressed mip chain as is with glCompressedTexImage2D. BC1 / BC3 need EXT_texture_compression_s3tc (every desktop driver
+    //has it), BC5 is core RGTC2.
+    //@return the texture name, 0 on failure
+    GLuint gl_upload_compressed_texture(const compressed_texture& t)
+    {
+        if(t.levels.empty())
+            return 0;
+
+        GLenum internal_format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        if(t.format == BC3)
+            internal_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        else if(t.format == BC5)
+            internal_format = GL_COMPRESSED_RG_RGTC2;
+
+        GLuint name = 0;
+        glGenTextures(1, &name);
+        if(name == 0)
+            return 0;
+
+        glBindTexture(GL_TEXTURE_2D, name);
+
+        uint32_t block_bytes = bc_block_bytes(t.format);
+        for(uint32_t level = 0; level < t.levels.size(); level++)
+        {
+            const bc_level& l = t.levels[level];
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, internal_format, l.width, l.height, 0, l.blocks_x * l.blocks_y * block_bytes, &t.data[l.offset]);
+        }
+
+        set_sampling((uint32_t)t.levels.size());
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        if(glGetError() != GL_NO_ERROR)
+        {
+            glDeleteTextures(1, &name);
+            return 0;
+        }
+
+        return name;
+    }
+
+    //Uploads textures of the same size and mip count as the layers of a new GL_TEXTURE_2D_ARRAY, sampled like gl_upload_texture
+    //@return the texture name, 0 if there are no layers or their sizes differ
+    GLuint gl_upload_texture_array(const texture* const* layers, uint32_t count)
+    {
+        if(count == 0 || layers[0]->levels.empty())
+            return 0;
+
+        const texture& first = *layers[0];
+        for(uint32_t i = 1; i < count; i++)
+        {
+            const texture& t = *layers[i];
+            if(t.levels.size() != first.levels.size() || t.levels[0].width != first.levels[0].width || t.levels[0].height != first.levels[0].height)
+                return 0;
+        }
+
+        GLuint name = 0;
+        glGenTextures(1, &name);
+        if(name == 0)
+            return 0;
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, name);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        //Storage for every level first, then one layer at a time
+        for(uint32_t level = 0; level < first.levels.size(); level++)
+        {
+            const texture_level& l = first.levels[level];
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, l.width, l.height, count, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+
+        std::vector<uint32_t> rows;
+        for(uint32_t i = 0; i < count; i++)
+        {
+            for(uint32_t level = 0; level < first.levels.size(); level++)
+            {
+                const texture_level& l = layers[i]->levels[level];
+                texture_read_level(*layers[i], level, rows);
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, i, l.width, l.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rows.data());
+            }
+        }
+
+        set_sampling((uint32_t)first.levels.size(), GL_TEXTURE_2D_ARRAY);
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        return name;
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "gl.h"
+#include "../texture/texture.h"
+#include "../texture/bc.h"
+
+namespace br
+{
+    //Uploads every level of the texture's mip chain (converted to linear rows) to a new GL_TEXTURE_2D with trilinear filtering and repeat wrapping.
+    //Needs a current context.
+    //@return the texture name, 0 on failure
+    GLuint gl_upload_texture(const texture& t);
+
+    //Uploads a block compressed mip chain as is with glCompressedTexImage2D. BC1 / BC3 need EXT_texture_compression_s3tc (every desktop driver
+    //has it), BC5 is core RGTC2.
+    //@return the texture name, 0 on failure
+    GLuint gl_upload_compressed_texture(const compressed_texture& t);
+
+    //Uploads textures of the same size and mip count as the layers of a new GL_TEXTURE_2D_ARRAY, sampled like gl_upload_texture
+    //@return the texture name, 0 if there are no layers or their sizes differ
+    GLuint gl_upload_texture_array(const texture* const* layers, uint32_t count);
+}
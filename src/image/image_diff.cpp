@@ -0,0 +1,135 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Image comparison for golden image tests.
+
+
+    Per Pixel -
+        Counts pixels where any channel is off by more than a tolerance. Catches small localized breakage (a missing triangle, a hole along an edge) that
+        an averaged metric would hide.
+
+
+    SSIM -
+        Structural similarity (Wang et al. 2004) over 8x8 windows of luma placed every 4 pixels. Each window compares mean, contrast and correlation:
+
+            SSIM = ((2 * mu_a * mu_b + C1) * (2 * cov_ab + C2)) / ((mu_a^2 + mu_b^2 + C1) * (var_a + var_b + C2))
+
+        It tracks what a person would call "looks different" much better than a mean squared error, e.g. a 1 pixel shift of a whole edge is a big MSE
+        change but a small SSIM change, while banding or lost detail show up strongly.
+
+
+    References -
+        Image Quality Assessment: From Error Visibility to Structural Similarity - https://www.cns.nyu.edu/pub/eero/wang03-reprint.pdf
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "image_diff.h"
+#include <cstdlib>
+
+namespace br
+{
+    static const uint32_t SSIM_WINDOW = 8;
+    static const uint32_t SSIM_STRIDE = 4;
+    static const double SSIM_C1 = (0.01 * 255.0) * (0.01 * 255.0);
+    static const double SSIM_C2 = (0.03 * 255.0) * (0.03 * 255.0);
+
+    static inline double luma(uint32_t p)
+    {
+        return (0.2126 * (p & 0xFF)) + (0.7152 * ((p >> 8) & 0xFF)) + (0.0722 * ((p >> 16) & 0xFF));
+    }
+
+    static double window_ssim(const std::vector<double>& a, const std::vector<double>& b, uint32_t width, uint32_t x0, uint32_t y0, uint32_t w, uint32_t h)
+    {
+        double sum_a = 0.0, sum_b = 0.0, sum_aa = 0.0, sum_bb = 0.0, sum_ab = 0.0;
+
+        for(uint32_t y = y0; y < y0 + h; y++)
+        {
+            for(uint32_t x = x0; x < x0 + w; x++)
+            {
+                double va = a[(size_t)y * width + x];
+                double vb = b[(size_t)y * width + x];
+                sum_a += va;
+                sum_b += vb;
+                sum_aa += va * va;
+                sum_bb += vb * vb;
+                sum_ab += va * vb;
+            }
+        }
+
+        double n = (double)w * h;
+        double mu_a = sum_a / n;
+        double mu_b = sum_b / n;
+        double var_a = (sum_aa / n) - (mu_a * mu_a);
+        double var_b = (sum_bb / n) - (mu_b * mu_b);
+        double cov = (sum_ab / n) - (mu_a * mu_b);
+
+        return ((2.0 * mu_a * mu_b + SSIM_C1) * (2.0 * cov + SSIM_C2)) / (((mu_a * mu_a) + (mu_b * mu_b) + SSIM_C1) * (var_a + var_b + SSIM_C2));
+    }
+
+    //Compares two RGBA8 images of the same size (alpha is ignored)
+    //@param tolerance per channel difference that is still considered a match
+    //@param diff_image optional visualization: pixels over tolerance in red, everything else as a dimmed copy of the reference
+    void compare_images(uint32_t width, uint32_t height, const uint32_t* image, const uint32_t* reference, uint32_t tolerance,
+                        image_diff& result, std::vector<uint32_t>* diff_image)
+    {
+        result = image_diff();
+
+        size_t count = (size_t)width * height;
+        if(count == 0)
+            return;
+
+        if(diff_image)
+            diff_image->resize(count);
+
+        std::vector<double> luma_a(count);
+        std::vector<double> luma_b(count);
+
+        for(size_t i = 0; i < count; i++)
+        {
+            uint32_t error = 0;
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                int a = (image[i] >> (c * 8)) & 0xFF;
+                int b = (reference[i] >> (c * 8)) & 0xFF;
+                uint32_t e = (uint32_t)abs(a - b);
+                error = e > error ? e : error;
+            }
+
+            result.max_channel_error = error > result.max_channel_error ? error : result.max_channel_error;
+
+            if(error > tolerance)
+                result.pixels_over_tolerance++;
+
+            luma_a[i] = luma(image[i]);
+            luma_b[i] = luma(reference[i]);
+
+            if(diff_image)
+            {
+                uint32_t gray = (uint32_t)(luma_b[i] * 0.3);
+                (*diff_image)[i] = error > tolerance ? 0xFF0000FFu : (0xFF000000u | (gray << 16) | (gray << 8) | gray);
+            }
+        }
+
+        result.fraction_over_tolerance = (double)result.pixels_over_tolerance / count;
+
+        //Windows are clamped to the image so small images still get at least one
+        uint32_t window_w = width < SSIM_WINDOW ? width : SSIM_WINDOW;
+        uint32_t window_h = height < SSIM_WINDOW ? height : SSIM_WINDOW;
+
+        double sum = 0.0;
+        uint32_t windows = 0;
+
+        for(uint32_t y = 0; y + window_h <= height; y += SSIM_STRIDE)
+        {
+            for(uint32_t x = 0; x + window_w <= width; x += SSIM_STRIDE)
+            {
+                double s = window_ssim(luma_a, luma_b, width, x, y, window_w, window_h);
+                sum += s;
+                windows++;
+
+                result.min_ssim = s < result.min_ssim ? s : result.min_ssim;
+            }
+        }
+
+        result.mean_ssim = sum / windows;
+    }
+}
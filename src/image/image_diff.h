@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    //Result of comparing a rendered image against a reference
+    struct image_diff
+    {
+        //Largest difference of any single channel (0 - 255)
+        uint32_t max_channel_error = 0;
+
+        //Pixels where some channel differs by more than the tolerance
+        uint64_t pixels_over_tolerance = 0;
+        double fraction_over_tolerance = 0.0;
+
+        //Structural similarity of the luma channels. 1 = identical, drops quickly for misplaced edges and missing geometry
+        //but barely moves for small shading noise, which is what we want when compilers round floats a little differently.
+        double mean_ssim = 1.0;
+        double min_ssim = 1.0;
+    };
+
+    //Compares two RGBA8 images of the same size (alpha is ignored)
+    //@param tolerance per channel difference that is still considered a match
+    //@param diff_image optional visualization: pixels over tolerance in red, everything else as a dimmed copy of the reference
+    void compare_images(uint32_t width, uint32_t height, const uint32_t* image, const uint32_t* reference, uint32_t tolerance,
+                        image_diff& result, std::vector<uint32_t>* diff_image = nullptr);
+}
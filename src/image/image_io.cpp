@@ -0,0 +1,474 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Image file output (PPM and PNG) for offscreen rendering.
+
+
+    PNG -
+        We write our own encoder instead of pulling in a library. A PNG is a signature followed by chunks (IHDR, IDAT, IEND), each with a CRC32. The pixel
+        rows are prefixed with a filter byte and compressed with zlib.
+
+        Filtering: every row tries the 5 PNG filters and keeps the one with the smallest sum of absolute (signed) bytes. Rendered images have large smooth
+        areas so Sub / Up / Paeth usually turn most bytes into zeros.
+
+        Compression: a single deflate block with the fixed Huffman tables and LZ77 matches found through a hash chain over the last 32KB. Dynamic
+        Huffman tables would squeeze out another 10-20% but the fixed tables keep the encoder short and fast, which matters more for batch rendering.
+
+
+    References -
+        PNG Specification - https://www.w3.org/TR/png/
+        DEFLATE (RFC 1951) - https://www.rfc-editor.org/rfc/rfc1951
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "image_io.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace br
+{
+    static const uint32_t WINDOW_SIZE = 32768;
+    static const uint32_t HASH_BITS = 15;
+    static const uint32_t MAX_CHAIN = 16;
+    static const uint32_t MIN_MATCH = 3;
+    static const uint32_t MAX_MATCH = 258;
+
+    static const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const uint16_t DIST_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    static const uint8_t DIST_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+    //Deflate packs bits starting from the least significant bit of each byte
+    struct bit_writer
+    {
+        std::vector<uint8_t>* out;
+        uint32_t bits;
+        uint32_t count;
+    };
+
+    static void put_bits(bit_writer& bw, uint32_t value, uint32_t n)
+    {
+        bw.bits |= value << bw.count;
+        bw.count += n;
+
+        while(bw.count >= 8)
+        {
+            bw.out->push_back((uint8_t)bw.bits);
+            bw.bits >>= 8;
+            bw.count -= 8;
+        }
+    }
+
+    static void flush_bits(bit_writer& bw)
+    {
+        if(bw.count)
+            bw.out->push_back((uint8_t)bw.bits);
+
+        bw.bits = 0;
+        bw.count = 0;
+    }
+
+    //Huffman codes are defined most significant bit first, so they get reversed before packing
+    static void put_code(bit_writer& bw, uint32_t code, uint32_t length)
+    {
+        uint32_t reversed = 0;
+        for(uint32_t i = 0; i < length; i++)
+        {
+            reversed |= ((code >> i) & 1) << (length - 1 - i);
+        }
+
+        put_bits(bw, reversed, length);
+    }
+
+    //Fixed Huffman literal / length alphabet (RFC 1951 section 3.2.6)
+    static void put_symbol(bit_writer& bw, uint32_t symbol)
+    {
+        if(symbol <= 143)
+            put_code(bw, 0x30 + symbol, 8);
+        else if(symbol <= 255)
+            put_code(bw, 0x190 + (symbol - 144), 9);
+        else if(symbol <= 279)
+            put_code(bw, symbol - 256, 7);
+        else
+            put_code(bw, 0xC0 + (symbol - 280), 8);
+    }
+
+    static void put_match(bit_writer& bw, uint32_t length, uint32_t distance)
+    {
+        uint32_t l = 28;
+        while(LENGTH_BASE[l] > length)
+        {
+            l--;
+        }
+
+        put_symbol(bw, 257 + l);
+        put_bits(bw, length - LENGTH_BASE[l], LENGTH_EXTRA[l]);
+
+        uint32_t d = 29;
+        while(DIST_BASE[d] > distance)
+        {
+            d--;
+        }
+
+        //Fixed distance codes are plain 5 bit numbers
+        put_code(bw, d, 5);
+        put_bits(bw, distance - DIST_BASE[d], DIST_EXTRA[d]);
+    }
+
+    static inline uint32_t hash3(const uint8_t* p)
+    {
+        uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+        return (v * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    //Compresses data into a zlib stream (header, one fixed Huffman deflate block, adler32)
+    static void zlib_compress(const uint8_t* data, uint32_t size, std::vector<uint8_t>& out)
+    {
+        out.push_back(0x78);
+        out.push_back(0x01);
+
+        bit_writer bw = { &out, 0, 0 };
+        put_bits(bw, 1, 1);     //Final block
+        put_bits(bw, 1, 2);     //Fixed Huffman
+
+        std::vector<int32_t> head(1u << HASH_BITS, -1);
+        std::vector<int32_t> prev(WINDOW_SIZE, -1);
+
+        uint32_t i = 0;
+        while(i < size)
+        {
+            uint32_t best_length = 0;
+            uint32_t best_distance = 0;
+
+            if(i + MIN_MATCH <= size)
+            {
+                int32_t candidate = head[hash3(data + i)];
+                uint32_t limit = size - i < MAX_MATCH ? size - i : MAX_MATCH;
+
+                for(uint32_t chain = 0; chain < MAX_CHAIN && candidate >= 0 && i - (uint32_t)candidate <= WINDOW_SIZE; chain++)
+                {
+                    uint32_t length = 0;
+                    while(length < limit && data[candidate + length] == data[i + length])
+                    {
+                        length++;
+                    }
+
+                    if(length > best_length)
+                    {
+                        best_length = length;
+                        best_distance = i - (uint32_t)candidate;
+
+                        if(length == limit)
+                            break;
+                    }
+
+                    candidate = prev[candidate & (WINDOW_SIZE - 1)];
+                }
+            }
+
+            uint32_t advance = 1;
+
+            if(best_length >= MIN_MATCH)
+            {
+                put_match(bw, best_length, best_distance);
+                advance = best_length;
+            }
+            else
+            {
+                put_symbol(bw, data[i]);
+            }
+
+            //Insert every position we step over into the hash chains
+            for(uint32_t k = 0; k < advance; k++, i++)
+            {
+                if(i + MIN_MATCH <= size)
+                {
+                    uint32_t h = hash3(data + i);
+                    prev[i & (WINDOW_SIZE - 1)] = head[h];
+                    head[h] = (int32_t)i;
+                }
+            }
+        }
+
+        put_symbol(bw, 256);
+        flush_bits(bw);
+
+        uint32_t a = 1;
+        uint32_t b = 0;
+        for(uint32_t k = 0; k < size; k++)
+        {
+            a = (a + data[k]) % 65521;
+            b = (b + a) % 65521;
+        }
+
+        uint32_t adler = (b << 16) | a;
+        out.push_back((uint8_t)(adler >> 24));
+        out.push_back((uint8_t)(adler >> 16));
+        out.push_back((uint8_t)(adler >> 8));
+        out.push_back((uint8_t)adler);
+    }
+
+    static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+    {
+        static uint32_t table[256];
+        static bool table_ready = false;
+
+        if(!table_ready)
+        {
+            for(uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+                for(int k = 0; k < 8; k++)
+                {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+
+                table[n] = c;
+            }
+
+            table_ready = true;
+        }
+
+        crc = ~crc;
+        for(size_t i = 0; i < size; i++)
+        {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+
+        return ~crc;
+    }
+
+    static void put_u32_be(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back((uint8_t)(value >> 24));
+        out.push_back((uint8_t)(value >> 16));
+        out.push_back((uint8_t)(value >> 8));
+        out.push_back((uint8_t)value);
+    }
+
+    static void put_chunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, uint32_t size)
+    {
+        put_u32_be(out, size);
+
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data, data + size);
+
+        put_u32_be(out, crc32(&out[start], size + 4));
+    }
+
+    static inline uint8_t paeth(uint8_t a, uint8_t b, uint8_t c)
+    {
+        int p = (int)a + b - c;
+        int pa = abs(p - a);
+        int pb = abs(p - b);
+        int pc = abs(p - c);
+
+        if(pa <= pb && pa <= pc)
+            return a;
+
+        return pb <= pc ? b : c;
+    }
+
+    //Encodes RGBA8 pixels into a PNG file image in memory
+    void encode_png(uint32_t width, uint32_t height, const uint32_t* pixels, std::vector<uint8_t>& out)
+    {
+        const uint32_t bpp = 3;
+        uint32_t row_bytes = width * bpp;
+
+        std::vector<uint8_t> rows[2] = { std::vector<uint8_t>(row_bytes, 0), std::vector<uint8_t>(row_bytes, 0) };
+        std::vector<uint8_t> candidate(row_bytes);
+        std::vector<uint8_t> best(row_bytes);
+        std::vector<uint8_t> filtered;
+        filtered.reserve((size_t)(row_bytes + 1) * height);
+
+        for(uint32_t y = 0; y < height; y++)
+        {
+            std::vector<uint8_t>& current = rows[y & 1];
+            const std::vector<uint8_t>& above = rows[(y + 1) & 1];
+
+            for(uint32_t x = 0; x < width; x++)
+            {
+                uint32_t p = pixels[(size_t)y * width + x];
+                current[(x * 3)] = (uint8_t)p;
+                current[(x * 3) + 1] = (uint8_t)(p >> 8);
+                current[(x * 3) + 2] = (uint8_t)(p >> 16);
+            }
+
+            uint32_t best_filter = 0;
+            uint64_t best_score = ~0ull;
+
+            for(uint32_t filter = 0; filter < 5; filter++)
+            {
+                uint64_t score = 0;
+
+                for(uint32_t i = 0; i < row_bytes; i++)
+                {
+                    uint8_t a = i >= bpp ? current[i - bpp] : 0;
+                    uint8_t b = y > 0 ? above[i] : 0;
+                    uint8_t c = (i >= bpp && y > 0) ? above[i - bpp] : 0;
+                    uint8_t predicted = 0;
+
+                    switch(filter)
+                    {
+                        case 1: predicted = a; break;
+                        case 2: predicted = b; break;
+                        case 3: predicted = (uint8_t)(((int)a + b) / 2); break;
+                        case 4: predicted = paeth(a, b, c); break;
+                        default: break;
+                    }
+
+                    candidate[i] = (uint8_t)(current[i] - predicted);
+                    score += (uint64_t)abs((int8_t)candidate[i]);
+                }
+
+                if(score < best_score)
+                {
+                    best_score = score;
+                    best_filter = filter;
+                    best.swap(candidate);
+                }
+            }
+
+            filtered.push_back((uint8_t)best_filter);
+            filtered.insert(filtered.end(), best.begin(), best.end());
+        }
+
+        out.clear();
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        out.insert(out.end(), signature, signature + 8);
+
+        uint8_t header[13];
+        header[0] = (uint8_t)(width >> 24); header[1] = (uint8_t)(width >> 16); header[2] = (uint8_t)(width >> 8); header[3] = (uint8_t)width;
+        header[4] = (uint8_t)(height >> 24); header[5] = (uint8_t)(height >> 16); header[6] = (uint8_t)(height >> 8); header[7] = (uint8_t)height;
+        header[8] = 8;      //Bit depth
+        header[9] = 2;      //RGB
+        header[10] = 0;     //Deflate
+        header[11] = 0;     //Adaptive filtering
+        header[12] = 0;     //No interlace
+        put_chunk(out, "IHDR", header, sizeof(header));
+
+        std::vector<uint8_t> compressed;
+        zlib_compress(filtered.data(), (uint32_t)filtered.size(), compressed);
+        put_chunk(out, "IDAT", compressed.data(), (uint32_t)compressed.size());
+
+        put_chunk(out, "IEND", nullptr, 0);
+    }
+
+    //Writes RGBA8 pixels (R in the lowest byte, like framebuffer::color) as a binary PPM (P6). Alpha is dropped.
+    //@return false if the file couldn't be written
+    bool write_ppm(const char* path, uint32_t width, uint32_t height, const uint32_t* pixels)
+    {
+        FILE* file = fopen(path, "wb");
+        if(!file)
+            return false;
+
+        fprintf(file, "P6\n%u %u\n255\n", width, height);
+
+        std::vector<uint8_t> row((size_t)width * 3);
+        bool ok = true;
+
+        for(uint32_t y = 0; y < height && ok; y++)
+        {
+            for(uint32_t x = 0; x < width; x++)
+            {
+                uint32_t p = pixels[(size_t)y * width + x];
+                row[(x * 3)] = (uint8_t)p;
+                row[(x * 3) + 1] = (uint8_t)(p >> 8);
+                row[(x * 3) + 2] = (uint8_t)(p >> 16);
+            }
+
+            ok = fwrite(row.data(), 1, row.size(), file) == row.size();
+        }
+
+        return fclose(file) == 0 && ok;
+    }
+
+    //Writes RGBA8 pixels as an 8 bit RGB PNG. Alpha is dropped.
+    //@return false if the file couldn't be written
+    bool write_png(const char* path, uint32_t width, uint32_t height, const uint32_t* pixels)
+    {
+        std::vector<uint8_t> encoded;
+        encode_png(width, height, pixels, encoded);
+
+        FILE* file = fopen(path, "wb");
+        if(!file)
+            return false;
+
+        bool ok = fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+        return fclose(file) == 0 && ok;
+    }
+
+    //Writes with whichever encoder format picks
+    bool write_image(const char* path, image_format format, uint32_t width, uint32_t height, const uint32_t* pixels)
+    {
+        return format == IMAGE_PNG ? write_png(path, width, height, pixels) : write_ppm(path, width, height, pixels);
+    }
+
+    //Skips whitespace and # comments in a PPM header
+    static void skip_ppm_space(FILE* file)
+    {
+        int c = fgetc(file);
+        while(c == '#' || c == ' ' || c == '\t' || c == '\n' || c == '\r')
+        {
+            if(c == '#')
+            {
+                while(c != '\n' && c != EOF)
+                {
+                    c = fgetc(file);
+                }
+            }
+
+            c = fgetc(file);
+        }
+
+        ungetc(c, file);
+    }
+
+    //Reads a binary PPM (P6, max value 255) into RGBA8 pixels with alpha = 255
+    //@return false if the file is missing or isn't a P6 file we understand
+    bool read_ppm(const char* path, uint32_t& width, uint32_t& height, std::vector<uint32_t>& pixels)
+    {
+        FILE* file = fopen(path, "rb");
+        if(!file)
+            return false;
+
+        char magic[3] = {};
+        unsigned int w = 0, h = 0, max_value = 0;
+        bool ok = fread(magic, 1, 2, file) == 2 && strcmp(magic, "P6") == 0;
+
+        if(ok)
+        {
+            skip_ppm_space(file);
+            ok = fscanf(file, "%u", &w) == 1;
+            skip_ppm_space(file);
+            ok = ok && fscanf(file, "%u", &h) == 1;
+            skip_ppm_space(file);
+            ok = ok && fscanf(file, "%u", &max_value) == 1 && max_value == 255;
+
+            //Exactly one whitespace byte between the header and the pixels
+            ok = ok && fgetc(file) != EOF;
+        }
+
+        if(ok)
+        {
+            std::vector<uint8_t> rgb((size_t)w * h * 3);
+            ok = fread(rgb.data(), 1, rgb.size(), file) == rgb.size();
+
+            if(ok)
+            {
+                width = w;
+                height = h;
+                pixels.resize((size_t)w * h);
+
+                for(size_t i = 0; i < pixels.size(); i++)
+                {
+                    pixels[i] = rgb[i * 3] | ((uint32_t)rgb[(i * 3) + 1] << 8) | ((uint32_t)rgb[(i * 3) + 2] << 16) | 0xFF000000u;
+                }
+            }
+        }
+
+        fclose(file);
+        return ok;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    enum image_format
+    {
+        IMAGE_PPM,
+        IMAGE_PNG
+    };
+
+    //Writes RGBA8 pixels (R in the lowest byte, like framebuffer::color) as a binary PPM (P6). Alpha is dropped.
+    //@return false if the file couldn't be written
+    bool write_ppm(const char* path, uint32_t width, uint32_t height, const uint32_t* pixels);
+
+    //Writes RGBA8 pixels as an 8 bit RGB PNG. Alpha is dropped.
+    //@return false if the file couldn't be written
+    bool write_png(const char* path, uint32_t width, uint32_t height, const uint32_t* pixels);
+
+    //Writes with whichever encoder format picks
+    bool write_image(const char* path, image_format format, uint32_t width, uint32_t height, const uint32_t* pixels);
+
+    //Reads a binary PPM (P6, max value 255) into RGBA8 pixels with alpha = 255
+    //@return false if the file is missing or isn't a P6 file we understand
+    bool read_ppm(const char* path, uint32_t& width, uint32_t& height, std::vector<uint32_t>& pixels);
+
+    //Encodes RGBA8 pixels into a PNG file image in memory
+    void encode_png(uint32_t width, uint32_t height, const uint32_t* pixels, std::vector<uint8_t>& out);
+}
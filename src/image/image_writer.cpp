@@ -0,0 +1,57 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Asynchronous image output.
+
+        Each submitted frame is copied (the framebuffer gets cleared and reused for the next frame right away) and handed to a job that encodes and writes
+        it. PNG encoding costs a lot more than rendering a small frame, so with a few workers a batch render is bound by the encoder threads instead of
+        alternating between render and encode on one thread.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "image_writer.h"
+#include <memory>
+
+namespace br
+{
+    static void write_frame(image_writer& writer, const std::string& path, image_format format, uint32_t width, uint32_t height, const uint32_t* pixels)
+    {
+        if(write_image(path.c_str(), format, width, height, pixels))
+            writer.written.fetch_add(1, std::memory_order_relaxed);
+        else
+            writer.failed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //Copies the framebuffer's color and queues it to be encoded and written to path
+    void image_writer_submit(image_writer& writer, const std::string& path, image_format format, const framebuffer& fb)
+    {
+        if(!writer.js)
+        {
+            write_frame(writer, path, format, fb.width, fb.height, fb.color.data());
+            return;
+        }
+
+        uint32_t limit = writer.max_in_flight > 0 ? writer.max_in_flight : 1;
+        job_wait(*writer.js, writer.pending, limit - 1);
+
+        //std::function needs a copyable callable, so the pixels ride along in a shared_ptr
+        std::shared_ptr<std::vector<uint32_t>> pixels = std::make_shared<std::vector<uint32_t>>(fb.color);
+        uint32_t width = fb.width;
+        uint32_t height = fb.height;
+        image_writer* w = &writer;
+
+        job_submit(*writer.js, [w, path, format, width, height, pixels]()
+        {
+            write_frame(*w, path, format, width, height, pixels->data());
+        }, &writer.pending);
+    }
+
+    //Waits for every submitted image to hit the disk
+    //@return true if nothing failed since the writer was created
+    bool image_writer_flush(image_writer& writer)
+    {
+        if(writer.js)
+            job_wait(*writer.js, writer.pending);
+
+        return writer.failed.load(std::memory_order_relaxed) == 0;
+    }
+}
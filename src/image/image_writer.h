@@ -0,0 +1,32 @@
+#pragma once
+
+#include "image_io.h"
+#include "../core/job.h"
+#include "../raster/framebuffer.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace br
+{
+    //Writes rendered frames to disk on the job system so encoding (PNG compression especially) overlaps with rendering the next frame
+    struct image_writer
+    {
+        //Null writes every image on the calling thread
+        job_system* js = nullptr;
+
+        //Frames copied but not yet written. Submitting blocks (running jobs itself) once this reaches max_in_flight so memory stays bounded.
+        job_counter pending;
+        uint32_t max_in_flight = 8;
+
+        std::atomic<uint32_t> written{0};
+        std::atomic<uint32_t> failed{0};
+    };
+
+    //Copies the framebuffer's color and queues it to be encoded and written to path
+    void image_writer_submit(image_writer& writer, const std::string& path, image_format format, const framebuffer& fb);
+
+    //Waits for every submitted image to hit the disk
+    //@return true if nothing failed since the writer was created
+    bool image_writer_flush(image_writer& writer);
+}
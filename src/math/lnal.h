@@ -102,6 +102,7 @@ namespace lnal
 
         //Returns a pointer to the first element of the internal array
         float* data();
+        const float* data() const;
 
         mat4 transpose();
         mat4 inverse();
@@ -130,6 +131,12 @@ namespace lnal
     void gen_orthographic_proj(mat4& A, float left, float right, float bottom, float top, float near, float far);
     void lookat(mat4& A, vec3 cam_pos, vec3 cam_lookat, vec3 temp_up);
 
+    //Transforms a point (w = 1) by A
+    vec3 transform_point(const mat4& A, const vec3& point);
+
+    //Largest scale factor applied by the upper 3x3 of A (used to scale bounding spheres)
+    float max_scale(const mat4& A);
+
     vec3 cross(const vec3& a, const vec3& b);
     float dot(const vec3& a, const vec3& b);
 
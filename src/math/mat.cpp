@@ -238,6 +238,63 @@ namespace lnal
         return &m_data[0][0];
     }
 
+    const float* mat4::data() const
+    {
+        return &m_data[0][0];
+    }
+
+    //Returns the inverse through the adjugate (cofactors of the 2x2 sub-determinants). A singular matrix returns all zeros.
+    mat4 mat4::inverse()
+    {
+        //a[c][r] is column c, row r
+        const float (*a)[4] = m_data;
+
+        float s0 = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+        float s1 = a[0][0] * a[2][1] - a[0][1] * a[2][0];
+        float s2 = a[0][0] * a[3][1] - a[0][1] * a[3][0];
+        float s3 = a[1][0] * a[2][1] - a[1][1] * a[2][0];
+        float s4 = a[1][0] * a[3][1] - a[1][1] * a[3][0];
+        float s5 = a[2][0] * a[3][1] - a[2][1] * a[3][0];
+
+        float c5 = a[2][2] * a[3][3] - a[2][3] * a[3][2];
+        float c4 = a[1][2] * a[3][3] - a[1][3] * a[3][2];
+        float c3 = a[1][2] * a[2][3] - a[1][3] * a[2][2];
+        float c2 = a[0][2] * a[3][3] - a[0][3] * a[3][2];
+        float c1 = a[0][2] * a[2][3] - a[0][3] * a[2][2];
+        float c0 = a[0][2] * a[1][3] - a[0][3] * a[1][2];
+
+        float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+
+        mat4 result(0.0f);
+        if(det == 0.0f)
+            return result;
+
+        float inv = 1.0f / det;
+        float (*b)[4] = result.m_data;
+
+        b[0][0] = ( a[1][1] * c5 - a[2][1] * c4 + a[3][1] * c3) * inv;
+        b[1][0] = (-a[1][0] * c5 + a[2][0] * c4 - a[3][0] * c3) * inv;
+        b[2][0] = ( a[1][3] * s5 - a[2][3] * s4 + a[3][3] * s3) * inv;
+        b[3][0] = (-a[1][2] * s5 + a[2][2] * s4 - a[3][2] * s3) * inv;
+
+        b[0][1] = (-a[0][1] * c5 + a[2][1] * c2 - a[3][1] * c1) * inv;
+        b[1][1] = ( a[0][0] * c5 - a[2][0] * c2 + a[3][0] * c1) * inv;
+        b[2][1] = (-a[0][3] * s5 + a[2][3] * s2 - a[3][3] * s1) * inv;
+        b[3][1] = ( a[0][2] * s5 - a[2][2] * s2 + a[3][2] * s1) * inv;
+
+        b[0][2] = ( a[0][1] * c4 - a[1][1] * c2 + a[3][1] * c0) * inv;
+        b[1][2] = (-a[0][0] * c4 + a[1][0] * c2 - a[3][0] * c0) * inv;
+        b[2][2] = ( a[0][3] * s4 - a[1][3] * s2 + a[3][3] * s0) * inv;
+        b[3][2] = (-a[0][2] * s4 + a[1][2] * s2 - a[3][2] * s0) * inv;
+
+        b[0][3] = (-a[0][1] * c3 + a[1][1] * c1 - a[2][1] * c0) * inv;
+        b[1][3] = ( a[0][0] * c3 - a[1][0] * c1 + a[2][0] * c0) * inv;
+        b[2][3] = (-a[0][3] * s3 + a[1][3] * s1 - a[2][3] * s0) * inv;
+        b[3][3] = ( a[0][2] * s3 - a[1][2] * s1 + a[2][2] * s0) * inv;
+
+        return result;
+    }
+
     //Creates a perspective projection matrix for rendering.
     //@param A the matrix to place the final result in
     //@param fovx horizontal fov for the camera
@@ -282,25 +339,25 @@ namespace lnal
     //@param far far clipping plane
     void gen_orthographic_proj(mat4& A, float left, float right, float bottom, float top, float near, float far)
     {
-       /* A.m_data[0][0] = 
-        A.m_data[0][1] = 
-        A.m_data[0][2] = 
-        A.m_data[0][3] = 
-
-        A.m_data[1][0] = 
-        A.m_data[1][1] = 
-        A.m_data[1][2] = 
-        A.m_data[1][3] = 
-
-        A.m_data[2][0] = 
-        A.m_data[2][1] = 
-        A.m_data[2][2] = 
-        A.m_data[2][3] = 
-
-        A.m_data[3][0] = 
-        A.m_data[3][1] = 
-        A.m_data[3][2] = 
-        A.m_data[3][3] = */
+        A.m_data[0][0] = 2 / (right - left);
+        A.m_data[0][1] = 0;
+        A.m_data[0][2] = 0;
+        A.m_data[0][3] = 0;
+
+        A.m_data[1][0] = 0;
+        A.m_data[1][1] = 2 / (top - bottom);
+        A.m_data[1][2] = 0;
+        A.m_data[1][3] = 0;
+
+        A.m_data[2][0] = 0;
+        A.m_data[2][1] = 0;
+        A.m_data[2][2] = -2 / (far - near);
+        A.m_data[2][3] = 0;
+
+        A.m_data[3][0] = -((right + left) / (right - left));
+        A.m_data[3][1] = -((top + bottom) / (top - bottom));
+        A.m_data[3][2] = -((far + near) / (far - near));
+        A.m_data[3][3] = 1;
     }
 
     //Generates the view matrix given a specified orientation
@@ -428,4 +485,34 @@ namespace lnal
 
         A = rotation * A;
     }
+
+    //Transforms a point (w = 1) by A
+    //@param A transform to apply
+    //@param point point to transform
+    //@return Transformed point (no divide by w)
+    vec3 transform_point(const mat4& A, const vec3& point)
+    {
+        const float* m = A.data();
+
+        return vec3(m[0] * point[0] + m[4] * point[1] + m[8] * point[2] + m[12],
+                    m[1] * point[0] + m[5] * point[1] + m[9] * point[2] + m[13],
+                    m[2] * point[0] + m[6] * point[1] + m[10] * point[2] + m[14]);
+    }
+
+    //Largest scale factor applied by the upper 3x3 of A (used to scale bounding spheres)
+    //@param A transform to measure
+    //@return Length of the longest basis vector
+    float max_scale(const mat4& A)
+    {
+        const float* m = A.data();
+
+        float sx = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+        float sy = m[4] * m[4] + m[5] * m[5] + m[6] * m[6];
+        float sz = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+
+        float s = sx > sy ? sx : sy;
+        s = s > sz ? s : sz;
+
+        return sqrt(s);
+    }
 }
@@ -0,0 +1,163 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Bit packing helpers for compressed vertex and surface formats (half floats, octahedral normals, normalized integers).
+
+
+    Half Floats -
+        Done with integer bit manipulation instead of F16C instructions so it works on every target we build for. This only runs at import time so the speed
+        of the conversion itself doesn't matter.
+
+
+    Octahedral Normals -
+        A unit vector is projected onto the octahedron |x| + |y| + |z| = 1. The upper half (z >= 0) maps straight onto the square |x| + |y| <= 1 and the
+        lower half is folded out over the corners. Two numbers in [-1, 1] are left, which quantize far better than three components of a unit vector
+        (16 bits per component gives a worst case error of a few hundredths of a degree).
+
+    References -
+        A Survey of Efficient Representations for Independent Unit Vectors - https://jcgt.org/published/0003/02/01/
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "pack.h"
+#include <cmath>
+#include <cstring>
+
+namespace lnal
+{
+    //Converts a 32 bit float to IEEE half precision (round to nearest even, overflow goes to infinity)
+    uint16_t float_to_half(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        uint32_t sign = (bits >> 16) & 0x8000;
+        int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+        uint32_t mantissa = bits & 0x007FFFFF;
+
+        //NaN and infinity
+        if(((bits >> 23) & 0xFF) == 0xFF)
+            return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+
+        //Too big, goes to infinity
+        if(exponent >= 31)
+            return (uint16_t)(sign | 0x7C00);
+
+        //Too small even for a denormal
+        if(exponent < -10)
+            return (uint16_t)sign;
+
+        if(exponent <= 0)
+        {
+            //Denormal: shift the mantissa (with the implicit 1) into place and round
+            mantissa |= 0x00800000;
+            uint32_t shift = (uint32_t)(14 - exponent);
+            uint32_t half_mantissa = mantissa >> shift;
+            uint32_t remainder = mantissa & ((1u << shift) - 1);
+            uint32_t halfway = 1u << (shift - 1);
+
+            if(remainder > halfway || (remainder == halfway && (half_mantissa & 1)))
+                half_mantissa++;
+
+            return (uint16_t)(sign | half_mantissa);
+        }
+
+        uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+        uint32_t remainder = mantissa & 0x1FFF;
+
+        //Round to nearest even. A carry out of the mantissa correctly bumps the exponent.
+        if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+            half++;
+
+        return (uint16_t)half;
+    }
+
+    //Converts an IEEE half precision value back to a 32 bit float
+    float half_to_float(uint16_t value)
+    {
+        uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+        uint32_t exponent = (value >> 10) & 0x1F;
+        uint32_t mantissa = value & 0x3FF;
+        uint32_t bits;
+
+        if(exponent == 0)
+        {
+            if(mantissa == 0)
+            {
+                bits = sign;
+            }
+            else
+            {
+                //Denormal, renormalize it
+                exponent = 127 - 15 + 1;
+                while((mantissa & 0x400) == 0)
+                {
+                    mantissa <<= 1;
+                    exponent--;
+                }
+
+                bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+            }
+        }
+        else if(exponent == 31)
+        {
+            bits = sign | 0x7F800000 | (mantissa << 13);
+        }
+        else
+        {
+            bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+        }
+
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    //Maps a unit vector onto the octahedron and unfolds it into a square
+    //@param n unit vector to encode
+    //@param out two values in [-1, 1]
+    void oct_encode(const float* n, float* out)
+    {
+        float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+        if(l1 == 0.0f)
+        {
+            out[0] = 0.0f;
+            out[1] = 0.0f;
+            return;
+        }
+
+        float x = n[0] / l1;
+        float y = n[1] / l1;
+
+        if(n[2] < 0.0f)
+        {
+            float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = fx;
+            y = fy;
+        }
+
+        out[0] = x;
+        out[1] = y;
+    }
+
+    //Inverse of oct_encode. The result is normalized.
+    void oct_decode(const float* in, float* n)
+    {
+        float x = in[0];
+        float y = in[1];
+        float z = 1.0f - fabsf(x) - fabsf(y);
+
+        if(z < 0.0f)
+        {
+            float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = fx;
+            y = fy;
+        }
+
+        float len = sqrtf((x * x) + (y * y) + (z * z));
+        n[0] = x / len;
+        n[1] = y / len;
+        n[2] = z / len;
+    }
+}
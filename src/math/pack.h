@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lnal
+{
+    //Converts a 32 bit float to IEEE half precision (round to nearest even, overflow goes to infinity)
+    uint16_t float_to_half(float value);
+
+    //Converts an IEEE half precision value back to a 32 bit float
+    float half_to_float(uint16_t value);
+
+    //Maps a unit vector onto the octahedron and unfolds it into a square
+    //@param n unit vector to encode
+    //@param out two values in [-1, 1]
+    void oct_encode(const float* n, float* out);
+
+    //Inverse of oct_encode. The result is normalized.
+    void oct_decode(const float* in, float* n);
+
+    //Converts a value in [0, 1] to an unsigned normalized integer with the given bit count
+    inline uint32_t pack_unorm(float value, uint32_t bits)
+    {
+        float max = (float)((1u << bits) - 1);
+        value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+        return (uint32_t)(value * max + 0.5f);
+    }
+
+    inline float unpack_unorm(uint32_t value, uint32_t bits)
+    {
+        return (float)value / (float)((1u << bits) - 1);
+    }
+
+    //Converts a value in [-1, 1] to a signed normalized integer with the given bit count
+    inline int32_t pack_snorm(float value, uint32_t bits)
+    {
+        float max = (float)((1u << (bits - 1)) - 1);
+        value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+        return (int32_t)(value * max + (value >= 0.0f ? 0.5f : -0.5f));
+    }
+
+    inline float unpack_snorm(int32_t value, uint32_t bits)
+    {
+        float max = (float)((1u << (bits - 1)) - 1);
+        float result = (float)value / max;
+        return result < -1.0f ? -1.0f : result;
+    }
+}
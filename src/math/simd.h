@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+//4 wide SIMD types used by the CPU rasterizer and samplers.
+//SSE2 is part of every x86-64 target so it is used whenever the compiler says it is available. Everything else gets a plain array fallback with the
+//same semantics, which the compiler is usually able to auto vectorize anyway.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LNAL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace lnal
+{
+#ifdef LNAL_SSE2
+
+    struct f32x4 { __m128 v; };
+    struct i32x4 { __m128i v; };
+
+    //Lane mask (all bits set = true) produced by comparisons
+    struct mask4 { __m128 v; };
+
+    inline f32x4 f32x4_splat(float a) { return { _mm_set1_ps(a) }; }
+    inline f32x4 f32x4_set(float a, float b, float c, float d) { return { _mm_setr_ps(a, b, c, d) }; }
+    inline f32x4 f32x4_load(const float* p) { return { _mm_loadu_ps(p) }; }
+    inline void f32x4_store(float* p, f32x4 a) { _mm_storeu_ps(p, a.v); }
+
+    inline f32x4 operator+(f32x4 a, f32x4 b) { return { _mm_add_ps(a.v, b.v) }; }
+    inline f32x4 operator-(f32x4 a, f32x4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+    inline f32x4 operator*(f32x4 a, f32x4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+    inline f32x4 operator/(f32x4 a, f32x4 b) { return { _mm_div_ps(a.v, b.v) }; }
+    inline f32x4 min(f32x4 a, f32x4 b) { return { _mm_min_ps(a.v, b.v) }; }
+    inline f32x4 max(f32x4 a, f32x4 b) { return { _mm_max_ps(a.v, b.v) }; }
+    inline f32x4 sqrt(f32x4 a) { return { _mm_sqrt_ps(a.v) }; }
+
+    inline mask4 operator<(f32x4 a, f32x4 b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+    inline mask4 operator<=(f32x4 a, f32x4 b) { return { _mm_cmple_ps(a.v, b.v) }; }
+    inline mask4 operator>(f32x4 a, f32x4 b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+    inline mask4 operator>=(f32x4 a, f32x4 b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+
+    inline mask4 operator&(mask4 a, mask4 b) { return { _mm_and_ps(a.v, b.v) }; }
+    inline mask4 operator|(mask4 a, mask4 b) { return { _mm_or_ps(a.v, b.v) }; }
+    inline mask4 andnot(mask4 a, mask4 b) { return { _mm_andnot_ps(b.v, a.v) }; }    //a & ~b
+
+    //Bit i is set when lane i is true
+    inline int mask_bits(mask4 m) { return _mm_movemask_ps(m.v); }
+
+    //Lane wise m ? a : b
+    inline f32x4 select(mask4 m, f32x4 a, f32x4 b) { return { _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)) }; }
+    inline i32x4 select(mask4 m, i32x4 a, i32x4 b)
+    {
+        __m128i mi = _mm_castps_si128(m.v);
+        return { _mm_or_si128(_mm_and_si128(mi, a.v), _mm_andnot_si128(mi, b.v)) };
+    }
+
+    //Rounds towards negative infinity (SSE2 has no round instruction so truncate and fix up negative values)
+    inline f32x4 floor(f32x4 a)
+    {
+        __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+        return { _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f))) };
+    }
+
+    inline i32x4 i32x4_splat(int32_t a) { return { _mm_set1_epi32(a) }; }
+    inline i32x4 i32x4_set(int32_t a, int32_t b, int32_t c, int32_t d) { return { _mm_setr_epi32(a, b, c, d) }; }
+    inline i32x4 i32x4_load(const int32_t* p) { return { _mm_loadu_si128((const __m128i*)p) }; }
+    inline void i32x4_store(int32_t* p, i32x4 a) { _mm_storeu_si128((__m128i*)p, a.v); }
+
+    inline i32x4 operator+(i32x4 a, i32x4 b) { return { _mm_add_epi32(a.v, b.v) }; }
+    inline i32x4 operator-(i32x4 a, i32x4 b) { return { _mm_sub_epi32(a.v, b.v) }; }
+    inline i32x4 operator&(i32x4 a, i32x4 b) { return { _mm_and_si128(a.v, b.v) }; }
+    inline i32x4 operator|(i32x4 a, i32x4 b) { return { _mm_or_si128(a.v, b.v) }; }
+    inline i32x4 operator<<(i32x4 a, int n) { return { _mm_slli_epi32(a.v, n) }; }
+    inline i32x4 operator>>(i32x4 a, int n) { return { _mm_srai_epi32(a.v, n) }; }
+    inline i32x4 shift_right_logical(i32x4 a, int n) { return { _mm_srli_epi32(a.v, n) }; }
+
+    //SSE2 only multiplies even lanes to 64 bits, so do even and odd lanes separately and shuffle the low halves back together
+    inline i32x4 operator*(i32x4 a, i32x4 b)
+    {
+        __m128i even = _mm_mul_epu32(a.v, b.v);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.v, 32), _mm_srli_epi64(b.v, 32));
+        return { _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))) };
+    }
+
+    inline mask4 operator<(i32x4 a, i32x4 b) { return { _mm_castsi128_ps(_mm_cmplt_epi32(a.v, b.v)) }; }
+    inline mask4 operator>(i32x4 a, i32x4 b) { return { _mm_castsi128_ps(_mm_cmpgt_epi32(a.v, b.v)) }; }
+    inline mask4 operator==(i32x4 a, i32x4 b) { return { _mm_castsi128_ps(_mm_cmpeq_epi32(a.v, b.v)) }; }
+
+    //Truncates towards zero
+    inline i32x4 to_int(f32x4 a) { return { _mm_cvttps_epi32(a.v) }; }
+    inline f32x4 to_float(i32x4 a) { return { _mm_cvtepi32_ps(a.v) }; }
+
+#else
+
+    struct f32x4 { float v[4]; };
+    struct i32x4 { int32_t v[4]; };
+    struct mask4 { int32_t v[4]; };
+
+    inline f32x4 f32x4_splat(float a) { return { { a, a, a, a } }; }
+    inline f32x4 f32x4_set(float a, float b, float c, float d) { return { { a, b, c, d } }; }
+    inline f32x4 f32x4_load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+    inline void f32x4_store(float* p, f32x4 a) { for(int i = 0; i < 4; i++) p[i] = a.v[i]; }
+
+    inline f32x4 operator+(f32x4 a, f32x4 b) { f32x4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] + b.v[i]; return r; }
+    inline f32x4 operator-(f32x4 a, f32x4 b) { f32x4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] - b.v[i]; return r; }
+    inline f32x4 operator*(f32x4 a, f32x4 b) { f32x4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] * b.v[i]; return r; }
+    inline f32x4 operator/(f32x4 a, f32x4 b) { f32x4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] / b.v[i]; return r; }
+    inline f32x4 min(f32x4 a, f32x4 b) { f32x4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return r; }
+    inline f32x4 max(f32x4 a, f32x4 b) { f32x4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r; }
+    inline f32x4 sqrt(f32x4 a) { f32x4 r; for(int i = 0; i < 4; i++) r.v[i] = sqrtf(a.v[i]); return r; }
+
+    inline mask4 operator<(f32x4 a, f32x4 b) { mask4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] < b.v[i] ? -1 : 0; return r; }
+    inline mask4 operator<=(f32x4 a, f32x4 b) { mask4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] <= b.v[i] ? -1 : 0; return r; }
+    inline mask4 operator>(f32x4 a, f32x4 b) { mask4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] > b.v[i] ? -1 : 0; return r; }
+    inline mask4 operator>=(f32x4 a, f32x4 b) { mask4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] >= b.v[i] ? -1 : 0; return r; }
+
+    inline mask4 operator&(mask4 a, mask4 b) { mask4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] & b.v[i]; return r; }
+    inline mask4 operator|(mask4 a, mask4 b) { mask4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] | b.v[i]; return r; }
+    inline mask4 andnot(mask4 a, mask4 b) { mask4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] & ~b.v[i]; return r; }
+
+    inline int mask_bits(mask4 m) { int bits = 0; for(int i = 0; i < 4; i++) bits |= (m.v[i] ? 1 : 0) << i; return bits; }
+
+    inline f32x4 select(mask4 m, f32x4 a, f32x4 b) { f32x4 r; for(int i = 0; i < 4; i++) r.v[i] = m.v[i] ? a.v[i] : b.v[i]; return r; }
+    inline i32x4 select(mask4 m, i32x4 a, i32x4 b) { i32x4 r; for(int i = 0; i < 4; i++) r.v[i] = m.v[i] ? a.v[i] : b.v[i]; return r; }
+
+    inline f32x4 floor(f32x4 a) { f32x4 r; for(int i = 0; i < 4; i++) r.v[i] = floorf(a.v[i]); return r; }
+
+    inline i32x4 i32x4_splat(int32_t a) { return { { a, a, a, a } }; }
+    inline i32x4 i32x4_set(int32_t a, int32_t b, int32_t c, int32_t d) { return { { a, b, c, d } }; }
+    inline i32x4 i32x4_load(const int32_t* p) { return { { p[0], p[1], p[2], p[3] } }; }
+    inline void i32x4_store(int32_t* p, i32x4 a) { for(int i = 0; i < 4; i++) p[i] = a.v[i]; }
+
+    inline i32x4 operator+(i32x4 a, i32x4 b) { i32x4 r; for(int i = 0; i < 4; i++) r.v[i] = (int32_t)((uint32_t)a.v[i] + (uint32_t)b.v[i]); return r; }
+    inline i32x4 operator-(i32x4 a, i32x4 b) { i32x4 r; for(int i = 0; i < 4; i++) r.v[i] = (int32_t)((uint32_t)a.v[i] - (uint32_t)b.v[i]); return r; }
+    inline i32x4 operator*(i32x4 a, i32x4 b) { i32x4 r; for(int i = 0; i < 4; i++) r.v[i] = (int32_t)((uint32_t)a.v[i] * (uint32_t)b.v[i]); return r; }
+    inline i32x4 operator&(i32x4 a, i32x4 b) { i32x4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] & b.v[i]; return r; }
+    inline i32x4 operator|(i32x4 a, i32x4 b) { i32x4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] | b.v[i]; return r; }
+    inline i32x4 operator<<(i32x4 a, int n) { i32x4 r; for(int i = 0; i < 4; i++) r.v[i] = (int32_t)((uint32_t)a.v[i] << n); return r; }
+    inline i32x4 operator>>(i32x4 a, int n) { i32x4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] >> n; return r; }
+    inline i32x4 shift_right_logical(i32x4 a, int n) { i32x4 r; for(int i = 0; i < 4; i++) r.v[i] = (int32_t)((uint32_t)a.v[i] >> n); return r; }
+
+    inline mask4 operator<(i32x4 a, i32x4 b) { mask4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] < b.v[i] ? -1 : 0; return r; }
+    inline mask4 operator>(i32x4 a, i32x4 b) { mask4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] > b.v[i] ? -1 : 0; return r; }
+    inline mask4 operator==(i32x4 a, i32x4 b) { mask4 r; for(int i = 0; i < 4; i++) r.v[i] = a.v[i] == b.v[i] ? -1 : 0; return r; }
+
+    inline i32x4 to_int(f32x4 a) { i32x4 r; for(int i = 0; i < 4; i++) r.v[i] = (int32_t)a.v[i]; return r; }
+    inline f32x4 to_float(i32x4 a) { f32x4 r; for(int i = 0; i < 4; i++) r.v[i] = (float)a.v[i]; return r; }
+
+#endif
+
+    //Fused helpers built from the basic ops
+    inline f32x4 lerp(f32x4 a, f32x4 b, f32x4 t) { return a + ((b - a) * t); }
+    inline f32x4 clamp(f32x4 a, f32x4 lo, f32x4 hi) { return min(max(a, lo), hi); }
+    inline bool any(mask4 m) { return mask_bits(m) != 0; }
+    inline bool all(mask4 m) { return mask_bits(m) == 0xF; }
+
+    inline int mask_count(mask4 m)
+    {
+        static const int COUNTS[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+        return COUNTS[mask_bits(m)];
+    }
+}
@@ -0,0 +1,252 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Mesh import. Turns OBJ files into indexed meshes with separate attribute arrays.
+
+
+    Vertex Merging -
+        OBJ faces index positions, normals and uvs separately while the GPU (and our CPU pipeline) wants one index per vertex. Every unique
+        (position, normal, uv) triple becomes one vertex, so a smooth mesh ends up with roughly as many vertices as positions and a flat shaded mesh ends up
+        with one vertex per face corner. With a material library the face's material is part of the key as well, so a vertex on the border between
+        two materials is split like one on a uv seam.
+
+
+    Materials -
+        The .mtl libraries an OBJ references are looked up next to the OBJ, and texture paths inside them are relative to it as well. Their
+        materials are added to the caller's library (material.h) and every vertex gets its face's material id. Faces without a material use the
+        library's default material.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "mesh.h"
+#include "../scene/material.h"
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+namespace br
+{
+    struct obj_vertex_key
+    {
+        int position;
+        int normal;
+        int uv;
+        uint32_t material;
+
+        bool operator==(const obj_vertex_key& rhs) const
+        {
+            return position == rhs.position && normal == rhs.normal && uv == rhs.uv && material == rhs.material;
+        }
+    };
+
+    struct obj_vertex_hash
+    {
+        size_t operator()(const obj_vertex_key& key) const
+        {
+            return ((size_t)key.position * 73856093u) ^ ((size_t)key.normal * 19349663u) ^ ((size_t)key.uv * 83492791u) ^ ((size_t)key.material * 2654435761u);
+        }
+    };
+
+    //Directory part of a path including the trailing slash, "./" for a bare file name
+    static std::string directory_of(const char* path)
+    {
+        std::string p = path;
+        size_t slash = p.find_last_of("/\\");
+        return slash == std::string::npos ? std::string("./") : p.substr(0, slash + 1);
+    }
+
+    static std::string texture_path(const std::string& directory, const std::string& name)
+    {
+        if(name.empty() || name[0] == '/')
+            return name;
+        return directory + name;
+    }
+
+    //Adds the file's materials to the library
+    //@param ids receives the library id of each of the file's materials
+    static void add_materials(material_library& lib, const std::vector<tinyobj::material_t>& materials, const std::string& directory, std::vector<uint32_t>& ids)
+    {
+        material_default(lib);
+
+        for(const tinyobj::material_t& mat : materials)
+        {
+            material_desc desc;
+            desc.name = mat.name;
+            for(int k = 0; k < 3; k++)
+            {
+                desc.diffuse[k] = mat.diffuse[k];
+                desc.specular[k] = mat.specular[k];
+                desc.emission[k] = mat.emission[k];
+            }
+            desc.shininess = mat.shininess;
+            desc.opacity = mat.dissolve;
+            desc.illum = mat.illum < 0 ? 0 : (uint32_t)mat.illum;
+
+            desc.textures[MATERIAL_DIFFUSE_MAP] = texture_path(directory, mat.diffuse_texname);
+            desc.textures[MATERIAL_NORMAL_MAP] = texture_path(directory, mat.normal_texname.empty() ? mat.bump_texname : mat.normal_texname);
+            desc.textures[MATERIAL_SPECULAR_MAP] = texture_path(directory, mat.specular_texname);
+
+            ids.push_back(material_add(lib, desc));
+        }
+    }
+
+    //Loads an OBJ file into an indexed mesh. Vertices that share position, normal, uv and material are merged.
+    //@param m mesh to fill
+    //@param path path to the .obj file
+    //@param materials optional, receives the materials of the file's .mtl libraries and fills mesh.materials with their ids (if the file has
+    //       any). Null ignores them.
+    //@return false if the file couldn't be parsed
+    bool load_obj(mesh& m, const char* path, material_library* materials)
+    {
+        std::string directory = directory_of(path);
+
+        tinyobj::ObjReader reader;
+        tinyobj::ObjReaderConfig reader_config;
+        reader_config.mtl_search_path = directory;
+        reader_config.triangulate = true;
+
+        if(!reader.ParseFromFile(path, reader_config))
+        {
+            if(!reader.Error().empty())
+            {
+                std::cerr << reader.Error();
+            }
+
+            return false;
+        }
+
+        if(!reader.Warning().empty())
+        {
+            std::cout << reader.Warning();
+        }
+
+        const tinyobj::attrib_t& attrib = reader.GetAttrib();
+        const std::vector<tinyobj::shape_t>& shapes = reader.GetShapes();
+
+        //Only keep attribute streams that every vertex can fill in
+        bool has_normals = !attrib.normals.empty();
+        bool has_uvs = !attrib.texcoords.empty();
+
+        size_t corner_count = 0;
+        for(const tinyobj::shape_t& shape : shapes)
+        {
+            corner_count += shape.mesh.indices.size();
+
+            for(const tinyobj::index_t& index : shape.mesh.indices)
+            {
+                has_normals &= index.normal_index >= 0;
+                has_uvs &= index.texcoord_index >= 0;
+            }
+        }
+
+        //File material index to library id. Faces without a material (index -1) get the library's default material. A file without any
+        //materials leaves mesh.materials empty, every vertex would have the default.
+        std::vector<uint32_t> material_ids;
+        if(materials)
+            add_materials(*materials, reader.GetMaterials(), directory, material_ids);
+
+        bool has_materials = !material_ids.empty();
+
+        m = mesh{};
+        m.indices.reserve(corner_count);
+
+        std::unordered_map<obj_vertex_key, uint32_t, obj_vertex_hash> vertex_ids;
+        vertex_ids.reserve(corner_count);
+
+        for(const tinyobj::shape_t& shape : shapes)
+        {
+            for(size_t c = 0; c < shape.mesh.indices.size(); c++)
+            {
+                const tinyobj::index_t& index = shape.mesh.indices[c];
+
+                uint32_t material = 0;
+                if(has_materials)
+                {
+                    int face_material = (c / 3) < shape.mesh.material_ids.size() ? shape.mesh.material_ids[c / 3] : -1;
+                    material = face_material >= 0 && (size_t)face_material < material_ids.size() ? material_ids[face_material] : 0;
+                }
+
+                obj_vertex_key key = { index.vertex_index, has_normals ? index.normal_index : -1, has_uvs ? index.texcoord_index : -1, material };
+
+                auto found = vertex_ids.find(key);
+                if(found != vertex_ids.end())
+                {
+                    m.indices.push_back(found->second);
+                    continue;
+                }
+
+                uint32_t id = mesh_vertex_count(m);
+                vertex_ids.emplace(key, id);
+                m.indices.push_back(id);
+
+                m.positions.push_back(attrib.vertices[key.position * 3]);
+                m.positions.push_back(attrib.vertices[(key.position * 3) + 1]);
+                m.positions.push_back(attrib.vertices[(key.position * 3) + 2]);
+
+                if(has_normals)
+                {
+                    m.normals.push_back(attrib.normals[key.normal * 3]);
+                    m.normals.push_back(attrib.normals[(key.normal * 3) + 1]);
+                    m.normals.push_back(attrib.normals[(key.normal * 3) + 2]);
+                }
+
+                if(has_uvs)
+                {
+                    m.uvs.push_back(attrib.texcoords[key.uv * 2]);
+                    m.uvs.push_back(attrib.texcoords[(key.uv * 2) + 1]);
+                }
+
+                if(has_materials)
+                    m.materials.push_back(material);
+            }
+        }
+
+        m.lods.push_back({ 0, (uint32_t)m.indices.size(), 0.0f });
+
+        compute_bounds(m);
+
+        return true;
+    }
+
+    //Recomputes the box and sphere bounds from the positions
+    void compute_bounds(mesh& m)
+    {
+        uint32_t count = mesh_vertex_count(m);
+
+        for(int i = 0; i < 3; i++)
+        {
+            m.bounds_min[i] = count ? m.positions[i] : 0.0f;
+            m.bounds_max[i] = count ? m.positions[i] : 0.0f;
+        }
+
+        for(uint32_t v = 0; v < count; v++)
+        {
+            for(int i = 0; i < 3; i++)
+            {
+                float p = m.positions[(v * 3) + i];
+                m.bounds_min[i] = p < m.bounds_min[i] ? p : m.bounds_min[i];
+                m.bounds_max[i] = p > m.bounds_max[i] ? p : m.bounds_max[i];
+            }
+        }
+
+        //Sphere around the box center. Not the tightest sphere but it is cheap and stable.
+        float radius_sqr = 0.0f;
+        for(int i = 0; i < 3; i++)
+        {
+            m.center[i] = (m.bounds_min[i] + m.bounds_max[i]) * 0.5f;
+        }
+
+        for(uint32_t v = 0; v < count; v++)
+        {
+            float dx = m.positions[v * 3] - m.center[0];
+            float dy = m.positions[(v * 3) + 1] - m.center[1];
+            float dz = m.positions[(v * 3) + 2] - m.center[2];
+            float d = (dx * dx) + (dy * dy) + (dz * dz);
+            radius_sqr = d > radius_sqr ? d : radius_sqr;
+        }
+
+        m.radius = sqrtf(radius_sqr);
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    struct material_library;
+
+    //Range of mesh.indices that makes up one level of detail
+    struct mesh_lod
+    {
+        uint32_t index_offset;
+        uint32_t index_count;
+
+        //Object space distance between this LOD and the full resolution surface: the largest distance of a collapsed vertex from the original
+        //planes it replaced (simplify), added up over the levels in between
+        float error;
+    };
+
+    //Indexed triangle mesh with one array per vertex attribute.
+    //normals and uvs are empty if the source file didn't have them, tangents are only filled by generate_tangents (normals.h), materials only when
+    //load_obj is given a material library.
+    struct mesh
+    {
+        std::vector<float> positions;   //xyz per vertex
+        std::vector<float> normals;     //xyz per vertex
+        std::vector<float> uvs;         //uv per vertex
+        std::vector<float> tangents;    //xyzw per vertex, w = +-1 is the bitangent sign: bitangent = w * cross(normal, tangent)
+        std::vector<uint32_t> materials;    //Material id per vertex (material.h)
+
+        //Index data for every LOD back to back. lods[0] is always the full resolution mesh.
+        std::vector<uint32_t> indices;
+        std::vector<mesh_lod> lods;
+
+        //Object space bounds
+        float bounds_min[3];
+        float bounds_max[3];
+        float center[3];
+        float radius;
+    };
+
+    inline uint32_t mesh_vertex_count(const mesh& m) { return (uint32_t)(m.positions.size() / 3); }
+
+    //Loads an OBJ file into an indexed mesh. Vertices that share position, normal, uv and material are merged.
+    //@param m mesh to fill
+    //@param path path to the .obj file
+    //@param materials optional, receives the materials of the file's .mtl libraries and fills mesh.materials with their ids (if the file has
+    //       any). Null ignores them.
+    //@return false if the file couldn't be parsed
+    bool load_obj(mesh& m, const char* path, material_library* materials = nullptr);
+
+    //Recomputes the box and sphere bounds from the positions
+    void compute_bounds(mesh& m);
+}
@@ -0,0 +1,278 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Meshlet building and per-cluster culling.
+
+
+    Building -
+        Meshlets are grown greedily. We start from the first unused triangle and keep adding the unused neighbour (a triangle sharing a vertex with the
+        meshlet) that brings in the fewest new vertices, until either limit is hit or there are no neighbours left. Favouring triangles that add no new
+        vertices keeps the patches round and compact, which makes their bounding spheres and normal cones tight.
+
+
+    Cone Culling -
+        Each meshlet stores a cone (axis a, half angle t) containing every triangle normal. A triangle faces away from the camera at e when
+        dot(n, p - e) >= 0. If the direction from the camera to every point of the meshlet is within 90 - t degrees of a, every normal is within 90 degrees of
+        that direction and the whole meshlet is back-facing. Bounding the points by the meshlet's sphere (c, r) gives the conservative test
+
+            dot(c - e, a) - r >= sin(t) * (|c - e| + r)
+
+        which is what cull_meshlets uses. The denser the mesh, the flatter each 64 vertex patch is and the narrower its cone, so this pays off most on
+        exactly the meshes where object level culling leaves the most work.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "meshlet.h"
+#include "../scene/frustum.h"
+#include <cmath>
+
+namespace br
+{
+    static const uint8_t NOT_IN_MESHLET = 0xFF;
+
+    //Fills in the bounds and cone of the last meshlet in the set
+    static void finish_meshlet(meshlet_set& set, const mesh& m)
+    {
+        meshlet& ml = set.meshlets.back();
+
+        float lo[3] = { 1e30f, 1e30f, 1e30f };
+        float hi[3] = { -1e30f, -1e30f, -1e30f };
+
+        for(uint32_t i = 0; i < ml.vertex_count; i++)
+        {
+            const float* p = &m.positions[set.vertices[ml.vertex_offset + i] * 3];
+            for(int k = 0; k < 3; k++)
+            {
+                lo[k] = p[k] < lo[k] ? p[k] : lo[k];
+                hi[k] = p[k] > hi[k] ? p[k] : hi[k];
+            }
+        }
+
+        float radius_sqr = 0.0f;
+        for(int k = 0; k < 3; k++)
+        {
+            ml.center[k] = (lo[k] + hi[k]) * 0.5f;
+        }
+
+        for(uint32_t i = 0; i < ml.vertex_count; i++)
+        {
+            const float* p = &m.positions[set.vertices[ml.vertex_offset + i] * 3];
+            float dx = p[0] - ml.center[0];
+            float dy = p[1] - ml.center[1];
+            float dz = p[2] - ml.center[2];
+            float d = (dx * dx) + (dy * dy) + (dz * dz);
+            radius_sqr = d > radius_sqr ? d : radius_sqr;
+        }
+
+        ml.radius = sqrtf(radius_sqr);
+
+        //Cone axis is the average unit normal, the spread is the worst normal
+        std::vector<lnal::vec3> normals;
+        normals.reserve(ml.triangle_count);
+
+        lnal::vec3 axis;
+        for(uint32_t t = 0; t < ml.triangle_count; t++)
+        {
+            const uint32_t* tri = &set.indices[ml.index_offset + (t * 3)];
+            const float* p0 = &m.positions[tri[0] * 3];
+            const float* p1 = &m.positions[tri[1] * 3];
+            const float* p2 = &m.positions[tri[2] * 3];
+
+            lnal::vec3 n = lnal::cross(lnal::vec3(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]), lnal::vec3(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]));
+            float len = n.len();
+            if(len == 0.0f)
+                continue;
+
+            n *= 1.0f / len;
+            normals.push_back(n);
+            axis += n;
+        }
+
+        float axis_len = axis.len();
+        float min_dot = 1.0f;
+
+        if(axis_len > 0.0f)
+        {
+            axis *= 1.0f / axis_len;
+
+            for(const lnal::vec3& n : normals)
+            {
+                float d = lnal::dot(n, axis);
+                min_dot = d < min_dot ? d : min_dot;
+            }
+        }
+
+        ml.cone_axis[0] = axis[0];
+        ml.cone_axis[1] = axis[1];
+        ml.cone_axis[2] = axis[2];
+
+        //A cone of 90 degrees or more can always be seen from the front somewhere
+        ml.cone_cutoff = (axis_len > 0.0f && min_dot > 0.0f) ? sqrtf(1.0f - (min_dot * min_dot)) : 1.0f;
+    }
+
+    //Splits a triangle list into meshlets of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles.
+    //Triangles are grown from neighbours so each meshlet is a compact patch of the surface.
+    //@param set meshlet set to fill
+    //@param m mesh that owns the vertex data
+    //@param indices triangle list to split (usually one LOD range of mesh.indices)
+    //@param index_count number of indices in the triangle list
+    void build_meshlets(meshlet_set& set, const mesh& m, const uint32_t* indices, uint32_t index_count)
+    {
+        set = meshlet_set{};
+
+        uint32_t vertex_count = mesh_vertex_count(m);
+        uint32_t tri_count = index_count / 3;
+
+        //Triangles around each vertex
+        std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+        for(uint32_t i = 0; i < index_count; i++)
+        {
+            adjacency_offsets[indices[i] + 1]++;
+        }
+
+        for(uint32_t v = 0; v < vertex_count; v++)
+        {
+            adjacency_offsets[v + 1] += adjacency_offsets[v];
+        }
+
+        std::vector<uint32_t> adjacency(index_count);
+        std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for(uint32_t i = 0; i < index_count; i++)
+        {
+            adjacency[fill[indices[i]]++] = i / 3;
+        }
+
+        std::vector<uint8_t> used(tri_count, 0);
+        std::vector<uint8_t> local(vertex_count, NOT_IN_MESHLET);
+        uint32_t seed = 0;
+
+        set.indices.reserve(index_count);
+        set.triangles.reserve(index_count);
+
+        while(true)
+        {
+            while(seed < tri_count && used[seed])
+            {
+                seed++;
+            }
+
+            if(seed == tri_count)
+                break;
+
+            meshlet ml = {};
+            ml.vertex_offset = (uint32_t)set.vertices.size();
+            ml.triangle_offset = (uint32_t)set.triangles.size();
+            ml.index_offset = (uint32_t)set.indices.size();
+
+            uint32_t next = seed;
+
+            while(true)
+            {
+                const uint32_t* tri = &indices[next * 3];
+                used[next] = 1;
+
+                for(int k = 0; k < 3; k++)
+                {
+                    if(local[tri[k]] == NOT_IN_MESHLET)
+                    {
+                        local[tri[k]] = (uint8_t)ml.vertex_count++;
+                        set.vertices.push_back(tri[k]);
+                    }
+
+                    set.triangles.push_back(local[tri[k]]);
+                    set.indices.push_back(tri[k]);
+                }
+
+                ml.triangle_count++;
+
+                if(ml.triangle_count == MESHLET_MAX_TRIANGLES)
+                    break;
+
+                //Neighbour that adds the fewest new vertices
+                uint32_t best = tri_count;
+                uint32_t best_new = 4;
+
+                for(uint32_t i = 0; i < ml.vertex_count && best_new > 0; i++)
+                {
+                    uint32_t v = set.vertices[ml.vertex_offset + i];
+
+                    for(uint32_t a = adjacency_offsets[v]; a < adjacency_offsets[v + 1]; a++)
+                    {
+                        uint32_t t = adjacency[a];
+                        if(used[t])
+                            continue;
+
+                        const uint32_t* candidate = &indices[t * 3];
+                        uint32_t new_vertices = (local[candidate[0]] == NOT_IN_MESHLET) + (local[candidate[1]] == NOT_IN_MESHLET) + (local[candidate[2]] == NOT_IN_MESHLET);
+
+                        if(ml.vertex_count + new_vertices > MESHLET_MAX_VERTICES)
+                            continue;
+
+                        if(new_vertices < best_new)
+                        {
+                            best = t;
+                            best_new = new_vertices;
+                        }
+                    }
+                }
+
+                if(best == tri_count)
+                    break;
+
+                next = best;
+            }
+
+            for(uint32_t i = 0; i < ml.vertex_count; i++)
+            {
+                local[set.vertices[ml.vertex_offset + i]] = NOT_IN_MESHLET;
+            }
+
+            set.meshlets.push_back(ml);
+            finish_meshlet(set, m);
+        }
+    }
+
+    //Appends the index of every meshlet that is inside the frustum and has at least one triangle facing the camera
+    //@param set meshlets to test
+    //@param model object to world transform of the mesh
+    //@param f world space frustum
+    //@param camera_pos world space camera position
+    //@param visible receives indices into set.meshlets
+    //@return Number of meshlets appended
+    uint32_t cull_meshlets(const meshlet_set& set, const lnal::mat4& model, const frustum& f, const lnal::vec3& camera_pos, std::vector<uint32_t>& visible)
+    {
+        const float* mm = model.data();
+        float scale = lnal::max_scale(model);
+        uint32_t count = 0;
+
+        for(uint32_t i = 0; i < set.meshlets.size(); i++)
+        {
+            const meshlet& ml = set.meshlets[i];
+
+            lnal::vec3 center = lnal::transform_point(model, lnal::vec3(ml.center[0], ml.center[1], ml.center[2]));
+            float radius = ml.radius * scale;
+
+            if(!sphere_in_frustum(f, center.data(), radius))
+                continue;
+
+            if(ml.cone_cutoff < 1.0f)
+            {
+                //Rotate the axis by the upper 3x3 (fine for the uniform scales we use)
+                lnal::vec3 axis(mm[0] * ml.cone_axis[0] + mm[4] * ml.cone_axis[1] + mm[8] * ml.cone_axis[2],
+                                mm[1] * ml.cone_axis[0] + mm[5] * ml.cone_axis[1] + mm[9] * ml.cone_axis[2],
+                                mm[2] * ml.cone_axis[0] + mm[6] * ml.cone_axis[1] + mm[10] * ml.cone_axis[2]);
+                axis.normalize();
+
+                lnal::vec3 to_center = center - camera_pos;
+                float distance = to_center.len();
+
+                if(lnal::dot(to_center, axis) - radius >= ml.cone_cutoff * (distance + radius))
+                    continue;
+            }
+
+            visible.push_back(i);
+            count++;
+        }
+
+        return count;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "mesh.h"
+#include "../math/lnal.h"
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    struct frustum;
+
+    const uint32_t MESHLET_MAX_VERTICES = 64;
+    const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+    //Small cluster of triangles that is culled as a unit
+    struct meshlet
+    {
+        //Range in meshlet_set.vertices (unique mesh vertex ids used by this meshlet)
+        uint32_t vertex_offset;
+        uint32_t vertex_count;
+
+        //Range in meshlet_set.triangles (3 local indices per triangle, each indexes the meshlet's vertex range)
+        uint32_t triangle_offset;
+        uint32_t triangle_count;
+
+        //Range in meshlet_set.indices (the same triangles as mesh vertex ids, ready for an element buffer)
+        uint32_t index_offset;
+
+        //Bounding sphere in object space
+        float center[3];
+        float radius;
+
+        //Normal cone: every triangle normal is within angle a of cone_axis and cone_cutoff = sin(a).
+        //cone_cutoff >= 1 means the normals are spread too wide to ever back-face cull the cluster.
+        float cone_axis[3];
+        float cone_cutoff;
+    };
+
+    struct meshlet_set
+    {
+        std::vector<meshlet> meshlets;
+        std::vector<uint32_t> vertices;
+        std::vector<uint8_t> triangles;
+        std::vector<uint32_t> indices;
+    };
+
+    //Splits a triangle list into meshlets of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles.
+    //Triangles are grown from neighbours so each meshlet is a compact patch of the surface.
+    //@param set meshlet set to fill
+    //@param m mesh that owns the vertex data
+    //@param indices triangle list to split (usually one LOD range of mesh.indices)
+    //@param index_count number of indices in the triangle list
+    void build_meshlets(meshlet_set& set, const mesh& m, const uint32_t* indices, uint32_t index_count);
+
+    //Appends the index of every meshlet that is inside the frustum and has at least one triangle facing the camera
+    //@param set meshlets to test
+    //@param model object to world transform of the mesh
+    //@param f world space frustum
+    //@param camera_pos world space camera position
+    //@param visible receives indices into set.meshlets
+    //@return Number of meshlets appended
+    uint32_t cull_meshlets(const meshlet_set& set, const lnal::mat4& model, const frustum& f, const lnal::vec3& camera_pos, std::vector<uint32_t>& visible);
+}
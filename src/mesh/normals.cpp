@@ -0,0 +1,424 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Normal and tangent generation.
+
+
+    Weighting -
+        A vertex normal is the sum of the face normals around it, each weighted by the triangle's angle at that corner (Thürmer and Wüthrich).
+        Weighting by area lets a long sliver next to the vertex tilt the normal, and an unweighted sum depends on how the faces around the vertex
+        happen to be triangulated. Weighting by the angle gives the same normal for any triangulation of the same surface.
+
+
+    Welding -
+        OBJ vertices are unique per position + normal + uv, so a mesh without normals is still split along its uv seams. Smooth normals are summed
+        per position (every vertex adds into the first vertex with the same position) so both sides of a seam get the same normal and the seam
+        doesn't show in the lighting.
+
+
+    Tangents -
+        Built like MikkTSpace: every face gets a tangent and bitangent from its uv derivatives (normalized, so a face's uv scale doesn't make it
+        count more), each corner projects them onto its vertex normal, and the projected directions are summed with the corner angle as the weight.
+        The bitangent isn't stored, only its sign relative to cross(normal, tangent), which is what a shader rebuilding it needs. Tangents are
+        summed per vertex, not per position, since the uvs on the two sides of a seam go in different directions.
+
+        MikkTSpace also splits a vertex whose faces disagree on the handedness of their uv mapping (a mirrored uv island meeting its original).
+        We don't split vertices here, so on such a vertex the sign follows the majority and the tangent is the sum of both sides. Everywhere else
+        the result matches.
+
+
+    Threads -
+        Above NORMALS_PARALLEL_TRIANGLES the triangles are split into one range per thread, and each range sums into its own full size array so
+        no two threads ever write the same memory. The arrays are then added together (also in parallel, by vertex) in range order, so the result
+        doesn't depend on which thread finished first.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "normals.h"
+#include "../math/lnal.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+namespace br
+{
+    static void sub3(const float* a, const float* b, float* out)
+    {
+        out[0] = a[0] - b[0];
+        out[1] = a[1] - b[1];
+        out[2] = a[2] - b[2];
+    }
+
+    static float dot3(const float* a, const float* b)
+    {
+        return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+    }
+
+    static void cross3(const float* a, const float* b, float* out)
+    {
+        out[0] = (a[1] * b[2]) - (a[2] * b[1]);
+        out[1] = (a[2] * b[0]) - (a[0] * b[2]);
+        out[2] = (a[0] * b[1]) - (a[1] * b[0]);
+    }
+
+    //@return false (and leaves v alone) if v is too short to have a direction
+    static bool normalize3(float* v)
+    {
+        float length_sqr = dot3(v, v);
+        if(length_sqr < 1e-30f)
+            return false;
+
+        float inv = 1.0f / sqrtf(length_sqr);
+        v[0] *= inv;
+        v[1] *= inv;
+        v[2] *= inv;
+        return true;
+    }
+
+    //Interior angles of a triangle, zero for all three if it's degenerate
+    static void corner_angles(const float* p0, const float* p1, const float* p2, float* angles)
+    {
+        float e01[3], e12[3], e20[3];
+        sub3(p1, p0, e01);
+        sub3(p2, p1, e12);
+        sub3(p0, p2, e20);
+
+        if(!normalize3(e01) || !normalize3(e12) || !normalize3(e20))
+        {
+            angles[0] = angles[1] = angles[2] = 0.0f;
+            return;
+        }
+
+        angles[0] = acosf(std::min(std::max(-dot3(e20, e01), -1.0f), 1.0f));
+        angles[1] = acosf(std::min(std::max(-dot3(e01, e12), -1.0f), 1.0f));
+        angles[2] = (float)PI - angles[0] - angles[1];
+    }
+
+    //Triangles of lods[0], or every index if the mesh has no LODs yet
+    static void base_triangles(const mesh& m, const uint32_t*& indices, uint32_t& triangle_count)
+    {
+        uint32_t offset = m.lods.empty() ? 0 : m.lods[0].index_offset;
+        uint32_t count = m.lods.empty() ? (uint32_t)m.indices.size() : m.lods[0].index_count;
+
+        indices = m.indices.data() + offset;
+        triangle_count = count / 3;
+    }
+
+    //Runs add(first triangle, end triangle, sums) over all triangles and returns the total of everything they added in sums. Big meshes get
+    //one range and one private sums array per thread, merged in range order.
+    static void accumulate_triangles(job_system* js, uint32_t triangle_count, size_t sum_count,
+                                     const std::function<void(uint32_t begin, uint32_t end, float* sums)>& add, std::vector<float>& sums)
+    {
+        uint32_t ranges = triangle_count >= NORMALS_PARALLEL_TRIANGLES ? job_thread_count(js) : 1;
+
+        if(ranges <= 1)
+        {
+            sums.assign(sum_count, 0.0f);
+            add(0, triangle_count, sums.data());
+            return;
+        }
+
+        uint32_t range_size = (triangle_count + ranges - 1) / ranges;
+        std::vector<std::vector<float>> partial(ranges);
+
+        //Each range allocates (and so first touches) its own array on the thread that fills it
+        parallel_for(js, ranges, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t r = begin; r < end; r++)
+            {
+                partial[r].assign(sum_count, 0.0f);
+                add(r * range_size, std::min((r + 1) * range_size, triangle_count), partial[r].data());
+            }
+        });
+
+        sums.resize(sum_count);
+        parallel_for(js, (uint32_t)sum_count, 1 << 14, [&](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t i = begin; i < end; i++)
+            {
+                float total = 0.0f;
+                for(const std::vector<float>& p : partial)
+                {
+                    total += p[i];
+                }
+                sums[i] = total;
+            }
+        });
+    }
+
+    static uint32_t position_hash(const float* p)
+    {
+        uint32_t bits[3];
+        memcpy(bits, p, sizeof(bits));
+
+        uint32_t h = (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        h ^= h >> 15;
+        h *= 0x2c1b3c6du;
+        h ^= h >> 12;
+        return h;
+    }
+
+    //Every vertex mapped to the first vertex with the same position. An open addressed table of vertex ids rather than an unordered_map:
+    //this runs over every vertex of the mesh before anything can be split across threads, and the map's node allocations were most of it.
+    static void weld_positions(const mesh& m, std::vector<uint32_t>& canonical)
+    {
+        const uint32_t EMPTY = 0xFFFFFFFF;
+
+        uint32_t vertex_count = mesh_vertex_count(m);
+        canonical.resize(vertex_count);
+
+        //At most half full
+        uint32_t capacity = 16;
+        while(capacity < vertex_count * 2)
+        {
+            capacity *= 2;
+        }
+
+        std::vector<uint32_t> table(capacity, EMPTY);
+        const float* positions = m.positions.data();
+
+        for(uint32_t v = 0; v < vertex_count; v++)
+        {
+            const float* p = positions + ((size_t)v * 3);
+            uint32_t slot = position_hash(p) & (capacity - 1);
+
+            while(table[slot] != EMPTY && memcmp(positions + ((size_t)table[slot] * 3), p, sizeof(float) * 3) != 0)
+            {
+                slot = (slot + 1) & (capacity - 1);
+            }
+
+            if(table[slot] == EMPTY)
+                table[slot] = v;
+
+            canonical[v] = table[slot];
+        }
+    }
+
+    //Gives every triangle of lods[0] its own 3 vertices so each can carry the face normal. Vertices only used by other LODs are dropped.
+    static void split_faces(mesh& m)
+    {
+        const uint32_t* indices;
+        uint32_t triangle_count;
+        base_triangles(m, indices, triangle_count);
+
+        bool has_uvs = !m.uvs.empty();
+        bool has_materials = !m.materials.empty();
+        std::vector<float> positions((size_t)triangle_count * 9);
+        std::vector<float> uvs(has_uvs ? (size_t)triangle_count * 6 : 0);
+        std::vector<uint32_t> materials(has_materials ? (size_t)triangle_count * 3 : 0);
+        std::vector<uint32_t> split_indices((size_t)triangle_count * 3);
+
+        for(uint32_t c = 0; c < triangle_count * 3; c++)
+        {
+            uint32_t v = indices[c];
+            memcpy(&positions[(size_t)c * 3], &m.positions[(size_t)v * 3], sizeof(float) * 3);
+            if(has_uvs)
+                memcpy(&uvs[(size_t)c * 2], &m.uvs[(size_t)v * 2], sizeof(float) * 2);
+            if(has_materials)
+                materials[c] = m.materials[v];
+
+            split_indices[c] = c;
+        }
+
+        m.positions.swap(positions);
+        m.uvs.swap(uvs);
+        m.materials.swap(materials);
+        m.indices.swap(split_indices);
+        m.lods.assign(1, { 0, triangle_count * 3, 0.0f });
+    }
+
+    //Replaces the mesh's normals with angle weighted face normals computed from lods[0]. Run it before generate_lods: NORMALS_FLAT splits
+    //the vertices and leaves a single LOD.
+    //@param js optional, large meshes are split across its threads
+    void generate_normals(mesh& m, normal_mode mode, job_system* js)
+    {
+        //Tangents are built against the normals, old ones would no longer be perpendicular
+        m.tangents.clear();
+
+        if(mode == NORMALS_FLAT)
+            split_faces(m);
+
+        const uint32_t* indices;
+        uint32_t triangle_count;
+        base_triangles(m, indices, triangle_count);
+
+        uint32_t vertex_count = mesh_vertex_count(m);
+
+        //Flat vertices are never shared, so they are their own canonical vertex
+        std::vector<uint32_t> canonical;
+        if(mode == NORMALS_SMOOTH)
+        {
+            weld_positions(m, canonical);
+        }
+        else
+        {
+            canonical.resize(vertex_count);
+            for(uint32_t v = 0; v < vertex_count; v++)
+            {
+                canonical[v] = v;
+            }
+        }
+
+        const float* positions = m.positions.data();
+        std::vector<float> sums;
+
+        accumulate_triangles(js, triangle_count, (size_t)vertex_count * 3, [&](uint32_t begin, uint32_t end, float* out)
+        {
+            for(uint32_t t = begin; t < end; t++)
+            {
+                const uint32_t* tri = &indices[t * 3];
+                const float* p[3] = { positions + (tri[0] * 3), positions + (tri[1] * 3), positions + (tri[2] * 3) };
+
+                float e1[3], e2[3], n[3];
+                sub3(p[1], p[0], e1);
+                sub3(p[2], p[0], e2);
+                cross3(e1, e2, n);
+                if(!normalize3(n))
+                    continue;
+
+                float angles[3];
+                corner_angles(p[0], p[1], p[2], angles);
+
+                for(int c = 0; c < 3; c++)
+                {
+                    float* sum = out + ((size_t)canonical[tri[c]] * 3);
+                    sum[0] += n[0] * angles[c];
+                    sum[1] += n[1] * angles[c];
+                    sum[2] += n[2] * angles[c];
+                }
+            }
+        }, sums);
+
+        //Vertices nothing added to (unused or only on degenerate triangles) get an arbitrary unit normal
+        m.normals.resize((size_t)vertex_count * 3);
+        for(uint32_t v = 0; v < vertex_count; v++)
+        {
+            float n[3];
+            memcpy(n, &sums[(size_t)canonical[v] * 3], sizeof(n));
+            if(!normalize3(n))
+            {
+                n[0] = 0.0f;
+                n[1] = 0.0f;
+                n[2] = 1.0f;
+            }
+
+            memcpy(&m.normals[(size_t)v * 3], n, sizeof(n));
+        }
+    }
+
+    //Removes the part of v along the unit vector n
+    static void reject(float* v, const float* n)
+    {
+        float d = dot3(v, n);
+        v[0] -= n[0] * d;
+        v[1] -= n[1] * d;
+        v[2] -= n[2] * d;
+    }
+
+    //Any unit vector perpendicular to the unit vector n
+    static void any_perpendicular(const float* n, float* out)
+    {
+        float axis[3] = { 0.0f, 0.0f, 0.0f };
+        axis[fabsf(n[0]) < 0.9f ? 0 : 1] = 1.0f;
+
+        cross3(n, axis, out);
+        normalize3(out);
+    }
+
+    //Fills mesh.tangents the way MikkTSpace builds them, so normal maps baked against MikkTSpace decode correctly. Needs normals and uvs,
+    //does nothing without them.
+    //@param js optional, large meshes are split across its threads
+    void generate_tangents(mesh& m, job_system* js)
+    {
+        uint32_t vertex_count = mesh_vertex_count(m);
+        if(m.normals.size() != (size_t)vertex_count * 3 || m.uvs.size() != (size_t)vertex_count * 2)
+            return;
+
+        const uint32_t* indices;
+        uint32_t triangle_count;
+        base_triangles(m, indices, triangle_count);
+
+        const float* positions = m.positions.data();
+        const float* normals = m.normals.data();
+        const float* uvs = m.uvs.data();
+
+        //Per vertex: summed tangent xyz, summed bitangent xyz
+        std::vector<float> sums;
+
+        accumulate_triangles(js, triangle_count, (size_t)vertex_count * 6, [&](uint32_t begin, uint32_t end, float* out)
+        {
+            for(uint32_t t = begin; t < end; t++)
+            {
+                const uint32_t* tri = &indices[t * 3];
+                const float* p[3] = { positions + (tri[0] * 3), positions + (tri[1] * 3), positions + (tri[2] * 3) };
+                const float* uv[3] = { uvs + (tri[0] * 2), uvs + (tri[1] * 2), uvs + (tri[2] * 2) };
+
+                float e1[3], e2[3];
+                sub3(p[1], p[0], e1);
+                sub3(p[2], p[0], e2);
+
+                float du1 = uv[1][0] - uv[0][0], dv1 = uv[1][1] - uv[0][1];
+                float du2 = uv[2][0] - uv[0][0], dv2 = uv[2][1] - uv[0][1];
+
+                //Twice the signed uv area. Its sign is the face's handedness, a face with no uv area has no tangent frame to give.
+                float uv_area = (du1 * dv2) - (du2 * dv1);
+                if(fabsf(uv_area) < 1e-20f)
+                    continue;
+
+                float sign = uv_area > 0.0f ? 1.0f : -1.0f;
+                float face_t[3], face_b[3];
+                for(int k = 0; k < 3; k++)
+                {
+                    face_t[k] = ((e1[k] * dv2) - (e2[k] * dv1)) * sign;
+                    face_b[k] = ((e2[k] * du1) - (e1[k] * du2)) * sign;
+                }
+
+                if(!normalize3(face_t) || !normalize3(face_b))
+                    continue;
+
+                float angles[3];
+                corner_angles(p[0], p[1], p[2], angles);
+
+                for(int c = 0; c < 3; c++)
+                {
+                    const float* n = normals + ((size_t)tri[c] * 3);
+                    float corner_t[3] = { face_t[0], face_t[1], face_t[2] };
+                    float corner_b[3] = { face_b[0], face_b[1], face_b[2] };
+                    reject(corner_t, n);
+                    reject(corner_b, n);
+                    normalize3(corner_t);
+                    normalize3(corner_b);
+
+                    float* sum = out + ((size_t)tri[c] * 6);
+                    for(int k = 0; k < 3; k++)
+                    {
+                        sum[k] += corner_t[k] * angles[c];
+                        sum[3 + k] += corner_b[k] * angles[c];
+                    }
+                }
+            }
+        }, sums);
+
+        m.tangents.resize((size_t)vertex_count * 4);
+        for(uint32_t v = 0; v < vertex_count; v++)
+        {
+            const float* n = normals + ((size_t)v * 3);
+            const float* sum = &sums[(size_t)v * 6];
+
+            //The summed tangent is only perpendicular to n up to rounding, project it once more
+            float tangent[3] = { sum[0], sum[1], sum[2] };
+            reject(tangent, n);
+            if(!normalize3(tangent))
+                any_perpendicular(n, tangent);
+
+            float nxt[3];
+            cross3(n, tangent, nxt);
+
+            float* out = &m.tangents[(size_t)v * 4];
+            out[0] = tangent[0];
+            out[1] = tangent[1];
+            out[2] = tangent[2];
+            out[3] = dot3(nxt, sum + 3) < 0.0f ? -1.0f : 1.0f;
+        }
+    }
+}
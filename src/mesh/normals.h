@@ -0,0 +1,27 @@
+#pragma once
+
+#include "mesh.h"
+#include "../core/job.h"
+#include <cstdint>
+
+namespace br
+{
+    enum normal_mode
+    {
+        NORMALS_SMOOTH,     //One normal per position, averaged over the triangles around it (uv seams don't show)
+        NORMALS_FLAT        //Face normals, every triangle gets its own 3 vertices
+    };
+
+    //Meshes with at least this many triangles accumulate on every thread of the job system
+    static const uint32_t NORMALS_PARALLEL_TRIANGLES = 1 << 16;
+
+    //Replaces the mesh's normals with angle weighted face normals computed from lods[0]. Run it before generate_lods: NORMALS_FLAT splits
+    //the vertices and leaves a single LOD.
+    //@param js optional, large meshes are split across its threads
+    void generate_normals(mesh& m, normal_mode mode = NORMALS_SMOOTH, job_system* js = nullptr);
+
+    //Fills mesh.tangents the way MikkTSpace builds them, so normal maps baked against MikkTSpace decode correctly. Needs normals and uvs,
+    //does nothing without them.
+    //@param js optional, large meshes are split across its threads
+    void generate_tangents(mesh& m, job_system* js = nullptr);
+}
@@ -0,0 +1,637 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Quadric error mesh simplification and LOD selection.
+
+
+    Quadrics -
+        Every triangle defines a plane (a, b, c, d) with ax + by + cz + d = 0. The squared distance of a point p to that plane is p^T Q p where
+        Q = (a, b, c, d)(a, b, c, d)^T is a symmetric 4x4 matrix. Summing the Q's of all triangles around a vertex gives a quadric that measures how far a
+        point is from all of the original planes at once, so when two vertices are merged, evaluating (Q_u + Q_v) at the merged position tells us how far the
+        new surface moved from the original one. Only the 10 unique values of the symmetric matrix are stored, plus the weight of the planes summed in.
+
+        The quadric divided by that weight is a mean squared distance. It orders the collapses, but a plane the merged vertex is far from gets averaged
+        away by the many it fits, so it can't be the error. Each vertex also keeps the list of planes it has gathered (a linked list, a collapse hands
+        its list to the surviving vertex), and a collapse's error is the largest unweighted distance from the merged position to any of them. That is
+        what max_error limits and what simplify returns.
+
+        Border edges (edges with only one triangle) get an extra plane perpendicular to the triangle so open boundaries don't shrink.
+
+
+    Collapses -
+        We only do half edge collapses (u is moved onto v, no new vertex position is solved for). This keeps every output index pointing at an existing
+        vertex, so all LODs share the mesh's vertex buffers and attributes don't have to be re-interpolated.
+
+        Vertices with the same position but different normals/uvs (seams) are welded for the topology and quadrics. When a welded vertex collapses, each
+        triangle corner picks the vertex at the destination whose attributes are closest to what it had before.
+
+        Instead of a priority queue we work in passes: compute the cost of every edge, sort them, then collapse from the cheapest up. Any vertex near a
+        collapse is locked for the rest of the pass so costs and flip checks stay valid without updating anything. Each pass removes a good chunk of the
+        mesh so only a handful of passes are needed.
+
+
+    References -
+        Surface Simplification Using Quadric Error Metrics - https://www.cs.cmu.edu/~./garland/Papers/quadrics.pdf
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "simplify.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace br
+{
+    //How much border planes count compared to surface planes
+    static const double BORDER_WEIGHT = 10.0;
+
+    struct quadric
+    {
+        double a2, ab, ac, ad;
+        double b2, bc, bd;
+        double c2, cd;
+        double d2;
+
+        //Total weight of the planes summed in, used to turn the sum of squared distances into an average
+        double w;
+    };
+
+    static const uint32_t NO_PLANE = 0xFFFFFFFF;
+
+    //Unit normal plane ax + by + cz + d = 0
+    struct plane
+    {
+        double a, b, c, d;
+    };
+
+    //One entry of a vertex's plane list
+    struct plane_ref
+    {
+        uint32_t plane;
+        uint32_t next;
+    };
+
+    //The planes every welded vertex has gathered, as linked lists so a collapse moves a whole list in constant time
+    struct plane_lists
+    {
+        std::vector<plane> planes;
+        std::vector<plane_ref> refs;
+        std::vector<uint32_t> head;         //Per vertex, first ref or NO_PLANE
+        std::vector<uint32_t> tail;
+    };
+
+    struct collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+
+    static quadric quadric_from_plane(double a, double b, double c, double d, double weight)
+    {
+        quadric q;
+        q.a2 = a * a * weight; q.ab = a * b * weight; q.ac = a * c * weight; q.ad = a * d * weight;
+        q.b2 = b * b * weight; q.bc = b * c * weight; q.bd = b * d * weight;
+        q.c2 = c * c * weight; q.cd = c * d * weight;
+        q.d2 = d * d * weight;
+        q.w = weight;
+        return q;
+    }
+
+    static void quadric_add(quadric& q, const quadric& r)
+    {
+        q.a2 += r.a2; q.ab += r.ab; q.ac += r.ac; q.ad += r.ad;
+        q.b2 += r.b2; q.bc += r.bc; q.bd += r.bd;
+        q.c2 += r.c2; q.cd += r.cd;
+        q.d2 += r.d2;
+        q.w += r.w;
+    }
+
+    static void plane_lists_add(plane_lists& pl, uint32_t v, uint32_t plane)
+    {
+        uint32_t r = (uint32_t)pl.refs.size();
+        pl.refs.push_back({ plane, NO_PLANE });
+
+        if(pl.head[v] == NO_PLANE)
+            pl.head[v] = r;
+        else
+            pl.refs[pl.tail[v]].next = r;
+
+        pl.tail[v] = r;
+    }
+
+    //Appends from's list to to's
+    static void plane_lists_merge(plane_lists& pl, uint32_t from, uint32_t to)
+    {
+        if(pl.head[from] == NO_PLANE)
+            return;
+
+        if(pl.head[to] == NO_PLANE)
+            pl.head[to] = pl.head[from];
+        else
+            pl.refs[pl.tail[to]].next = pl.head[from];
+
+        pl.tail[to] = pl.tail[from];
+        pl.head[from] = pl.tail[from] = NO_PLANE;
+    }
+
+    //Largest distance from p to any plane in v's list
+    static double plane_lists_distance(const plane_lists& pl, uint32_t v, const float* p)
+    {
+        double result = 0.0;
+
+        for(uint32_t r = pl.head[v]; r != NO_PLANE; r = pl.refs[r].next)
+        {
+            const plane& e = pl.planes[pl.refs[r].plane];
+            double distance = fabs((e.a * p[0]) + (e.b * p[1]) + (e.c * p[2]) + e.d);
+            result = distance > result ? distance : result;
+        }
+
+        return result;
+    }
+
+    //p^T Q p with p = (x, y, z, 1), divided by the plane weight so the result is a mean squared distance
+    static double quadric_eval(const quadric& q, const float* p)
+    {
+        double x = p[0];
+        double y = p[1];
+        double z = p[2];
+
+        double result = (q.a2 * x * x) + (q.b2 * y * y) + (q.c2 * z * z) + q.d2;
+        result += 2.0 * ((q.ab * x * y) + (q.ac * x * z) + (q.bc * y * z));
+        result += 2.0 * ((q.ad * x) + (q.bd * y) + (q.cd * z));
+
+        //Rounding can push this slightly below zero
+        if(result <= 0.0 || q.w == 0.0)
+            return 0.0;
+
+        return result / q.w;
+    }
+
+    static void triangle_normal(const float* p0, const float* p1, const float* p2, double* n)
+    {
+        double e1[3] = { (double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2] };
+        double e2[3] = { (double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2] };
+
+        n[0] = (e1[1] * e2[2]) - (e1[2] * e2[1]);
+        n[1] = (e1[2] * e2[0]) - (e1[0] * e2[2]);
+        n[2] = (e1[0] * e2[1]) - (e1[1] * e2[0]);
+    }
+
+    struct position_hash
+    {
+        const float* positions;
+
+        size_t operator()(uint32_t v) const
+        {
+            uint32_t bits[3];
+            memcpy(bits, positions + (v * 3), sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    struct position_equal
+    {
+        const float* positions;
+
+        bool operator()(uint32_t a, uint32_t b) const
+        {
+            return memcmp(positions + (a * 3), positions + (b * 3), sizeof(float) * 3) == 0;
+        }
+    };
+
+    //Maps every vertex to the first vertex with the same position and links vertices with the same position into a ring (wedge_next)
+    static void weld_positions(const mesh& m, std::vector<uint32_t>& canonical, std::vector<uint32_t>& wedge_next)
+    {
+        uint32_t vertex_count = mesh_vertex_count(m);
+        canonical.resize(vertex_count);
+        wedge_next.resize(vertex_count);
+
+        std::unordered_map<uint32_t, uint32_t, position_hash, position_equal> first(vertex_count, position_hash{ m.positions.data() }, position_equal{ m.positions.data() });
+
+        for(uint32_t v = 0; v < vertex_count; v++)
+        {
+            auto found = first.find(v);
+            if(found == first.end())
+            {
+                first.emplace(v, v);
+                canonical[v] = v;
+                wedge_next[v] = v;
+                continue;
+            }
+
+            //Insert v into the ring after the canonical vertex
+            uint32_t c = found->second;
+            canonical[v] = c;
+            wedge_next[v] = wedge_next[c];
+            wedge_next[c] = v;
+        }
+    }
+
+    //Picks the vertex in the wedge of target whose attributes best match vertex
+    static uint32_t pick_wedge_vertex(const mesh& m, const std::vector<uint32_t>& wedge_next, uint32_t target, uint32_t vertex)
+    {
+        if(wedge_next[target] == target)
+            return target;
+
+        bool has_normals = !m.normals.empty();
+        bool has_uvs = !m.uvs.empty();
+        bool has_materials = !m.materials.empty();
+
+        uint32_t best = target;
+        float best_score = -1e30f;
+        uint32_t w = target;
+
+        do
+        {
+            float score = 0.0f;
+
+            if(has_normals)
+            {
+                const float* a = &m.normals[vertex * 3];
+                const float* b = &m.normals[w * 3];
+                score += (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+            }
+
+            if(has_uvs)
+            {
+                float du = m.uvs[vertex * 2] - m.uvs[w * 2];
+                float dv = m.uvs[(vertex * 2) + 1] - m.uvs[(w * 2) + 1];
+                score -= (du * du) + (dv * dv);
+            }
+
+            //A vertex of another material would pull the material border along with the collapse
+            if(has_materials && m.materials[vertex] != m.materials[w])
+                score -= 1e6f;
+
+            if(score > best_score)
+            {
+                best_score = score;
+                best = w;
+            }
+
+            w = wedge_next[w];
+        } while(w != target);
+
+        return best;
+    }
+
+    //Builds the quadric and the plane list of every welded vertex from the current triangle list
+    static void build_quadrics(const mesh& m, const std::vector<uint32_t>& canonical, const std::vector<uint32_t>& tris, std::vector<quadric>& quadrics,
+                               plane_lists& pl)
+    {
+        quadrics.assign(canonical.size(), quadric{});
+
+        pl.planes.clear();
+        pl.refs.clear();
+        pl.head.assign(canonical.size(), NO_PLANE);
+        pl.tail.assign(canonical.size(), NO_PLANE);
+
+        //Directed edges seen so far. An edge is a border if the reverse edge never shows up.
+        std::unordered_set<uint64_t> directed;
+        directed.reserve(tris.size());
+
+        for(size_t i = 0; i < tris.size(); i++)
+        {
+            uint32_t a = canonical[tris[i]];
+            uint32_t b = canonical[tris[(i % 3 == 2) ? i - 2 : i + 1]];
+            directed.insert(((uint64_t)a << 32) | b);
+        }
+
+        for(size_t t = 0; t < tris.size(); t += 3)
+        {
+            uint32_t c[3] = { canonical[tris[t]], canonical[tris[t + 1]], canonical[tris[t + 2]] };
+            const float* p[3] = { &m.positions[c[0] * 3], &m.positions[c[1] * 3], &m.positions[c[2] * 3] };
+
+            double n[3];
+            triangle_normal(p[0], p[1], p[2], n);
+
+            double len = sqrt((n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]));
+            if(len == 0.0)
+                continue;
+
+            n[0] /= len;
+            n[1] /= len;
+            n[2] /= len;
+
+            double d = -((n[0] * p[0][0]) + (n[1] * p[0][1]) + (n[2] * p[0][2]));
+            quadric q = quadric_from_plane(n[0], n[1], n[2], d, 1.0);
+            uint32_t face = (uint32_t)pl.planes.size();
+            pl.planes.push_back({ n[0], n[1], n[2], d });
+
+            for(int k = 0; k < 3; k++)
+            {
+                quadric_add(quadrics[c[k]], q);
+                plane_lists_add(pl, c[k], face);
+            }
+
+            for(int k = 0; k < 3; k++)
+            {
+                uint32_t a = c[k];
+                uint32_t b = c[(k + 1) % 3];
+
+                if(directed.count(((uint64_t)b << 32) | a))
+                    continue;
+
+                //Plane through the border edge, perpendicular to the triangle
+                const float* pa = &m.positions[a * 3];
+                const float* pb = &m.positions[b * 3];
+                double e[3] = { (double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2] };
+                double bn[3] = { (e[1] * n[2]) - (e[2] * n[1]), (e[2] * n[0]) - (e[0] * n[2]), (e[0] * n[1]) - (e[1] * n[0]) };
+                double bl = sqrt((bn[0] * bn[0]) + (bn[1] * bn[1]) + (bn[2] * bn[2]));
+                if(bl == 0.0)
+                    continue;
+
+                bn[0] /= bl;
+                bn[1] /= bl;
+                bn[2] /= bl;
+
+                double bd = -((bn[0] * pa[0]) + (bn[1] * pa[1]) + (bn[2] * pa[2]));
+                quadric bq = quadric_from_plane(bn[0], bn[1], bn[2], bd, BORDER_WEIGHT);
+                quadric_add(quadrics[a], bq);
+                quadric_add(quadrics[b], bq);
+
+                uint32_t border = (uint32_t)pl.planes.size();
+                pl.planes.push_back({ bn[0], bn[1], bn[2], bd });
+                plane_lists_add(pl, a, border);
+                plane_lists_add(pl, b, border);
+            }
+        }
+    }
+
+    //Returns true if moving from onto to would turn any of from's remaining triangles upside down
+    static bool collapse_flips(const mesh& m, const std::vector<uint32_t>& canonical, const std::vector<uint32_t>& tris,
+                               const std::vector<uint32_t>& adjacency_offsets, const std::vector<uint32_t>& adjacency, uint32_t from, uint32_t to)
+    {
+        for(uint32_t a = adjacency_offsets[from]; a < adjacency_offsets[from + 1]; a++)
+        {
+            uint32_t t = adjacency[a];
+            uint32_t c[3] = { canonical[tris[t]], canonical[tris[t + 1]], canonical[tris[t + 2]] };
+
+            //Triangles on the collapsed edge disappear, nothing to check
+            if(c[0] == to || c[1] == to || c[2] == to)
+                continue;
+
+            const float* p[3] = { &m.positions[c[0] * 3], &m.positions[c[1] * 3], &m.positions[c[2] * 3] };
+
+            double before[3];
+            triangle_normal(p[0], p[1], p[2], before);
+
+            for(int k = 0; k < 3; k++)
+            {
+                if(c[k] == from)
+                    p[k] = &m.positions[to * 3];
+            }
+
+            double after[3];
+            triangle_normal(p[0], p[1], p[2], after);
+
+            if((before[0] * after[0]) + (before[1] * after[1]) + (before[2] * after[2]) <= 0.0)
+                return true;
+        }
+
+        return false;
+    }
+
+    //Simplifies a triangle list with quadric error edge collapses (Garland-Heckbert).
+    //Vertices are never moved or created, so the result indexes the same vertex arrays as the input.
+    //@param m mesh that owns the vertex data
+    //@param indices triangle list to simplify
+    //@param index_count number of indices in the triangle list
+    //@param target_index_count stop once the result has this many indices or fewer
+    //@param max_error skip any collapse that would leave a vertex further than this from one of the planes it replaces (object space units)
+    //@param result receives the simplified triangle list
+    //@return Largest distance of a collapsed vertex from the planes it replaced, in object space
+    float simplify(const mesh& m, const uint32_t* indices, uint32_t index_count, uint32_t target_index_count, float max_error, std::vector<uint32_t>& result)
+    {
+        result.assign(indices, indices + index_count);
+
+        uint32_t vertex_count = mesh_vertex_count(m);
+
+        std::vector<uint32_t> canonical;
+        std::vector<uint32_t> wedge_next;
+        weld_positions(m, canonical, wedge_next);
+
+        std::vector<quadric> quadrics;
+        plane_lists planes;
+        build_quadrics(m, canonical, result, quadrics, planes);
+
+        double max_cost = (double)max_error * (double)max_error;
+        double worst = 0.0;
+
+        std::vector<uint32_t> adjacency_offsets;
+        std::vector<uint32_t> adjacency;
+        std::vector<uint64_t> edges;
+        std::vector<collapse> collapses;
+        std::vector<uint32_t> remap(vertex_count);
+        std::vector<uint8_t> locked(vertex_count);
+
+        while(result.size() > target_index_count)
+        {
+            uint32_t tri_count = (uint32_t)result.size() / 3;
+
+            //Triangles around each welded vertex (compressed: offsets + one flat list of triangle starts)
+            adjacency_offsets.assign(vertex_count + 1, 0);
+            for(uint32_t i = 0; i < result.size(); i++)
+            {
+                adjacency_offsets[canonical[result[i]] + 1]++;
+            }
+
+            for(uint32_t v = 0; v < vertex_count; v++)
+            {
+                adjacency_offsets[v + 1] += adjacency_offsets[v];
+            }
+
+            adjacency.resize(result.size());
+            std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+            for(uint32_t i = 0; i < result.size(); i++)
+            {
+                adjacency[fill[canonical[result[i]]]++] = i - (i % 3);
+            }
+
+            //Unique undirected edges
+            edges.clear();
+            for(uint32_t i = 0; i < result.size(); i++)
+            {
+                uint32_t a = canonical[result[i]];
+                uint32_t b = canonical[result[(i % 3 == 2) ? i - 2 : i + 1]];
+                edges.push_back(a < b ? (((uint64_t)a << 32) | b) : (((uint64_t)b << 32) | a));
+            }
+
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+            //Cheapest direction of every edge
+            collapses.clear();
+            for(uint64_t e : edges)
+            {
+                uint32_t a = (uint32_t)(e >> 32);
+                uint32_t b = (uint32_t)e;
+
+                quadric q = quadrics[a];
+                quadric_add(q, quadrics[b]);
+
+                double a_onto_b = quadric_eval(q, &m.positions[b * 3]);
+                double b_onto_a = quadric_eval(q, &m.positions[a * 3]);
+
+                if(a_onto_b <= b_onto_a)
+                    collapses.push_back({ a, b, a_onto_b });
+                else
+                    collapses.push_back({ b, a, b_onto_a });
+            }
+
+            std::sort(collapses.begin(), collapses.end(), [](const collapse& l, const collapse& r) { return l.cost < r.cost; });
+
+            for(uint32_t v = 0; v < vertex_count; v++)
+            {
+                remap[v] = v;
+            }
+
+            std::fill(locked.begin(), locked.end(), 0);
+
+            uint32_t target_tris = target_index_count / 3;
+            uint32_t removed = 0;
+            uint32_t performed = 0;
+
+            for(const collapse& c : collapses)
+            {
+                //The mean squared distance is never more than the largest one, so nothing from here on can stay under max_error
+                if(c.cost > max_cost)
+                    break;
+
+                if(locked[c.from] || locked[c.to])
+                    continue;
+
+                if(collapse_flips(m, canonical, result, adjacency_offsets, adjacency, c.from, c.to))
+                    continue;
+
+                const float* p = &m.positions[c.to * 3];
+                double from_distance = plane_lists_distance(planes, c.from, p);
+                double to_distance = plane_lists_distance(planes, c.to, p);
+                double distance = from_distance > to_distance ? from_distance : to_distance;
+                if(distance > max_error)
+                    continue;
+
+                remap[c.from] = c.to;
+                quadric_add(quadrics[c.to], quadrics[c.from]);
+                plane_lists_merge(planes, c.from, c.to);
+                worst = distance > worst ? distance : worst;
+                performed++;
+
+                //Lock the whole neighbourhood of both ends and count triangles that will disappear
+                for(uint32_t v : { c.from, c.to })
+                {
+                    for(uint32_t a = adjacency_offsets[v]; a < adjacency_offsets[v + 1]; a++)
+                    {
+                        uint32_t t = adjacency[a];
+                        uint32_t c0 = canonical[result[t]];
+                        uint32_t c1 = canonical[result[t + 1]];
+                        uint32_t c2 = canonical[result[t + 2]];
+
+                        locked[c0] = locked[c1] = locked[c2] = 1;
+
+                        if(v == c.from && (c0 == c.to || c1 == c.to || c2 == c.to))
+                            removed++;
+                    }
+                }
+
+                if(tri_count - removed <= target_tris)
+                    break;
+            }
+
+            if(performed == 0)
+                break;
+
+            //Apply this pass's collapses and drop triangles that became degenerate
+            uint32_t write = 0;
+            for(uint32_t t = 0; t < result.size(); t += 3)
+            {
+                uint32_t v[3];
+                uint32_t c[3];
+
+                for(int k = 0; k < 3; k++)
+                {
+                    v[k] = result[t + k];
+                    c[k] = canonical[v[k]];
+
+                    if(remap[c[k]] != c[k])
+                    {
+                        c[k] = remap[c[k]];
+                        v[k] = pick_wedge_vertex(m, wedge_next, c[k], v[k]);
+                    }
+                }
+
+                if(c[0] == c[1] || c[1] == c[2] || c[0] == c[2])
+                    continue;
+
+                result[write++] = v[0];
+                result[write++] = v[1];
+                result[write++] = v[2];
+            }
+
+            result.resize(write);
+        }
+
+        return (float)worst;
+    }
+
+    //Builds a LOD chain from lods[0], each level targeting ratio times the triangles of the last one.
+    //Stops early when a level can't be reduced by at least 10%.
+    //@param m mesh to append LODs to (mesh.indices and mesh.lods grow)
+    //@param max_levels maximum number of LODs including lods[0]
+    //@param ratio triangle count ratio between neighbouring levels
+    //@param max_error upper limit on the error of any level
+    void generate_lods(mesh& m, uint32_t max_levels, float ratio, float max_error)
+    {
+        std::vector<uint32_t> lod_indices;
+
+        //A level that moves the surface by more than the size of the object is never worth drawing
+        max_error = max_error < m.radius ? max_error : m.radius;
+
+        while(m.lods.size() < max_levels)
+        {
+            mesh_lod previous = m.lods.back();
+            uint32_t target = ((uint32_t)(previous.index_count * ratio) / 3) * 3;
+
+            //Each level is simplified from the last one, so errors stack up
+            float error = simplify(m, &m.indices[previous.index_offset], previous.index_count, target, max_error - previous.error, lod_indices);
+
+            if(lod_indices.empty() || lod_indices.size() > previous.index_count * 0.9f)
+                break;
+
+            m.lods.push_back({ (uint32_t)m.indices.size(), (uint32_t)lod_indices.size(), previous.error + error });
+            m.indices.insert(m.indices.end(), lod_indices.begin(), lod_indices.end());
+        }
+    }
+
+    //Converts an object space error into pixels on screen
+    //@param error object space error (mesh_lod::error)
+    //@param projection projection matrix from gen_perspective_proj
+    //@param viewport_height height of the render target in pixels
+    //@param distance view space distance to the object
+    //@param scale largest scale factor of the model matrix (lnal::max_scale)
+    float projected_error(float error, const lnal::mat4& projection, float viewport_height, float distance, float scale)
+    {
+        if(distance <= 0.0f)
+            return 1e30f;
+
+        //[1][1] of the projection is cot(fovy / 2), which maps view space height at distance 1 to NDC
+        float ndc_per_unit = projection.data()[5] / distance;
+
+        return error * scale * ndc_per_unit * 0.5f * viewport_height;
+    }
+
+    //Picks the coarsest LOD whose projected error is under pixel_threshold
+    //@return Index into mesh.lods
+    uint32_t select_lod(const mesh& m, const lnal::mat4& projection, float viewport_height, float distance, float scale, float pixel_threshold)
+    {
+        for(uint32_t i = (uint32_t)m.lods.size(); i > 1; i--)
+        {
+            if(projected_error(m.lods[i - 1].error, projection, viewport_height, distance, scale) < pixel_threshold)
+                return i - 1;
+        }
+
+        return 0;
+    }
+}
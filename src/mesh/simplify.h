@@ -0,0 +1,40 @@
+#pragma once
+
+#include "mesh.h"
+#include "../math/lnal.h"
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    //Simplifies a triangle list with quadric error edge collapses (Garland-Heckbert).
+    //Vertices are never moved or created, so the result indexes the same vertex arrays as the input.
+    //@param m mesh that owns the vertex data
+    //@param indices triangle list to simplify
+    //@param index_count number of indices in the triangle list
+    //@param target_index_count stop once the result has this many indices or fewer
+    //@param max_error skip any collapse that would leave a vertex further than this from one of the planes it replaces (object space units)
+    //@param result receives the simplified triangle list
+    //@return Largest distance of a collapsed vertex from the planes it replaced, in object space
+    float simplify(const mesh& m, const uint32_t* indices, uint32_t index_count, uint32_t target_index_count, float max_error, std::vector<uint32_t>& result);
+
+    //Builds a LOD chain from lods[0], each level targeting ratio times the triangles of the last one.
+    //Stops early when a level can't be reduced by at least 10%.
+    //@param m mesh to append LODs to (mesh.indices and mesh.lods grow)
+    //@param max_levels maximum number of LODs including lods[0]
+    //@param ratio triangle count ratio between neighbouring levels
+    //@param max_error upper limit on the error of any level
+    void generate_lods(mesh& m, uint32_t max_levels = 6, float ratio = 0.5f, float max_error = 1e30f);
+
+    //Converts an object space error into pixels on screen
+    //@param error object space error (mesh_lod::error)
+    //@param projection projection matrix from gen_perspective_proj
+    //@param viewport_height height of the render target in pixels
+    //@param distance view space distance to the object
+    //@param scale largest scale factor of the model matrix (lnal::max_scale)
+    float projected_error(float error, const lnal::mat4& projection, float viewport_height, float distance, float scale);
+
+    //Picks the coarsest LOD whose projected error is under pixel_threshold
+    //@return Index into mesh.lods
+    uint32_t select_lod(const mesh& m, const lnal::mat4& projection, float viewport_height, float distance, float scale, float pixel_threshold = 1.0f);
+}
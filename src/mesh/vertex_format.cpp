@@ -0,0 +1,262 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Compressed vertex formats.
+
+
+    Sizes (bytes per vertex) -
+                            float       compact
+        position            12          8   (3 x unorm16 + 2 bytes padding so the next attribute stays 4 byte aligned)
+        normal              12          4   (octahedral, 2 x snorm16)
+        uv                  8           4   (2 x half)
+        tangent             16          4   (4 x snorm8, only for meshes with generated tangents)
+        material            4           4   (uint32 material id, only for meshes loaded with a material library)
+        --------------------------------------
+        total               52          24
+
+    Tangents only drive normal map lookups, where 8 bits (about half a degree) are plenty, and the sign in w is exactly +-1 either way. Material ids
+    stay 32 bit in both formats: a 16 bit id would need the same 2 bytes of padding to keep the stride 4 byte aligned.
+
+    Positions are quantized relative to the mesh's bounding box, so the precision scales with the size of the mesh: a 2 meter object gets steps of about
+    0.03 mm. Decoding is a scale and offset that we fold into the model matrix (position_dequantize_matrix) so the vertex shader and the CPU pipeline
+    transform the raw [0, 1] values directly.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "vertex_format.h"
+#include "../math/pack.h"
+#include <cstring>
+
+namespace br
+{
+    const char* OCT_DECODE_GLSL =
+    "vec3 oct_decode(vec2 e)\n"
+    "{\n"
+    "    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));\n"
+    "    if(n.z < 0.0)\n"
+    "        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);\n"
+    "    return normalize(n);\n"
+    "}\n";
+
+    //Works out the layout for a mesh in the given format
+    vertex_layout make_vertex_layout(const mesh& m, uint32_t format)
+    {
+        vertex_layout layout;
+        layout.format = format;
+        layout.stride = 0;
+
+        layout.position_offset = (int32_t)layout.stride;
+        layout.stride += (format & VERTEX_POSITION_UNORM16) ? 8 : 12;
+
+        layout.normal_offset = -1;
+        if(!m.normals.empty())
+        {
+            layout.normal_offset = (int32_t)layout.stride;
+            layout.stride += (format & VERTEX_NORMAL_OCT16) ? 4 : 12;
+        }
+
+        layout.uv_offset = -1;
+        if(!m.uvs.empty())
+        {
+            layout.uv_offset = (int32_t)layout.stride;
+            layout.stride += (format & VERTEX_UV_HALF) ? 4 : 8;
+        }
+
+        layout.tangent_offset = -1;
+        if(!m.tangents.empty())
+        {
+            layout.tangent_offset = (int32_t)layout.stride;
+            layout.stride += (format & VERTEX_TANGENT_SNORM8) ? 4 : 16;
+        }
+
+        layout.material_offset = -1;
+        if(!m.materials.empty())
+        {
+            layout.material_offset = (int32_t)layout.stride;
+            layout.stride += 4;
+        }
+
+        return layout;
+    }
+
+    //Encodes the mesh's attributes into one interleaved buffer using the requested format
+    //@param out packed vertex data
+    //@param m source mesh
+    //@param format combination of vertex_format_flags
+    void pack_vertices(packed_vertices& out, const mesh& m, uint32_t format)
+    {
+        uint32_t count = mesh_vertex_count(m);
+
+        out.layout = make_vertex_layout(m, format);
+        out.data.assign((size_t)count * out.layout.stride, 0);
+
+        for(int k = 0; k < 3; k++)
+        {
+            float extent = m.bounds_max[k] - m.bounds_min[k];
+            out.position_offset[k] = (format & VERTEX_POSITION_UNORM16) ? m.bounds_min[k] : 0.0f;
+            out.position_scale[k] = (format & VERTEX_POSITION_UNORM16) ? (extent > 0.0f ? extent : 1.0f) : 1.0f;
+        }
+
+        for(uint32_t v = 0; v < count; v++)
+        {
+            uint8_t* vertex = &out.data[(size_t)v * out.layout.stride];
+            const float* p = &m.positions[v * 3];
+
+            if(format & VERTEX_POSITION_UNORM16)
+            {
+                uint16_t q[4] = { 0, 0, 0, 0 };
+                for(int k = 0; k < 3; k++)
+                {
+                    q[k] = (uint16_t)lnal::pack_unorm((p[k] - out.position_offset[k]) / out.position_scale[k], 16);
+                }
+
+                memcpy(vertex + out.layout.position_offset, q, sizeof(q));
+            }
+            else
+            {
+                memcpy(vertex + out.layout.position_offset, p, sizeof(float) * 3);
+            }
+
+            if(out.layout.normal_offset >= 0)
+            {
+                const float* n = &m.normals[v * 3];
+
+                if(format & VERTEX_NORMAL_OCT16)
+                {
+                    float e[2];
+                    lnal::oct_encode(n, e);
+                    int16_t q[2] = { (int16_t)lnal::pack_snorm(e[0], 16), (int16_t)lnal::pack_snorm(e[1], 16) };
+                    memcpy(vertex + out.layout.normal_offset, q, sizeof(q));
+                }
+                else
+                {
+                    memcpy(vertex + out.layout.normal_offset, n, sizeof(float) * 3);
+                }
+            }
+
+            if(out.layout.uv_offset >= 0)
+            {
+                const float* uv = &m.uvs[v * 2];
+
+                if(format & VERTEX_UV_HALF)
+                {
+                    uint16_t h[2] = { lnal::float_to_half(uv[0]), lnal::float_to_half(uv[1]) };
+                    memcpy(vertex + out.layout.uv_offset, h, sizeof(h));
+                }
+                else
+                {
+                    memcpy(vertex + out.layout.uv_offset, uv, sizeof(float) * 2);
+                }
+            }
+
+            if(out.layout.tangent_offset >= 0)
+            {
+                const float* t = &m.tangents[v * 4];
+
+                if(format & VERTEX_TANGENT_SNORM8)
+                {
+                    int8_t q[4];
+                    for(int k = 0; k < 4; k++)
+                    {
+                        q[k] = (int8_t)lnal::pack_snorm(t[k], 8);
+                    }
+
+                    memcpy(vertex + out.layout.tangent_offset, q, sizeof(q));
+                }
+                else
+                {
+                    memcpy(vertex + out.layout.tangent_offset, t, sizeof(float) * 4);
+                }
+            }
+
+            if(out.layout.material_offset >= 0)
+                memcpy(vertex + out.layout.material_offset, &m.materials[v], sizeof(uint32_t));
+        }
+    }
+
+    //Decodes one vertex back to floats (any of the outputs may be null)
+    void unpack_vertex(const packed_vertices& packed, uint32_t vertex, float* position, float* normal, float* uv, float* tangent, uint32_t* material)
+    {
+        const vertex_layout& layout = packed.layout;
+        const uint8_t* data = &packed.data[(size_t)vertex * layout.stride];
+
+        if(position)
+        {
+            if(layout.format & VERTEX_POSITION_UNORM16)
+            {
+                uint16_t q[3];
+                memcpy(q, data + layout.position_offset, sizeof(q));
+
+                for(int k = 0; k < 3; k++)
+                {
+                    position[k] = packed.position_offset[k] + (lnal::unpack_unorm(q[k], 16) * packed.position_scale[k]);
+                }
+            }
+            else
+            {
+                memcpy(position, data + layout.position_offset, sizeof(float) * 3);
+            }
+        }
+
+        if(normal && layout.normal_offset >= 0)
+        {
+            if(layout.format & VERTEX_NORMAL_OCT16)
+            {
+                int16_t q[2];
+                memcpy(q, data + layout.normal_offset, sizeof(q));
+
+                float e[2] = { lnal::unpack_snorm(q[0], 16), lnal::unpack_snorm(q[1], 16) };
+                lnal::oct_decode(e, normal);
+            }
+            else
+            {
+                memcpy(normal, data + layout.normal_offset, sizeof(float) * 3);
+            }
+        }
+
+        if(uv && layout.uv_offset >= 0)
+        {
+            if(layout.format & VERTEX_UV_HALF)
+            {
+                uint16_t h[2];
+                memcpy(h, data + layout.uv_offset, sizeof(h));
+                uv[0] = lnal::half_to_float(h[0]);
+                uv[1] = lnal::half_to_float(h[1]);
+            }
+            else
+            {
+                memcpy(uv, data + layout.uv_offset, sizeof(float) * 2);
+            }
+        }
+
+        if(tangent && layout.tangent_offset >= 0)
+        {
+            if(layout.format & VERTEX_TANGENT_SNORM8)
+            {
+                int8_t q[4];
+                memcpy(q, data + layout.tangent_offset, sizeof(q));
+
+                for(int k = 0; k < 4; k++)
+                {
+                    tangent[k] = lnal::unpack_snorm(q[k], 8);
+                }
+            }
+            else
+            {
+                memcpy(tangent, data + layout.tangent_offset, sizeof(float) * 4);
+            }
+        }
+
+        if(material && layout.material_offset >= 0)
+            memcpy(material, data + layout.material_offset, sizeof(uint32_t));
+    }
+
+    //Matrix that maps the stored position (in [0, 1] for VERTEX_POSITION_UNORM16) back into object space.
+    //Multiply it into the model matrix (model * dequantize) so shaders don't need to know about the quantization.
+    lnal::mat4 position_dequantize_matrix(const packed_vertices& packed)
+    {
+        lnal::mat4 result(1.0);
+        lnal::scale(result, lnal::vec3(packed.position_scale[0], packed.position_scale[1], packed.position_scale[2]));
+        lnal::translate_absolute(result, lnal::vec3(packed.position_offset[0], packed.position_offset[1], packed.position_offset[2]));
+        return result;
+    }
+}
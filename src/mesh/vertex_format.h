@@ -0,0 +1,64 @@
+#pragma once
+
+#include "mesh.h"
+#include "../math/lnal.h"
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    //Per attribute encodings. Anything not set is stored as 32 bit floats.
+    enum vertex_format_flags : uint32_t
+    {
+        VERTEX_POSITION_UNORM16 = 1 << 0,   //16 bit unsigned normalized, relative to the mesh bounds
+        VERTEX_NORMAL_OCT16 = 1 << 1,       //Octahedral encoding, 2 x 16 bit signed normalized
+        VERTEX_UV_HALF = 1 << 2,            //2 x half float
+        VERTEX_TANGENT_SNORM8 = 1 << 3,     //4 x 8 bit signed normalized, w is the bitangent sign
+
+        VERTEX_FORMAT_FLOAT = 0,
+        VERTEX_FORMAT_COMPACT = VERTEX_POSITION_UNORM16 | VERTEX_NORMAL_OCT16 | VERTEX_UV_HALF | VERTEX_TANGENT_SNORM8
+    };
+
+    //Where each attribute lives inside one interleaved vertex. Offsets are -1 for missing attributes.
+    struct vertex_layout
+    {
+        uint32_t format;
+        uint32_t stride;
+        int32_t position_offset;
+        int32_t normal_offset;
+        int32_t uv_offset;
+        int32_t tangent_offset;
+        int32_t material_offset;    //uint32 in every format
+    };
+
+    //Interleaved, possibly quantized copy of a mesh's vertex data
+    struct packed_vertices
+    {
+        vertex_layout layout;
+        std::vector<uint8_t> data;
+
+        //Quantized positions decode as position = offset + q * scale (q in [0, 1])
+        float position_offset[3];
+        float position_scale[3];
+    };
+
+    //Works out the layout for a mesh in the given format
+    vertex_layout make_vertex_layout(const mesh& m, uint32_t format);
+
+    //Encodes the mesh's attributes into one interleaved buffer using the requested format
+    //@param out packed vertex data
+    //@param m source mesh
+    //@param format combination of vertex_format_flags
+    void pack_vertices(packed_vertices& out, const mesh& m, uint32_t format);
+
+    //Decodes one vertex back to floats (any of the outputs may be null)
+    void unpack_vertex(const packed_vertices& packed, uint32_t vertex, float* position, float* normal, float* uv, float* tangent = nullptr,
+                       uint32_t* material = nullptr);
+
+    //Matrix that maps the stored position (in [0, 1] for VERTEX_POSITION_UNORM16) back into object space.
+    //Multiply it into the model matrix (model * dequantize) so shaders don't need to know about the quantization.
+    lnal::mat4 position_dequantize_matrix(const packed_vertices& packed);
+
+    //GLSL function that decodes a VERTEX_NORMAL_OCT16 attribute: vec3 oct_decode(vec2 e)
+    extern const char* OCT_DECODE_GLSL;
+}
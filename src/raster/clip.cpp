@@ -0,0 +1,195 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Homogeneous clipping with a guard band.
+
+
+    Why only near / far -
+        The rasterizer scans the triangle's screen bounding box clamped to the framebuffer, so a triangle hanging over the left or right side of the
+        image costs nothing extra and doesn't have to be cut. What it can't handle is w <= 0 (the divide flips or blows up) which is exactly what
+        the near plane removes, and the far plane keeps depth within [0, 1]. So only those two planes are clipped against normally.
+
+        The guard band is a second set of x / y planes a few viewports out. Inside it the screen coordinates are small enough for the float edge
+        functions, outside it (a huge triangle right in front of the camera) the triangle is also clipped against the guard planes it crosses.
+        That almost never happens, so the common case stays at zero or two planes.
+
+
+    Outcodes -
+        Every vertex gets a bit per plane it is outside of. For a triangle, the and of its vertices' codes is non zero if all three are outside the
+        same plane (trivial reject) and the or is zero if nothing needs clipping (trivial accept). Vertices are classified 4 at a time and triangles
+        are tested 4 at a time, so the common all-inside triangle never runs a per plane branch.
+
+
+    Planes (GL clip space, visible when the distance is >= 0) -
+        near    z + w           left    x + gw          (g = 1 for the view planes, CLIP_GUARD_BAND for the guard planes)
+        far     w - z           right   gw - x
+                                bottom  y + gw
+                                top     gw - y
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "clip.h"
+#include "../math/simd.h"
+
+namespace br
+{
+    using namespace lnal;
+
+    static inline i32x4 outcode_bit(mask4 outside, uint32_t bit)
+    {
+        return select(outside, i32x4_splat((int32_t)bit), i32x4_splat(0));
+    }
+
+    //Computes the outcode of every vertex, 4 at a time
+    //@param positions clip space xyzw per vertex
+    //@param count number of vertices
+    //@param outcodes one per vertex
+    //@param stride floats from one vertex to the next (positions can be the start of a bigger vertex)
+    void clip_classify(const float* positions, uint32_t count, uint32_t* outcodes, uint32_t stride)
+    {
+        f32x4 guard = f32x4_splat(CLIP_GUARD_BAND);
+        f32x4 zero = f32x4_splat(0.0f);
+
+        for(uint32_t v = 0; v < count; v += 4)
+        {
+            //The last group repeats the final vertex instead of reading past the end
+            uint32_t i0 = v;
+            uint32_t i1 = v + 1 < count ? v + 1 : count - 1;
+            uint32_t i2 = v + 2 < count ? v + 2 : count - 1;
+            uint32_t i3 = v + 3 < count ? v + 3 : count - 1;
+
+            const float* p0 = &positions[(size_t)i0 * stride];
+            const float* p1 = &positions[(size_t)i1 * stride];
+            const float* p2 = &positions[(size_t)i2 * stride];
+            const float* p3 = &positions[(size_t)i3 * stride];
+
+            f32x4 x = f32x4_set(p0[0], p1[0], p2[0], p3[0]);
+            f32x4 y = f32x4_set(p0[1], p1[1], p2[1], p3[1]);
+            f32x4 z = f32x4_set(p0[2], p1[2], p2[2], p3[2]);
+            f32x4 w = f32x4_set(p0[3], p1[3], p2[3], p3[3]);
+            f32x4 gw = guard * w;
+
+            i32x4 code = outcode_bit(x + w < zero, CLIP_LEFT) | outcode_bit(w - x < zero, CLIP_RIGHT)
+                       | outcode_bit(y + w < zero, CLIP_BOTTOM) | outcode_bit(w - y < zero, CLIP_TOP)
+                       | outcode_bit(z + w < zero, CLIP_NEAR) | outcode_bit(w - z < zero, CLIP_FAR)
+                       | outcode_bit(x + gw < zero, CLIP_GUARD_LEFT) | outcode_bit(gw - x < zero, CLIP_GUARD_RIGHT)
+                       | outcode_bit(y + gw < zero, CLIP_GUARD_BOTTOM) | outcode_bit(gw - y < zero, CLIP_GUARD_TOP);
+
+            int32_t codes[4];
+            i32x4_store(codes, code);
+
+            for(uint32_t k = 0; k < 4 && v + k < count; k++)
+            {
+                outcodes[v + k] = (uint32_t)codes[k];
+            }
+        }
+    }
+
+    //Classifies 4 triangles at once from their vertices' outcodes
+    //@param indices 12 vertex indices (4 triangles)
+    //@param reject bit t set if triangle t is outside the frustum
+    //@param clip bit t set if triangle t isn't rejected but has to be clipped
+    void clip_triangles4(const uint32_t* outcodes, const uint32_t* indices, uint32_t& reject, uint32_t& clip)
+    {
+        i32x4 a = i32x4_set((int32_t)outcodes[indices[0]], (int32_t)outcodes[indices[3]], (int32_t)outcodes[indices[6]], (int32_t)outcodes[indices[9]]);
+        i32x4 b = i32x4_set((int32_t)outcodes[indices[1]], (int32_t)outcodes[indices[4]], (int32_t)outcodes[indices[7]], (int32_t)outcodes[indices[10]]);
+        i32x4 c = i32x4_set((int32_t)outcodes[indices[2]], (int32_t)outcodes[indices[5]], (int32_t)outcodes[indices[8]], (int32_t)outcodes[indices[11]]);
+
+        i32x4 zero = i32x4_splat(0);
+        i32x4 all = a & b & c;
+        i32x4 any = a | b | c;
+
+        reject = (uint32_t)~mask_bits((all & i32x4_splat(CLIP_REJECT_MASK)) == zero) & 0xF;
+        clip = (uint32_t)~mask_bits((any & i32x4_splat(CLIP_NEEDED_MASK)) == zero) & 0xF & ~reject;
+    }
+
+    static inline float plane_distance(const float* p, uint32_t plane)
+    {
+        switch(plane)
+        {
+            case CLIP_NEAR: return p[2] + p[3];
+            case CLIP_FAR: return p[3] - p[2];
+            case CLIP_GUARD_LEFT: return p[0] + (CLIP_GUARD_BAND * p[3]);
+            case CLIP_GUARD_RIGHT: return (CLIP_GUARD_BAND * p[3]) - p[0];
+            case CLIP_GUARD_BOTTOM: return p[1] + (CLIP_GUARD_BAND * p[3]);
+            case CLIP_GUARD_TOP: return (CLIP_GUARD_BAND * p[3]) - p[1];
+        }
+
+        return 0.0f;
+    }
+
+    static inline clip_vertex intersect(const clip_vertex& a, const clip_vertex& b, float da, float db)
+    {
+        float t = da / (da - db);
+
+        clip_vertex v;
+        for(int k = 0; k < 4; k++)
+        {
+            v.position[k] = a.position[k] + ((b.position[k] - a.position[k]) * t);
+        }
+
+        for(int k = 0; k < 3; k++)
+        {
+            v.bary[k] = a.bary[k] + ((b.bary[k] - a.bary[k]) * t);
+        }
+
+        return v;
+    }
+
+    //Keeps the part of the polygon on the visible side of one plane
+    static uint32_t clip_polygon(const clip_vertex* in, uint32_t count, uint32_t plane, clip_vertex* out)
+    {
+        uint32_t written = 0;
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            const clip_vertex& a = in[i];
+            const clip_vertex& b = in[i + 1 < count ? i + 1 : 0];
+
+            float da = plane_distance(a.position, plane);
+            float db = plane_distance(b.position, plane);
+
+            if(da >= 0.0f)
+                out[written++] = a;
+
+            //The edge crosses the plane (strictly, so a vertex on the plane isn't emitted twice)
+            if((da >= 0.0f) != (db >= 0.0f))
+                out[written++] = intersect(a, b, da, db);
+        }
+
+        return written;
+    }
+
+    //Sutherland-Hodgman clipping against the near / far planes, plus the guard band planes the triangle actually crosses (rare)
+    //@param outcode_union outcodes of the 3 vertices or'ed together
+    //@param out at least CLIP_MAX_VERTICES vertices, a convex polygon with the original winding
+    //@return number of vertices written (0 or >= 3)
+    uint32_t clip_triangle(const clip_vertex* in, uint32_t outcode_union, clip_vertex* out)
+    {
+        static const uint32_t PLANES[] = { CLIP_NEAR, CLIP_FAR, CLIP_GUARD_LEFT, CLIP_GUARD_RIGHT, CLIP_GUARD_BOTTOM, CLIP_GUARD_TOP };
+
+        clip_vertex buffers[2][CLIP_MAX_VERTICES];
+        const clip_vertex* current = in;
+        uint32_t count = 3;
+        uint32_t target = 0;
+
+        for(uint32_t plane : PLANES)
+        {
+            if(!(outcode_union & plane))
+                continue;
+
+            count = clip_polygon(current, count, plane, buffers[target]);
+            current = buffers[target];
+            target ^= 1;
+
+            if(count < 3)
+                return 0;
+        }
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            out[i] = current[i];
+        }
+
+        return count;
+    }
+}
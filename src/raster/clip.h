@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+namespace br
+{
+    //Outcode bits of a clip space vertex. The view bits are the real frustum sides (used for trivial reject), the guard bits are the same sides
+    //pushed out to the guard band (a vertex inside the guard band can be rasterized without clipping).
+    enum clip_outcode : uint32_t
+    {
+        CLIP_LEFT = 1 << 0,
+        CLIP_RIGHT = 1 << 1,
+        CLIP_BOTTOM = 1 << 2,
+        CLIP_TOP = 1 << 3,
+        CLIP_NEAR = 1 << 4,
+        CLIP_FAR = 1 << 5,
+
+        CLIP_GUARD_LEFT = 1 << 6,
+        CLIP_GUARD_RIGHT = 1 << 7,
+        CLIP_GUARD_BOTTOM = 1 << 8,
+        CLIP_GUARD_TOP = 1 << 9,
+
+        //All three vertices outside one of these planes: the triangle can't be visible
+        CLIP_REJECT_MASK = CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP | CLIP_NEAR | CLIP_FAR,
+
+        //Any vertex outside one of these planes: the triangle has to go through clip_triangle
+        CLIP_NEEDED_MASK = CLIP_NEAR | CLIP_FAR | CLIP_GUARD_LEFT | CLIP_GUARD_RIGHT | CLIP_GUARD_BOTTOM | CLIP_GUARD_TOP,
+    };
+
+    //Half extent of the guard band in NDC units (1 is the viewport edge). Screen positions stay within a few viewports of the image so the
+    //float edge functions keep their precision.
+    static const float CLIP_GUARD_BAND = 4.0f;
+
+    //A triangle clipped against all 6 planes has at most 3 + 6 vertices
+    static const uint32_t CLIP_MAX_VERTICES = 9;
+
+    struct clip_vertex
+    {
+        float position[4];
+
+        //Weights of the original triangle's vertices, so any vertex attribute can be interpolated at the new vertex later
+        float bary[3];
+    };
+
+    //Computes the outcode of every vertex, 4 at a time
+    //@param positions clip space xyzw per vertex
+    //@param count number of vertices
+    //@param outcodes one per vertex
+    //@param stride floats from one vertex to the next (positions can be the start of a bigger vertex)
+    void clip_classify(const float* positions, uint32_t count, uint32_t* outcodes, uint32_t stride = 4);
+
+    //Classifies 4 triangles at once from their vertices' outcodes
+    //@param indices 12 vertex indices (4 triangles)
+    //@param reject bit t set if triangle t is outside the frustum
+    //@param clip bit t set if triangle t isn't rejected but has to be clipped
+    void clip_triangles4(const uint32_t* outcodes, const uint32_t* indices, uint32_t& reject, uint32_t& clip);
+
+    //Sutherland-Hodgman clipping against the near / far planes, plus the guard band planes the triangle actually crosses (rare)
+    //@param outcode_union outcodes of the 3 vertices or'ed together
+    //@param out at least CLIP_MAX_VERTICES vertices, a convex polygon with the original winding
+    //@return number of vertices written (0 or >= 3)
+    uint32_t clip_triangle(const clip_vertex* in, uint32_t outcode_union, clip_vertex* out);
+}
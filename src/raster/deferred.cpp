@@ -0,0 +1,280 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Tiled deferred shading.
+
+
+    G-buffer -
+        One 32 bit texel per pixel next to the depth buffer: the view space normal octahedral encoded to 12 + 12 bits and an 8 bit material index
+        that selects the albedo from a small table. Position isn't stored at all, the lighting pass rebuilds it from the pixel coordinate and the
+        depth through the inverse projection. That's 8 bytes per pixel in total (with depth) instead of the 36+ a float position / normal / color
+        G-buffer needs, and the depth buffer was there anyway.
+
+
+    Tiles -
+        The image is cut into DEFERRED_TILE_SIZE tiles. Each tile first finds the depth range of its pixels, then bin_lights (light.cpp) gives it
+        the lights whose sphere overlaps both its screen rectangle and that depth range. Shading a pixel only walks its tile's list, so a frame
+        with hundreds of small lights costs about what the handful touching each pixel cost instead of all of them.
+
+        Tiles are independent so they're handed to the job system in rows.
+
+
+    Lighting -
+        Lambert diffuse per light with a smooth window falloff, (1 - d^2 / r^2)^2, that reaches zero exactly at the light's radius so culling by
+        radius doesn't leave a visible edge (add_point_light4 in shaders.h, shared with the clustered forward shader). Ambient is a constant
+        fraction of the albedo.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "deferred.h"
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+namespace br
+{
+    using namespace lnal;
+
+    //Depth buffer value of a cleared pixel (see framebuffer.h)
+    static const float DEPTH_BACKGROUND = 1.0f;
+
+    //View space depth (distance in front of the camera) of a pixel through the inverse projection
+    static inline float view_distance(const float* inv, float ndc_x, float ndc_y, float depth)
+    {
+        float ndc_z = (depth * 2.0f) - 1.0f;
+        float z = (inv[2] * ndc_x) + (inv[6] * ndc_y) + (inv[10] * ndc_z) + inv[14];
+        float w = (inv[3] * ndc_x) + (inv[7] * ndc_y) + (inv[11] * ndc_z) + inv[15];
+        return -z / w;
+    }
+
+    //Nearest and farthest view distance of every tile's geometry. Depth maps to distance monotonically and (for the projections lnal builds)
+    //independently of x / y, so only the raw min / max depth is tracked per pixel and the two extremes are converted at the tile center.
+    static void tile_depth_bounds(const framebuffer& gbuffer, const float* inv, const light_tiles& tiles, std::vector<float>& bounds, job_system* js)
+    {
+        uint32_t tile_size = tiles.tile_size;
+        bounds.resize(tiles.tiles_x * tiles.tiles_y * 2);
+
+        parallel_for(js, tiles.tiles_y, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t ty = begin; ty < end; ty++)
+            {
+                for(uint32_t tx = 0; tx < tiles.tiles_x; tx++)
+                {
+                    uint32_t x0 = tx * tile_size, y0 = ty * tile_size;
+                    uint32_t x1 = x0 + tile_size < gbuffer.width ? x0 + tile_size : gbuffer.width;
+                    uint32_t y1 = y0 + tile_size < gbuffer.height ? y0 + tile_size : gbuffer.height;
+
+                    f32x4 background = f32x4_splat(DEPTH_BACKGROUND);
+                    f32x4 nearest = background;
+                    f32x4 farthest = f32x4_splat(-1.0f);
+
+                    for(uint32_t y = y0; y < y1; y++)
+                    {
+                        const float* row = &gbuffer.depth[(size_t)y * gbuffer.width];
+                        uint32_t x = x0;
+
+                        for(; x + 4 <= x1; x += 4)
+                        {
+                            f32x4 d = f32x4_load(&row[x]);
+                            nearest = min(nearest, d);
+                            farthest = max(farthest, select(d < background, d, f32x4_splat(-1.0f)));
+                        }
+
+                        for(; x < x1; x++)
+                        {
+                            f32x4 d = f32x4_splat(row[x]);
+                            nearest = min(nearest, d);
+                            farthest = max(farthest, select(d < background, d, f32x4_splat(-1.0f)));
+                        }
+                    }
+
+                    float n[4], f[4];
+                    f32x4_store(n, nearest);
+                    f32x4_store(f, farthest);
+                    float near_depth = fminf(fminf(n[0], n[1]), fminf(n[2], n[3]));
+                    float far_depth = fmaxf(fmaxf(f[0], f[1]), fmaxf(f[2], f[3]));
+
+                    float* out = &bounds[(ty * tiles.tiles_x + tx) * 2];
+
+                    //Only background: an empty range
+                    if(far_depth < 0.0f)
+                    {
+                        out[0] = 1.0f;
+                        out[1] = 0.0f;
+                        continue;
+                    }
+
+                    float ndc_x = (((x0 + x1) * 0.5f) / gbuffer.width) * 2.0f - 1.0f;
+                    float ndc_y = 1.0f - (((y0 + y1) * 0.5f) / gbuffer.height) * 2.0f;
+                    out[0] = view_distance(inv, ndc_x, ndc_y, near_depth);
+                    out[1] = view_distance(inv, ndc_x, ndc_y, far_depth);
+                }
+            }
+        });
+    }
+
+    //Shades one tile's pixels with the given lights (light_list null means lights 0 .. light_count - 1)
+    static void shade_tile(framebuffer& out, const framebuffer& gbuffer, const deferred_lighting& lighting, const float* inv, uint32_t x0, uint32_t y0,
+                           uint32_t x1, uint32_t y1, const uint32_t* light_list, uint32_t light_count, uint64_t& pixels_shaded, uint64_t& evaluations)
+    {
+        f32x4 zero = f32x4_splat(0.0f);
+        f32x4 one = f32x4_splat(1.0f);
+        f32x4 ambient = f32x4_splat(lighting.ambient);
+        f32x4 background_depth = f32x4_splat(DEPTH_BACKGROUND);
+        i32x4 background = i32x4_splat((int32_t)lighting.background);
+
+        //Pixel center to NDC, per lane for x
+        float scale_x = 2.0f / gbuffer.width;
+        float scale_y = 2.0f / gbuffer.height;
+        f32x4 lane = f32x4_set(0.5f, 1.5f, 2.5f, 3.5f);
+
+        for(uint32_t y = y0; y < y1; y++)
+        {
+            float ndc_y = 1.0f - ((y + 0.5f) * scale_y);
+
+            //Everything of the inverse projection that doesn't depend on x / depth for this row
+            f32x4 row_x = f32x4_splat((inv[4] * ndc_y) + inv[12]);
+            f32x4 row_y = f32x4_splat((inv[5] * ndc_y) + inv[13]);
+            f32x4 row_z = f32x4_splat((inv[6] * ndc_y) + inv[14]);
+            f32x4 row_w = f32x4_splat((inv[7] * ndc_y) + inv[15]);
+
+            for(uint32_t x = x0; x < x1; x += 4)
+            {
+                uint32_t valid = x1 - x < 4 ? x1 - x : 4;
+                size_t offset = (size_t)y * gbuffer.width + x;
+
+                //Partial groups at the right edge go through a copy so nothing past the row is touched
+                float depth_copy[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+                int32_t texel_copy[4] = { 0, 0, 0, 0 };
+                for(uint32_t k = 0; k < valid; k++)
+                {
+                    depth_copy[k] = gbuffer.depth[offset + k];
+                    texel_copy[k] = (int32_t)gbuffer.color[offset + k];
+                }
+
+                f32x4 depth = f32x4_load(depth_copy);
+                i32x4 texel = i32x4_load(texel_copy);
+                mask4 geometry = depth < background_depth;
+
+                i32x4 result = background;
+
+                if(any(geometry))
+                {
+                    f32x4 nx, ny, nz;
+                    unpack_gbuffer_normal4(texel, nx, ny, nz);
+
+                    //Albedo gather, scalar since the table is tiny. Background lanes hold whatever the G-buffer was cleared to, they use material 0.
+                    float albedo[3][4];
+                    for(uint32_t k = 0; k < 4; k++)
+                    {
+                        uint32_t material = depth_copy[k] < DEPTH_BACKGROUND ? (uint32_t)texel_copy[k] >> 24 : 0;
+                        material = material < lighting.material_count ? material : 0;
+                        const float* a = &lighting.albedo[material * lighting.albedo_stride];
+                        albedo[0][k] = a[0];
+                        albedo[1][k] = a[1];
+                        albedo[2][k] = a[2];
+                    }
+
+                    //View space position from depth
+                    f32x4 ndc_x = (f32x4_splat((float)x) + lane) * f32x4_splat(scale_x) - one;
+                    f32x4 ndc_z = (depth + depth) - one;
+                    f32x4 vw = (f32x4_splat(inv[3]) * ndc_x) + (f32x4_splat(inv[11]) * ndc_z) + row_w;
+                    f32x4 inv_w = one / vw;
+                    f32x4 px = ((f32x4_splat(inv[0]) * ndc_x) + (f32x4_splat(inv[8]) * ndc_z) + row_x) * inv_w;
+                    f32x4 py = ((f32x4_splat(inv[1]) * ndc_x) + (f32x4_splat(inv[9]) * ndc_z) + row_y) * inv_w;
+                    f32x4 pz = ((f32x4_splat(inv[2]) * ndc_x) + (f32x4_splat(inv[10]) * ndc_z) + row_z) * inv_w;
+
+                    f32x4 r = zero, g = zero, b = zero;
+
+                    for(uint32_t i = 0; i < light_count; i++)
+                    {
+                        const point_light& light = lighting.lights[light_list ? light_list[i] : i];
+
+                        if(add_point_light4(light, geometry, px, py, pz, nx, ny, nz, r, g, b))
+                            evaluations++;
+                    }
+
+                    i32x4 lit = pack_color4(f32x4_load(albedo[0]) * (ambient + r), f32x4_load(albedo[1]) * (ambient + g), f32x4_load(albedo[2]) * (ambient + b));
+                    result = select(geometry, lit, background);
+                    pixels_shaded += mask_count(geometry);
+                }
+
+                int32_t colors[4];
+                i32x4_store(colors, result);
+                for(uint32_t k = 0; k < valid; k++)
+                {
+                    out.color[offset + k] = (uint32_t)colors[k];
+                }
+            }
+        }
+    }
+
+    //Lights the G-buffer into out.color. out can be the G-buffer itself.
+    //@param gbuffer color holds the packed texels, depth the depth buffer of the geometry pass
+    //@param tiles per tile light lists, rebuilt every call (kept by the caller so they don't reallocate)
+    //@param js optional, tiles are shaded in parallel
+    //@param stats optional counters
+    void deferred_shade(framebuffer& out, const framebuffer& gbuffer, const deferred_lighting& lighting, light_tiles& tiles, job_system* js, deferred_stats* stats)
+    {
+        lnal::mat4 projection = lighting.projection;
+        lnal::mat4 inverse_projection = projection.inverse();
+        const float* inv = inverse_projection.data();
+
+        tiles.tile_size = DEFERRED_TILE_SIZE;
+        tiles.tiles_x = (gbuffer.width + tiles.tile_size - 1) / tiles.tile_size;
+        tiles.tiles_y = (gbuffer.height + tiles.tile_size - 1) / tiles.tile_size;
+
+        if(lighting.tiled)
+        {
+            tile_depth_bounds(gbuffer, inv, tiles, tiles.depth_bounds, js);
+            bin_lights(tiles, lighting.lights, lighting.light_count, lighting.projection, gbuffer.width, gbuffer.height, tiles.depth_bounds.data());
+        }
+
+        std::atomic<uint64_t> pixels_shaded{0};
+        std::atomic<uint64_t> evaluations{0};
+
+        parallel_for(js, tiles.tiles_y, 1, [&](uint32_t begin, uint32_t end)
+        {
+            uint64_t local_pixels = 0;
+            uint64_t local_evaluations = 0;
+
+            for(uint32_t ty = begin; ty < end; ty++)
+            {
+                for(uint32_t tx = 0; tx < tiles.tiles_x; tx++)
+                {
+                    uint32_t x0 = tx * tiles.tile_size, y0 = ty * tiles.tile_size;
+                    uint32_t x1 = x0 + tiles.tile_size < gbuffer.width ? x0 + tiles.tile_size : gbuffer.width;
+                    uint32_t y1 = y0 + tiles.tile_size < gbuffer.height ? y0 + tiles.tile_size : gbuffer.height;
+
+                    const uint32_t* list = nullptr;
+                    uint32_t count = lighting.light_count;
+
+                    if(lighting.tiled)
+                    {
+                        uint32_t tile = ty * tiles.tiles_x + tx;
+                        list = tiles.indices.data() + tiles.offsets[tile];
+                        count = tiles.offsets[tile + 1] - tiles.offsets[tile];
+                    }
+
+                    shade_tile(out, gbuffer, lighting, inv, x0, y0, x1, y1, list, count, local_pixels, local_evaluations);
+                }
+            }
+
+            pixels_shaded += local_pixels;
+            evaluations += local_evaluations;
+        });
+
+        if(stats)
+        {
+            stats->pixels_shaded += pixels_shaded;
+            stats->light_evaluations += evaluations;
+
+            uint32_t tile_count = tiles.tiles_x * tiles.tiles_y;
+            for(uint32_t t = 0; t < tile_count; t++)
+            {
+                uint32_t count = lighting.tiled ? tiles.offsets[t + 1] - tiles.offsets[t] : lighting.light_count;
+                stats->tile_lights += count;
+                stats->max_tile_lights = count > stats->max_tile_lights ? count : stats->max_tile_lights;
+            }
+        }
+    }
+}
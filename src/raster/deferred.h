@@ -0,0 +1,121 @@
+#pragma once
+
+#include "framebuffer.h"
+#include "shaders.h"
+#include "../math/lnal.h"
+#include "../math/simd.h"
+#include "../scene/light.h"
+#include "../core/job.h"
+#include <cstdint>
+
+//Deferred shading for the CPU rasterizer, see deferred.cpp. The G-buffer is an ordinary framebuffer: the geometry pass writes packed texels
+//into color with gbuffer_fragment_shader and leaves its depth buffer behind, deferred_shade turns both into the lit image.
+
+namespace br
+{
+    //G-buffer texel layout (the GL backend uses the same one)
+    //  bits 0 - 11     octahedral view space normal x, unorm
+    //  bits 12 - 23    octahedral view space normal y, unorm
+    //  bits 24 - 31    material index
+    static const uint32_t GBUFFER_NORMAL_BITS = 12;
+    static const uint32_t GBUFFER_MATERIALS = 256;
+
+    //Tile size of the light lists. 16 x 16 keeps the per tile depth range tight without making the lists too many.
+    static const uint32_t DEFERRED_TILE_SIZE = 16;
+
+    //Octahedral encodes 4 unit vectors and packs them with the material index. A zero vector encodes as +z (facing the camera).
+    inline lnal::i32x4 pack_gbuffer4(lnal::f32x4 nx, lnal::f32x4 ny, lnal::f32x4 nz, uint32_t material)
+    {
+        using namespace lnal;
+
+        f32x4 zero = f32x4_splat(0.0f);
+        f32x4 one = f32x4_splat(1.0f);
+        f32x4 ax = max(nx, zero - nx), ay = max(ny, zero - ny), az = max(nz, zero - nz);
+        f32x4 inv = one / max(ax + ay + az, f32x4_splat(1e-20f));
+
+        f32x4 ex = nx * inv;
+        f32x4 ey = ny * inv;
+
+        //Lower hemisphere folds over the diagonals
+        f32x4 sign_x = select(ex >= zero, one, zero - one);
+        f32x4 sign_y = select(ey >= zero, one, zero - one);
+        mask4 lower = nz < zero;
+        f32x4 fx = (one - (ay * inv)) * sign_x;
+        f32x4 fy = (one - (ax * inv)) * sign_y;
+        ex = select(lower, fx, ex);
+        ey = select(lower, fy, ey);
+
+        f32x4 scale = f32x4_splat((float)((1 << GBUFFER_NORMAL_BITS) - 1) * 0.5f);
+        f32x4 half = f32x4_splat(0.5f);
+        i32x4 qx = to_int(((ex + one) * scale) + half);
+        i32x4 qy = to_int(((ey + one) * scale) + half);
+
+        return qx | (qy << GBUFFER_NORMAL_BITS) | i32x4_splat((int32_t)(material << 24));
+    }
+
+    //Inverse of pack_gbuffer4's normal part, normalized
+    inline void unpack_gbuffer_normal4(lnal::i32x4 texel, lnal::f32x4& nx, lnal::f32x4& ny, lnal::f32x4& nz)
+    {
+        using namespace lnal;
+
+        i32x4 field = i32x4_splat((1 << GBUFFER_NORMAL_BITS) - 1);
+        f32x4 scale = f32x4_splat(2.0f / (float)((1 << GBUFFER_NORMAL_BITS) - 1));
+        f32x4 zero = f32x4_splat(0.0f);
+        f32x4 one = f32x4_splat(1.0f);
+
+        nx = (to_float(texel & field) * scale) - one;
+        ny = (to_float((texel >> GBUFFER_NORMAL_BITS) & field) * scale) - one;
+        nz = one - max(nx, zero - nx) - max(ny, zero - ny);
+
+        f32x4 t = max(zero - nz, zero);
+        nx = nx + select(nx >= zero, zero - t, t);
+        ny = ny + select(ny >= zero, zero - t, t);
+        normalize4(nx, ny, nz);
+    }
+
+    //Geometry pass fragment shader. Pair it with lambert_vertex_shader with model = view * model so the normal varyings are in view space.
+    struct gbuffer_fragment_shader
+    {
+        uint32_t material;  //< GBUFFER_MATERIALS
+
+        lnal::i32x4 operator()(const lnal::f32x4* varyings) const
+        {
+            lnal::f32x4 nx = varyings[0], ny = varyings[1], nz = varyings[2];
+            normalize4(nx, ny, nz);
+            return pack_gbuffer4(nx, ny, nz, material);
+        }
+    };
+
+    //Everything the lighting pass needs besides the G-buffer
+    struct deferred_lighting
+    {
+        lnal::mat4 projection;                  //The projection the G-buffer was drawn with (the view is baked into the view space normals)
+        const point_light* lights = nullptr;    //View space (transform_lights)
+        uint32_t light_count = 0;
+        const float* albedo = nullptr;          //RGB per material index
+        uint32_t albedo_stride = 3;             //Floats from one material's RGB to the next, MATERIAL_PARAMS_FLOATS to read a material library's block
+        uint32_t material_count = 1;            //Entries in albedo, texels with a bigger index use material 0
+        float ambient = 0.05f;
+        uint32_t background = 0xFF000000;       //pack_color for pixels without geometry
+
+        //False shades every pixel with every light (reference for the benchmarks)
+        bool tiled = true;
+    };
+
+    //Counters for one deferred_shade call
+    struct deferred_stats
+    {
+        uint64_t pixels_shaded = 0;
+        uint64_t tile_lights = 0;           //Sum of the tile list lengths
+        uint32_t max_tile_lights = 0;
+        uint64_t light_evaluations = 0;     //4 pixel groups x lights that reached at least one of the pixels
+    };
+
+    //Lights the G-buffer into out.color. out can be the G-buffer itself.
+    //@param gbuffer color holds the packed texels, depth the depth buffer of the geometry pass
+    //@param tiles per tile light lists, rebuilt every call (kept by the caller so they don't reallocate)
+    //@param js optional, tiles are shaded in parallel
+    //@param stats optional counters
+    void deferred_shade(framebuffer& out, const framebuffer& gbuffer, const deferred_lighting& lighting, light_tiles& tiles, job_system* js = nullptr,
+                        deferred_stats* stats = nullptr);
+}
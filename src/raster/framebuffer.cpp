@@ -0,0 +1,48 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Framebuffer storage for the CPU rasterizer.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "framebuffer.h"
+#include "../math/pack.h"
+#include <algorithm>
+
+namespace br
+{
+    void framebuffer_init(framebuffer& fb, uint32_t width, uint32_t height)
+    {
+        fb.width = width;
+        fb.height = height;
+        fb.color.assign((size_t)width * height, 0);
+        fb.depth.assign((size_t)width * height, 1.0f);
+    }
+
+    void framebuffer_clear(framebuffer& fb, uint32_t color, float depth)
+    {
+        std::fill(fb.color.begin(), fb.color.end(), color);
+        std::fill(fb.depth.begin(), fb.depth.end(), depth);
+    }
+
+    void depth_buffer_init(depth_buffer& db, uint32_t width, uint32_t height, uint32_t border)
+    {
+        db.width = width;
+        db.height = height;
+        db.border = border;
+
+        //Whole 4 texel groups per row so the rasterizer's last group on a row stays inside the row
+        db.stride = ((width + 3) & ~3u) + (border * 2);
+        db.depth.assign((size_t)db.stride * (height + (border * 2)), 1.0f);
+    }
+
+    void depth_buffer_clear(depth_buffer& db, float depth)
+    {
+        std::fill(db.depth.begin(), db.depth.end(), depth);
+    }
+
+    //Packs a color with components in [0, 1] into the framebuffer's RGBA8 layout
+    uint32_t pack_color(float r, float g, float b, float a)
+    {
+        return lnal::pack_unorm(r, 8) | (lnal::pack_unorm(g, 8) << 8) | (lnal::pack_unorm(b, 8) << 16) | (lnal::pack_unorm(a, 8) << 24);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    //Render target for the CPU rasterizer. Color is RGBA8 (R in the lowest byte), depth is [0, 1] with 1 = far plane.
+    struct framebuffer
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint32_t> color;
+        std::vector<float> depth;
+    };
+
+    //Depth only render target (shadow maps). Rows are stored with a border of untouched texels around the image so filters can read a few
+    //texels past the edge without clamping, texel (x, y) is at depth[(y + border) * stride + x + border].
+    struct depth_buffer
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t border = 0;
+        uint32_t stride = 0;
+        std::vector<float> depth;
+    };
+
+    void framebuffer_init(framebuffer& fb, uint32_t width, uint32_t height);
+
+    void framebuffer_clear(framebuffer& fb, uint32_t color, float depth = 1.0f);
+
+    //@param border texels of padding on every side, they keep the clear depth
+    void depth_buffer_init(depth_buffer& db, uint32_t width, uint32_t height, uint32_t border = 0);
+
+    //Clears the border as well
+    void depth_buffer_clear(depth_buffer& db, float depth = 1.0f);
+
+    inline float* depth_buffer_row(depth_buffer& db, int y)
+    {
+        return &db.depth[((size_t)(y + (int)db.border) * db.stride) + db.border];
+    }
+
+    inline const float* depth_buffer_row(const depth_buffer& db, int y)
+    {
+        return &db.depth[((size_t)(y + (int)db.border) * db.stride) + db.border];
+    }
+
+    //Packs a color with components in [0, 1] into the framebuffer's RGBA8 layout
+    uint32_t pack_color(float r, float g, float b, float a = 1.0f);
+}
@@ -0,0 +1,246 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Multisampled render target.
+
+
+    Samples -
+        Coverage and depth are tested at 2, 4 or 8 sample positions per pixel (the standard D3D / GL patterns, which are rotated so no two
+        samples share a row or column and near horizontal / vertical edges still get every coverage step). The fragment shader runs once per
+        pixel per triangle at the pixel center and its color goes to all samples the triangle covers, so 4x MSAA costs 4x the edge and depth tests
+        but the same shading as no AA. Supersampling would shade every sample.
+
+
+    Tiles -
+        Most pixels are inside a single triangle, and all their samples end up the same color. Storing samples per pixel would write (and resolve)
+        the same color samples times over, so color is kept per MSAA_TILE_SIZE tile in one of three modes:
+
+            clear       nothing drawn since the clear. Clearing only resets the modes, the first block drawn into the tile fills in its colors
+                        and depths.
+            uniform     one color per pixel. A write that covers every sample of every pixel it touches stays uniform.
+            expanded    a pixel got partial coverage (a triangle edge went through it), the tile's colors are copied into a slot of per sample
+                        colors and stay there until the next clear.
+
+        Only tiles along edges expand, so for ordinary scenes the color storage in use is not much more than a plain framebuffer. Depth isn't
+        compressed, every sample's depth is read by every test anyway.
+
+
+    Resolve -
+        Clear tiles are filled, uniform tiles copied and expanded tiles box filtered 4 pixels at a time: red / blue and green / alpha are split
+        into 16 bit halves of the 32 bit lanes (8 samples of 255 still fit), summed over the samples, rounded and shifted down by log2(samples).
+        Filtering is on the stored (gamma encoded) values like GL's default resolve.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "msaa.h"
+#include <algorithm>
+#include <cstring>
+
+namespace br
+{
+    using namespace lnal;
+
+    //Standard sample positions in 1/16 pixel units, relative to the pixel center
+    static const int8_t SAMPLES_1[] = { 0, 0 };
+    static const int8_t SAMPLES_2[] = { 4, 4, -4, -4 };
+    static const int8_t SAMPLES_4[] = { -2, -6, 6, -2, -6, 2, 2, 6 };
+    static const int8_t SAMPLES_8[] = { 1, -3, -1, 3, 5, 1, -3, -5, -5, 5, -7, -1, 3, 7, 7, -7 };
+
+    bool msaa_init(msaa_framebuffer& fb, uint32_t width, uint32_t height, uint32_t samples)
+    {
+        const int8_t* positions = nullptr;
+        switch(samples)
+        {
+            case 1: positions = SAMPLES_1; break;
+            case 2: positions = SAMPLES_2; break;
+            case 4: positions = SAMPLES_4; break;
+            case 8: positions = SAMPLES_8; break;
+            default: return false;
+        }
+
+        fb.width = width;
+        fb.height = height;
+        fb.samples = samples;
+
+        for(uint32_t s = 0; s < samples; s++)
+        {
+            fb.sample_x[s] = positions[s * 2] / 16.0f;
+            fb.sample_y[s] = positions[s * 2 + 1] / 16.0f;
+        }
+
+        fb.tiles_x = (width + MSAA_TILE_SIZE - 1) / MSAA_TILE_SIZE;
+        fb.tiles_y = (height + MSAA_TILE_SIZE - 1) / MSAA_TILE_SIZE;
+        fb.stride = fb.tiles_x * MSAA_TILE_SIZE;
+
+        size_t padded = (size_t)fb.stride * fb.tiles_y * MSAA_TILE_SIZE;
+        fb.tile_mode.assign(fb.tiles_x * fb.tiles_y, MSAA_TILE_CLEAR);
+        fb.tile_slot.assign(fb.tiles_x * fb.tiles_y, 0);
+        fb.color.assign(padded, 0);
+        fb.depth.assign(padded * samples, 1.0f);
+        fb.sample_colors.clear();
+        fb.slots_used = 0;
+
+        return true;
+    }
+
+    void msaa_clear(msaa_framebuffer& fb, uint32_t color, float depth)
+    {
+        fb.clear_color = color;
+        fb.clear_depth = depth;
+        std::fill(fb.tile_mode.begin(), fb.tile_mode.end(), (uint8_t)MSAA_TILE_CLEAR);
+        fb.slots_used = 0;
+    }
+
+    void msaa_begin_tile(msaa_framebuffer& fb, uint32_t tile)
+    {
+        uint32_t x = (tile % fb.tiles_x) * MSAA_TILE_SIZE;
+        uint32_t y = (tile / fb.tiles_x) * MSAA_TILE_SIZE;
+
+        for(uint32_t row = y; row < y + MSAA_TILE_SIZE; row++)
+        {
+            std::fill_n(&fb.color[((size_t)row * fb.stride) + x], MSAA_TILE_SIZE, fb.clear_color);
+
+            for(uint32_t s = 0; s < fb.samples; s++)
+            {
+                std::fill_n(msaa_depth(fb, x, row, s), MSAA_TILE_SIZE, fb.clear_depth);
+            }
+        }
+
+        fb.tile_mode[tile] = MSAA_TILE_UNIFORM;
+    }
+
+    void msaa_expand_tile(msaa_framebuffer& fb, uint32_t tile)
+    {
+        size_t slot_size = (size_t)MSAA_TILE_SIZE * MSAA_TILE_SIZE * fb.samples;
+
+        //Slots are kept between frames, so this only grows until the scene's edge tile count settles
+        if(fb.sample_colors.size() < (fb.slots_used + 1) * slot_size)
+            fb.sample_colors.resize((fb.slots_used + 1) * slot_size);
+
+        fb.tile_slot[tile] = fb.slots_used++;
+        fb.tile_mode[tile] = MSAA_TILE_EXPANDED;
+
+        uint32_t x = (tile % fb.tiles_x) * MSAA_TILE_SIZE;
+        uint32_t y = (tile / fb.tiles_x) * MSAA_TILE_SIZE;
+
+        for(uint32_t row = y; row < y + MSAA_TILE_SIZE; row++)
+        {
+            const uint32_t* src = &fb.color[((size_t)row * fb.stride) + x];
+
+            for(uint32_t s = 0; s < fb.samples; s++)
+            {
+                memcpy(msaa_sample_colors(fb, tile, x, row, s), src, MSAA_TILE_SIZE * sizeof(uint32_t));
+            }
+        }
+    }
+
+    //Stores the first count lanes
+    static inline void store_pixels(uint32_t* dst, i32x4 color, uint32_t count)
+    {
+        if(count >= 4)
+        {
+            i32x4_store((int32_t*)dst, color);
+            return;
+        }
+
+        uint32_t lanes[4];
+        i32x4_store((int32_t*)lanes, color);
+        memcpy(dst, lanes, count * sizeof(uint32_t));
+    }
+
+    static void resolve_tile(const msaa_framebuffer& fb, uint32_t tile, framebuffer& out)
+    {
+        uint32_t x = (tile % fb.tiles_x) * MSAA_TILE_SIZE;
+        uint32_t y = (tile / fb.tiles_x) * MSAA_TILE_SIZE;
+        uint32_t columns = std::min(MSAA_TILE_SIZE, fb.width - x);
+        uint32_t rows = std::min(MSAA_TILE_SIZE, fb.height - y);
+
+        if(fb.tile_mode[tile] == MSAA_TILE_CLEAR)
+        {
+            for(uint32_t row = y; row < y + rows; row++)
+            {
+                std::fill_n(&out.color[((size_t)row * out.width) + x], columns, fb.clear_color);
+            }
+            return;
+        }
+
+        if(fb.tile_mode[tile] == MSAA_TILE_UNIFORM)
+        {
+            for(uint32_t row = y; row < y + rows; row++)
+            {
+                memcpy(&out.color[((size_t)row * out.width) + x], &fb.color[((size_t)row * fb.stride) + x], columns * sizeof(uint32_t));
+            }
+            return;
+        }
+
+        //Expanded: average the samples per channel pair
+        int shift = 0;
+        while((1u << shift) < fb.samples)
+        {
+            shift++;
+        }
+
+        int32_t half = (int32_t)(fb.samples / 2);
+        const i32x4 low_bytes = i32x4_splat(0x00FF00FF);
+        const i32x4 round = i32x4_splat((half << 16) | half);
+
+        size_t slot = (size_t)fb.tile_slot[tile] * MSAA_TILE_SIZE * MSAA_TILE_SIZE * fb.samples;
+        const uint32_t* samples = &fb.sample_colors[slot];
+        const size_t sample_stride = MSAA_TILE_SIZE * MSAA_TILE_SIZE;
+
+        for(uint32_t row = 0; row < rows; row++)
+        {
+            for(uint32_t column = 0; column < columns; column += 4)
+            {
+                const uint32_t* p = &samples[(row * MSAA_TILE_SIZE) + column];
+
+                i32x4 red_blue = i32x4_splat(0);
+                i32x4 green_alpha = i32x4_splat(0);
+
+                for(uint32_t s = 0; s < fb.samples; s++)
+                {
+                    i32x4 c = i32x4_load((const int32_t*)&p[s * sample_stride]);
+                    red_blue = red_blue + (c & low_bytes);
+                    green_alpha = green_alpha + (shift_right_logical(c, 8) & low_bytes);
+                }
+
+                red_blue = shift_right_logical(red_blue + round, shift) & low_bytes;
+                green_alpha = shift_right_logical(green_alpha + round, shift) & low_bytes;
+
+                store_pixels(&out.color[((size_t)(y + row) * out.width) + x + column], red_blue | (green_alpha << 8), columns - column);
+            }
+        }
+    }
+
+    void msaa_resolve(const msaa_framebuffer& fb, framebuffer& out, job_system* js)
+    {
+        parallel_for(js, fb.tiles_y, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t ty = begin; ty < end; ty++)
+            {
+                for(uint32_t tx = 0; tx < fb.tiles_x; tx++)
+                {
+                    resolve_tile(fb, (ty * fb.tiles_x) + tx, out);
+                }
+            }
+        });
+    }
+
+    msaa_stats msaa_memory(const msaa_framebuffer& fb)
+    {
+        msaa_stats stats;
+
+        for(uint8_t mode : fb.tile_mode)
+        {
+            stats.tiles_clear += mode == MSAA_TILE_CLEAR;
+            stats.tiles_uniform += mode == MSAA_TILE_UNIFORM;
+            stats.tiles_expanded += mode == MSAA_TILE_EXPANDED;
+        }
+
+        size_t slot_size = (size_t)MSAA_TILE_SIZE * MSAA_TILE_SIZE * fb.samples;
+        stats.color_bytes = (fb.color.size() + (fb.slots_used * slot_size)) * sizeof(uint32_t) + fb.tile_mode.size() + (fb.tile_slot.size() * sizeof(uint32_t));
+        stats.uncompressed_color_bytes = (size_t)fb.width * fb.height * fb.samples * sizeof(uint32_t);
+        stats.depth_bytes = fb.depth.size() * sizeof(float);
+
+        return stats;
+    }
+}
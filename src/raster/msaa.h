@@ -0,0 +1,136 @@
+#pragma once
+
+#include "framebuffer.h"
+#include "../math/simd.h"
+#include "../core/job.h"
+#include <cstdint>
+#include <vector>
+
+//Multisampled render target for the CPU rasterizer, see msaa.cpp. draw_shaded takes it in place of a framebuffer, msaa_resolve averages the
+//samples into an ordinary framebuffer afterwards.
+
+namespace br
+{
+    static const uint32_t MSAA_MAX_SAMPLES = 8;
+
+    //Compression tiles, the same size as the rasterizer's blocks so a block only ever touches one tile
+    static const uint32_t MSAA_TILE_SIZE = 8;
+
+    //How a tile's colors are stored
+    enum msaa_tile_mode : uint8_t
+    {
+        MSAA_TILE_CLEAR,        //Nothing drawn since the clear, every sample has the clear color and depth (neither is stored yet)
+        MSAA_TILE_UNIFORM,      //Every pixel's samples share one color, kept in color
+        MSAA_TILE_EXPANDED      //Per sample colors in sample_colors
+    };
+
+    struct msaa_framebuffer
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t samples = 0;
+
+        //Sample positions relative to the pixel center, in pixels (y down like the pixel rows)
+        float sample_x[MSAA_MAX_SAMPLES];
+        float sample_y[MSAA_MAX_SAMPLES];
+
+        //Storage is padded to whole tiles, stride is the padded width
+        uint32_t tiles_x = 0;
+        uint32_t tiles_y = 0;
+        uint32_t stride = 0;
+
+        uint32_t clear_color = 0;
+        float clear_depth = 1.0f;
+
+        std::vector<uint8_t> tile_mode;         //msaa_tile_mode per tile
+        std::vector<uint32_t> tile_slot;        //Expanded tiles: slot in sample_colors
+
+        //One color per pixel (uniform tiles)
+        std::vector<uint32_t> color;
+
+        //Expanded tiles, MSAA_TILE_SIZE^2 * samples colors per slot laid out [sample][row][column]. Slots are handed out in the order tiles
+        //expand and all released by msaa_clear.
+        std::vector<uint32_t> sample_colors;
+        uint32_t slots_used = 0;
+
+        //Depth of every sample, each pixel row holds samples planes of stride floats ([row][sample][column])
+        std::vector<float> depth;
+    };
+
+    //Storage of the last frame (msaa_memory)
+    struct msaa_stats
+    {
+        uint32_t tiles_clear = 0;
+        uint32_t tiles_uniform = 0;
+        uint32_t tiles_expanded = 0;
+
+        size_t color_bytes = 0;                 //Color storage in use, uniform plane + expanded slots + tile modes
+        size_t uncompressed_color_bytes = 0;    //A plain color per sample
+        size_t depth_bytes = 0;
+    };
+
+    //@param samples 1, 2, 4 or 8 (standard D3D / GL sample patterns)
+    //@return false if the sample count isn't supported
+    bool msaa_init(msaa_framebuffer& fb, uint32_t width, uint32_t height, uint32_t samples);
+
+    //Fast clear, only resets the tile modes. Color and depth are filled in when a tile is first drawn to.
+    void msaa_clear(msaa_framebuffer& fb, uint32_t color, float depth = 1.0f);
+
+    //Box filters every pixel's samples into out's color (out must have the same size, its depth is left alone)
+    //@param js optional, tile rows are resolved in parallel
+    void msaa_resolve(const msaa_framebuffer& fb, framebuffer& out, job_system* js = nullptr);
+
+    msaa_stats msaa_memory(const msaa_framebuffer& fb);
+
+    //Fills a cleared tile's colors and depths so it can be drawn to (the rasterizer calls this for each block it enters)
+    void msaa_begin_tile(msaa_framebuffer& fb, uint32_t tile);
+
+    //Moves a uniform tile's colors into a sample slot, replicated to every sample
+    void msaa_expand_tile(msaa_framebuffer& fb, uint32_t tile);
+
+    inline uint32_t msaa_tile_index(const msaa_framebuffer& fb, int x, int y)
+    {
+        return ((uint32_t)y / MSAA_TILE_SIZE) * fb.tiles_x + ((uint32_t)x / MSAA_TILE_SIZE);
+    }
+
+    inline float* msaa_depth(msaa_framebuffer& fb, int x, int y, uint32_t sample)
+    {
+        return &fb.depth[((((size_t)y * fb.samples) + sample) * fb.stride) + x];
+    }
+
+    inline uint32_t* msaa_sample_colors(msaa_framebuffer& fb, uint32_t tile, int x, int y, uint32_t sample)
+    {
+        size_t slot = (size_t)fb.tile_slot[tile] * MSAA_TILE_SIZE * MSAA_TILE_SIZE * fb.samples;
+        return &fb.sample_colors[slot + (((sample * MSAA_TILE_SIZE) + ((uint32_t)y % MSAA_TILE_SIZE)) * MSAA_TILE_SIZE) + ((uint32_t)x % MSAA_TILE_SIZE)];
+    }
+
+    //Writes a shaded 4 pixel group (x a multiple of 4) to the samples that passed. Groups that cover every sample of each pixel they touch stay
+    //in the uniform plane, anything else expands the tile first.
+    //@param pass per sample coverage & depth test result
+    //@param any_pass / all_pass the or / and of pass over the samples
+    inline void msaa_write4(msaa_framebuffer& fb, uint32_t tile, int x, int y, lnal::i32x4 color, const lnal::mask4* pass, lnal::mask4 any_pass, lnal::mask4 all_pass)
+    {
+        using namespace lnal;
+
+        if(fb.tile_mode[tile] == MSAA_TILE_UNIFORM)
+        {
+            if(mask_bits(any_pass) == mask_bits(all_pass))
+            {
+                int32_t* p = (int32_t*)&fb.color[((size_t)y * fb.stride) + x];
+                i32x4_store(p, select(any_pass, color, i32x4_load(p)));
+                return;
+            }
+
+            msaa_expand_tile(fb, tile);
+        }
+
+        for(uint32_t sample = 0; sample < fb.samples; sample++)
+        {
+            if(!any(pass[sample]))
+                continue;
+
+            int32_t* p = (int32_t*)msaa_sample_colors(fb, tile, x, y, sample);
+            i32x4_store(p, select(pass[sample], color, i32x4_load(p)));
+        }
+    }
+}
@@ -0,0 +1,197 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Occlusion culling buffer.
+
+
+    Idea -
+        Most of what a draw list submits in a dense scene ends up behind something else. Rasterizing a handful of low poly occluders (boxes
+        standing in for buildings, a coarse LOD of a large mesh) into a small depth buffer on the CPU and testing every object's bounds against it
+        before submission drops those objects for the price of a few thousand pixels, on the GL path as well as the software one.
+
+
+    Masked Tiles -
+        The buffer doesn't store a depth per pixel. It's split into OCCLUSION_TILE_WIDTH x OCCLUSION_TILE_HEIGHT tiles (32 pixels, one bit each)
+        and every tile keeps two conservative depths, the layout from Masked Software Occlusion Culling (Hasselgren et al.):
+
+            far_depth       no pixel of the tile is deeper
+            layer_depth     no pixel set in layer_mask is deeper
+
+        A triangle's coverage of a tile is a mask plus the deepest point of the triangle inside the tile. It is merged into the layer, or replaces
+        it (occlusion_merge), and once the layer's mask is full the layer becomes the new far_depth. A bound is never nearer than the occluder
+        pixels under it, so the buffer can only hide what the occluders really hide, up to coverage: a pixel counts as covered when the triangle
+        covers its center like in any rasterizer, so an object peeking out by less than a coarse pixel past an occluder's edge can be culled.
+
+
+    Occluders -
+        draw_occluder (raster.cpp) runs the occluder through the normal transform / clip stage, and the occlusion_buffer overload of
+        raster_triangle (triangle.h) computes the coverage masks: a whole row of 8 pixels is two 4 wide edge tests per edge, a tile entirely
+        inside the triangle skips them. Occluders should be closed or at least cover what they are meant to hide, and must not stick out of the
+        object they stand for.
+
+
+    Tests -
+        An object's box is projected, its screen rectangle taken at the depth of its nearest corner. The rectangle's tiles are compared 4 at a
+        time against far_depth, and only tiles that fail that go on to the layer check. A box that crosses the near plane is always visible.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "occlusion.h"
+#include <algorithm>
+#include <cmath>
+
+namespace br
+{
+    using namespace lnal;
+
+    void occlusion_init(occlusion_buffer& ob, uint32_t width, uint32_t height)
+    {
+        ob.tiles_x = (width + OCCLUSION_TILE_WIDTH - 1) / OCCLUSION_TILE_WIDTH;
+        ob.tiles_y = (height + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT;
+        ob.width = ob.tiles_x * OCCLUSION_TILE_WIDTH;
+        ob.height = ob.tiles_y * OCCLUSION_TILE_HEIGHT;
+
+        //far_depth has 3 tiles of padding so the tests can always load 4
+        size_t tiles = (size_t)ob.tiles_x * ob.tiles_y;
+        ob.far_depth.assign(tiles + 3, 1.0f);
+        ob.layer_depth.assign(tiles, 0.0f);
+        ob.layer_mask.assign(tiles, 0);
+    }
+
+    void occlusion_clear(occlusion_buffer& ob)
+    {
+        std::fill(ob.far_depth.begin(), ob.far_depth.end(), 1.0f);
+        std::fill(ob.layer_depth.begin(), ob.layer_depth.end(), 0.0f);
+        std::fill(ob.layer_mask.begin(), ob.layer_mask.end(), 0u);
+    }
+
+    bool occlusion_test_rect(const occlusion_buffer& ob, int x0, int y0, int x1, int y1, float depth)
+    {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, (int)ob.width);
+        y1 = std::min(y1, (int)ob.height);
+
+        if(x0 >= x1 || y0 >= y1)
+            return false;
+
+        const int tile_w = (int)OCCLUSION_TILE_WIDTH;
+        const int tile_h = (int)OCCLUSION_TILE_HEIGHT;
+        int tx0 = x0 / tile_w;
+        int tx1 = (x1 - 1) / tile_w;
+        int ty0 = y0 / tile_h;
+        int ty1 = (y1 - 1) / tile_h;
+
+        const f32x4 lane = f32x4_set(0.0f, 1.0f, 2.0f, 3.0f);
+        const f32x4 last_column = f32x4_splat((float)tx1);
+        const f32x4 z = f32x4_splat(depth);
+
+        for(int ty = ty0; ty <= ty1; ty++)
+        {
+            //Rows of this tile row inside the rectangle, as a mask of whole rows
+            int r0 = std::max(y0 - (ty * tile_h), 0);
+            int r1 = std::min(y1 - (ty * tile_h), tile_h);
+            uint32_t rows = 0;
+            for(int r = r0; r < r1; r++)
+            {
+                rows |= 0xFFu << (r * tile_w);
+            }
+
+            const float* far_row = &ob.far_depth[(size_t)ty * ob.tiles_x];
+
+            for(int tx = tx0; tx <= tx1; tx += 4)
+            {
+                mask4 in_rect = (lane + f32x4_splat((float)tx)) <= last_column;
+                int open = mask_bits(in_rect & (z < f32x4_load(&far_row[tx])));
+
+                //Tiles the object is nearer than the far depth of, the layer might still hide the part of the tile the rectangle touches
+                for(int k = 0; open; k++, open >>= 1)
+                {
+                    if(!(open & 1))
+                        continue;
+
+                    int x = (tx + k) * tile_w;
+                    int c0 = std::max(x0 - x, 0);
+                    int c1 = std::min(x1 - x, tile_w);
+                    uint32_t columns = ((1u << c1) - 1) & ~((1u << c0) - 1);
+                    uint32_t rect_mask = rows & (columns * 0x01010101u);
+
+                    size_t tile = ((size_t)ty * ob.tiles_x) + tx + k;
+                    if((rect_mask & ~ob.layer_mask[tile]) != 0 || depth < ob.layer_depth[tile])
+                        return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    bool occlusion_test_box(const occlusion_buffer& ob, const float* bounds_min, const float* bounds_max, const lnal::mat4& mvp)
+    {
+        const float* m = mvp.data();
+
+        //The 8 corners as two groups of 4, the low and the high z face
+        f32x4 x = f32x4_set(bounds_min[0], bounds_max[0], bounds_min[0], bounds_max[0]);
+        f32x4 y = f32x4_set(bounds_min[1], bounds_min[1], bounds_max[1], bounds_max[1]);
+        float faces[2] = { bounds_min[2], bounds_max[2] };
+
+        const f32x4 half = f32x4_splat(0.5f);
+        const f32x4 width = f32x4_splat((float)ob.width);
+        const f32x4 height = f32x4_splat((float)ob.height);
+
+        f32x4 min_x = f32x4_splat(1e30f), min_y = min_x, min_z = min_x;
+        f32x4 max_x = f32x4_splat(-1e30f), max_y = max_x;
+
+        for(float face : faces)
+        {
+            f32x4 z = f32x4_splat(face);
+            f32x4 cx = (x * f32x4_splat(m[0])) + (y * f32x4_splat(m[4])) + (z * f32x4_splat(m[8])) + f32x4_splat(m[12]);
+            f32x4 cy = (x * f32x4_splat(m[1])) + (y * f32x4_splat(m[5])) + (z * f32x4_splat(m[9])) + f32x4_splat(m[13]);
+            f32x4 cz = (x * f32x4_splat(m[2])) + (y * f32x4_splat(m[6])) + (z * f32x4_splat(m[10])) + f32x4_splat(m[14]);
+            f32x4 cw = (x * f32x4_splat(m[3])) + (y * f32x4_splat(m[7])) + (z * f32x4_splat(m[11])) + f32x4_splat(m[15]);
+
+            //A corner in front of the near plane has no useful screen position
+            if(any(cz < (f32x4_splat(0.0f) - cw)))
+                return true;
+
+            f32x4 inv_w = f32x4_splat(1.0f) / cw;
+            f32x4 sx = (((cx * inv_w) * half) + half) * width;
+            f32x4 sy = (half - ((cy * inv_w) * half)) * height;
+            f32x4 sz = ((cz * inv_w) * half) + half;
+
+            min_x = lnal::min(min_x, sx);
+            max_x = lnal::max(max_x, sx);
+            min_y = lnal::min(min_y, sy);
+            max_y = lnal::max(max_y, sy);
+            min_z = lnal::min(min_z, sz);
+        }
+
+        float lo_x[4], hi_x[4], lo_y[4], hi_y[4], lo_z[4];
+        f32x4_store(lo_x, min_x);
+        f32x4_store(hi_x, max_x);
+        f32x4_store(lo_y, min_y);
+        f32x4_store(hi_y, max_y);
+        f32x4_store(lo_z, min_z);
+
+        float x0 = std::min(std::min(lo_x[0], lo_x[1]), std::min(lo_x[2], lo_x[3]));
+        float x1 = std::max(std::max(hi_x[0], hi_x[1]), std::max(hi_x[2], hi_x[3]));
+        float y0 = std::min(std::min(lo_y[0], lo_y[1]), std::min(lo_y[2], lo_y[3]));
+        float y1 = std::max(std::max(hi_y[0], hi_y[1]), std::max(hi_y[2], hi_y[3]));
+        float depth = std::min(std::min(lo_z[0], lo_z[1]), std::min(lo_z[2], lo_z[3]));
+
+        //Every pixel the box touches, the rectangle is clamped to the buffer by the test
+        x0 = std::max(x0, -1.0f);
+        y0 = std::max(y0, -1.0f);
+        x1 = std::min(x1, (float)ob.width + 1.0f);
+        y1 = std::min(y1, (float)ob.height + 1.0f);
+
+        return occlusion_test_rect(ob, (int)floorf(x0), (int)floorf(y0), (int)ceilf(x1), (int)ceilf(y1), depth);
+    }
+
+    float occlusion_depth(const occlusion_buffer& ob, uint32_t x, uint32_t y)
+    {
+        size_t tile = ((size_t)(y / OCCLUSION_TILE_HEIGHT) * ob.tiles_x) + (x / OCCLUSION_TILE_WIDTH);
+        uint32_t bit = ((y % OCCLUSION_TILE_HEIGHT) * OCCLUSION_TILE_WIDTH) + (x % OCCLUSION_TILE_WIDTH);
+
+        return (ob.layer_mask[tile] >> bit) & 1 ? ob.layer_depth[tile] : ob.far_depth[tile];
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../math/lnal.h"
+#include "../math/simd.h"
+#include <cstdint>
+#include <vector>
+
+//Coarse conservative depth for occlusion culling, see occlusion.cpp. Occluder proxies are drawn with draw_occluder (raster.h), then objects
+//are tested with occlusion_test_box before they are submitted to either backend.
+
+namespace br
+{
+    //A tile's coverage mask is one bit per pixel, bit row * OCCLUSION_TILE_WIDTH + column
+    static const uint32_t OCCLUSION_TILE_WIDTH = 8;
+    static const uint32_t OCCLUSION_TILE_HEIGHT = 4;
+    static const uint32_t OCCLUSION_FULL_MASK = 0xFFFFFFFF;
+
+    struct occlusion_buffer
+    {
+        //Pixels, rounded up to whole tiles
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t tiles_x = 0;
+        uint32_t tiles_y = 0;
+
+        //Per tile, kept as separate arrays so a test can load 4 neighbouring tiles at once. Depth is [0, 1] with 1 = far like the framebuffer.
+        std::vector<float> far_depth;           //No pixel of the tile is deeper than this
+        std::vector<float> layer_depth;         //No pixel in layer_mask is deeper than this (always less than far_depth)
+        std::vector<uint32_t> layer_mask;
+    };
+
+    //@param width / height pixels, rounded up to whole tiles. A quarter of the screen resolution per axis or less is plenty.
+    void occlusion_init(occlusion_buffer& ob, uint32_t width, uint32_t height);
+
+    void occlusion_clear(occlusion_buffer& ob);
+
+    //@return true if any pixel of [x0, x1) x [y0, y1) might be further away than depth (so something at depth could be seen there), false if
+    //the rectangle is hidden or entirely off the buffer
+    bool occlusion_test_rect(const occlusion_buffer& ob, int x0, int y0, int x1, int y1, float depth);
+
+    //Projects the box's corners and tests their screen rectangle at the nearest corner's depth. Boxes crossing the near plane are visible.
+    //@param mvp object space to clip space (the same matrix the occluders were drawn with for world space boxes)
+    //@return false if the box is hidden behind the occluders
+    bool occlusion_test_box(const occlusion_buffer& ob, const float* bounds_min, const float* bounds_max, const lnal::mat4& mvp);
+
+    //Conservative depth of one pixel (for debug views)
+    float occlusion_depth(const occlusion_buffer& ob, uint32_t x, uint32_t y);
+
+    inline uint32_t occlusion_bit_count(uint32_t bits)
+    {
+        bits = bits - ((bits >> 1) & 0x55555555);
+        bits = (bits & 0x33333333) + ((bits >> 2) & 0x33333333);
+        return (((bits + (bits >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+    }
+
+    //Adds a triangle's coverage of a tile. A tile only has room for one layer besides far_depth, so the triangle is either merged into it
+    //(the layer takes the deeper of the two depths) or replaces it, whichever leaves more pixels with more depth range culled behind them.
+    //@param coverage pixels of the tile the triangle covers
+    //@param depth the triangle's deepest point inside the tile
+    inline void occlusion_merge(occlusion_buffer& ob, uint32_t tile, uint32_t coverage, float depth)
+    {
+        float far_depth = ob.far_depth[tile];
+        if(depth >= far_depth)
+            return;
+
+        float layer_depth = ob.layer_depth[tile];
+        uint32_t layer_mask = ob.layer_mask[tile];
+
+        float merged_depth = layer_depth > depth ? layer_depth : depth;
+        uint32_t merged_mask = layer_mask | coverage;
+
+        float merged_gain = (far_depth - merged_depth) * (float)occlusion_bit_count(merged_mask);
+        float replaced_gain = (far_depth - depth) * (float)occlusion_bit_count(coverage);
+
+        if(layer_mask == 0 || merged_gain >= replaced_gain)
+        {
+            layer_depth = merged_depth;
+            layer_mask = merged_mask;
+        }
+        else
+        {
+            layer_depth = depth;
+            layer_mask = coverage;
+        }
+
+        //A complete layer becomes the tile's new far depth and the layer starts over
+        if(layer_mask == OCCLUSION_FULL_MASK)
+        {
+            ob.far_depth[tile] = layer_depth;
+            layer_depth = 0.0f;
+            layer_mask = 0;
+        }
+
+        ob.layer_depth[tile] = layer_depth;
+        ob.layer_mask[tile] = layer_mask;
+    }
+}
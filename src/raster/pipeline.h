@@ -0,0 +1,77 @@
+#pragma once
+
+#include "framebuffer.h"
+#include "msaa.h"
+#include "raster.h"
+#include "clip.h"
+#include "triangle.h"
+#include "../mesh/mesh.h"
+#include <vector>
+
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Programmable CPU pipeline.
+
+
+    Shaders -
+        Shaders are plain structs with their uniforms as members and a call operator, passed to draw_shaded as template arguments. Every
+        vertex / fragment shader pair instantiates its own copy of the pipeline, so the shader calls inline into the vertex loop and the 4 pixel
+        group loop and the varying count is a compile time constant all the way through triangle setup.
+
+        Vertex shader
+            static const uint32_t VARYINGS;
+            void operator()(const mesh& m, uint32_t vertex, float* position, float* varyings) const;
+                position    clip space xyzw (gl_Position)
+                varyings    VARYINGS floats, null if VARYINGS is 0
+
+        Fragment shader
+            lnal::i32x4 operator()(const lnal::f32x4* varyings) const;
+                Shades 4 horizontally adjacent pixels at once. varyings[i] holds varying i for the 4 pixels, interpolated perspective correct.
+                Returns the 4 RGBA8 colors (pack_color4 in shaders.h).
+
+        See shaders.h for the catalog.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+namespace br
+{
+    template<uint32_t N>
+    inline float* vertex_varyings(raster_vertex<N>& v)
+    {
+        if constexpr(N > 0)
+            return v.varyings;
+        else
+            return nullptr;
+    }
+
+    //Runs the vertex shader over the mesh's vertices, then clips and rasterizes the triangle list with the fragment shader
+    //@param fb framebuffer or msaa_framebuffer (shaded once per pixel, covered per sample)
+    //@param indices triangle list (any range of mesh.indices, e.g. one LOD)
+    //@param stats optional counters
+    //@param scratch optional, reused between draws (see raster_scratch)
+    template<typename Target, typename VertexShader, typename FragmentShader>
+    void draw_shaded(Target& fb, const mesh& m, const uint32_t* indices, uint32_t index_count, const VertexShader& vs, const FragmentShader& fs,
+                     bool cull_backfaces = true, raster_stats* stats = nullptr, raster_scratch* scratch = nullptr)
+    {
+        constexpr uint32_t N = VertexShader::VARYINGS;
+
+        raster_scratch local;
+        raster_scratch& s = scratch ? *scratch : local;
+
+        uint32_t count = mesh_vertex_count(m);
+        raster_vertex<N>* vertices = raster_scratch_vertices<N>(s, count);
+
+        for(uint32_t v = 0; v < count; v++)
+        {
+            vs(m, v, vertices[v].position, vertex_varyings(vertices[v]));
+        }
+
+        clip_classify((const float*)vertices, count, s.outcodes.data(), sizeof(raster_vertex<N>) / sizeof(float));
+
+        auto same_shader = [&fs](const uint32_t*) -> const FragmentShader& { return fs; };
+        raster_triangle_list<N>(fb, vertices, s.outcodes.data(), indices, index_count / 3, cull_backfaces, same_shader, stats);
+
+        if(stats)
+            stats->triangles_submitted += index_count / 3;
+    }
+}
@@ -0,0 +1,210 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                CPU triangle rasterizer.
+
+
+    Pipeline -
+        1. Every vertex of the mesh is transformed to clip space and classified against the clip planes (clip.cpp) once per draw.
+        2. Triangles are tested 4 at a time: outside the frustum is dropped, crossing the near / far plane (or the guard band) is clipped into a
+           fan of smaller triangles, everything else goes straight on.
+        3. Each triangle is divided by w, mapped to pixels, back-face culled and set up as edge functions and plane equations (triangle.h).
+        4. The triangle's screen bounding box is walked in 8x8 blocks and each pixel center is tested against the three edge functions.
+        5. Depth (z / w, which is linear in screen space) is stepped along its plane equation, tested and written along with the color.
+
+
+    Edge Functions -
+        For an edge from a to b, E(p) = (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x) is twice the signed area of the triangle (a, b, p). A pixel is
+        inside when all three edge functions have the same sign as the triangle's area, and E / area is the barycentric weight of the opposite vertex.
+
+        Pixels exactly on an edge use the top-left rule (same as D3D / GL) so two triangles sharing an edge never both write the same pixel.
+
+
+    Coordinates -
+        Screen space has y pointing down (row 0 is the top of the image) to match how images are stored. That flips the winding, so counter clockwise
+        (front facing in GL) triangles have a negative area here.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "raster.h"
+#include "clip.h"
+#include "triangle.h"
+#include <cmath>
+
+namespace br
+{
+    static void transform_vertices(const mesh& m, const lnal::mat4& mvp, raster_vertex<0>* clip)
+    {
+        uint32_t count = mesh_vertex_count(m);
+        const float* t = mvp.data();
+
+        for(uint32_t v = 0; v < count; v++)
+        {
+            const float* p = &m.positions[v * 3];
+            float* out = clip[v].position;
+
+            for(int r = 0; r < 4; r++)
+            {
+                out[r] = (t[r] * p[0]) + (t[4 + r] * p[1]) + (t[8 + r] * p[2]) + t[12 + r];
+            }
+        }
+    }
+
+    //Facet shades the triangle with the draw's light
+    static uint32_t shade_triangle(const mesh& m, const uint32_t* tri, const draw_state& state)
+    {
+        const float* p0 = &m.positions[tri[0] * 3];
+        const float* p1 = &m.positions[tri[1] * 3];
+        const float* p2 = &m.positions[tri[2] * 3];
+
+        lnal::vec3 n = lnal::cross(lnal::vec3(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]), lnal::vec3(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]));
+
+        //Rotate into world space (model is assumed to have uniform scale)
+        const float* mm = state.model.data();
+        lnal::vec3 world_n(mm[0] * n[0] + mm[4] * n[1] + mm[8] * n[2],
+                           mm[1] * n[0] + mm[5] * n[1] + mm[9] * n[2],
+                           mm[2] * n[0] + mm[6] * n[1] + mm[10] * n[2]);
+
+        float len = world_n.len();
+        float diffuse = 0.0f;
+
+        if(len > 0.0f)
+        {
+            diffuse = lnal::dot(world_n, lnal::vec3(state.light_dir[0], state.light_dir[1], state.light_dir[2])) / len;
+            diffuse = diffuse > 0.0f ? diffuse : 0.0f;
+        }
+
+        float light = 0.2f + (0.8f * diffuse);
+
+        return pack_color(state.color[0] * light, state.color[1] * light, state.color[2] * light);
+    }
+
+    //Runs a triangle list through the clip stage and the rasterizer. The scratch has to hold the draw's vertices (prepare_vertices).
+    template<typename Target>
+    static void draw_triangles(Target& fb, const mesh& m, const uint32_t* indices, uint32_t triangle_count, const draw_state& state, raster_scratch& s,
+                               raster_stats* stats)
+    {
+        auto facet_color = [&m, &state](const uint32_t* tri)
+        {
+            lnal::i32x4 color = lnal::i32x4_splat((int32_t)shade_triangle(m, tri, state));
+            return [color](const lnal::f32x4*) { return color; };
+        };
+
+        raster_triangle_list<0>(fb, (const raster_vertex<0>*)s.vertices.data(), s.outcodes.data(), indices, triangle_count, state.cull_backfaces,
+                                facet_color, stats);
+    }
+
+    //Fills the scratch with the mesh's clip space vertices and their outcodes
+    static const raster_vertex<0>* prepare_vertices(const mesh& m, const lnal::mat4& mvp, raster_scratch& s)
+    {
+        uint32_t count = mesh_vertex_count(m);
+        raster_vertex<0>* clip = raster_scratch_vertices<0>(s, count);
+
+        transform_vertices(m, mvp, clip);
+        clip_classify((const float*)clip, count, s.outcodes.data());
+        return clip;
+    }
+
+    static void prepare_vertices(const mesh& m, const draw_state& state, raster_scratch& s)
+    {
+        lnal::mat4 view_proj = state.view_proj;
+        prepare_vertices(m, view_proj * state.model, s);
+    }
+
+    //Rasterizes an indexed triangle list into the framebuffer with depth testing
+    //@param fb target framebuffer
+    //@param m mesh that owns the vertex data
+    //@param indices triangle list (any range of mesh.indices, e.g. one LOD)
+    //@param index_count number of indices
+    //@param state transforms and shading
+    //@param stats optional counters
+    //@param scratch optional, reused between draws
+    void draw_mesh(framebuffer& fb, const mesh& m, const uint32_t* indices, uint32_t index_count, const draw_state& state, raster_stats* stats,
+                   raster_scratch* scratch)
+    {
+        raster_scratch local;
+        raster_scratch& s = scratch ? *scratch : local;
+
+        prepare_vertices(m, state, s);
+        draw_triangles(fb, m, indices, index_count / 3, state, s, stats);
+
+        if(stats)
+            stats->triangles_submitted += index_count / 3;
+    }
+
+    //Multisampled draw_mesh, facets are shaded once per triangle as always and covered per sample
+    void draw_mesh(msaa_framebuffer& fb, const mesh& m, const uint32_t* indices, uint32_t index_count, const draw_state& state, raster_stats* stats,
+                   raster_scratch* scratch)
+    {
+        raster_scratch local;
+        raster_scratch& s = scratch ? *scratch : local;
+
+        prepare_vertices(m, state, s);
+        draw_triangles(fb, m, indices, index_count / 3, state, s, stats);
+
+        if(stats)
+            stats->triangles_submitted += index_count / 3;
+    }
+
+    //Depth only draw (shadow maps, depth pre passes). Vertices are transformed and clipped as usual, nothing is shaded.
+    void draw_depth(depth_buffer& db, const mesh& m, const uint32_t* indices, uint32_t index_count, const lnal::mat4& mvp, bool cull_backfaces, raster_stats* stats,
+                    raster_scratch* scratch)
+    {
+        raster_scratch local;
+        raster_scratch& s = scratch ? *scratch : local;
+        const raster_vertex<0>* clip = prepare_vertices(m, mvp, s);
+
+        auto no_fragment = [](const uint32_t*) { return [](const lnal::f32x4*) { return lnal::i32x4_splat(0); }; };
+        raster_triangle_list<0>(db, clip, s.outcodes.data(), indices, index_count / 3, cull_backfaces, no_fragment, stats);
+
+        if(stats)
+            stats->triangles_submitted += index_count / 3;
+    }
+
+    //Draws an occluder proxy (a box, a coarse LOD) into an occlusion buffer, see occlusion.cpp
+    void draw_occluder(occlusion_buffer& ob, const mesh& m, const uint32_t* indices, uint32_t index_count, const lnal::mat4& mvp, bool cull_backfaces, raster_stats* stats,
+                       raster_scratch* scratch)
+    {
+        raster_scratch local;
+        raster_scratch& s = scratch ? *scratch : local;
+        const raster_vertex<0>* clip = prepare_vertices(m, mvp, s);
+
+        auto no_fragment = [](const uint32_t*) { return [](const lnal::f32x4*) { return lnal::i32x4_splat(0); }; };
+        raster_triangle_list<0>(ob, clip, s.outcodes.data(), indices, index_count / 3, cull_backfaces, no_fragment, stats);
+
+        if(stats)
+            stats->triangles_submitted += index_count / 3;
+    }
+
+    template<typename Target>
+    static void draw_meshlet_list(Target& fb, const mesh& m, const meshlet_set& set, const std::vector<uint32_t>& visible, const draw_state& state,
+                                  raster_stats* stats, raster_scratch* scratch)
+    {
+        raster_scratch local;
+        raster_scratch& s = scratch ? *scratch : local;
+
+        prepare_vertices(m, state, s);
+
+        for(uint32_t index : visible)
+        {
+            const meshlet& ml = set.meshlets[index];
+            draw_triangles(fb, m, &set.indices[ml.index_offset], ml.triangle_count, state, s, stats);
+
+            if(stats)
+                stats->triangles_submitted += ml.triangle_count;
+        }
+    }
+
+    //Rasterizes only the listed meshlets (usually the output of cull_meshlets)
+    void draw_meshlets(framebuffer& fb, const mesh& m, const meshlet_set& set, const std::vector<uint32_t>& visible, const draw_state& state, raster_stats* stats,
+                       raster_scratch* scratch)
+    {
+        draw_meshlet_list(fb, m, set, visible, state, stats, scratch);
+    }
+
+    //Multisampled draw_meshlets
+    void draw_meshlets(msaa_framebuffer& fb, const mesh& m, const meshlet_set& set, const std::vector<uint32_t>& visible, const draw_state& state,
+                       raster_stats* stats, raster_scratch* scratch)
+    {
+        draw_meshlet_list(fb, m, set, visible, state, stats, scratch);
+    }
+}
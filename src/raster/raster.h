@@ -0,0 +1,79 @@
+#pragma once
+
+#include "framebuffer.h"
+#include "msaa.h"
+#include "occlusion.h"
+#include "../math/lnal.h"
+#include "../mesh/mesh.h"
+#include "../mesh/meshlet.h"
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    //Everything a draw needs besides the geometry
+    struct draw_state
+    {
+        lnal::mat4 model;
+        lnal::mat4 view_proj;
+
+        float color[3];
+
+        //World space direction towards the light (unit length). Triangles are facet shaded with it.
+        float light_dir[3];
+
+        bool cull_backfaces = true;
+    };
+
+    //Counters filled in by the draw calls (add up over a frame)
+    struct raster_stats
+    {
+        uint64_t triangles_submitted = 0;
+        uint64_t triangles_rejected = 0;      //Outside the frustum by outcode
+        uint64_t triangles_clipped = 0;       //Crossed the near / far plane or the guard band
+        uint64_t triangles_rasterized = 0;
+        uint64_t pixels_written = 0;
+    };
+
+    //Vertex stage output of a draw: clip space positions (and varyings for draw_shaded) and their clip outcodes. Keep one per drawing thread
+    //and pass it to every draw so steady state frames don't allocate, a draw without one allocates its own.
+    struct raster_scratch
+    {
+        std::vector<float> vertices;        //raster_vertex<N> back to back
+        std::vector<uint32_t> outcodes;
+    };
+
+    //Rasterizes an indexed triangle list into the framebuffer with depth testing
+    //@param fb target framebuffer
+    //@param m mesh that owns the vertex data
+    //@param indices triangle list (any range of mesh.indices, e.g. one LOD)
+    //@param index_count number of indices
+    //@param state transforms and shading
+    //@param stats optional counters
+    //@param scratch optional, reused between draws
+    void draw_mesh(framebuffer& fb, const mesh& m, const uint32_t* indices, uint32_t index_count, const draw_state& state, raster_stats* stats = nullptr,
+                   raster_scratch* scratch = nullptr);
+
+    //Multisampled draw_mesh, facets are shaded once per triangle as always and covered per sample
+    void draw_mesh(msaa_framebuffer& fb, const mesh& m, const uint32_t* indices, uint32_t index_count, const draw_state& state, raster_stats* stats = nullptr,
+                   raster_scratch* scratch = nullptr);
+
+    //Depth only draw (shadow maps, depth pre passes). Vertices are transformed and clipped as usual, nothing is shaded.
+    //@param mvp object space to the depth buffer's clip space
+    //@param cull_backfaces shadow passes usually draw both sides so open meshes still cast
+    void draw_depth(depth_buffer& db, const mesh& m, const uint32_t* indices, uint32_t index_count, const lnal::mat4& mvp, bool cull_backfaces = false,
+                    raster_stats* stats = nullptr, raster_scratch* scratch = nullptr);
+
+    //Draws an occluder proxy (a box, a coarse LOD) into an occlusion buffer, see occlusion.cpp
+    //@param mvp object space to the buffer's clip space, the view projection the objects are tested with times the occluder's model
+    void draw_occluder(occlusion_buffer& ob, const mesh& m, const uint32_t* indices, uint32_t index_count, const lnal::mat4& mvp, bool cull_backfaces = true,
+                       raster_stats* stats = nullptr, raster_scratch* scratch = nullptr);
+
+    //Rasterizes only the listed meshlets (usually the output of cull_meshlets)
+    void draw_meshlets(framebuffer& fb, const mesh& m, const meshlet_set& set, const std::vector<uint32_t>& visible, const draw_state& state, raster_stats* stats = nullptr,
+                       raster_scratch* scratch = nullptr);
+
+    //Multisampled draw_meshlets
+    void draw_meshlets(msaa_framebuffer& fb, const mesh& m, const meshlet_set& set, const std::vector<uint32_t>& visible, const draw_state& state,
+                       raster_stats* stats = nullptr, raster_scratch* scratch = nullptr);
+}
@@ -0,0 +1,379 @@
+#pragma once
+
+#include "../math/lnal.h"
+#include "../math/simd.h"
+#include "../mesh/mesh.h"
+#include "../scene/light.h"
+#include "../scene/cluster.h"
+#include "shadow.h"
+#include <cstdint>
+
+//Shader catalog for draw_shaded (pipeline.h). Lighting is done in world space with one directional light, light_dir points towards the light,
+//except for the clustered point light shader which works in view space and the spot light shader.
+
+namespace br
+{
+    //4 colors with components in [0, 1] to RGBA8 with alpha 1, rounded the same way as pack_color
+    inline lnal::i32x4 pack_color4(lnal::f32x4 r, lnal::f32x4 g, lnal::f32x4 b)
+    {
+        using namespace lnal;
+
+        f32x4 zero = f32x4_splat(0.0f);
+        f32x4 one = f32x4_splat(1.0f);
+        f32x4 scale = f32x4_splat(255.0f);
+        f32x4 half = f32x4_splat(0.5f);
+
+        i32x4 ri = to_int((clamp(r, zero, one) * scale) + half);
+        i32x4 gi = to_int((clamp(g, zero, one) * scale) + half);
+        i32x4 bi = to_int((clamp(b, zero, one) * scale) + half);
+
+        return ri | (gi << 8) | (bi << 16) | i32x4_splat((int32_t)0xFF000000u);
+    }
+
+    //Column major matrix times (x, y, z, 1)
+    inline void transform_point(const lnal::mat4& m, const float* p, float* out)
+    {
+        const float* t = m.data();
+        for(int r = 0; r < 4; r++)
+        {
+            out[r] = (t[r] * p[0]) + (t[4 + r] * p[1]) + (t[8 + r] * p[2]) + t[12 + r];
+        }
+    }
+
+    //Column major matrix times (x, y, z, 0), rows 0 - 2. Fine for normals as long as the matrix has uniform scale.
+    inline void transform_direction(const lnal::mat4& m, const float* d, float* out)
+    {
+        const float* t = m.data();
+        for(int r = 0; r < 3; r++)
+        {
+            out[r] = (t[r] * d[0]) + (t[4 + r] * d[1]) + (t[8 + r] * d[2]);
+        }
+    }
+
+    //Normalizes 4 vectors at once. Zero length vectors stay zero instead of turning into NaNs.
+    inline void normalize4(lnal::f32x4& x, lnal::f32x4& y, lnal::f32x4& z)
+    {
+        using namespace lnal;
+
+        f32x4 len2 = (x * x) + (y * y) + (z * z);
+        f32x4 inv_len = f32x4_splat(1.0f) / sqrt(max(len2, f32x4_splat(1e-20f)));
+        x = x * inv_len;
+        y = y * inv_len;
+        z = z * inv_len;
+    }
+
+    //x^E as a chain of multiplies
+    template<uint32_t E>
+    inline lnal::f32x4 pow_uint(lnal::f32x4 x)
+    {
+        if constexpr(E == 0)
+            return lnal::f32x4_splat(1.0f);
+        else if constexpr(E == 1)
+            return x;
+        else
+        {
+            lnal::f32x4 half = pow_uint<E / 2>(x);
+            half = half * half;
+
+            if constexpr(E % 2 == 1)
+                half = half * x;
+
+            return half;
+        }
+    }
+
+    //Adds one point light's diffuse to 4 surface points: Lambert times a (1 - d^2 / r^2)^2 window that reaches zero at the light's radius.
+    //Positions, normals (unit length) and the light have to be in the same space.
+    //@param mask lanes to light
+    //@return false if the light doesn't reach any of the masked lanes (nothing was added)
+    inline bool add_point_light4(const point_light& light, lnal::mask4 mask, lnal::f32x4 px, lnal::f32x4 py, lnal::f32x4 pz,
+                                 lnal::f32x4 nx, lnal::f32x4 ny, lnal::f32x4 nz, lnal::f32x4& r, lnal::f32x4& g, lnal::f32x4& b)
+    {
+        using namespace lnal;
+
+        f32x4 zero = f32x4_splat(0.0f);
+        f32x4 one = f32x4_splat(1.0f);
+
+        f32x4 lx = f32x4_splat(light.position[0]) - px;
+        f32x4 ly = f32x4_splat(light.position[1]) - py;
+        f32x4 lz = f32x4_splat(light.position[2]) - pz;
+        f32x4 d2 = (lx * lx) + (ly * ly) + (lz * lz);
+
+        f32x4 radius2 = f32x4_splat(light.radius * light.radius);
+        mask4 inside = (d2 < radius2) & mask;
+        if(!any(inside))
+            return false;
+
+        f32x4 n_dot_l = ((nx * lx) + (ny * ly) + (nz * lz)) / sqrt(max(d2, f32x4_splat(1e-12f)));
+        f32x4 falloff = max(one - (d2 / radius2), zero);
+        f32x4 intensity = select(inside, max(n_dot_l, zero) * falloff * falloff, zero);
+
+        r = r + (intensity * f32x4_splat(light.color[0]));
+        g = g + (intensity * f32x4_splat(light.color[1]));
+        b = b + (intensity * f32x4_splat(light.color[2]));
+
+        return true;
+    }
+
+    //Same as vertex_shader_source in graphic_test.cpp: gl_Position = projection * view * model * position
+    struct flat_vertex_shader
+    {
+        static const uint32_t VARYINGS = 0;
+
+        lnal::mat4 mvp;
+
+        void operator()(const mesh& m, uint32_t vertex, float* position, float*) const
+        {
+            transform_point(mvp, &m.positions[vertex * 3], position);
+        }
+    };
+
+    //Same as fragment_shader_source in graphic_test.cpp: one color everywhere
+    struct flat_fragment_shader
+    {
+        uint32_t color;     //pack_color
+
+        lnal::i32x4 operator()(const lnal::f32x4*) const
+        {
+            return lnal::i32x4_splat((int32_t)color);
+        }
+    };
+
+    //Passes the world space normal on (3 varyings). Meshes without normals get a zero normal and end up with only the ambient term.
+    struct lambert_vertex_shader
+    {
+        static const uint32_t VARYINGS = 3;
+
+        lnal::mat4 model;
+        lnal::mat4 mvp;
+
+        void operator()(const mesh& m, uint32_t vertex, float* position, float* varyings) const
+        {
+            transform_point(mvp, &m.positions[vertex * 3], position);
+
+            if(m.normals.empty())
+            {
+                varyings[0] = varyings[1] = varyings[2] = 0.0f;
+                return;
+            }
+
+            transform_direction(model, &m.normals[vertex * 3], varyings);
+        }
+    };
+
+    //Ambient plus diffuse N.L, per pixel
+    struct lambert_fragment_shader
+    {
+        float color[3];
+        float light_dir[3];
+        float ambient = 0.2f;
+
+        lnal::i32x4 operator()(const lnal::f32x4* varyings) const
+        {
+            using namespace lnal;
+
+            f32x4 nx = varyings[0], ny = varyings[1], nz = varyings[2];
+            normalize4(nx, ny, nz);
+
+            f32x4 n_dot_l = (nx * f32x4_splat(light_dir[0])) + (ny * f32x4_splat(light_dir[1])) + (nz * f32x4_splat(light_dir[2]));
+            f32x4 light = f32x4_splat(ambient) + (f32x4_splat(1.0f - ambient) * max(n_dot_l, f32x4_splat(0.0f)));
+
+            return pack_color4(f32x4_splat(color[0]) * light, f32x4_splat(color[1]) * light, f32x4_splat(color[2]) * light);
+        }
+    };
+
+    //Passes the world space normal and position on (6 varyings)
+    struct phong_vertex_shader
+    {
+        static const uint32_t VARYINGS = 6;
+
+        lnal::mat4 model;
+        lnal::mat4 mvp;
+
+        void operator()(const mesh& m, uint32_t vertex, float* position, float* varyings) const
+        {
+            const float* p = &m.positions[vertex * 3];
+            transform_point(mvp, p, position);
+
+            float world[4];
+            transform_point(model, p, world);
+            varyings[3] = world[0];
+            varyings[4] = world[1];
+            varyings[5] = world[2];
+
+            if(m.normals.empty())
+            {
+                varyings[0] = varyings[1] = varyings[2] = 0.0f;
+                return;
+            }
+
+            transform_direction(model, &m.normals[vertex * 3], varyings);
+        }
+    };
+
+    //Lambert plus a white Phong highlight (R.V)^SHININESS. The exponent is a template parameter so the power unrolls into multiplies.
+    template<uint32_t SHININESS>
+    struct phong_fragment_shader
+    {
+        float color[3];
+        float light_dir[3];
+        float eye[3];       //World space camera position
+        float ambient = 0.2f;
+        float specular = 0.4f;
+
+        lnal::i32x4 operator()(const lnal::f32x4* varyings) const
+        {
+            using namespace lnal;
+
+            f32x4 zero = f32x4_splat(0.0f);
+            f32x4 lx = f32x4_splat(light_dir[0]), ly = f32x4_splat(light_dir[1]), lz = f32x4_splat(light_dir[2]);
+
+            f32x4 nx = varyings[0], ny = varyings[1], nz = varyings[2];
+            normalize4(nx, ny, nz);
+
+            f32x4 vx = f32x4_splat(eye[0]) - varyings[3];
+            f32x4 vy = f32x4_splat(eye[1]) - varyings[4];
+            f32x4 vz = f32x4_splat(eye[2]) - varyings[5];
+            normalize4(vx, vy, vz);
+
+            f32x4 n_dot_l = (nx * lx) + (ny * ly) + (nz * lz);
+
+            //Reflection of the light direction around the normal, R = 2 (N.L) N - L
+            f32x4 twice = n_dot_l + n_dot_l;
+            f32x4 r_dot_v = (((twice * nx) - lx) * vx) + (((twice * ny) - ly) * vy) + (((twice * nz) - lz) * vz);
+
+            f32x4 highlight = select(n_dot_l > zero, pow_uint<SHININESS>(max(r_dot_v, zero)) * f32x4_splat(specular), zero);
+            f32x4 light = f32x4_splat(ambient) + (f32x4_splat(1.0f - ambient) * max(n_dot_l, zero));
+
+            return pack_color4((f32x4_splat(color[0]) * light) + highlight, (f32x4_splat(color[1]) * light) + highlight, (f32x4_splat(color[2]) * light) + highlight);
+        }
+    };
+
+    //Forward+ point lights: every fragment walks only the light list of the cluster its view space position falls in. Pair it with
+    //phong_vertex_shader with model = view * model (normal and position varyings in view space) and the clusters assign_lights built for the
+    //same lights and projection.
+    struct clustered_fragment_shader
+    {
+        const light_clusters* clusters;
+        const point_light* lights;      //View space, as passed to assign_lights
+        float color[3];
+        float ambient = 0.05f;
+
+        lnal::i32x4 operator()(const lnal::f32x4* varyings) const
+        {
+            using namespace lnal;
+
+            f32x4 nx = varyings[0], ny = varyings[1], nz = varyings[2];
+            normalize4(nx, ny, nz);
+            f32x4 px = varyings[3], py = varyings[4], pz = varyings[5];
+
+            float position[3][4];
+            f32x4_store(position[0], px);
+            f32x4_store(position[1], py);
+            f32x4_store(position[2], pz);
+
+            int32_t cluster[4];
+            for(uint32_t k = 0; k < 4; k++)
+            {
+                float p[3] = { position[0][k], position[1][k], position[2][k] };
+                cluster[k] = (int32_t)cluster_of(*clusters, p);
+            }
+
+            //Usually all 4 pixels share a cluster. Otherwise each distinct cluster's list runs once, masked to its lanes.
+            i32x4 ids = i32x4_load(cluster);
+            f32x4 r = f32x4_splat(0.0f), g = r, b = r;
+            int done = 0;
+
+            for(uint32_t k = 0; k < 4; k++)
+            {
+                if(done & (1 << k))
+                    continue;
+
+                mask4 lanes = ids == i32x4_splat(cluster[k]);
+                done |= mask_bits(lanes);
+
+                uint32_t end = clusters->offsets[cluster[k] + 1];
+                for(uint32_t i = clusters->offsets[cluster[k]]; i < end; i++)
+                {
+                    add_point_light4(lights[clusters->indices[i]], lanes, px, py, pz, nx, ny, nz, r, g, b);
+                }
+            }
+
+            f32x4 ambient4 = f32x4_splat(ambient);
+            return pack_color4(f32x4_splat(color[0]) * (ambient4 + r), f32x4_splat(color[1]) * (ambient4 + g), f32x4_splat(color[2]) * (ambient4 + b));
+        }
+    };
+
+    //Directional Lambert with cascaded shadows. Pair it with phong_vertex_shader (world space normal and position) and cascades fit to the
+    //camera with fit_cascades and filled with draw_depth.
+    struct shadowed_fragment_shader
+    {
+        const shadow_cascades* cascades;
+        float color[3];
+        float light_dir[3];
+        float ambient = 0.2f;
+
+        lnal::i32x4 operator()(const lnal::f32x4* varyings) const
+        {
+            using namespace lnal;
+
+            f32x4 zero = f32x4_splat(0.0f);
+            f32x4 nx = varyings[0], ny = varyings[1], nz = varyings[2];
+            normalize4(nx, ny, nz);
+
+            f32x4 n_dot_l = (nx * f32x4_splat(light_dir[0])) + (ny * f32x4_splat(light_dir[1])) + (nz * f32x4_splat(light_dir[2]));
+
+            //Surfaces facing away are unlit either way, so only the lit ones look up the shadow
+            f32x4 visibility = cascade_visibility4(*cascades, n_dot_l > zero, varyings[3], varyings[4], varyings[5], nx, ny, nz);
+            f32x4 light = f32x4_splat(ambient) + (f32x4_splat(1.0f - ambient) * max(n_dot_l, zero) * visibility);
+
+            return pack_color4(f32x4_splat(color[0]) * light, f32x4_splat(color[1]) * light, f32x4_splat(color[2]) * light);
+        }
+    };
+
+    //Spot light: Lambert times the range window of add_point_light4 times a smooth cone edge, optionally shadowed by a map from
+    //fit_spot_shadow. Pair it with phong_vertex_shader.
+    struct spot_fragment_shader
+    {
+        const spot_light* light;
+        const shadow_map* shadow;       //null for no shadows
+        float color[3];
+        float ambient = 0.05f;
+
+        lnal::i32x4 operator()(const lnal::f32x4* varyings) const
+        {
+            using namespace lnal;
+
+            f32x4 zero = f32x4_splat(0.0f);
+            f32x4 one = f32x4_splat(1.0f);
+
+            f32x4 nx = varyings[0], ny = varyings[1], nz = varyings[2];
+            normalize4(nx, ny, nz);
+            f32x4 px = varyings[3], py = varyings[4], pz = varyings[5];
+
+            f32x4 lx = f32x4_splat(light->position[0]) - px;
+            f32x4 ly = f32x4_splat(light->position[1]) - py;
+            f32x4 lz = f32x4_splat(light->position[2]) - pz;
+            f32x4 d2 = (lx * lx) + (ly * ly) + (lz * lz);
+            f32x4 inv_d = one / sqrt(max(d2, f32x4_splat(1e-12f)));
+
+            //Cone: cosine between the light's direction and the direction from the light to the point, smoothstepped between the two angles
+            f32x4 cos_angle = zero - (((lx * f32x4_splat(light->direction[0])) + (ly * f32x4_splat(light->direction[1])) + (lz * f32x4_splat(light->direction[2]))) * inv_d);
+            f32x4 t = clamp((cos_angle - f32x4_splat(light->cos_outer)) / f32x4_splat(light->cos_inner - light->cos_outer), zero, one);
+            f32x4 cone = t * t * (f32x4_splat(3.0f) - (t + t));
+
+            f32x4 radius2 = f32x4_splat(light->range * light->range);
+            f32x4 falloff = max(one - (d2 / radius2), zero);
+            f32x4 n_dot_l = ((nx * lx) + (ny * ly) + (nz * lz)) * inv_d;
+            f32x4 intensity = max(n_dot_l, zero) * falloff * falloff * cone;
+
+            if(shadow)
+                intensity = intensity * shadow_visibility4(*shadow, intensity > zero, px, py, pz, nx, ny, nz);
+
+            f32x4 ambient4 = f32x4_splat(ambient);
+            return pack_color4(f32x4_splat(color[0]) * (ambient4 + (intensity * f32x4_splat(light->color[0]))),
+                               f32x4_splat(color[1]) * (ambient4 + (intensity * f32x4_splat(light->color[1]))),
+                               f32x4_splat(color[2]) * (ambient4 + (intensity * f32x4_splat(light->color[2]))));
+        }
+    };
+}
@@ -0,0 +1,147 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Shadow maps.
+
+
+    Cascades -
+        One map over the whole view would spend as many texels on the far distance as right in front of the camera. The view distance is split
+        into up to SHADOW_MAX_CASCADES slices instead, placed by the usual blend of logarithmic and uniform splits (lambda), and every slice gets
+        its own orthographic map. Near slices are short, so their maps are dense where the screen needs it.
+
+
+    Stability -
+        Each cascade covers the bounding sphere of its frustum slice rather than a tight box, so its size doesn't change as the camera turns, and
+        the sphere's center is snapped to whole texels in light space, so moving the camera slides the map by whole texels. Either change alone
+        makes shadow edges crawl from frame to frame.
+
+
+    Bias -
+        A surface compared against its own depth shadows itself wherever the map's texels are coarser than the surface's slope. Receivers are
+        pushed along their normal by about a texel (normal_offset) plus a small constant depth bias, which removes the acne without the
+        detached shadows a large depth bias gives.
+
+
+    Filtering -
+        shadow_pcf (shadow.h) is the 3x3 bilinear PCF tent: 16 texels around the lookup with weights (1 - f, 1, 1, f) per axis. One row of the
+        footprint is one 4 wide load and compare, so a lookup is 4 compares. Maps keep a SHADOW_BORDER ring of far depth around them so the
+        footprint never needs clamping.
+
+
+    Rendering -
+        Casters go through draw_depth, the rasterizer's depth only path (see triangle.h). Both sides are drawn by default so open meshes cast too.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "shadow.h"
+#include "../scene/cluster.h"
+#include <algorithm>
+
+namespace br
+{
+    void shadow_map_init(shadow_map& map, uint32_t size)
+    {
+        depth_buffer_init(map.depth, size, size, SHADOW_BORDER);
+    }
+
+    //Any direction that isn't parallel to d
+    static lnal::vec3 pick_up(const lnal::vec3& d)
+    {
+        return fabsf(d[1]) < 0.99f ? lnal::vec3(0.0f, 1.0f, 0.0f) : lnal::vec3(1.0f, 0.0f, 0.0f);
+    }
+
+    void fit_cascades(shadow_cascades& cascades, const lnal::mat4& view, const lnal::mat4& projection, const float* light_dir)
+    {
+        shadow_cascades& c = cascades;
+        c.count = std::min(std::max(c.count, 1u), SHADOW_MAX_CASCADES);
+        c.view = view;
+
+        float near_plane, far_plane;
+        perspective_depth_range(projection, near_plane, far_plane);
+        float end = c.max_distance > 0.0f ? std::min(c.max_distance, far_plane) : far_plane;
+
+        c.splits[0] = near_plane;
+        for(uint32_t i = 1; i <= c.count; i++)
+        {
+            float t = (float)i / (float)c.count;
+            float logarithmic = near_plane * powf(end / near_plane, t);
+            float uniform = near_plane + ((end - near_plane) * t);
+            c.splits[i] = (c.lambda * logarithmic) + ((1.0f - c.lambda) * uniform);
+        }
+
+        //Half extents of the view at distance 1 (symmetric projection)
+        const float* p = projection.data();
+        float tan_x = 1.0f / p[0];
+        float tan_y = 1.0f / p[5];
+        float k2 = (tan_x * tan_x) + (tan_y * tan_y);
+
+        lnal::mat4 inv_view = view;
+        inv_view = inv_view.inverse();
+
+        //Light space rotation, looking the way the light travels
+        lnal::vec3 towards_light(light_dir[0], light_dir[1], light_dir[2]);
+        lnal::mat4 light_view;
+        lnal::lookat(light_view, lnal::vec3(0.0f, 0.0f, 0.0f), lnal::vec3(0.0f, 0.0f, 0.0f) - towards_light, pick_up(towards_light));
+
+        for(uint32_t i = 0; i < c.count; i++)
+        {
+            shadow_map& map = c.maps[i];
+            if(map.depth.width != c.size)
+                shadow_map_init(map, c.size);
+
+            depth_buffer_clear(map.depth);
+
+            //Smallest sphere around the slice's 8 corners. It's centered on the view axis, at the distance that's equally far from the near
+            //and far corners (or at the far plane when the far corners alone decide).
+            float d0 = c.splits[i];
+            float d1 = c.splits[i + 1];
+            float center_distance = std::min(((d0 + d1) * 0.5f) * (1.0f + k2), d1);
+            float far_offset = d1 - center_distance;
+            float near_offset = center_distance - d0;
+            float radius = sqrtf(std::max((far_offset * far_offset) + (d1 * d1 * k2), (near_offset * near_offset) + (d0 * d0 * k2)));
+
+            //Rounded up so the size doesn't flicker with float noise
+            radius = ceilf(radius * 16.0f) / 16.0f;
+
+            lnal::vec3 center = lnal::transform_point(inv_view, lnal::vec3(0.0f, 0.0f, -center_distance));
+            lnal::vec3 light_center = lnal::transform_point(light_view, center);
+
+            float texel = (2.0f * radius) / (float)c.size;
+            float cx = floorf(light_center[0] / texel) * texel;
+            float cy = floorf(light_center[1] / texel) * texel;
+
+            //The light looks down -z, so distances along the light are -z
+            float near_distance = -light_center[2] - radius - c.caster_distance;
+            float far_distance = -light_center[2] + radius;
+
+            lnal::mat4 ortho;
+            lnal::gen_orthographic_proj(ortho, cx - radius, cx + radius, cy - radius, cy + radius, near_distance, far_distance);
+            map.view_proj = ortho * light_view;
+
+            map.normal_offset = texel * 1.5f;
+            map.depth_bias = (texel * 0.5f) / (far_distance - near_distance);
+        }
+    }
+
+    void fit_spot_shadow(shadow_map& map, const spot_light& light)
+    {
+        lnal::vec3 position(light.position[0], light.position[1], light.position[2]);
+        lnal::vec3 direction(light.direction[0], light.direction[1], light.direction[2]);
+
+        lnal::mat4 view;
+        lnal::lookat(view, position, position + direction, pick_up(direction));
+
+        //The map's square covers the cone, capped below 180 degrees where the projection breaks down
+        float fov = std::min(2.0f * acosf(light.cos_outer) * 1.05f, lnal::radians(170.0f));
+
+        lnal::mat4 projection;
+        lnal::gen_perspective_proj(projection, fov, 1.0f, light.range * 0.02f, light.range);
+        map.view_proj = projection * view;
+
+        //Texels grow with distance, the offset is sized for the middle of the range
+        float texel = (light.range * tanf(fov * 0.5f)) / (float)map.depth.width;
+        map.normal_offset = texel * 1.5f;
+        map.depth_bias = 0.0001f;
+
+        depth_buffer_clear(map.depth);
+    }
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "framebuffer.h"
+#include "../math/lnal.h"
+#include "../math/simd.h"
+#include "../scene/light.h"
+#include <cmath>
+#include <cstdint>
+
+//Shadow maps for the CPU rasterizer, see shadow.cpp. A map is a depth_buffer filled with draw_depth(map.depth, ..., map.view_proj * model),
+//the shadowed shaders in shaders.h look it up with shadow_visibility4 / cascade_visibility4.
+
+namespace br
+{
+    static const uint32_t SHADOW_MAX_CASCADES = 4;
+
+    //PCF reads 4x4 texels around a lookup. Lookups are clamped to the map, the border keeps the footprint inside the buffer.
+    static const uint32_t SHADOW_BORDER = 2;
+
+    struct shadow_map
+    {
+        depth_buffer depth;
+        lnal::mat4 view_proj;       //World space to the map's clip space
+
+        //Receivers move normal_offset world units along their normal and depth_bias (map depth units) towards the light before the compare
+        float normal_offset = 0.0f;
+        float depth_bias = 0.0f;
+    };
+
+    //Directional light shadows, one map per slice of the camera's view distance
+    struct shadow_cascades
+    {
+        uint32_t count = 4;
+        uint32_t size = 1024;               //Texels per side of every map
+        float lambda = 0.8f;                //Split placement, 0 = uniform, 1 = logarithmic
+        float max_distance = 0.0f;          //View distance the shadows end at, 0 = the camera's far plane
+        float caster_distance = 0.0f;       //How far beyond a cascade's bounds (towards the light) casters are still caught
+
+        //Filled in by fit_cascades
+        lnal::mat4 view;                                //Camera view the cascades were fit to
+        float splits[SHADOW_MAX_CASCADES + 1];          //Cascade i covers view distances splits[i] .. splits[i + 1]
+        shadow_map maps[SHADOW_MAX_CASCADES];
+    };
+
+    //@param size texels per side
+    void shadow_map_init(shadow_map& map, uint32_t size);
+
+    //Splits the camera's view distance into cascades and points one orthographic map at each slice. Maps are (re)created when the size
+    //changes and cleared, draw the casters into every cascade afterwards.
+    //@param projection a gen_perspective_proj matrix
+    //@param light_dir world space direction towards the light (unit length)
+    void fit_cascades(shadow_cascades& cascades, const lnal::mat4& view, const lnal::mat4& projection, const float* light_dir);
+
+    //Points a perspective map down the spot light's cone and clears it
+    void fit_spot_shadow(shadow_map& map, const spot_light& light);
+
+    //Fraction of a 4x4 texel tent filter around (u, v) that is lit (nearer the light than z counts as occluded). Each row of the footprint is
+    //one 4 wide compare.
+    //@param u / v map position in texels
+    //@param z receiver depth in the map's [0, 1] range
+    inline float shadow_pcf(const depth_buffer& db, float u, float v, float z)
+    {
+        using namespace lnal;
+
+        //Texel centers sit at + 0.5, clamped to the outermost ones
+        float tu = fminf(fmaxf(u - 0.5f, 0.0f), (float)(db.width - 1));
+        float tv = fminf(fmaxf(v - 0.5f, 0.0f), (float)(db.height - 1));
+        int x0 = (int)tu;
+        int y0 = (int)tv;
+        float fx = tu - (float)x0;
+        float fy = tv - (float)y0;
+
+        //Three bilinear compares 1 texel apart in each direction sum to the weights (1 - f, 1, 1, f), 9 in total
+        const f32x4 zero = f32x4_splat(0.0f);
+        f32x4 wx = f32x4_set(1.0f - fx, 1.0f, 1.0f, fx);
+        float wy[4] = { 1.0f - fy, 1.0f, 1.0f, fy };
+        f32x4 receiver = f32x4_splat(z);
+        f32x4 lit = zero;
+
+        for(int r = 0; r < 4; r++)
+        {
+            f32x4 row = f32x4_load(depth_buffer_row(db, y0 - 1 + r) + (x0 - 1));
+            lit = lit + (select(receiver <= row, wx, zero) * f32x4_splat(wy[r]));
+        }
+
+        float lanes[4];
+        f32x4_store(lanes, lit);
+        return (lanes[0] + lanes[1] + lanes[2] + lanes[3]) * (1.0f / 9.0f);
+    }
+
+    //Visibility of one world space point that has already been offset along its normal. Points outside the map are lit.
+    inline float shadow_lookup(const shadow_map& map, float x, float y, float z)
+    {
+        const float* m = map.view_proj.data();
+        float clip_x = (m[0] * x) + (m[4] * y) + (m[8] * z) + m[12];
+        float clip_y = (m[1] * x) + (m[5] * y) + (m[9] * z) + m[13];
+        float clip_z = (m[2] * x) + (m[6] * y) + (m[10] * z) + m[14];
+        float clip_w = (m[3] * x) + (m[7] * y) + (m[11] * z) + m[15];
+
+        if(clip_w <= 0.0f || fabsf(clip_x) > clip_w || fabsf(clip_y) > clip_w || clip_z > clip_w)
+            return 1.0f;
+
+        float inv_w = 1.0f / clip_w;
+        float u = ((clip_x * inv_w) * 0.5f + 0.5f) * map.depth.width;
+        float v = (0.5f - (clip_y * inv_w) * 0.5f) * map.depth.height;
+        float depth = ((clip_z * inv_w) * 0.5f + 0.5f) - map.depth_bias;
+
+        return shadow_pcf(map.depth, u, v, depth);
+    }
+
+    //Visibility of 4 world space points with unit normals (1 = lit). Lanes outside the mask are lit without a lookup.
+    inline lnal::f32x4 shadow_visibility4(const shadow_map& map, lnal::mask4 lanes, lnal::f32x4 px, lnal::f32x4 py, lnal::f32x4 pz,
+                                          lnal::f32x4 nx, lnal::f32x4 ny, lnal::f32x4 nz)
+    {
+        using namespace lnal;
+
+        f32x4 offset = f32x4_splat(map.normal_offset);
+        float x[4], y[4], z[4], visibility[4];
+        f32x4_store(x, px + (nx * offset));
+        f32x4_store(y, py + (ny * offset));
+        f32x4_store(z, pz + (nz * offset));
+
+        int bits = mask_bits(lanes);
+        for(int k = 0; k < 4; k++)
+        {
+            visibility[k] = (bits & (1 << k)) ? shadow_lookup(map, x[k], y[k], z[k]) : 1.0f;
+        }
+
+        return f32x4_load(visibility);
+    }
+
+    //shadow_visibility4 through the cascade each point's view distance falls in. Points past the last cascade are lit.
+    inline lnal::f32x4 cascade_visibility4(const shadow_cascades& c, lnal::mask4 lanes, lnal::f32x4 px, lnal::f32x4 py, lnal::f32x4 pz,
+                                           lnal::f32x4 nx, lnal::f32x4 ny, lnal::f32x4 nz)
+    {
+        using namespace lnal;
+
+        //View distance is minus the view space z, row 2 of the view matrix
+        const float* v = c.view.data();
+        f32x4 distance = f32x4_splat(0.0f) - ((px * f32x4_splat(v[2])) + (py * f32x4_splat(v[6])) + (pz * f32x4_splat(v[10])) + f32x4_splat(v[14]));
+
+        float d[4], x[4], y[4], z[4], visibility[4];
+        f32x4_store(d, distance);
+        f32x4_store(x, px);
+        f32x4_store(y, py);
+        f32x4_store(z, pz);
+
+        float n[3][4];
+        f32x4_store(n[0], nx);
+        f32x4_store(n[1], ny);
+        f32x4_store(n[2], nz);
+
+        int bits = mask_bits(lanes);
+        for(int k = 0; k < 4; k++)
+        {
+            visibility[k] = 1.0f;
+            if(!(bits & (1 << k)))
+                continue;
+
+            uint32_t i = 0;
+            while(i < c.count && d[k] > c.splits[i + 1])
+            {
+                i++;
+            }
+
+            if(i == c.count)
+                continue;
+
+            const shadow_map& map = c.maps[i];
+            float offset = map.normal_offset;
+            visibility[k] = shadow_lookup(map, x[k] + (n[0][k] * offset), y[k] + (n[1][k] * offset), z[k] + (n[2][k] * offset));
+        }
+
+        return f32x4_load(visibility);
+    }
+}
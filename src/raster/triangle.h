@@ -0,0 +1,959 @@
+#pragma once
+
+#include "framebuffer.h"
+#include "raster.h"
+#include "clip.h"
+#include "msaa.h"
+#include "occlusion.h"
+#include "../math/simd.h"
+#include <cmath>
+
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Triangle setup and block traversal.
+
+
+    Plane Equations -
+        Anything that is linear in screen space can be written as f(x, y) = f0 + dx * (x - x0) + dy * (y - y0) around the first vertex. Setup solves
+        for dx / dy once per triangle, after that moving one pixel right is a single add. z / w is linear in screen space and so are varying / w and
+        1 / w, so a perspective correct varying is (varying / w)(x, y) / (1 / w)(x, y): one plane per varying, one shared plane for 1 / w and one
+        divide per pixel shared by all varyings.
+
+
+    Blocks -
+        The bounding box is walked in RASTER_BLOCK_SIZE square blocks. The three edge functions are evaluated at the block's corner pixel centers
+        first: a block entirely outside one edge is skipped without looking at its pixels, a block entirely inside all three skips the per pixel
+        edge tests. Inside a block, rows are processed 4 pixels at a time with the lnal 4 wide types and the planes are stepped incrementally.
+
+
+    Varyings -
+        The number of varyings is a template parameter, so the per varying loops unroll and a draw with no varyings doesn't set up or step the
+        1 / w plane at all.
+
+
+    Multisampling -
+        The msaa_framebuffer overload of raster_triangle walks the same blocks but tests coverage and depth per sample. A sample's edge and depth
+        values are the pixel center's plus a constant per triangle (dx * offset x + dy * offset y), so every extra sample is an add and a compare
+        per edge. The fragment functor still runs once per 4 pixel group at the pixel centers, the samples that passed take its color.
+
+
+    Depth Only -
+        Shadow passes only need depth, so the depth_buffer overload drops everything else: no color loads / stores, no fragment call, no 1 / w or
+        varying planes, and since depth buffers are padded to whole 4 texel groups, no partial group copies either. Blocks inside the triangle
+        are straight line code, a row is two groups of one load, one compare, one select and one store. Partial blocks keep the row's half of
+        the edge functions and test every group without branching on coverage.
+
+
+    Occlusion -
+        The occlusion_buffer overload walks 8x4 tiles instead of blocks and produces a coverage bit per pixel plus the triangle's deepest point
+        in the tile, which occlusion_merge folds into the tile (see occlusion.cpp). No per pixel depth is ever computed.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+namespace br
+{
+    static const int RASTER_BLOCK_SIZE = 8;
+    static_assert(RASTER_BLOCK_SIZE == MSAA_TILE_SIZE, "a block has to map to exactly one MSAA tile");
+
+    //Vertex after the vertex stage: clip space position and N varyings
+    template<uint32_t N>
+    struct raster_vertex
+    {
+        float position[4];
+        float varyings[N];
+    };
+
+    template<>
+    struct raster_vertex<0>
+    {
+        float position[4];
+    };
+
+    //Sizes the scratch for count vertices with N varyings and returns them, the outcodes are in s.outcodes
+    template<uint32_t N>
+    inline raster_vertex<N>* raster_scratch_vertices(raster_scratch& s, uint32_t count)
+    {
+        static_assert(sizeof(raster_vertex<N>) == sizeof(float) * (4 + N), "raster_vertex has to be tightly packed floats");
+
+        s.vertices.resize((size_t)count * (4 + N));
+        s.outcodes.resize(count);
+        return (raster_vertex<N>*)s.vertices.data();
+    }
+
+    //f(x, y) = origin + dx * (x - anchor x) + dy * (y - anchor y), anchored at the triangle's first vertex
+    struct raster_plane
+    {
+        float origin;
+        float dx;
+        float dy;
+    };
+
+    //Edge from a to b, E(p) = dx * (p.y - ay) - dy * (p.x - ax)
+    struct raster_edge
+    {
+        float ax;
+        float ay;
+        float dx;
+        float dy;
+        bool top_left;
+    };
+
+    //Everything computed once per triangle
+    template<uint32_t N>
+    struct triangle_setup
+    {
+        raster_edge edges[3];
+
+        float anchor_x;
+        float anchor_y;
+
+        raster_plane z;
+        raster_plane inv_w;
+        raster_plane varyings[N > 0 ? N : 1];     //varying / w
+
+        //Pixel bounds clamped to the framebuffer, [x0, x1) x [y0, y1)
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+    };
+
+    //Plane through (x[i], y[i], f[i])
+    //@param inv_det 1 / signed area of the three points
+    inline raster_plane make_plane(const float* x, const float* y, float inv_det, float f0, float f1, float f2)
+    {
+        float d1x = x[1] - x[0], d1y = y[1] - y[0];
+        float d2x = x[2] - x[0], d2y = y[2] - y[0];
+        float df1 = f1 - f0, df2 = f2 - f0;
+
+        return { f0, ((df1 * d2y) - (df2 * d1y)) * inv_det, ((df2 * d1x) - (df1 * d2x)) * inv_det };
+    }
+
+    inline float plane_at(const raster_plane& p, float x, float y)
+    {
+        return p.origin + (p.dx * x) + (p.dy * y);
+    }
+
+    //Setup runs once per triangle and most triangles are a few pixels, so it avoids libm: without -ffast-math fminf / fmaxf / floorf / ceilf
+    //are calls. Screen positions are bounded by the guard band, well inside int range.
+    inline float min3(float a, float b, float c)
+    {
+        float m = a < b ? a : b;
+        return m < c ? m : c;
+    }
+
+    inline float max3(float a, float b, float c)
+    {
+        float m = a > b ? a : b;
+        return m > c ? m : c;
+    }
+
+    inline int floor_to_int(float f)
+    {
+        int i = (int)f;
+        return f < (float)i ? i - 1 : i;
+    }
+
+    inline int ceil_to_int(float f)
+    {
+        int i = (int)f;
+        return f > (float)i ? i + 1 : i;
+    }
+
+    //Edge functions at a block's 4 corners, all 4 at once. Done with scalar fminf / fmaxf this was 24 libm calls per block, which cost more
+    //than filling an inside block's pixels.
+    //@param outside set if all corners are outside one of the edges (no pixel of the block is covered)
+    //@param inside set if all corners are inside every edge (all pixels are)
+    inline void classify_block(const raster_edge* edges, float left, float top, float right, float bottom, bool& outside, bool& inside)
+    {
+        using namespace lnal;
+
+        const f32x4 zero = f32x4_splat(0.0f);
+        const f32x4 x = f32x4_set(left, right, left, right);
+        const f32x4 y = f32x4_set(top, top, bottom, bottom);
+
+        outside = false;
+        inside = true;
+
+        for(int i = 0; i < 3; i++)
+        {
+            const raster_edge& e = edges[i];
+            f32x4 value = (f32x4_splat(e.dx) * (y - f32x4_splat(e.ay))) - (f32x4_splat(e.dy) * (x - f32x4_splat(e.ax)));
+
+            outside = outside || !any(value >= zero);
+            inside = inside && all(value > zero);
+        }
+    }
+
+    inline raster_edge make_edge(float ax, float ay, float bx, float by)
+    {
+        raster_edge e = { ax, ay, bx - ax, by - ay, false };
+
+        //Top or left edges own the pixels that land exactly on them (see raster.cpp)
+        e.top_left = (e.dy == 0.0f && e.dx > 0.0f) || e.dy < 0.0f;
+        return e;
+    }
+
+    //Projects the triangle to the screen and computes its edges, bounds and planes
+    //@return false if it is culled (back facing, zero area or no pixels on the framebuffer)
+    template<uint32_t N>
+    bool setup_triangle(triangle_setup<N>& s, uint32_t width, uint32_t height, const raster_vertex<N>& a, const raster_vertex<N>& b, const raster_vertex<N>& c, bool cull_backfaces)
+    {
+        const raster_vertex<N>* v[3] = { &a, &b, &c };
+        float x[3], y[3], z[3], inv_w[3];
+
+        //The clip stage guarantees w > 0 here
+        for(int i = 0; i < 3; i++)
+        {
+            inv_w[i] = 1.0f / v[i]->position[3];
+            x[i] = ((v[i]->position[0] * inv_w[i]) * 0.5f + 0.5f) * width;
+            y[i] = (0.5f - (v[i]->position[1] * inv_w[i]) * 0.5f) * height;
+            z[i] = (v[i]->position[2] * inv_w[i]) * 0.5f + 0.5f;
+        }
+
+        float area = ((x[1] - x[0]) * (y[2] - y[0])) - ((y[1] - y[0]) * (x[2] - x[0]));
+
+        //Counter clockwise in GL terms is negative here
+        if(area == 0.0f || (cull_backfaces && area > 0.0f))
+            return false;
+
+        int x0 = floor_to_int(min3(x[0], x[1], x[2]));
+        int x1 = ceil_to_int(max3(x[0], x[1], x[2]));
+        int y0 = floor_to_int(min3(y[0], y[1], y[2]));
+        int y1 = ceil_to_int(max3(y[0], y[1], y[2]));
+        s.x0 = x0 > 0 ? x0 : 0;
+        s.x1 = x1 < (int)width ? x1 : (int)width;
+        s.y0 = y0 > 0 ? y0 : 0;
+        s.y1 = y1 < (int)height ? y1 : (int)height;
+
+        if(s.x0 >= s.x1 || s.y0 >= s.y1)
+            return false;
+
+        //Edges of the clockwise (positive area) order so inside is positive for all three
+        int i1 = area < 0.0f ? 2 : 1;
+        int i2 = area < 0.0f ? 1 : 2;
+        s.edges[0] = make_edge(x[i1], y[i1], x[i2], y[i2]);
+        s.edges[1] = make_edge(x[i2], y[i2], x[0], y[0]);
+        s.edges[2] = make_edge(x[0], y[0], x[i1], y[i1]);
+
+        float inv_det = 1.0f / area;
+        s.anchor_x = x[0];
+        s.anchor_y = y[0];
+        s.z = make_plane(x, y, inv_det, z[0], z[1], z[2]);
+
+        if constexpr(N > 0)
+        {
+            s.inv_w = make_plane(x, y, inv_det, inv_w[0], inv_w[1], inv_w[2]);
+
+            for(uint32_t i = 0; i < N; i++)
+            {
+                s.varyings[i] = make_plane(x, y, inv_det, a.varyings[i] * inv_w[0], b.varyings[i] * inv_w[1], c.varyings[i] * inv_w[2]);
+            }
+        }
+
+        return true;
+    }
+
+    //Depth and color of 4 pixels starting at x. Groups hanging over the right edge of the framebuffer go through a padded copy.
+    struct pixel_group
+    {
+        float* depth;
+        uint32_t* color;
+        int valid;
+        float depth_copy[4];
+        uint32_t color_copy[4];
+    };
+
+    inline void pixel_group_load(pixel_group& g, framebuffer& fb, int x, int y, lnal::f32x4& depth, lnal::i32x4& color)
+    {
+        size_t offset = ((size_t)y * fb.width) + x;
+        g.depth = &fb.depth[offset];
+        g.color = &fb.color[offset];
+        g.valid = (int)fb.width - x;
+
+        if(g.valid >= 4)
+        {
+            depth = lnal::f32x4_load(g.depth);
+            color = lnal::i32x4_load((const int32_t*)g.color);
+            return;
+        }
+
+        for(int k = 0; k < 4; k++)
+        {
+            g.depth_copy[k] = k < g.valid ? g.depth[k] : 0.0f;
+            g.color_copy[k] = k < g.valid ? g.color[k] : 0;
+        }
+
+        depth = lnal::f32x4_load(g.depth_copy);
+        color = lnal::i32x4_load((const int32_t*)g.color_copy);
+    }
+
+    inline void pixel_group_store(pixel_group& g, lnal::f32x4 depth, lnal::i32x4 color)
+    {
+        if(g.valid >= 4)
+        {
+            lnal::f32x4_store(g.depth, depth);
+            lnal::i32x4_store((int32_t*)g.color, color);
+            return;
+        }
+
+        lnal::f32x4_store(g.depth_copy, depth);
+        lnal::i32x4_store((int32_t*)g.color_copy, color);
+
+        for(int k = 0; k < g.valid; k++)
+        {
+            g.depth[k] = g.depth_copy[k];
+            g.color[k] = g.color_copy[k];
+        }
+    }
+
+    //Rasterizes one triangle with depth testing. The fragment functor is called for every group of 4 horizontal pixels with at least one
+    //pixel passing the depth test: lnal::i32x4 fragment(const lnal::f32x4* varyings) returns the 4 RGBA8 colors. Lanes that fail are discarded
+    //afterwards, so the functor doesn't need the mask.
+    template<uint32_t N, typename Fragment>
+    void raster_triangle(framebuffer& fb, const raster_vertex<N>& a, const raster_vertex<N>& b, const raster_vertex<N>& c, bool cull_backfaces, const Fragment& fragment, raster_stats* stats)
+    {
+        using namespace lnal;
+
+        triangle_setup<N> s;
+        if(!setup_triangle(s, fb.width, fb.height, a, b, c, cull_backfaces))
+            return;
+
+        if(stats)
+            stats->triangles_rasterized++;
+
+        const f32x4 lane = f32x4_set(0.0f, 1.0f, 2.0f, 3.0f);
+        const f32x4 zero = f32x4_splat(0.0f);
+        const f32x4 right = f32x4_splat((float)s.x1);
+
+        //Per group (4 pixel) steps
+        f32x4 z_step = f32x4_splat(s.z.dx * 4.0f);
+        f32x4 inv_w_step = f32x4_splat(s.inv_w.dx * 4.0f);
+        f32x4 varying_steps[N > 0 ? N : 1];
+
+        if constexpr(N > 0)
+        {
+            for(uint32_t i = 0; i < N; i++)
+            {
+                varying_steps[i] = f32x4_splat(s.varyings[i].dx * 4.0f);
+            }
+        }
+
+        uint64_t written = 0;
+
+        for(int by = s.y0 & ~(RASTER_BLOCK_SIZE - 1); by < s.y1; by += RASTER_BLOCK_SIZE)
+        {
+            for(int bx = s.x0 & ~(RASTER_BLOCK_SIZE - 1); bx < s.x1; bx += RASTER_BLOCK_SIZE)
+            {
+                float left = (float)bx + 0.5f;
+                float top = (float)by + 0.5f;
+                float far_x = left + (float)(RASTER_BLOCK_SIZE - 1);
+                float far_y = top + (float)(RASTER_BLOCK_SIZE - 1);
+
+                bool outside, inside;
+                classify_block(s.edges, left, top, far_x, far_y, outside, inside);
+
+                if(outside)
+                    continue;
+
+                //Small triangles only touch part of a block, so the rows and groups are trimmed to the bounding box
+                int row_begin = by > s.y0 ? by : s.y0;
+                int row_end = by + RASTER_BLOCK_SIZE < s.y1 ? by + RASTER_BLOCK_SIZE : s.y1;
+                int group_begin = bx > (s.x0 & ~3) ? bx : (s.x0 & ~3);
+                int group_end = bx + RASTER_BLOCK_SIZE < s.x1 ? bx + RASTER_BLOCK_SIZE : s.x1;
+
+                for(int y = row_begin; y < row_end; y++)
+                {
+                    float py = (float)y + 0.5f;
+                    float ry = py - s.anchor_y;
+                    float rx = ((float)group_begin + 0.5f) - s.anchor_x;
+
+                    //Plane values for the row's first group, stepped by 4 pixels after each group
+                    f32x4 z = f32x4_splat(plane_at(s.z, rx, ry)) + (lane * f32x4_splat(s.z.dx));
+                    f32x4 inv_w = zero;
+                    f32x4 varyings_over_w[N > 0 ? N : 1];
+
+                    if constexpr(N > 0)
+                    {
+                        inv_w = f32x4_splat(plane_at(s.inv_w, rx, ry)) + (lane * f32x4_splat(s.inv_w.dx));
+
+                        for(uint32_t i = 0; i < N; i++)
+                        {
+                            varyings_over_w[i] = f32x4_splat(plane_at(s.varyings[i], rx, ry)) + (lane * f32x4_splat(s.varyings[i].dx));
+                        }
+                    }
+
+                    f32x4 py4 = f32x4_splat(py);
+
+                    for(int x = group_begin; x < group_end; x += 4)
+                    {
+                        f32x4 px = f32x4_splat((float)x + 0.5f) + lane;
+                        mask4 covered = px < right;
+
+                        if(!inside)
+                        {
+                            for(const raster_edge& e : s.edges)
+                            {
+                                f32x4 value = (f32x4_splat(e.dx) * (py4 - f32x4_splat(e.ay))) - (f32x4_splat(e.dy) * (px - f32x4_splat(e.ax)));
+                                covered = covered & (e.top_left ? value >= zero : value > zero);
+                            }
+                        }
+
+                        if(any(covered))
+                        {
+                            pixel_group group;
+                            f32x4 depth;
+                            i32x4 color;
+                            pixel_group_load(group, fb, x, y, depth, color);
+
+                            mask4 pass = covered & (z >= zero) & (z < depth);
+
+                            if(any(pass))
+                            {
+                                f32x4 varyings[N > 0 ? N : 1];
+
+                                if constexpr(N > 0)
+                                {
+                                    f32x4 w = f32x4_splat(1.0f) / inv_w;
+
+                                    for(uint32_t i = 0; i < N; i++)
+                                    {
+                                        varyings[i] = varyings_over_w[i] * w;
+                                    }
+                                }
+
+                                color = select(pass, fragment((const f32x4*)varyings), color);
+                                depth = select(pass, z, depth);
+                                pixel_group_store(group, depth, color);
+
+                                written += mask_count(pass);
+                            }
+                        }
+
+                        z = z + z_step;
+
+                        if constexpr(N > 0)
+                        {
+                            inv_w = inv_w + inv_w_step;
+
+                            for(uint32_t i = 0; i < N; i++)
+                            {
+                                varyings_over_w[i] = varyings_over_w[i] + varying_steps[i];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        if(stats)
+            stats->pixels_written += written;
+    }
+
+    //Multisampled raster_triangle, same functor interface. Coverage and depth are per sample, the functor runs once per 4 pixel group with the
+    //varyings at the pixel centers and its colors go to every sample that passed.
+    template<uint32_t N, typename Fragment>
+    void raster_triangle(msaa_framebuffer& fb, const raster_vertex<N>& a, const raster_vertex<N>& b, const raster_vertex<N>& c, bool cull_backfaces, const Fragment& fragment, raster_stats* stats)
+    {
+        using namespace lnal;
+
+        triangle_setup<N> s;
+        if(!setup_triangle(s, fb.width, fb.height, a, b, c, cull_backfaces))
+            return;
+
+        if(stats)
+            stats->triangles_rasterized++;
+
+        const uint32_t samples = fb.samples;
+        const f32x4 lane = f32x4_set(0.0f, 1.0f, 2.0f, 3.0f);
+        const f32x4 zero = f32x4_splat(0.0f);
+        const f32x4 right = f32x4_splat((float)s.x1);
+
+        //Offsets of each sample's edge and depth values from the pixel center's
+        f32x4 edge_offsets[3][MSAA_MAX_SAMPLES];
+        f32x4 z_offsets[MSAA_MAX_SAMPLES];
+
+        for(uint32_t k = 0; k < samples; k++)
+        {
+            for(int i = 0; i < 3; i++)
+            {
+                edge_offsets[i][k] = f32x4_splat((s.edges[i].dx * fb.sample_y[k]) - (s.edges[i].dy * fb.sample_x[k]));
+            }
+
+            z_offsets[k] = f32x4_splat((s.z.dx * fb.sample_x[k]) + (s.z.dy * fb.sample_y[k]));
+        }
+
+        f32x4 z_step = f32x4_splat(s.z.dx * 4.0f);
+        f32x4 inv_w_step = f32x4_splat(s.inv_w.dx * 4.0f);
+        f32x4 varying_steps[N > 0 ? N : 1];
+
+        if constexpr(N > 0)
+        {
+            for(uint32_t i = 0; i < N; i++)
+            {
+                varying_steps[i] = f32x4_splat(s.varyings[i].dx * 4.0f);
+            }
+        }
+
+        uint64_t written = 0;
+
+        for(int by = s.y0 & ~(RASTER_BLOCK_SIZE - 1); by < s.y1; by += RASTER_BLOCK_SIZE)
+        {
+            for(int bx = s.x0 & ~(RASTER_BLOCK_SIZE - 1); bx < s.x1; bx += RASTER_BLOCK_SIZE)
+            {
+                //Samples can sit anywhere in a pixel, so the block tests use the block's outer corners instead of its corner pixel centers
+                float left = (float)bx;
+                float top = (float)by;
+                float far_x = left + (float)RASTER_BLOCK_SIZE;
+                float far_y = top + (float)RASTER_BLOCK_SIZE;
+
+                bool outside, inside;
+                classify_block(s.edges, left, top, far_x, far_y, outside, inside);
+
+                if(outside)
+                    continue;
+
+                uint32_t tile = msaa_tile_index(fb, bx, by);
+                if(fb.tile_mode[tile] == MSAA_TILE_CLEAR)
+                    msaa_begin_tile(fb, tile);
+
+                int row_begin = by > s.y0 ? by : s.y0;
+                int row_end = by + RASTER_BLOCK_SIZE < s.y1 ? by + RASTER_BLOCK_SIZE : s.y1;
+                int group_begin = bx > (s.x0 & ~3) ? bx : (s.x0 & ~3);
+                int group_end = bx + RASTER_BLOCK_SIZE < s.x1 ? bx + RASTER_BLOCK_SIZE : s.x1;
+
+                for(int y = row_begin; y < row_end; y++)
+                {
+                    float py = (float)y + 0.5f;
+                    float ry = py - s.anchor_y;
+                    float rx = ((float)group_begin + 0.5f) - s.anchor_x;
+
+                    f32x4 z = f32x4_splat(plane_at(s.z, rx, ry)) + (lane * f32x4_splat(s.z.dx));
+                    f32x4 inv_w = zero;
+                    f32x4 varyings_over_w[N > 0 ? N : 1];
+
+                    if constexpr(N > 0)
+                    {
+                        inv_w = f32x4_splat(plane_at(s.inv_w, rx, ry)) + (lane * f32x4_splat(s.inv_w.dx));
+
+                        for(uint32_t i = 0; i < N; i++)
+                        {
+                            varyings_over_w[i] = f32x4_splat(plane_at(s.varyings[i], rx, ry)) + (lane * f32x4_splat(s.varyings[i].dx));
+                        }
+                    }
+
+                    f32x4 py4 = f32x4_splat(py);
+
+                    for(int x = group_begin; x < group_end; x += 4)
+                    {
+                        f32x4 px = f32x4_splat((float)x + 0.5f) + lane;
+                        mask4 valid = px < right;
+
+                        //Edge values at the pixel centers
+                        f32x4 center[3];
+                        if(!inside)
+                        {
+                            for(int i = 0; i < 3; i++)
+                            {
+                                const raster_edge& e = s.edges[i];
+                                center[i] = (f32x4_splat(e.dx) * (py4 - f32x4_splat(e.ay))) - (f32x4_splat(e.dy) * (px - f32x4_splat(e.ax)));
+                            }
+                        }
+
+                        //Coverage and depth test per sample. Storage is padded to whole tiles, so the loads never leave the buffers.
+                        mask4 pass[MSAA_MAX_SAMPLES];
+                        mask4 any_pass = andnot(valid, valid);
+                        mask4 all_pass = valid;
+
+                        for(uint32_t k = 0; k < samples; k++)
+                        {
+                            mask4 covered = valid;
+                            if(!inside)
+                            {
+                                for(int i = 0; i < 3; i++)
+                                {
+                                    f32x4 value = center[i] + edge_offsets[i][k];
+                                    covered = covered & (s.edges[i].top_left ? value >= zero : value > zero);
+                                }
+                            }
+
+                            float* depth_row = msaa_depth(fb, x, y, k);
+                            f32x4 depth = f32x4_load(depth_row);
+                            f32x4 sample_z = z + z_offsets[k];
+
+                            pass[k] = covered & (sample_z >= zero) & (sample_z < depth);
+                            any_pass = any_pass | pass[k];
+                            all_pass = all_pass & pass[k];
+
+                            if(any(pass[k]))
+                                f32x4_store(depth_row, select(pass[k], sample_z, depth));
+                        }
+
+                        if(any(any_pass))
+                        {
+                            f32x4 varyings[N > 0 ? N : 1];
+
+                            if constexpr(N > 0)
+                            {
+                                f32x4 w = f32x4_splat(1.0f) / inv_w;
+
+                                for(uint32_t i = 0; i < N; i++)
+                                {
+                                    varyings[i] = varyings_over_w[i] * w;
+                                }
+                            }
+
+                            msaa_write4(fb, tile, x, y, fragment((const f32x4*)varyings), pass, any_pass, all_pass);
+                            written += mask_count(any_pass);
+                        }
+
+                        z = z + z_step;
+
+                        if constexpr(N > 0)
+                        {
+                            inv_w = inv_w + inv_w_step;
+
+                            for(uint32_t i = 0; i < N; i++)
+                            {
+                                varyings_over_w[i] = varyings_over_w[i] + varying_steps[i];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        if(stats)
+            stats->pixels_written += written;
+    }
+
+    //Depth only raster_triangle for shadow maps and other depth passes. The fragment functor is never called.
+    template<uint32_t N, typename Fragment>
+    void raster_triangle(depth_buffer& db, const raster_vertex<N>& a, const raster_vertex<N>& b, const raster_vertex<N>& c, bool cull_backfaces, const Fragment&, raster_stats* stats)
+    {
+        using namespace lnal;
+
+        //Only the positions matter, so any varyings are dropped before setup
+        raster_vertex<0> v[3];
+        const raster_vertex<N>* in[3] = { &a, &b, &c };
+        for(int i = 0; i < 3; i++)
+        {
+            for(int k = 0; k < 4; k++)
+            {
+                v[i].position[k] = in[i]->position[k];
+            }
+        }
+
+        triangle_setup<0> s;
+        if(!setup_triangle(s, db.width, db.height, v[0], v[1], v[2], cull_backfaces))
+            return;
+
+        if(stats)
+            stats->triangles_rasterized++;
+
+        const f32x4 lane = f32x4_set(0.0f, 1.0f, 2.0f, 3.0f);
+        const f32x4 zero = f32x4_splat(0.0f);
+        const f32x4 right = f32x4_splat((float)s.x1);
+        const f32x4 z_step = f32x4_splat(s.z.dx * 4.0f);
+        const f32x4 z_lanes = lane * f32x4_splat(s.z.dx);
+
+        f32x4 edge_dy[3], edge_ax[3];
+        for(int i = 0; i < 3; i++)
+        {
+            edge_dy[i] = f32x4_splat(s.edges[i].dy);
+            edge_ax[i] = f32x4_splat(s.edges[i].ax);
+        }
+
+        uint64_t written = 0;
+
+        for(int by = s.y0 & ~(RASTER_BLOCK_SIZE - 1); by < s.y1; by += RASTER_BLOCK_SIZE)
+        {
+            for(int bx = s.x0 & ~(RASTER_BLOCK_SIZE - 1); bx < s.x1; bx += RASTER_BLOCK_SIZE)
+            {
+                float left = (float)bx + 0.5f;
+                float top = (float)by + 0.5f;
+                float far_x = left + (float)(RASTER_BLOCK_SIZE - 1);
+                float far_y = top + (float)(RASTER_BLOCK_SIZE - 1);
+
+                bool outside, inside;
+                classify_block(s.edges, left, top, far_x, far_y, outside, inside);
+
+                if(outside)
+                    continue;
+
+                //Blocks inside the triangle and the target (most of a big triangle) are just a depth test per 4 texels, 2 groups per row
+                if(inside && bx + RASTER_BLOCK_SIZE <= s.x1 && by + RASTER_BLOCK_SIZE <= s.y1)
+                {
+                    float rx = left - s.anchor_x;
+
+                    for(int y = by; y < by + RASTER_BLOCK_SIZE; y++)
+                    {
+                        float* row = depth_buffer_row(db, y) + bx;
+                        f32x4 z = f32x4_splat(plane_at(s.z, rx, ((float)y + 0.5f) - s.anchor_y)) + z_lanes;
+                        f32x4 z1 = z + z_step;
+
+                        f32x4 depth0 = f32x4_load(row);
+                        f32x4 depth1 = f32x4_load(row + 4);
+                        mask4 pass0 = (z < depth0) & (z >= zero);
+                        mask4 pass1 = (z1 < depth1) & (z1 >= zero);
+                        f32x4_store(row, select(pass0, z, depth0));
+                        f32x4_store(row + 4, select(pass1, z1, depth1));
+
+                        if(stats)
+                            written += mask_count(pass0) + mask_count(pass1);
+                    }
+
+                    continue;
+                }
+
+                int row_begin = by > s.y0 ? by : s.y0;
+                int row_end = by + RASTER_BLOCK_SIZE < s.y1 ? by + RASTER_BLOCK_SIZE : s.y1;
+                int group_begin = bx > (s.x0 & ~3) ? bx : (s.x0 & ~3);
+                int group_end = bx + RASTER_BLOCK_SIZE < s.x1 ? bx + RASTER_BLOCK_SIZE : s.x1;
+
+                for(int y = row_begin; y < row_end; y++)
+                {
+                    float py = (float)y + 0.5f;
+                    float rx = ((float)group_begin + 0.5f) - s.anchor_x;
+                    f32x4 z = f32x4_splat(plane_at(s.z, rx, py - s.anchor_y)) + z_lanes;
+                    float* row = depth_buffer_row(db, y);
+
+                    //The y half of each edge function is constant along the row
+                    f32x4 edge_rows[3];
+                    for(int i = 0; i < 3; i++)
+                    {
+                        edge_rows[i] = f32x4_splat(s.edges[i].dx * (py - s.edges[i].ay));
+                    }
+
+                    for(int x = group_begin; x < group_end; x += 4)
+                    {
+                        f32x4 px = f32x4_splat((float)x + 0.5f) + lane;
+                        mask4 covered = (px < right) & (z >= zero);
+
+                        if(!inside)
+                        {
+                            for(int i = 0; i < 3; i++)
+                            {
+                                f32x4 value = edge_rows[i] - (edge_dy[i] * (px - edge_ax[i]));
+                                covered = covered & (s.edges[i].top_left ? value >= zero : value > zero);
+                            }
+                        }
+
+                        //Groups the triangle misses still load and store, which is cheaper than a mispredicted branch on small triangles
+                        f32x4 depth = f32x4_load(&row[x]);
+                        mask4 pass = covered & (z < depth);
+                        f32x4_store(&row[x], select(pass, z, depth));
+
+                        if(stats)
+                            written += mask_count(pass);
+
+                        z = z + z_step;
+                    }
+                }
+            }
+        }
+
+        if(stats)
+            stats->pixels_written += written;
+    }
+
+    //Occluder triangle into an occlusion buffer: coverage masks per tile, merged with the deepest depth the triangle reaches in the tile
+    template<uint32_t N, typename Fragment>
+    void raster_triangle(occlusion_buffer& ob, const raster_vertex<N>& a, const raster_vertex<N>& b, const raster_vertex<N>& c, bool cull_backfaces, const Fragment&, raster_stats* stats)
+    {
+        using namespace lnal;
+
+        raster_vertex<0> v[3];
+        const raster_vertex<N>* in[3] = { &a, &b, &c };
+        for(int i = 0; i < 3; i++)
+        {
+            for(int k = 0; k < 4; k++)
+            {
+                v[i].position[k] = in[i]->position[k];
+            }
+        }
+
+        triangle_setup<0> s;
+        if(!setup_triangle(s, ob.width, ob.height, v[0], v[1], v[2], cull_backfaces))
+            return;
+
+        if(stats)
+            stats->triangles_rasterized++;
+
+        //The plane's maximum over a tile is at one of its corners, but it keeps rising past the triangle's own vertices
+        float deepest = max3(v[0].position[2] / v[0].position[3], v[1].position[2] / v[1].position[3], v[2].position[2] / v[2].position[3]) * 0.5f + 0.5f;
+        float tile_rise = (s.z.dx > 0.0f ? s.z.dx * (float)(OCCLUSION_TILE_WIDTH - 1) : 0.0f) + (s.z.dy > 0.0f ? s.z.dy * (float)(OCCLUSION_TILE_HEIGHT - 1) : 0.0f);
+
+        //Edge function offsets of the tile's 8 groups of 4 pixels (2 per row) from its first pixel
+        const f32x4 lane = f32x4_set(0.0f, 1.0f, 2.0f, 3.0f);
+        const f32x4 zero = f32x4_splat(0.0f);
+        f32x4 offsets[3][8];
+        for(int i = 0; i < 3; i++)
+        {
+            for(int g = 0; g < 8; g++)
+            {
+                float row = (float)(g >> 1);
+                float column = (float)((g & 1) * 4);
+                offsets[i][g] = f32x4_splat(s.edges[i].dx * row) - (f32x4_splat(s.edges[i].dy) * (lane + f32x4_splat(column)));
+            }
+        }
+
+        int tx0 = s.x0 / (int)OCCLUSION_TILE_WIDTH;
+        int tx1 = (s.x1 - 1) / (int)OCCLUSION_TILE_WIDTH;
+        int ty0 = s.y0 / (int)OCCLUSION_TILE_HEIGHT;
+        int ty1 = (s.y1 - 1) / (int)OCCLUSION_TILE_HEIGHT;
+
+        for(int ty = ty0; ty <= ty1; ty++)
+        {
+            for(int tx = tx0; tx <= tx1; tx++)
+            {
+                float left = (float)(tx * (int)OCCLUSION_TILE_WIDTH) + 0.5f;
+                float top = (float)(ty * (int)OCCLUSION_TILE_HEIGHT) + 0.5f;
+
+                bool outside, inside;
+                classify_block(s.edges, left, top, left + (float)(OCCLUSION_TILE_WIDTH - 1), top + (float)(OCCLUSION_TILE_HEIGHT - 1), outside, inside);
+
+                if(outside)
+                    continue;
+
+                uint32_t coverage = OCCLUSION_FULL_MASK;
+                if(!inside)
+                {
+                    f32x4 origin[3];
+                    for(int i = 0; i < 3; i++)
+                    {
+                        const raster_edge& e = s.edges[i];
+                        origin[i] = f32x4_splat((e.dx * (top - e.ay)) - (e.dy * (left - e.ax)));
+                    }
+
+                    coverage = 0;
+                    for(int g = 0; g < 8; g++)
+                    {
+                        mask4 covered = zero <= zero;
+                        for(int i = 0; i < 3; i++)
+                        {
+                            f32x4 value = origin[i] + offsets[i][g];
+                            covered = covered & (s.edges[i].top_left ? value >= zero : value > zero);
+                        }
+
+                        coverage |= (uint32_t)mask_bits(covered) << (g * 4);
+                    }
+
+                    if(!coverage)
+                        continue;
+                }
+
+                float depth = plane_at(s.z, left - s.anchor_x, top - s.anchor_y) + tile_rise;
+                occlusion_merge(ob, ((uint32_t)ty * ob.tiles_x) + (uint32_t)tx, coverage, depth < deepest ? depth : deepest);
+            }
+        }
+    }
+
+    //Clips the triangle (see clip.cpp) and rasterizes the resulting polygon as a fan. Varyings of the new vertices are blended from the
+    //original three with the clipper's weights, which is correct because clip space is where they are linear.
+    template<uint32_t N, typename Target, typename Fragment>
+    void raster_clipped_triangle(Target& fb, const raster_vertex<N>& a, const raster_vertex<N>& b, const raster_vertex<N>& c, uint32_t outcode_union,
+                                 bool cull_backfaces, const Fragment& fragment, raster_stats* stats)
+    {
+        const raster_vertex<N>* v[3] = { &a, &b, &c };
+        clip_vertex in[3] = {};
+
+        for(int i = 0; i < 3; i++)
+        {
+            for(int k = 0; k < 4; k++)
+            {
+                in[i].position[k] = v[i]->position[k];
+            }
+
+            in[i].bary[i] = 1.0f;
+        }
+
+        clip_vertex polygon[CLIP_MAX_VERTICES];
+        uint32_t count = clip_triangle(in, outcode_union, polygon);
+
+        raster_vertex<N> out[CLIP_MAX_VERTICES];
+        for(uint32_t i = 0; i < count; i++)
+        {
+            for(int k = 0; k < 4; k++)
+            {
+                out[i].position[k] = polygon[i].position[k];
+            }
+
+            if constexpr(N > 0)
+            {
+                const float* w = polygon[i].bary;
+                for(uint32_t k = 0; k < N; k++)
+                {
+                    out[i].varyings[k] = (w[0] * a.varyings[k]) + (w[1] * b.varyings[k]) + (w[2] * c.varyings[k]);
+                }
+            }
+        }
+
+        for(uint32_t i = 1; i + 1 < count; i++)
+        {
+            raster_triangle<N>(fb, out[0], out[i], out[i + 1], cull_backfaces, fragment, stats);
+        }
+    }
+
+    //Runs a triangle list through the clip stage and the rasterizer, 4 triangles at a time through the outcode tests
+    //@param vertices vertex stage output
+    //@param outcodes clip_classify of the vertices
+    //@param fb framebuffer, msaa_framebuffer, depth_buffer or occlusion_buffer
+    //@param fragment_for called with each visible triangle's 3 indices, returns the fragment functor for it (usually the same one every time)
+    template<uint32_t N, typename Target, typename FragmentFor>
+    void raster_triangle_list(Target& fb, const raster_vertex<N>* vertices, const uint32_t* outcodes, const uint32_t* indices, uint32_t triangle_count,
+                              bool cull_backfaces, const FragmentFor& fragment_for, raster_stats* stats)
+    {
+        for(uint32_t first = 0; first < triangle_count; first += 4)
+        {
+            uint32_t batch_count = triangle_count - first < 4 ? triangle_count - first : 4;
+            const uint32_t* batch = &indices[first * 3];
+
+            //The last batch repeats its final triangle to fill all 4 lanes
+            uint32_t padded[12];
+            if(batch_count < 4)
+            {
+                for(uint32_t i = 0; i < 12; i++)
+                {
+                    padded[i] = batch[i < batch_count * 3 ? i : ((batch_count - 1) * 3) + (i % 3)];
+                }
+
+                batch = padded;
+            }
+
+            uint32_t reject = 0, needs_clip = 0;
+            clip_triangles4(outcodes, batch, reject, needs_clip);
+
+            for(uint32_t t = 0; t < batch_count; t++)
+            {
+                const uint32_t* tri = &batch[t * 3];
+
+                if(reject & (1u << t))
+                {
+                    if(stats)
+                        stats->triangles_rejected++;
+
+                    continue;
+                }
+
+                auto&& fragment = fragment_for(tri);
+                const raster_vertex<N>& a = vertices[tri[0]];
+                const raster_vertex<N>& b = vertices[tri[1]];
+                const raster_vertex<N>& c = vertices[tri[2]];
+
+                if(needs_clip & (1u << t))
+                {
+                    if(stats)
+                        stats->triangles_clipped++;
+
+                    uint32_t outcode_union = outcodes[tri[0]] | outcodes[tri[1]] | outcodes[tri[2]];
+                    raster_clipped_triangle<N>(fb, a, b, c, outcode_union, cull_backfaces, fragment, stats);
+                }
+                else
+                {
+                    raster_triangle<N>(fb, a, b, c, cull_backfaces, fragment, stats);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,210 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Clustered light assignment (forward+).
+
+
+    Why clusters -
+        Tiled deferred (raster/deferred.cpp) gets each tile's depth range from the depth buffer. A forward pass shades while it rasterizes, before
+        the depth buffer is finished, and transparent surfaces don't write depth at all, so there is nothing to bound the tiles with. Instead the
+        frustum itself is cut into depth slices as well as screen tiles. Every froxel (frustum voxel) is small in all three directions, so its light
+        list is short no matter what the geometry looks like, and a fragment finds its list from its own view space position.
+
+
+    Slices -
+        Slice boundaries are spaced exponentially between the projection's near and far planes, distance_k = near * (far / near)^(k / slices).
+        That keeps froxels roughly cube shaped (a tile grows linearly with distance, so the slices have to as well), and the slice of a distance is
+        a log, a multiply and an add.
+
+
+    Assignment -
+        Each light's screen tile range comes from light_tile_rect, and its depth range gives the slices it spans. Within those, the light's sphere
+        is tested against each froxel's view space bounding box. Slices are independent, so every slice is a job that builds its own lists (count,
+        prefix sum, fill like bin_lights), and the slices are concatenated in order at the end, which makes the global index slice major.
+
+        The froxel boxes assume a symmetric projection (no off center terms), which is what gen_perspective_proj makes.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "cluster.h"
+#include <cstring>
+
+namespace br
+{
+    //Near and far plane distances of a gen_perspective_proj matrix
+    void perspective_depth_range(const lnal::mat4& projection, float& near_plane, float& far_plane)
+    {
+        //m[10] = -(far + near) / (far - near), m[14] = -2 far near / (far - near)
+        const float* m = projection.data();
+        near_plane = m[14] / (m[10] - 1.0f);
+        far_plane = m[14] / (m[10] + 1.0f);
+    }
+
+    //View space box of one froxel
+    struct froxel_box
+    {
+        float min[3];
+        float max[3];
+    };
+
+    static froxel_box make_froxel(const light_clusters& c, uint32_t tx, uint32_t ty, float near_distance, float far_distance)
+    {
+        const float* m = c.projection.data();
+
+        //Tile edges in NDC (y up)
+        float x0 = ((float)(tx * c.tile_size) / c.width) * 2.0f - 1.0f;
+        float x1 = (fminf((float)((tx + 1) * c.tile_size), (float)c.width) / c.width) * 2.0f - 1.0f;
+        float y0 = 1.0f - (fminf((float)((ty + 1) * c.tile_size), (float)c.height) / c.height) * 2.0f;
+        float y1 = 1.0f - ((float)(ty * c.tile_size) / c.height) * 2.0f;
+
+        //x_view = ndc_x * distance / m[0], the extremes are at the near or far distance
+        froxel_box box;
+        box.min[0] = fminf(x0 * near_distance, x0 * far_distance) / m[0];
+        box.max[0] = fmaxf(x1 * near_distance, x1 * far_distance) / m[0];
+        box.min[1] = fminf(y0 * near_distance, y0 * far_distance) / m[5];
+        box.max[1] = fmaxf(y1 * near_distance, y1 * far_distance) / m[5];
+        box.min[2] = -far_distance;
+        box.max[2] = -near_distance;
+
+        return box;
+    }
+
+    static inline bool sphere_touches_box(const point_light& light, const froxel_box& box)
+    {
+        float d2 = 0.0f;
+        for(int k = 0; k < 3; k++)
+        {
+            float p = light.position[k];
+            float e = p < box.min[k] ? box.min[k] - p : (p > box.max[k] ? p - box.max[k] : 0.0f);
+            d2 += e * e;
+        }
+
+        return d2 <= light.radius * light.radius;
+    }
+
+    //Builds one slice's lists (local cluster index = y * tiles_x + x)
+    static void assign_slice(light_clusters& c, uint32_t slice, const point_light* lights, uint32_t count)
+    {
+        float near_distance = expf(((float)slice - c.slice_bias) / c.slice_scale);
+        float far_distance = expf(((float)slice + 1.0f - c.slice_bias) / c.slice_scale);
+
+        uint32_t tile_count = c.tiles_x * c.tiles_y;
+        std::vector<uint32_t>& offsets = c.slice_offsets[slice];
+        std::vector<uint32_t>& indices = c.slice_indices[slice];
+        offsets.assign(tile_count + 1, 0);
+
+        //Count, then fill through running cursors like bin_lights. The box tests are cheap enough to do twice.
+        for(uint32_t pass = 0; pass < 2; pass++)
+        {
+            for(uint32_t i = 0; i < count; i++)
+            {
+                const point_light& light = lights[i];
+                const tile_rect& rect = c.rects[i];
+
+                float distance = -light.position[2];
+                if(rect.x0 > rect.x1 || distance + light.radius < near_distance || distance - light.radius > far_distance)
+                    continue;
+
+                for(int32_t y = rect.y0; y <= rect.y1; y++)
+                {
+                    for(int32_t x = rect.x0; x <= rect.x1; x++)
+                    {
+                        if(!sphere_touches_box(light, make_froxel(c, x, y, near_distance, far_distance)))
+                            continue;
+
+                        uint32_t tile = (uint32_t)y * c.tiles_x + (uint32_t)x;
+                        if(pass == 0)
+                            offsets[tile + 1]++;
+                        else
+                            indices[offsets[tile]++] = i;
+                    }
+                }
+            }
+
+            if(pass == 0)
+            {
+                for(uint32_t t = 0; t < tile_count; t++)
+                {
+                    offsets[t + 1] += offsets[t];
+                }
+
+                indices.resize(offsets[tile_count]);
+            }
+        }
+
+        for(uint32_t t = tile_count; t > 0; t--)
+        {
+            offsets[t] = offsets[t - 1];
+        }
+        offsets[0] = 0;
+    }
+
+    //Rebuilds the per cluster light lists. Slices are assigned in parallel.
+    //@param lights view space (transform_lights)
+    //@param projection a gen_perspective_proj matrix, its near / far planes bound the slices
+    //@param js optional
+    void assign_lights(light_clusters& clusters, const point_light* lights, uint32_t count, const lnal::mat4& projection, uint32_t width, uint32_t height,
+                       job_system* js)
+    {
+        light_clusters& c = clusters;
+
+        c.width = width;
+        c.height = height;
+        c.projection = projection;
+        c.tiles_x = (width + c.tile_size - 1) / c.tile_size;
+        c.tiles_y = (height + c.tile_size - 1) / c.tile_size;
+
+        perspective_depth_range(projection, c.near_plane, c.far_plane);
+        c.slice_scale = (float)c.slices / logf(c.far_plane / c.near_plane);
+        c.slice_bias = -logf(c.near_plane) * c.slice_scale;
+
+        c.rects.resize(count);
+        parallel_for(js, count, 256, [&](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t i = begin; i < end; i++)
+            {
+                c.rects[i] = light_tile_rect(lights[i], projection, width, height, c.tile_size);
+            }
+        });
+
+        c.slice_offsets.resize(c.slices);
+        c.slice_indices.resize(c.slices);
+
+        parallel_for(js, c.slices, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t s = begin; s < end; s++)
+            {
+                assign_slice(c, s, lights, count);
+            }
+        });
+
+        //Concatenate the slices
+        uint32_t tile_count = c.tiles_x * c.tiles_y;
+        uint32_t total = 0;
+        for(uint32_t s = 0; s < c.slices; s++)
+        {
+            total += (uint32_t)c.slice_indices[s].size();
+        }
+
+        c.offsets.resize((size_t)tile_count * c.slices + 1);
+        c.indices.resize(total);
+
+        uint32_t base = 0;
+        for(uint32_t s = 0; s < c.slices; s++)
+        {
+            const std::vector<uint32_t>& offsets = c.slice_offsets[s];
+            const std::vector<uint32_t>& indices = c.slice_indices[s];
+
+            for(uint32_t t = 0; t < tile_count; t++)
+            {
+                c.offsets[(size_t)s * tile_count + t] = base + offsets[t];
+            }
+
+            if(!indices.empty())
+                memcpy(&c.indices[base], indices.data(), indices.size() * sizeof(uint32_t));
+
+            base += (uint32_t)indices.size();
+        }
+
+        c.offsets[(size_t)tile_count * c.slices] = base;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "light.h"
+#include "../math/lnal.h"
+#include "../core/job.h"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    //Froxel grid over the view frustum (screen tiles x exponential depth slices) with the lights touching each froxel
+    struct light_clusters
+    {
+        uint32_t tile_size = 32;
+        uint32_t slices = 24;
+
+        //Filled in by assign_lights
+        uint32_t tiles_x = 0;
+        uint32_t tiles_y = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        lnal::mat4 projection;
+        float near_plane = 0.0f;
+        float far_plane = 0.0f;
+
+        //slice = log(distance) * slice_scale + slice_bias
+        float slice_scale = 0.0f;
+        float slice_bias = 0.0f;
+
+        //Cluster c = (slice * tiles_y + y) * tiles_x + x, its lights are indices[offsets[c]] .. indices[offsets[c + 1] - 1]
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> indices;
+
+        //Per light tile ranges and per slice lists, kept between frames so assignment doesn't allocate in steady state
+        std::vector<tile_rect> rects;
+        std::vector<std::vector<uint32_t>> slice_offsets;
+        std::vector<std::vector<uint32_t>> slice_indices;
+    };
+
+    //Near and far plane distances of a gen_perspective_proj matrix
+    void perspective_depth_range(const lnal::mat4& projection, float& near_plane, float& far_plane);
+
+    //Depth slice of a view space distance, clamped to the grid
+    inline uint32_t cluster_slice(const light_clusters& c, float distance)
+    {
+        float slice = logf(fmaxf(distance, c.near_plane)) * c.slice_scale + c.slice_bias;
+        slice = fminf(fmaxf(slice, 0.0f), (float)(c.slices - 1));
+        return (uint32_t)slice;
+    }
+
+    //Cluster of a view space point, clamped to the grid (so points slightly off screen use the border clusters)
+    inline uint32_t cluster_of(const light_clusters& c, const float* p)
+    {
+        const float* m = c.projection.data();
+        float clip_x = (m[0] * p[0]) + (m[4] * p[1]) + (m[8] * p[2]) + m[12];
+        float clip_y = (m[1] * p[0]) + (m[5] * p[1]) + (m[9] * p[2]) + m[13];
+        float clip_w = fmaxf((m[3] * p[0]) + (m[7] * p[1]) + (m[11] * p[2]) + m[15], 1e-6f);
+
+        float x = ((clip_x / clip_w) * 0.5f + 0.5f) * c.width / c.tile_size;
+        float y = (0.5f - (clip_y / clip_w) * 0.5f) * c.height / c.tile_size;
+        uint32_t tx = (uint32_t)fminf(fmaxf(x, 0.0f), (float)(c.tiles_x - 1));
+        uint32_t ty = (uint32_t)fminf(fmaxf(y, 0.0f), (float)(c.tiles_y - 1));
+
+        return (cluster_slice(c, -p[2]) * c.tiles_y + ty) * c.tiles_x + tx;
+    }
+
+    //Rebuilds the per cluster light lists. Slices are assigned in parallel.
+    //@param lights view space (transform_lights)
+    //@param projection a gen_perspective_proj matrix, its near / far planes bound the slices
+    //@param js optional
+    void assign_lights(light_clusters& clusters, const point_light* lights, uint32_t count, const lnal::mat4& projection, uint32_t width, uint32_t height,
+                       job_system* js = nullptr);
+}
@@ -0,0 +1,99 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Sparse-set entity component storage for renderable objects.
+
+
+    Layout -
+        There are no entity objects. An entity is a 32 bit id and every component type is stored in its own component_pool, which is three flat arrays:
+            sparse - indexed by entity index, holds the slot of the entity's component (or INVALID)
+            dense  - packed list of entities that have the component
+            data   - packed component values, parallel to dense
+
+        Systems walk dense/data front to back, so iterating 100k transforms is a linear read over 100k matrices instead of hopping between heap objects.
+        Removal swaps the last element into the hole so the arrays never get gaps.
+
+        When several pools are iterated together, pool_sort_like can be used to line their dense arrays up with a lead pool. ecs_each checks for that case
+        first and only falls back to the sparse lookup for entities that are out of place.
+
+
+    Threading -
+        ecs_each hands out chunks of the lead pool to the job system. Each chunk only writes to the components of its own entities, so systems written
+        in the (entity, component&...) form are safe to run in parallel as long as they don't add or remove components while iterating.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "ecs.h"
+#include "scene_graph.h"
+
+namespace br
+{
+    //Number of entities handed to a job at a time in the built in systems
+    static const uint32_t SYSTEM_CHUNK_SIZE = 2048;
+
+    entity ecs_create(ecs_world& world)
+    {
+        uint32_t index;
+
+        if(!world.free_indices.empty())
+        {
+            index = world.free_indices.back();
+            world.free_indices.pop_back();
+        }
+        else
+        {
+            index = (uint32_t)world.generations.size();
+            world.generations.push_back(0);
+        }
+
+        world.alive++;
+
+        return index | ((uint32_t)world.generations[index] << ENTITY_GENERATION_SHIFT);
+    }
+
+    //Destroys e and removes all of its components. Old handles to e stop resolving.
+    void ecs_destroy(ecs_world& world, entity e)
+    {
+        if(!ecs_alive(world, e))
+            return;
+
+        pool_remove(world.transforms, e);
+        pool_remove(world.meshes, e);
+        pool_remove(world.materials, e);
+        pool_remove(world.bounds, e);
+        pool_remove(world.scene_nodes, e);
+
+        uint32_t index = entity_index(e);
+        world.generations[index]++;
+        world.free_indices.push_back(index);
+        world.alive--;
+    }
+
+    bool ecs_alive(const ecs_world& world, entity e)
+    {
+        uint32_t index = entity_index(e);
+        return index < world.generations.size() && world.generations[index] == entity_generation(e);
+    }
+
+    //Copies world matrices from the scene graph into the transform components of entities with a scene node
+    void ecs_sync_transforms(ecs_world& world, const scene_graph& graph, job_system* js)
+    {
+        ecs_each(js, SYSTEM_CHUNK_SIZE, [&graph](entity, uint32_t& node, transform_component& transform)
+        {
+            transform.world = graph.world[node];
+        }, world.scene_nodes, world.transforms);
+    }
+
+    //Moves every local bounding sphere into world space using the entity's transform
+    void ecs_update_bounds(ecs_world& world, job_system* js)
+    {
+        ecs_each(js, SYSTEM_CHUNK_SIZE, [](entity, bounds_component& b, transform_component& transform)
+        {
+            lnal::vec3 center = lnal::transform_point(transform.world, lnal::vec3(b.center[0], b.center[1], b.center[2]));
+
+            b.world_center[0] = center[0];
+            b.world_center[1] = center[1];
+            b.world_center[2] = center[2];
+            b.world_radius = b.radius * lnal::max_scale(transform.world);
+        }, world.bounds, world.transforms);
+    }
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include "../math/lnal.h"
+#include "../core/job.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace br
+{
+    struct scene_graph;
+
+    //Entities are just ids. Low 24 bits index the slot, high 8 bits are a generation that catches stale handles.
+    typedef uint32_t entity;
+
+    const entity NULL_ENTITY = 0xFFFFFFFF;
+    const uint32_t ENTITY_INDEX_MASK = 0x00FFFFFF;
+    const uint32_t ENTITY_GENERATION_SHIFT = 24;
+
+    inline uint32_t entity_index(entity e) { return e & ENTITY_INDEX_MASK; }
+    inline uint32_t entity_generation(entity e) { return e >> ENTITY_GENERATION_SHIFT; }
+
+    //Component data. Each type lives in its own tightly packed array (see component_pool)
+    //so a system only streams through the memory it actually touches.
+
+    struct transform_component
+    {
+        lnal::mat4 world;
+    };
+
+    struct mesh_component
+    {
+        uint32_t mesh;
+        uint32_t lod;
+    };
+
+    struct material_component
+    {
+        uint32_t material;
+    };
+
+    //Bounding sphere in local space and the same sphere moved into world space by ecs_update_bounds
+    struct bounds_component
+    {
+        float center[3];
+        float radius;
+        float world_center[3];
+        float world_radius;
+    };
+
+    //Sparse set storage for one component type.
+    //sparse maps an entity index to a slot in the dense arrays, dense/data are packed with no holes.
+    template<typename T>
+    struct component_pool
+    {
+        static constexpr uint32_t INVALID = 0xFFFFFFFF;
+
+        std::vector<uint32_t> sparse;
+        std::vector<entity> dense;
+        std::vector<T> data;
+    };
+
+    //Returns the dense slot of e in the pool or INVALID if e doesn't have the component
+    template<typename T>
+    inline uint32_t pool_find(const component_pool<T>& pool, entity e)
+    {
+        uint32_t index = entity_index(e);
+        if(index >= pool.sparse.size())
+            return component_pool<T>::INVALID;
+
+        uint32_t slot = pool.sparse[index];
+        if(slot == component_pool<T>::INVALID || pool.dense[slot] != e)
+            return component_pool<T>::INVALID;
+
+        return slot;
+    }
+
+    template<typename T>
+    inline bool pool_has(const component_pool<T>& pool, entity e)
+    {
+        return pool_find(pool, e) != component_pool<T>::INVALID;
+    }
+
+    //Adds (or overwrites) the component for e and returns a reference to it
+    template<typename T>
+    T& pool_add(component_pool<T>& pool, entity e, const T& value)
+    {
+        uint32_t slot = pool_find(pool, e);
+        if(slot != component_pool<T>::INVALID)
+        {
+            pool.data[slot] = value;
+            return pool.data[slot];
+        }
+
+        uint32_t index = entity_index(e);
+        if(index >= pool.sparse.size())
+            pool.sparse.resize(index + 1, component_pool<T>::INVALID);
+
+        pool.sparse[index] = (uint32_t)pool.dense.size();
+        pool.dense.push_back(e);
+        pool.data.push_back(value);
+
+        return pool.data.back();
+    }
+
+    //Removes the component by moving the last element into its slot (keeps the arrays packed)
+    template<typename T>
+    void pool_remove(component_pool<T>& pool, entity e)
+    {
+        uint32_t slot = pool_find(pool, e);
+        if(slot == component_pool<T>::INVALID)
+            return;
+
+        uint32_t last = (uint32_t)pool.dense.size() - 1;
+        if(slot != last)
+        {
+            pool.dense[slot] = pool.dense[last];
+            pool.data[slot] = std::move(pool.data[last]);
+            pool.sparse[entity_index(pool.dense[slot])] = slot;
+        }
+
+        pool.dense.pop_back();
+        pool.data.pop_back();
+        pool.sparse[entity_index(e)] = component_pool<T>::INVALID;
+    }
+
+    template<typename T>
+    inline T* pool_get(component_pool<T>& pool, entity e)
+    {
+        uint32_t slot = pool_find(pool, e);
+        return slot == component_pool<T>::INVALID ? nullptr : &pool.data[slot];
+    }
+
+    //Reorders pool so that entities shared with lead sit at the same dense slots as in lead (and in front).
+    //After this, iterating lead together with pool is a straight walk over both arrays with no sparse lookups.
+    template<typename T, typename L>
+    void pool_sort_like(component_pool<T>& pool, const component_pool<L>& lead)
+    {
+        uint32_t next = 0;
+
+        for(entity e : lead.dense)
+        {
+            uint32_t slot = pool_find(pool, e);
+            if(slot == component_pool<T>::INVALID)
+                continue;
+
+            if(slot != next)
+            {
+                entity other = pool.dense[next];
+                std::swap(pool.dense[slot], pool.dense[next]);
+                std::swap(pool.data[slot], pool.data[next]);
+                pool.sparse[entity_index(e)] = next;
+                pool.sparse[entity_index(other)] = slot;
+            }
+
+            next++;
+        }
+    }
+
+    //All entity bookkeeping plus one pool per component type
+    struct ecs_world
+    {
+        std::vector<uint8_t> generations;
+        std::vector<uint32_t> free_indices;
+        uint32_t alive = 0;
+
+        component_pool<transform_component> transforms;
+        component_pool<mesh_component> meshes;
+        component_pool<material_component> materials;
+        component_pool<bounds_component> bounds;
+
+        //Optional link from an entity to a node in a scene_graph (see ecs_sync_transforms)
+        component_pool<uint32_t> scene_nodes;
+    };
+
+    entity ecs_create(ecs_world& world);
+
+    //Destroys e and removes all of its components. Old handles to e stop resolving.
+    void ecs_destroy(ecs_world& world, entity e);
+
+    bool ecs_alive(const ecs_world& world, entity e);
+
+    //Expands the slot array back into component references (helper for ecs_each)
+    template<typename F, typename T, typename... R, size_t... I>
+    inline void ecs_invoke(F& fn, entity e, T& lead, const uint32_t* slots, std::index_sequence<I...>, component_pool<R>&... rest)
+    {
+        fn(e, lead, rest.data[slots[I]]...);
+    }
+
+    //Calls fn(e, a, b, ...) for every entity that has a component in every pool passed in.
+    //The first pool drives the iteration so pass the smallest one first. Work is split into chunks of
+    //chunk_size entities that run in parallel when a job system is given, so fn must be safe to run concurrently.
+    template<typename F, typename T, typename... R>
+    void ecs_each(job_system* js, uint32_t chunk_size, F fn, component_pool<T>& lead, component_pool<R>&... rest)
+    {
+        auto each = [&](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t i = begin; i < end; i++)
+            {
+                entity e = lead.dense[i];
+
+                //Pools sorted with pool_sort_like hit the first check and never touch the sparse arrays
+                uint32_t slots[sizeof...(R) + 1] = { (i < rest.dense.size() && rest.dense[i] == e ? i : pool_find(rest, e))... };
+
+                bool missing = false;
+                for(uint32_t s = 0; s < sizeof...(R); s++)
+                {
+                    missing |= slots[s] == component_pool<T>::INVALID;
+                }
+
+                if(missing)
+                    continue;
+
+                ecs_invoke(fn, e, lead.data[i], slots, std::index_sequence_for<R...>{}, rest...);
+            }
+        };
+
+        //A single reference fits in std::function's inline storage, capturing every pool directly would put it on the heap on every call
+        parallel_for(js, (uint32_t)lead.dense.size(), chunk_size, [&each](uint32_t begin, uint32_t end) { each(begin, end); });
+    }
+
+    //Copies world matrices from the scene graph into the transform components of entities with a scene node
+    void ecs_sync_transforms(ecs_world& world, const scene_graph& graph, job_system* js = nullptr);
+
+    //Moves every local bounding sphere into world space using the entity's transform
+    void ecs_update_bounds(ecs_world& world, job_system* js = nullptr);
+}
@@ -0,0 +1,60 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                View frustum planes and bounds tests used by the culling passes.
+
+
+    Plane Extraction -
+        A point p is inside clip space when -w <= x, y, z <= w. With M the clip-from-space matrix, x = row0 . p and w = row3 . p, so -w <= x turns into
+        (row3 + row0) . p >= 0, which is the equation of the left plane directly. The other five planes follow the same way (Gribb / Hartmann).
+        Remember the matrices are column-major so "row i" is every 4th float starting at i.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "frustum.h"
+#include <cmath>
+
+namespace br
+{
+    //Pulls the clip planes out of a combined matrix. Pass projection * view for world space planes
+    //or projection * view * model for object space planes.
+    void extract_frustum(frustum& f, const lnal::mat4& clip_from_space)
+    {
+        const float* m = clip_from_space.data();
+
+        for(int i = 0; i < 3; i++)
+        {
+            for(int k = 0; k < 4; k++)
+            {
+                float row_w = m[(k * 4) + 3];
+                float row_i = m[(k * 4) + i];
+
+                f.planes[i * 2][k] = row_w + row_i;
+                f.planes[(i * 2) + 1][k] = row_w - row_i;
+            }
+        }
+
+        //Normalize so plane distances are real distances (needed for the sphere radius compare)
+        for(int p = 0; p < 6; p++)
+        {
+            float len = sqrtf((f.planes[p][0] * f.planes[p][0]) + (f.planes[p][1] * f.planes[p][1]) + (f.planes[p][2] * f.planes[p][2]));
+
+            for(int k = 0; k < 4; k++)
+            {
+                f.planes[p][k] /= len;
+            }
+        }
+    }
+
+    //Returns false if the sphere is completely outside any plane
+    bool sphere_in_frustum(const frustum& f, const float* center, float radius)
+    {
+        for(int p = 0; p < 6; p++)
+        {
+            float d = (f.planes[p][0] * center[0]) + (f.planes[p][1] * center[1]) + (f.planes[p][2] * center[2]) + f.planes[p][3];
+            if(d < -radius)
+                return false;
+        }
+
+        return true;
+    }
+}
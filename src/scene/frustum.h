@@ -0,0 +1,19 @@
+#pragma once
+
+#include "../math/lnal.h"
+
+namespace br
+{
+    //Six clip planes (left, right, bottom, top, near, far) stored as (a, b, c, d) with the normal pointing inside
+    struct frustum
+    {
+        float planes[6][4];
+    };
+
+    //Pulls the clip planes out of a combined matrix. Pass projection * view for world space planes
+    //or projection * view * model for object space planes.
+    void extract_frustum(frustum& f, const lnal::mat4& clip_from_space);
+
+    //Returns false if the sphere is completely outside any plane
+    bool sphere_in_frustum(const frustum& f, const float* center, float radius);
+}
@@ -0,0 +1,179 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Point light binning for tiled shading.
+
+
+    Screen Bounds -
+        A light only touches pixels inside the projection of its bounding sphere. Projecting the 8 corners of the sphere's view space bounding box
+        gives a rectangle that always contains that projection (a little loose at the corners, which only costs a few extra tiles). If the box
+        reaches behind the camera the projection isn't bounded anymore and the light covers the whole screen, that only happens for lights the
+        camera is standing in.
+
+
+    Depth Bounds -
+        With the depth buffer of the frame, every tile knows the nearest and farthest surface it shows. A light whose sphere ends in front of the
+        nearest surface or starts behind the farthest one can't light anything in the tile, which removes most of the lights a screen rectangle
+        test lets through when lights are spread out in depth. Empty tiles (only background) get no lights at all.
+
+
+    Lists -
+        The lists are built as a counting sort: count the lights per tile, prefix sum the counts into offsets, then fill. Every tile's list ends up
+        in one flat array, which the GL backend uploads as is.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "light.h"
+#include <cmath>
+
+namespace br
+{
+    //Moves lights into view space (the space the lighting passes work in)
+    void transform_lights(const lnal::mat4& view, const point_light* lights, uint32_t count, point_light* out)
+    {
+        for(uint32_t i = 0; i < count; i++)
+        {
+            const float* p = lights[i].position;
+            lnal::vec3 v = lnal::transform_point(view, lnal::vec3(p[0], p[1], p[2]));
+
+            out[i] = lights[i];
+            out[i].position[0] = v[0];
+            out[i].position[1] = v[1];
+            out[i].position[2] = v[2];
+        }
+    }
+
+    //Tiles the screen rectangle of a view space light's bounding sphere covers. Lights behind the camera get an empty range, lights crossing the
+    //near plane the whole screen.
+    tile_rect light_tile_rect(const point_light& light, const lnal::mat4& projection, uint32_t width, uint32_t height, uint32_t tile_size)
+    {
+        int32_t tiles_x = (int32_t)((width + tile_size - 1) / tile_size);
+        int32_t tiles_y = (int32_t)((height + tile_size - 1) / tile_size);
+
+        tile_rect full = { 0, 0, tiles_x - 1, tiles_y - 1 };
+        tile_rect none = { 1, 1, 0, 0 };
+
+        const float* p = projection.data();
+
+        const float* c = light.position;
+        float r = light.radius;
+
+        //Entirely behind the camera
+        if(c[2] - r >= 0.0f)
+            return none;
+
+        float min_x = 1e30f, min_y = 1e30f, max_x = -1e30f, max_y = -1e30f;
+
+        for(uint32_t corner = 0; corner < 8; corner++)
+        {
+            float x = c[0] + ((corner & 1) ? r : -r);
+            float y = c[1] + ((corner & 2) ? r : -r);
+            float z = c[2] + ((corner & 4) ? r : -r);
+
+            float clip_x = (p[0] * x) + (p[4] * y) + (p[8] * z) + p[12];
+            float clip_y = (p[1] * x) + (p[5] * y) + (p[9] * z) + p[13];
+            float clip_w = (p[3] * x) + (p[7] * y) + (p[11] * z) + p[15];
+
+            if(clip_w <= 1e-6f)
+                return full;
+
+            min_x = fminf(min_x, clip_x / clip_w);
+            max_x = fmaxf(max_x, clip_x / clip_w);
+            min_y = fminf(min_y, clip_y / clip_w);
+            max_y = fmaxf(max_y, clip_y / clip_w);
+        }
+
+        if(min_x > 1.0f || max_x < -1.0f || min_y > 1.0f || max_y < -1.0f)
+            return none;
+
+        //NDC to pixels, y flipped so row 0 is the top of the image
+        float left = (min_x * 0.5f + 0.5f) * width;
+        float right = (max_x * 0.5f + 0.5f) * width;
+        float top = (0.5f - max_y * 0.5f) * height;
+        float bottom = (0.5f - min_y * 0.5f) * height;
+
+        tile_rect rect;
+        rect.x0 = (int32_t)fmaxf(0.0f, floorf(left / tile_size));
+        rect.y0 = (int32_t)fmaxf(0.0f, floorf(top / tile_size));
+        rect.x1 = (int32_t)fminf((float)(tiles_x - 1), floorf(right / tile_size));
+        rect.y1 = (int32_t)fminf((float)(tiles_y - 1), floorf(bottom / tile_size));
+
+        if(rect.x0 > rect.x1 || rect.y0 > rect.y1)
+            return none;
+
+        return rect;
+    }
+
+    static inline bool light_in_depth_range(const point_light& light, const float* tile_depth, uint32_t tile)
+    {
+        if(!tile_depth)
+            return true;
+
+        float distance = -light.position[2];
+        return distance - light.radius <= tile_depth[tile * 2 + 1] && distance + light.radius >= tile_depth[tile * 2];
+    }
+
+    //Bins view space lights into screen tiles by the screen rectangle of their bounding sphere. Lights behind the camera are dropped, lights
+    //crossing the near plane cover the whole screen.
+    //@param projection the camera's projection (view space to clip space)
+    //@param tile_depth optional view space depth range of each tile's geometry, 2 floats per tile (nearest, farthest distance in front of
+    //       the camera). Lights outside a tile's range are left out of its list, a tile with nearest > farthest gets no lights.
+    void bin_lights(light_tiles& tiles, const point_light* lights, uint32_t count, const lnal::mat4& projection, uint32_t width, uint32_t height,
+                    const float* tile_depth)
+    {
+        tiles.tiles_x = (width + tiles.tile_size - 1) / tiles.tile_size;
+        tiles.tiles_y = (height + tiles.tile_size - 1) / tiles.tile_size;
+        uint32_t tile_count = tiles.tiles_x * tiles.tiles_y;
+
+        std::vector<tile_rect>& rects = tiles.rects;
+        rects.resize(count);
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            rects[i] = light_tile_rect(lights[i], projection, width, height, tiles.tile_size);
+        }
+
+        tiles.offsets.assign(tile_count + 1, 0);
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            const tile_rect& rect = rects[i];
+            for(int32_t y = rect.y0; y <= rect.y1; y++)
+            {
+                for(int32_t x = rect.x0; x <= rect.x1; x++)
+                {
+                    uint32_t tile = (uint32_t)y * tiles.tiles_x + (uint32_t)x;
+                    if(light_in_depth_range(lights[i], tile_depth, tile))
+                        tiles.offsets[tile + 1]++;
+                }
+            }
+        }
+
+        for(uint32_t t = 0; t < tile_count; t++)
+        {
+            tiles.offsets[t + 1] += tiles.offsets[t];
+        }
+
+        tiles.indices.resize(tiles.offsets[tile_count]);
+
+        //Fill through a running cursor per tile (the start offsets), then shift them back
+        for(uint32_t i = 0; i < count; i++)
+        {
+            const tile_rect& rect = rects[i];
+            for(int32_t y = rect.y0; y <= rect.y1; y++)
+            {
+                for(int32_t x = rect.x0; x <= rect.x1; x++)
+                {
+                    uint32_t tile = (uint32_t)y * tiles.tiles_x + (uint32_t)x;
+                    if(light_in_depth_range(lights[i], tile_depth, tile))
+                        tiles.indices[tiles.offsets[tile]++] = i;
+                }
+            }
+        }
+
+        for(uint32_t t = tile_count; t > 0; t--)
+        {
+            tiles.offsets[t] = tiles.offsets[t - 1];
+        }
+        tiles.offsets[0] = 0;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../math/lnal.h"
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    //Point light with a finite range. The falloff reaches zero at radius so lights can be culled exactly.
+    struct point_light
+    {
+        float position[3];
+        float radius;
+        float color[3];     //Linear, already multiplied by the intensity
+    };
+
+    //Point light limited to a cone, with the same finite range falloff
+    struct spot_light
+    {
+        float position[3];
+        float direction[3]; //Unit length, the way the light shines
+        float range;
+        float cos_inner;    //Full intensity inside this angle
+        float cos_outer;    //Falls off smoothly to zero at this one
+        float color[3];
+    };
+
+    //Inclusive range of tiles, empty if x0 > x1
+    struct tile_rect
+    {
+        int32_t x0, y0, x1, y1;
+    };
+
+    //Square screen tiles with the list of lights touching each one. Tiles are numbered row by row from the top left of the image (the CPU
+    //rasterizer's pixel order).
+    struct light_tiles
+    {
+        uint32_t tile_size = 16;
+        uint32_t tiles_x = 0;
+        uint32_t tiles_y = 0;
+
+        //tiles_x * tiles_y + 1 entries, tile t's lights are indices[offsets[t]] .. indices[offsets[t + 1] - 1]
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> indices;
+
+        //Scratch kept between frames so binning doesn't allocate once the light count settles: each light's tile_rect, and the per tile
+        //depth range deferred_shade passes to bin_lights
+        std::vector<tile_rect> rects;
+        std::vector<float> depth_bounds;
+    };
+
+    //Moves lights into view space (the space the lighting passes work in)
+    void transform_lights(const lnal::mat4& view, const point_light* lights, uint32_t count, point_light* out);
+
+    //Tiles the screen rectangle of a view space light's bounding sphere covers. Lights behind the camera get an empty range, lights crossing the
+    //near plane the whole screen.
+    tile_rect light_tile_rect(const point_light& light, const lnal::mat4& projection, uint32_t width, uint32_t height, uint32_t tile_size);
+
+    //Bins view space lights into screen tiles by the screen rectangle of their bounding sphere. Lights behind the camera are dropped, lights
+    //crossing the near plane cover the whole screen.
+    //@param projection the camera's projection (view space to clip space)
+    //@param tile_depth optional view space depth range of each tile's geometry, 2 floats per tile (nearest, farthest distance in front of
+    //       the camera). Lights outside a tile's range are left out of its list, a tile with nearest > farthest gets no lights.
+    void bin_lights(light_tiles& tiles, const point_light* lights, uint32_t count, const lnal::mat4& projection, uint32_t width, uint32_t height,
+                    const float* tile_depth = nullptr);
+}
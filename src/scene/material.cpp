@@ -0,0 +1,183 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Materials.
+
+
+    Parameter Block -
+        Every material's parameters are one 64 byte material_params and the library keeps them in a single vector indexed by material id. The CPU
+        renderers read the vector directly (the deferred pass points its albedo table at it with a stride), the GL backend uploads it unchanged as
+        one buffer. Meshes carry the material id per vertex, so a mesh with many materials is still one draw: the shader fetches its parameters
+        with the id instead of the renderer setting uniforms per material.
+
+
+    Texture Arrays -
+        Binding textures per material would split that draw again. Instead images are grouped by size, every group becomes one texture array and a
+        material's texture slot stores (array << 16) | layer. All images of a size share the array's mip chain shape, which is what an array
+        needs. Most scenes have a handful of sizes, so a few array samplers cover every material.
+
+        Lots of small textures of assorted sizes would still mean lots of arrays. Those are better packed into atlas pages at import
+        (build_material_atlas in asset_load.h), the pages then go into arrays like any other texture.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "material.h"
+#include <iostream>
+
+namespace br
+{
+    //Adds the default material if the library is still empty
+    //@return its id, always 0
+    uint32_t material_default(material_library& lib)
+    {
+        if(lib.params.empty())
+        {
+            material_desc desc;
+            desc.name = "default";
+            material_add(lib, desc);
+        }
+        return 0;
+    }
+
+    static int32_t add_texture(material_library& lib, const std::string& path)
+    {
+        if(path.empty())
+            return -1;
+
+        auto found = lib.texture_by_path.find(path);
+        if(found != lib.texture_by_path.end())
+            return (int32_t)found->second;
+
+        uint32_t id = (uint32_t)lib.textures.size();
+        lib.textures.emplace_back();
+        lib.textures.back().path = path;
+        lib.texture_by_path.emplace(path, id);
+        return (int32_t)id;
+    }
+
+    //Adds a material. A material with the same name as one already in the library isn't added again.
+    //@return the material id
+    uint32_t material_add(material_library& lib, const material_desc& desc)
+    {
+        if(lib.params.empty() && desc.name != "default")
+            material_default(lib);
+
+        auto found = lib.by_name.find(desc.name);
+        if(found != lib.by_name.end())
+            return found->second;
+
+        material_params p = {};
+        for(int k = 0; k < 3; k++)
+        {
+            p.diffuse[k] = desc.diffuse[k];
+            p.specular[k] = desc.specular[k];
+            p.emission[k] = desc.emission[k];
+        }
+        p.diffuse[3] = desc.opacity;
+        p.specular[3] = desc.shininess;
+        p.illum = desc.illum;
+
+        for(uint32_t s = 0; s < MATERIAL_TEXTURE_SLOTS; s++)
+        {
+            p.textures[s] = MATERIAL_NO_TEXTURE;
+            lib.texture_refs.push_back(add_texture(lib, desc.textures[s]));
+        }
+
+        uint32_t id = (uint32_t)lib.params.size();
+        lib.params.push_back(p);
+        lib.names.push_back(desc.name);
+        lib.by_name.emplace(desc.name, id);
+        return id;
+    }
+
+    //@return the id of a named material, 0 (the default material) if there is none
+    uint32_t material_find(const material_library& lib, const char* name)
+    {
+        auto found = lib.by_name.find(name);
+        return found != lib.by_name.end() ? found->second : 0;
+    }
+
+    //Drops textures no material references anymore (e.g. the sources of an atlas) and renumbers texture_refs
+    void material_compact_textures(material_library& lib)
+    {
+        std::vector<int32_t> remap(lib.textures.size(), -1);
+        for(int32_t ref : lib.texture_refs)
+        {
+            if(ref >= 0)
+                remap[ref] = 0;
+        }
+
+        std::vector<material_texture> kept;
+        lib.texture_by_path.clear();
+        for(uint32_t t = 0; t < lib.textures.size(); t++)
+        {
+            if(remap[t] < 0)
+                continue;
+
+            remap[t] = (int32_t)kept.size();
+            lib.texture_by_path.emplace(lib.textures[t].path, (uint32_t)kept.size());
+            kept.push_back(std::move(lib.textures[t]));
+        }
+
+        lib.textures.swap(kept);
+        for(int32_t& ref : lib.texture_refs)
+        {
+            ref = ref >= 0 ? remap[ref] : -1;
+        }
+    }
+
+    //Groups the loaded textures by size into texture arrays and points every material's texture slots at their (array, layer). Textures
+    //that didn't load, and sizes past MATERIAL_MAX_ARRAYS, leave the slots empty.
+    void build_material_arrays(material_library& lib)
+    {
+        lib.arrays.clear();
+        uint32_t dropped = 0;
+
+        for(uint32_t t = 0; t < lib.textures.size(); t++)
+        {
+            material_texture& tex = lib.textures[t];
+            tex.array = MATERIAL_NO_TEXTURE;
+            tex.layer = 0;
+
+            if(tex.width == 0 || tex.height == 0)
+                continue;
+
+            //First array of this size with room left
+            uint32_t a = 0;
+            for(; a < lib.arrays.size(); a++)
+            {
+                const material_texture_array& array = lib.arrays[a];
+                if(array.width == tex.width && array.height == tex.height && array.layers.size() < MATERIAL_MAX_ARRAY_LAYERS)
+                    break;
+            }
+
+            if(a == lib.arrays.size())
+            {
+                if(a == MATERIAL_MAX_ARRAYS)
+                {
+                    dropped++;
+                    continue;
+                }
+
+                lib.arrays.push_back({ tex.width, tex.height, {} });
+            }
+
+            tex.array = a;
+            tex.layer = (uint32_t)lib.arrays[a].layers.size();
+            lib.arrays[a].layers.push_back(t);
+        }
+
+        if(dropped)
+            std::cerr << "Materials: " << dropped << " textures don't fit in " << MATERIAL_MAX_ARRAYS << " texture arrays and are left out" << std::endl;
+
+        for(uint32_t m = 0; m < lib.params.size(); m++)
+        {
+            for(uint32_t s = 0; s < MATERIAL_TEXTURE_SLOTS; s++)
+            {
+                int32_t ref = lib.texture_refs[(m * MATERIAL_TEXTURE_SLOTS) + s];
+                const material_texture* tex = ref >= 0 ? &lib.textures[ref] : nullptr;
+
+                lib.params[m].textures[s] = (tex && tex->array != MATERIAL_NO_TEXTURE) ? (tex->array << 16) | tex->layer : MATERIAL_NO_TEXTURE;
+            }
+        }
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "../texture/texture.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace br
+{
+    //Textures a material can reference
+    enum material_texture_slot
+    {
+        MATERIAL_DIFFUSE_MAP,       //map_Kd, multiplies the diffuse color
+        MATERIAL_NORMAL_MAP,        //norm / map_Bump, tangent space
+        MATERIAL_SPECULAR_MAP,      //map_Ks, multiplies the specular color
+        MATERIAL_TEXTURE_SLOTS
+    };
+
+    //Texture slot without a texture
+    static const uint32_t MATERIAL_NO_TEXTURE = 0xFFFFFFFF;
+
+    //Limits of the texture arrays: GL 3.3 guarantees 256 layers, and shaders pick the array with a chain of ifs over a fixed number of samplers
+    static const uint32_t MATERIAL_MAX_ARRAYS = 8;
+    static const uint32_t MATERIAL_MAX_ARRAY_LAYERS = 256;
+
+    //A material the way an .mtl file describes it. Texture paths are empty for unused slots.
+    struct material_desc
+    {
+        std::string name;
+        float diffuse[3] = { 0.8f, 0.8f, 0.8f };    //Kd
+        float specular[3] = { 0.0f, 0.0f, 0.0f };   //Ks
+        float emission[3] = { 0.0f, 0.0f, 0.0f };   //Ke
+        float shininess = 1.0f;                     //Ns
+        float opacity = 1.0f;                       //d
+        uint32_t illum = 2;
+        std::string textures[MATERIAL_TEXTURE_SLOTS];
+    };
+
+    //One material's parameters, laid out the same on the CPU and the GPU: 4 x 16 bytes, which is also the std140 layout of the matching GLSL
+    //struct, so the whole table is uploaded as one block and shaders index it with the material id.
+    struct material_params
+    {
+        float diffuse[4];       //rgb, a = opacity
+        float specular[4];      //rgb, a = shininess
+        float emission[4];      //rgb, a unused
+        uint32_t textures[MATERIAL_TEXTURE_SLOTS];  //(array << 16) | layer, MATERIAL_NO_TEXTURE if the slot is empty or its image didn't load
+        uint32_t illum;
+    };
+
+    static_assert(sizeof(material_params) == 64, "material_params has to match the GPU layout");
+
+    //Floats from one material's diffuse color to the next, e.g. deferred_lighting::albedo_stride
+    static const uint32_t MATERIAL_PARAMS_FLOATS = sizeof(material_params) / sizeof(float);
+
+    //One image referenced by the library's materials
+    struct material_texture
+    {
+        std::string path;
+
+        //Filled when the image is loaded (load_material_textures in asset_load.h), 0 x 0 if it couldn't be
+        texture image;
+        bool generated = false;         //Built at import (atlas pages) rather than loaded from path, path is only a name
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        //Where build_material_arrays put it
+        uint32_t array = MATERIAL_NO_TEXTURE;
+        uint32_t layer = 0;
+    };
+
+    //Images of the same size, one texture array on the GPU
+    struct material_texture_array
+    {
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint32_t> layers;   //Index into material_library::textures per layer
+    };
+
+    //Every material of a scene with its parameters in one contiguous block. Material 0 is a plain default used by faces without a material.
+    struct material_library
+    {
+        std::vector<std::string> names;
+        std::vector<material_params> params;    //Indexed by material id, uploaded as is
+
+        //Library texture index per material and slot, -1 for empty slots. params[m].textures is only valid after build_material_arrays.
+        std::vector<int32_t> texture_refs;
+
+        std::vector<material_texture> textures;
+        std::vector<material_texture_array> arrays;
+
+        std::unordered_map<std::string, uint32_t> by_name;
+        std::unordered_map<std::string, uint32_t> texture_by_path;
+    };
+
+    //Adds the default material if the library is still empty
+    //@return its id, always 0
+    uint32_t material_default(material_library& lib);
+
+    //Adds a material. A material with the same name as one already in the library isn't added again.
+    //@return the material id
+    uint32_t material_add(material_library& lib, const material_desc& desc);
+
+    //@return the id of a named material, 0 (the default material) if there is none
+    uint32_t material_find(const material_library& lib, const char* name);
+
+    inline uint32_t material_count(const material_library& lib) { return (uint32_t)lib.params.size(); }
+
+    //Drops textures no material references anymore (e.g. the sources of an atlas) and renumbers texture_refs
+    void material_compact_textures(material_library& lib);
+
+    //Groups the loaded textures by size into texture arrays and points every material's texture slots at their (array, layer). Textures
+    //that didn't load, and sizes past MATERIAL_MAX_ARRAYS, leave the slots empty.
+    void build_material_arrays(material_library& lib);
+
+    //Bytes of the parameter block
+    inline size_t material_block_bytes(const material_library& lib) { return lib.params.size() * sizeof(material_params); }
+}
@@ -0,0 +1,294 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Flat transform hierarchy with dirty-flag propagation.
+
+
+    Memory -
+        Every node property lives in its own array indexed by node id (parent, local, world, etc.). Nodes are stored in depth-first pre-order, which gives us
+        two guarantees:
+            1. parent[i] < i, so walking the arrays front to back always sees a parent's world matrix before its children need it.
+            2. The subtree of node i is exactly the range [i, subtree_end[i]).
+
+        Because of (2), updating a dirty node means recomputing one contiguous block of matrices with a single linear pass and no pointer chasing.
+
+
+    Dirty Tracking -
+        scene_set_local only records the node in dirty_nodes. scene_update sorts that list and throws away any node that is already covered by an earlier
+        range (a dirty ancestor recomputes it anyway). What is left is a set of disjoint ranges whose roots have clean parents, so each range can be handed to
+        a different thread. A static scene has an empty dirty list and the update returns immediately.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "scene_graph.h"
+#include "../core/job.h"
+#include <algorithm>
+#include <cassert>
+
+namespace br
+{
+    //Ranges bigger than this get broken up into their child subtrees so one huge dirty subtree can still use every thread
+    static const uint32_t SPLIT_SIZE = 4096;
+
+    //Adds a node to the graph and returns its index
+    //@param parent index of the parent node or -1 for a root
+    //@param local local-to-parent transform
+    uint32_t scene_add_node(scene_graph& graph, int32_t parent, const lnal::mat4& local)
+    {
+        uint32_t index = (uint32_t)graph.parent.size();
+        assert(parent < (int32_t)index);
+
+        graph.parent.push_back(parent);
+        graph.subtree_end.push_back(index + 1);
+        graph.local.push_back(local);
+        graph.world.push_back(local);
+        graph.dirty.push_back(0);
+
+        if(parent >= 0)
+        {
+            //Appending only keeps pre-order if the parent's subtree is the last thing in the arrays.
+            //In that case every ancestor's subtree also ends here and just grows by one.
+            if(graph.subtree_end[parent] == index)
+            {
+                for(int32_t a = parent; a >= 0; a = graph.parent[a])
+                {
+                    graph.subtree_end[a] = index + 1;
+                }
+            }
+            else
+            {
+                graph.sorted = false;
+            }
+        }
+
+        scene_mark_dirty(graph, index);
+
+        return index;
+    }
+
+    //Replaces the local transform of a node and flags its subtree for update
+    void scene_set_local(scene_graph& graph, uint32_t node, const lnal::mat4& local)
+    {
+        graph.local[node] = local;
+        scene_mark_dirty(graph, node);
+    }
+
+    //Flags a node's subtree for update after its local transform was modified in place
+    void scene_mark_dirty(scene_graph& graph, uint32_t node)
+    {
+        if(graph.dirty[node])
+            return;
+
+        graph.dirty[node] = 1;
+        graph.dirty_nodes.push_back(node);
+    }
+
+    //Reorders nodes into depth-first pre-order so subtrees are contiguous again
+    //@return table mapping old node index -> new node index
+    std::vector<uint32_t> scene_sort(scene_graph& graph)
+    {
+        uint32_t count = (uint32_t)graph.parent.size();
+
+        //Children lists in compressed form (first_child offsets into one array) to avoid a vector per node
+        std::vector<uint32_t> child_count(count + 1, 0);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            if(graph.parent[i] >= 0)
+                child_count[graph.parent[i] + 1]++;
+        }
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            child_count[i + 1] += child_count[i];
+        }
+
+        std::vector<uint32_t> children(count);
+        std::vector<uint32_t> fill(child_count.begin(), child_count.end() - 1);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            if(graph.parent[i] >= 0)
+                children[fill[graph.parent[i]]++] = i;
+        }
+
+        //Iterative depth-first walk from every root in original order
+        std::vector<uint32_t> order;
+        order.reserve(count);
+        std::vector<uint32_t> stack;
+
+        for(uint32_t r = 0; r < count; r++)
+        {
+            if(graph.parent[r] >= 0)
+                continue;
+
+            stack.push_back(r);
+            while(!stack.empty())
+            {
+                uint32_t n = stack.back();
+                stack.pop_back();
+                order.push_back(n);
+
+                //Push in reverse so the first child is visited first
+                for(uint32_t c = child_count[n + 1]; c > child_count[n]; c--)
+                {
+                    stack.push_back(children[c - 1]);
+                }
+            }
+        }
+
+        std::vector<uint32_t> remap(count);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            remap[order[i]] = i;
+        }
+
+        std::vector<int32_t> parent(count);
+        std::vector<lnal::mat4> local(count);
+        std::vector<lnal::mat4> world(count);
+        std::vector<uint8_t> dirty(count);
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            uint32_t old = order[i];
+            parent[i] = graph.parent[old] >= 0 ? (int32_t)remap[graph.parent[old]] : -1;
+            local[i] = graph.local[old];
+            world[i] = graph.world[old];
+            dirty[i] = graph.dirty[old];
+        }
+
+        //Walk backwards so children have their ranges before their parents need them
+        std::vector<uint32_t> subtree_end(count);
+        for(uint32_t i = count; i > 0; i--)
+        {
+            uint32_t n = i - 1;
+            if(subtree_end[n] == 0)
+                subtree_end[n] = n + 1;
+
+            if(parent[n] >= 0 && subtree_end[parent[n]] < subtree_end[n])
+                subtree_end[parent[n]] = subtree_end[n];
+        }
+
+        for(uint32_t& d : graph.dirty_nodes)
+        {
+            d = remap[d];
+        }
+
+        graph.parent = std::move(parent);
+        graph.subtree_end = std::move(subtree_end);
+        graph.local = std::move(local);
+        graph.world = std::move(world);
+        graph.dirty = std::move(dirty);
+        graph.sorted = true;
+
+        return remap;
+    }
+
+    //Recomputes one contiguous block of world matrices. The parent of range.begin must already be up to date.
+    static void update_range(scene_graph& graph, node_range range)
+    {
+        for(uint32_t i = range.begin; i < range.end; i++)
+        {
+            int32_t p = graph.parent[i];
+            graph.world[i] = p < 0 ? graph.local[i] : graph.world[p] * graph.local[i];
+        }
+    }
+
+    //Fallback when the arrays are not in pre-order. Parents still come before children so one pass with propagated flags works, it just has to visit every node.
+    static void update_unsorted(scene_graph& graph)
+    {
+        uint32_t count = (uint32_t)graph.parent.size();
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            int32_t p = graph.parent[i];
+            if(p >= 0 && graph.dirty[p])
+                graph.dirty[i] = 1;
+
+            if(graph.dirty[i])
+                graph.world[i] = p < 0 ? graph.local[i] : graph.world[p] * graph.local[i];
+        }
+
+        std::fill(graph.dirty.begin(), graph.dirty.end(), 0);
+        graph.dirty_nodes.clear();
+    }
+
+    //Recomputes world transforms of every dirty subtree.
+    //Independent subtrees are spread over the job system when one is given.
+    //If nothing changed since the last call this does no work at all.
+    void scene_update(scene_graph& graph, job_system* js)
+    {
+        if(graph.dirty_nodes.empty())
+            return;
+
+        if(!graph.sorted)
+        {
+            update_unsorted(graph);
+            return;
+        }
+
+        std::sort(graph.dirty_nodes.begin(), graph.dirty_nodes.end());
+
+        //Collapse the dirty list into disjoint ranges. Pre-order ranges either nest or don't overlap,
+        //so anything starting before the current end is inside the current range.
+        std::vector<node_range>& ranges = graph.update_ranges;
+        std::vector<node_range>& work = graph.update_work;
+        ranges.clear();
+        work.clear();
+
+        uint32_t covered_end = 0;
+        uint32_t total = 0;
+
+        for(uint32_t d : graph.dirty_nodes)
+        {
+            graph.dirty[d] = 0;
+
+            if(d < covered_end)
+                continue;
+
+            covered_end = graph.subtree_end[d];
+            ranges.push_back({ d, covered_end });
+            total += covered_end - d;
+        }
+
+        graph.dirty_nodes.clear();
+
+        if(js == nullptr || total <= SPLIT_SIZE)
+        {
+            for(const node_range& r : ranges)
+            {
+                update_range(graph, r);
+            }
+
+            return;
+        }
+
+        //Split big ranges: update the range root here, then each child subtree becomes its own independent range
+        while(!ranges.empty())
+        {
+            node_range r = ranges.back();
+            ranges.pop_back();
+
+            if(r.end - r.begin <= SPLIT_SIZE)
+            {
+                work.push_back(r);
+                continue;
+            }
+
+            update_range(graph, { r.begin, r.begin + 1 });
+
+            for(uint32_t c = r.begin + 1; c < r.end; c = graph.subtree_end[c])
+            {
+                ranges.push_back({ c, graph.subtree_end[c] });
+            }
+        }
+
+        //A few chunks per thread keeps the load balanced without queueing one job per tiny subtree
+        uint32_t chunk = (uint32_t)work.size() / (job_thread_count(js) * 4);
+
+        parallel_for(js, (uint32_t)work.size(), chunk, [&graph, &work](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t i = begin; i < end; i++)
+            {
+                update_range(graph, work[i]);
+            }
+        });
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../math/lnal.h"
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    struct job_system;
+
+    //Nodes [begin, end), a subtree when end is the subtree_end of begin
+    struct node_range
+    {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    //Transform hierarchy stored as flat arrays (one entry per node) instead of a tree of pointers.
+    //Nodes are kept in depth-first pre-order so a parent always comes before its children
+    //and every subtree is one contiguous range [i, subtree_end[i]).
+    struct scene_graph
+    {
+        std::vector<int32_t> parent;        //Index of the parent node, -1 for roots
+        std::vector<uint32_t> subtree_end;  //One past the last descendant of the node
+        std::vector<lnal::mat4> local;      //Local-to-parent transform
+        std::vector<lnal::mat4> world;      //Local-to-world transform (valid after scene_update)
+
+        std::vector<uint8_t> dirty;         //1 if the node is already in dirty_nodes
+        std::vector<uint32_t> dirty_nodes;  //Nodes whose local transform changed since the last update
+
+        //scene_update's dirty ranges and the subtrees it hands the job system, kept so an animated scene doesn't allocate every frame
+        std::vector<node_range> update_ranges;
+        std::vector<node_range> update_work;
+
+        //False if nodes were appended out of pre-order (call scene_sort to fix)
+        bool sorted = true;
+    };
+
+    //Adds a node to the graph and returns its index
+    //@param parent index of the parent node or -1 for a root
+    //@param local local-to-parent transform
+    uint32_t scene_add_node(scene_graph& graph, int32_t parent, const lnal::mat4& local);
+
+    //Replaces the local transform of a node and flags its subtree for update
+    void scene_set_local(scene_graph& graph, uint32_t node, const lnal::mat4& local);
+
+    //Flags a node's subtree for update after its local transform was modified in place
+    void scene_mark_dirty(scene_graph& graph, uint32_t node);
+
+    //Reorders nodes into depth-first pre-order so subtrees are contiguous again
+    //@return table mapping old node index -> new node index
+    std::vector<uint32_t> scene_sort(scene_graph& graph);
+
+    //Recomputes world transforms of every dirty subtree.
+    //Independent subtrees are spread over the job system when one is given.
+    //If nothing changed since the last call this does no work at all.
+    void scene_update(scene_graph& graph, job_system* js = nullptr);
+}
@@ -0,0 +1,326 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Texture atlases, many small textures packed into a few large pages at import time.
+
+
+    Skyline Packing -
+        The packer keeps the top outline of everything placed so far as a list of horizontal segments (the skyline). A new rectangle goes where its
+        top edge ends up lowest, resting on the highest segment under it; ties go to the narrower segment, which wastes less of the outline.
+        Rectangles are placed tallest first. It's not as tight as MaxRects but it only tracks one outline instead of every free rectangle, and with
+        similar sized textures the difference is a few percent.
+
+
+    Gutters -
+        Bilinear filtering at a texture's border reads one texel past it, and every mip level halves the distance the gutter reaches. A page keeps
+        mip_levels levels, and every texture gets padding << (mip_levels - 1) texels of gutter with its cell aligned to 1 << (mip_levels - 1), so
+        at the last kept level there are still padding texels of gutter and no 2x2 box of a lower level straddles two textures. Levels below that
+        would mix neighbours, so the pages stop there. The gutters repeat the texture (wrapped copies of the opposite edge), which is what the
+        original texture's repeat addressing filtered in.
+
+        Remapped uvs can't repeat anymore, so only textures a mesh samples inside [0, 1] can go into an atlas.
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "atlas.h"
+#include <algorithm>
+
+namespace br
+{
+    struct skyline_node
+    {
+        uint32_t x, y, width;
+    };
+
+    //Pages being filled
+    struct skyline_page
+    {
+        std::vector<skyline_node> nodes;
+    };
+
+    static uint32_t round_up(uint32_t value, uint32_t multiple)
+    {
+        return ((value + multiple - 1) / multiple) * multiple;
+    }
+
+    //Base level texels of gutter on each side of a texture, also the alignment of every rect: padding << (mip_levels - 1)
+    uint32_t atlas_gutter(const atlas_settings& settings)
+    {
+        uint32_t levels = settings.mip_levels ? settings.mip_levels : 1;
+        return (settings.padding ? settings.padding : 1) << (levels - 1);
+    }
+
+    //Lowest y a w x h rectangle can rest at with its left edge on node i
+    //@return false if it runs off the page
+    static bool skyline_fit(const std::vector<skyline_node>& nodes, size_t i, uint32_t w, uint32_t h, uint32_t page_width, uint32_t page_height, uint32_t& y)
+    {
+        if(nodes[i].x + w > page_width)
+            return false;
+
+        //The nodes cover the whole page width, so the loop ends before running out of them
+        y = 0;
+        uint32_t left = w;
+        for(size_t j = i; left > 0; j++)
+        {
+            y = nodes[j].y > y ? nodes[j].y : y;
+            if(y + h > page_height)
+                return false;
+
+            left -= nodes[j].width < left ? nodes[j].width : left;
+        }
+
+        return true;
+    }
+
+    //Raises the skyline over a rectangle placed at (x, y) on node i
+    static void skyline_add(std::vector<skyline_node>& nodes, size_t i, uint32_t x, uint32_t y, uint32_t w, uint32_t h)
+    {
+        nodes.insert(nodes.begin() + i, { x, y + h, w });
+        uint32_t end = x + w;
+
+        //Cut the nodes the rectangle now covers
+        while(i + 1 < nodes.size() && nodes[i + 1].x < end)
+        {
+            skyline_node& next = nodes[i + 1];
+            uint32_t covered = end - next.x;
+            if(next.width <= covered)
+            {
+                nodes.erase(nodes.begin() + i + 1);
+                continue;
+            }
+
+            next.x += covered;
+            next.width -= covered;
+            break;
+        }
+
+        for(size_t j = 0; j + 1 < nodes.size();)
+        {
+            if(nodes[j].y == nodes[j + 1].y)
+            {
+                nodes[j].width += nodes[j + 1].width;
+                nodes.erase(nodes.begin() + j + 1);
+            }
+            else
+            {
+                j++;
+            }
+        }
+    }
+
+    //Places a rectangle where its top edge ends up lowest
+    //@return false if there's no room left
+    static bool skyline_insert(std::vector<skyline_node>& nodes, uint32_t w, uint32_t h, uint32_t page_width, uint32_t page_height, uint32_t& x, uint32_t& y)
+    {
+        size_t best = nodes.size();
+        uint32_t best_top = UINT32_MAX, best_width = UINT32_MAX, best_y = 0;
+
+        for(size_t i = 0; i < nodes.size(); i++)
+        {
+            uint32_t fit_y;
+            if(!skyline_fit(nodes, i, w, h, page_width, page_height, fit_y))
+                continue;
+
+            uint32_t top = fit_y + h;
+            if(top < best_top || (top == best_top && nodes[i].width < best_width))
+            {
+                best = i;
+                best_top = top;
+                best_width = nodes[i].width;
+                best_y = fit_y;
+            }
+        }
+
+        if(best == nodes.size())
+            return false;
+
+        x = nodes[best].x;
+        y = best_y;
+        skyline_add(nodes, best, x, y, w, h);
+        return true;
+    }
+
+    //Skyline bottom left packing of rectangles into as few pages as possible. A single page shrinks to the smallest power of two size that
+    //holds everything and is then trimmed to what it uses, with more than one page every page is max_size.
+    //@param widths, heights base level size of each texture, at most max_size minus the gutters
+    //@return false if a texture is too big for a page
+    bool atlas_pack(atlas_layout& layout, const uint32_t* widths, const uint32_t* heights, uint32_t count, const atlas_settings& settings)
+    {
+        uint32_t gutter = atlas_gutter(settings);
+        uint32_t align = 1u << ((settings.mip_levels ? settings.mip_levels : 1) - 1);
+
+        layout = atlas_layout();
+        layout.rects.resize(count);
+
+        //Cells: the texture, its gutter on both sides, rounded up to the alignment
+        std::vector<uint32_t> cell_w(count), cell_h(count), order(count);
+        uint32_t largest = align;
+        for(uint32_t i = 0; i < count; i++)
+        {
+            cell_w[i] = round_up(widths[i] + (2 * gutter), align);
+            cell_h[i] = round_up(heights[i] + (2 * gutter), align);
+            largest = std::max(largest, std::max(cell_w[i], cell_h[i]));
+
+            layout.texture_area += (uint64_t)widths[i] * heights[i];
+            layout.padded_area += (uint64_t)cell_w[i] * cell_h[i];
+            order[i] = i;
+            layout.rects[i] = { 0, 0, 0, widths[i], heights[i] };
+        }
+
+        if(largest > settings.max_size)
+            return false;
+
+        if(count == 0)
+            return true;
+
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+        {
+            return cell_h[a] != cell_h[b] ? cell_h[a] > cell_h[b] : (cell_w[a] != cell_w[b] ? cell_w[a] > cell_w[b] : a < b);
+        });
+
+        auto place_all = [&](uint32_t page_width, uint32_t page_height, bool grow_pages)
+        {
+            std::vector<skyline_page> pages;
+
+            for(uint32_t i : order)
+            {
+                bool placed = false;
+                for(uint32_t p = 0; p < pages.size() && !placed; p++)
+                {
+                    uint32_t x, y;
+                    if(skyline_insert(pages[p].nodes, cell_w[i], cell_h[i], page_width, page_height, x, y))
+                    {
+                        layout.rects[i].page = p;
+                        layout.rects[i].x = x + gutter;
+                        layout.rects[i].y = y + gutter;
+                        placed = true;
+                    }
+                }
+
+                if(!placed)
+                {
+                    if(!pages.empty() && !grow_pages)
+                        return false;
+
+                    pages.push_back({ { { 0, 0, page_width } } });
+
+                    uint32_t x, y;
+                    skyline_insert(pages.back().nodes, cell_w[i], cell_h[i], page_width, page_height, x, y);
+                    layout.rects[i].page = (uint32_t)pages.size() - 1;
+                    layout.rects[i].x = x + gutter;
+                    layout.rects[i].y = y + gutter;
+                }
+            }
+
+            layout.page_width = page_width;
+            layout.page_height = page_height;
+            layout.page_count = (uint32_t)pages.size();
+            return true;
+        };
+
+        //Smallest single page first: a power of two square at least as big as the largest cell, widened then doubled until everything fits
+        uint32_t size = 1;
+        while(size < largest)
+        {
+            size *= 2;
+        }
+
+        uint32_t page_width = size, page_height = size;
+        while((uint64_t)page_width * page_height < layout.padded_area)
+        {
+            if(page_width == page_height)
+                page_width *= 2;
+            else
+                page_height *= 2;
+        }
+
+        bool packed = false;
+        while(!packed && page_width <= settings.max_size && page_height <= settings.max_size)
+        {
+            packed = place_all(page_width, page_height, false);
+            if(page_width == page_height)
+                page_width *= 2;
+            else
+                page_height *= 2;
+        }
+
+        if(!packed)
+        {
+            place_all(settings.max_size, settings.max_size, true);
+        }
+        else
+        {
+            //A single page only needs to reach the farthest cell. Sizes stay multiples of the alignment so the kept levels still halve exactly.
+            uint32_t right = 0, top = 0;
+            for(uint32_t i = 0; i < count; i++)
+            {
+                right = std::max(right, layout.rects[i].x - gutter + cell_w[i]);
+                top = std::max(top, layout.rects[i].y - gutter + cell_h[i]);
+            }
+
+            layout.page_width = round_up(right, align);
+            layout.page_height = round_up(top, align);
+        }
+
+        layout.page_area = (uint64_t)layout.page_width * layout.page_height * layout.page_count;
+        return true;
+    }
+
+    //Copies the textures placed on a page into it and builds its mip chain, mip_levels deep. Gutters repeat the texture's opposite edge, so
+    //filtering near a texture's border blends the same texels the repeat wrapped original would.
+    //@param sources texture per rect of the layout, null leaves its area transparent black
+    void atlas_compose(texture& page, const atlas_layout& layout, uint32_t page_index, const texture* const* sources, const atlas_settings& settings,
+                       texture_layout memory_layout)
+    {
+        uint32_t gutter = atlas_gutter(settings);
+        uint32_t align = 1u << ((settings.mip_levels ? settings.mip_levels : 1) - 1);
+
+        std::vector<uint32_t> pixels((size_t)layout.page_width * layout.page_height, 0);
+        std::vector<uint32_t> rows;
+
+        for(size_t i = 0; i < layout.rects.size(); i++)
+        {
+            const atlas_rect& r = layout.rects[i];
+            if(r.page != page_index || !sources[i] || sources[i]->levels.empty())
+                continue;
+
+            texture_read_level(*sources[i], 0, rows);
+
+            //The whole cell, gutter and alignment slack included
+            uint32_t cell_w = round_up(r.width + (2 * gutter), align);
+            uint32_t cell_h = round_up(r.height + (2 * gutter), align);
+
+            for(uint32_t cy = 0; cy < cell_h; cy++)
+            {
+                uint32_t py = r.y - gutter + cy;
+                uint32_t sy = ((cy + r.height) - (gutter % r.height)) % r.height;
+
+                for(uint32_t cx = 0; cx < cell_w; cx++)
+                {
+                    uint32_t px = r.x - gutter + cx;
+                    uint32_t sx = ((cx + r.width) - (gutter % r.width)) % r.width;
+                    pixels[((size_t)py * layout.page_width) + px] = rows[((size_t)sy * r.width) + sx];
+                }
+            }
+        }
+
+        texture_create(page, layout.page_width, layout.page_height, pixels.data(), memory_layout, MIP_BOX);
+
+        //Lower levels would blend neighbouring textures
+        uint32_t levels = settings.mip_levels ? settings.mip_levels : 1;
+        if(page.levels.size() > levels)
+        {
+            page.texels.resize(page.levels[levels].offset);
+            page.levels.resize(levels);
+        }
+    }
+
+    //Maps a texture coordinate in [0, 1] of packed texture i to its page: atlas uv = uv * scale + offset
+    void atlas_uv_transform(const atlas_layout& layout, uint32_t i, float* scale, float* offset)
+    {
+        const atlas_rect& r = layout.rects[i];
+        scale[0] = (float)r.width / (float)layout.page_width;
+        scale[1] = (float)r.height / (float)layout.page_height;
+        offset[0] = (float)r.x / (float)layout.page_width;
+        offset[1] = (float)r.y / (float)layout.page_height;
+    }
+}
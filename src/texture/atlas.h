@@ -0,0 +1,58 @@
+#pragma once
+
+#include "texture.h"
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    struct atlas_settings
+    {
+        uint32_t max_size = 2048;           //Largest page, power of two. Textures that don't fit on one page go to the next.
+        uint32_t max_texture_size = 256;    //Only textures up to this size in both directions are worth packing
+        uint32_t mip_levels = 4;            //Levels the pages keep, the gutters stay intact down to the last one
+        uint32_t padding = 1;               //Gutter texels around every texture at the last kept level
+    };
+
+    //Where one texture went, x and y are its first texel (inside the gutter) on page
+    struct atlas_rect
+    {
+        uint32_t page;
+        uint32_t x, y;
+        uint32_t width, height;
+    };
+
+    struct atlas_layout
+    {
+        uint32_t page_width = 0;
+        uint32_t page_height = 0;
+        uint32_t page_count = 0;
+        std::vector<atlas_rect> rects;      //Per packed texture, in input order
+
+        //Texels of the textures themselves, of the textures with their gutters and alignment, and of all pages
+        uint64_t texture_area = 0;
+        uint64_t padded_area = 0;
+        uint64_t page_area = 0;
+    };
+
+    //Base level texels of gutter on each side of a texture, also the alignment of every rect: padding << (mip_levels - 1)
+    uint32_t atlas_gutter(const atlas_settings& settings);
+
+    //Skyline bottom left packing of rectangles into as few pages as possible. A single page shrinks to the smallest power of two size that
+    //holds everything and is then trimmed to what it uses, with more than one page every page is max_size.
+    //@param widths, heights base level size of each texture, at most max_size minus the gutters
+    //@return false if a texture is too big for a page
+    bool atlas_pack(atlas_layout& layout, const uint32_t* widths, const uint32_t* heights, uint32_t count, const atlas_settings& settings);
+
+    //Copies the textures placed on a page into it and builds its mip chain, mip_levels deep. Gutters repeat the texture's opposite edge, so
+    //filtering near a texture's border blends the same texels the repeat wrapped original would.
+    //@param sources texture per rect of the layout, null leaves its area transparent black
+    void atlas_compose(texture& page, const atlas_layout& layout, uint32_t page_index, const texture* const* sources, const atlas_settings& settings,
+                       texture_layout memory_layout = TEXTURE_TILED);
+
+    //Maps a texture coordinate in [0, 1] of packed texture i to its page: atlas uv = uv * scale + offset
+    void atlas_uv_transform(const atlas_layout& layout, uint32_t i, float* scale, float* offset);
+
+    //Share of the pages covered by texture texels, 1 is a perfect pack
+    inline float atlas_efficiency(const atlas_layout& layout) { return layout.page_area ? (float)((double)layout.texture_area / (double)layout.page_area) : 0.0f; }
+}
@@ -0,0 +1,691 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Block compression (BC1 / BC3 / BC5) encoder and decoder.
+
+
+    Formats -
+        BC1   Two RGB565 endpoints + 2 bit index per texel. With c0 > c1 the palette is c0, c1, (2c0 + c1) / 3, (c0 + 2c1) / 3. With c0 <= c1 the
+              third entry is the midpoint and the fourth is transparent black, so the encoder always makes sure c0 > c1 (or every index is 0).
+        BC4   Two 8 bit endpoints + 3 bit index per texel. With a0 > a1 there are 6 evenly spaced values between them. Used as the alpha block
+              of BC3 and for both channels of BC5.
+
+
+    BC1 Endpoints -
+        1. The principal axis of the block's colors (power iteration on the covariance matrix) is the line the colors are spread along.
+        2. The extreme projections onto that axis, pulled in by 1/16 of the range, are the first endpoints. Pulling them in trades the
+           extremes for a better fit of everything in between, which lowers the error on almost every block.
+        3. Indices are picked by nearest palette entry. Then the endpoints are refit by least squares for those indices and kept if the
+           error went down (twice).
+
+        Index selection and error evaluation run on the lnal 4 wide types, 4 texels per vector.
+
+
+    References -
+        https://learn.microsoft.com/en-us/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression
+        Real-Time DXT Compression (J.M.P. van Waveren) - https://www.researchgate.net/publication/259000525_Real-Time_DXT_Compression
+        stb_dxt (Fabian Giesen) - https://github.com/nothings/stb/blob/master/stb_dxt.h
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "bc.h"
+#include <cmath>
+
+namespace br
+{
+    using namespace lnal;
+
+    uint32_t bc_block_bytes(bc_format format)
+    {
+        return format == BC1 ? 8 : 16;
+    }
+
+    //--------------------------------------------------------------- Shared helpers ---------------------------------------------------------------
+
+    static inline uint16_t read_u16(const uint8_t* p)
+    {
+        return (uint16_t)(p[0] | (p[1] << 8));
+    }
+
+    static inline void write_u16(uint8_t* p, uint16_t v)
+    {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+    }
+
+    static inline uint32_t clamp_byte(float v)
+    {
+        return v <= 0.0f ? 0 : (v >= 255.0f ? 255 : (uint32_t)(v + 0.5f));
+    }
+
+    static inline uint16_t pack_565(const float* rgb)
+    {
+        uint32_t r = (clamp_byte(rgb[0]) * 31 + 127) / 255;
+        uint32_t g = (clamp_byte(rgb[1]) * 63 + 127) / 255;
+        uint32_t b = (clamp_byte(rgb[2]) * 31 + 127) / 255;
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    //565 to 888 by bit replication, what the hardware does
+    static inline void unpack_565(uint16_t c, uint32_t* rgb)
+    {
+        uint32_t r = c >> 11;
+        uint32_t g = (c >> 5) & 63;
+        uint32_t b = c & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    //BC1 palette in RGBA8. four_color forces the 4 color mode (BC3 color blocks ignore the endpoint order).
+    static void bc1_palette(uint16_t c0, uint16_t c1, bool four_color, uint32_t* palette)
+    {
+        uint32_t a[3], b[3];
+        unpack_565(c0, a);
+        unpack_565(c1, b);
+
+        uint32_t p[4][3];
+        for(int k = 0; k < 3; k++)
+        {
+            p[0][k] = a[k];
+            p[1][k] = b[k];
+
+            if(four_color || c0 > c1)
+            {
+                p[2][k] = ((2 * a[k]) + b[k]) / 3;
+                p[3][k] = (a[k] + (2 * b[k])) / 3;
+            }
+            else
+            {
+                p[2][k] = (a[k] + b[k]) / 2;
+                p[3][k] = 0;
+            }
+        }
+
+        for(int i = 0; i < 4; i++)
+        {
+            palette[i] = p[i][0] | (p[i][1] << 8) | (p[i][2] << 16) | 0xFF000000u;
+        }
+
+        if(!four_color && c0 <= c1)
+            palette[3] = 0;
+    }
+
+    static void bc4_palette(uint32_t a0, uint32_t a1, uint32_t* palette)
+    {
+        palette[0] = a0;
+        palette[1] = a1;
+
+        if(a0 > a1)
+        {
+            for(uint32_t i = 2; i < 8; i++)
+            {
+                palette[i] = (((8 - i) * a0) + ((i - 1) * a1)) / 7;
+            }
+        }
+        else
+        {
+            for(uint32_t i = 2; i < 6; i++)
+            {
+                palette[i] = (((6 - i) * a0) + ((i - 1) * a1)) / 5;
+            }
+
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    //--------------------------------------------------------------- Encoder ---------------------------------------------------------------
+
+    //Block channels as floats in structure of arrays order so 4 texels fit one vector
+    struct block_channels
+    {
+        float c[4][16];
+    };
+
+    static void split_channels(const uint32_t* texels, block_channels& b)
+    {
+        for(int i = 0; i < 16; i++)
+        {
+            for(int k = 0; k < 4; k++)
+            {
+                b.c[k][i] = (float)((texels[i] >> (k * 8)) & 0xFF);
+            }
+        }
+    }
+
+    //Picks the nearest 4 color palette entry for every texel
+    //@return total squared error
+    static float bc1_select(const block_channels& b, uint16_t c0, uint16_t c1, uint32_t& indices)
+    {
+        uint32_t palette[4];
+        bc1_palette(c0, c1, true, palette);
+
+        f32x4 pr[4], pg[4], pb[4];
+        for(int p = 0; p < 4; p++)
+        {
+            pr[p] = f32x4_splat((float)(palette[p] & 0xFF));
+            pg[p] = f32x4_splat((float)((palette[p] >> 8) & 0xFF));
+            pb[p] = f32x4_splat((float)((palette[p] >> 16) & 0xFF));
+        }
+
+        f32x4 total = f32x4_splat(0.0f);
+        indices = 0;
+
+        for(int group = 0; group < 4; group++)
+        {
+            f32x4 r = f32x4_load(&b.c[0][group * 4]);
+            f32x4 g = f32x4_load(&b.c[1][group * 4]);
+            f32x4 bl = f32x4_load(&b.c[2][group * 4]);
+
+            f32x4 best = f32x4_splat(1e30f);
+            i32x4 best_index = i32x4_splat(0);
+
+            for(int p = 0; p < 4; p++)
+            {
+                f32x4 dr = r - pr[p];
+                f32x4 dg = g - pg[p];
+                f32x4 db = bl - pb[p];
+                f32x4 d = (dr * dr) + (dg * dg) + (db * db);
+
+                mask4 closer = d < best;
+                best = select(closer, d, best);
+                best_index = select(closer, i32x4_splat(p), best_index);
+            }
+
+            total = total + best;
+
+            int32_t idx[4];
+            i32x4_store(idx, best_index);
+            for(int k = 0; k < 4; k++)
+            {
+                indices |= (uint32_t)idx[k] << (((group * 4) + k) * 2);
+            }
+        }
+
+        float sum[4];
+        f32x4_store(sum, total);
+        return sum[0] + sum[1] + sum[2] + sum[3];
+    }
+
+    //Least squares endpoints for fixed indices
+    //@return false if the system is degenerate (e.g. every texel uses the same index)
+    static bool bc1_refit(const block_channels& b, uint32_t indices, float* e0, float* e1)
+    {
+        static const float WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+        float ax[3] = {}, bx[3] = {};
+
+        for(int i = 0; i < 16; i++)
+        {
+            float alpha = WEIGHTS[(indices >> (i * 2)) & 3];
+            float beta = 1.0f - alpha;
+
+            aa += alpha * alpha;
+            bb += beta * beta;
+            ab += alpha * beta;
+
+            for(int k = 0; k < 3; k++)
+            {
+                ax[k] += alpha * b.c[k][i];
+                bx[k] += beta * b.c[k][i];
+            }
+        }
+
+        float det = (aa * bb) - (ab * ab);
+        if(fabsf(det) < 1e-6f)
+            return false;
+
+        for(int k = 0; k < 3; k++)
+        {
+            e0[k] = ((ax[k] * bb) - (bx[k] * ab)) / det;
+            e1[k] = ((bx[k] * aa) - (ax[k] * ab)) / det;
+        }
+
+        return true;
+    }
+
+    static void encode_bc1_color(const block_channels& b, uint8_t* out)
+    {
+        float mean[3] = {};
+        float lo[3] = { 255.0f, 255.0f, 255.0f };
+        float hi[3] = { 0.0f, 0.0f, 0.0f };
+
+        for(int i = 0; i < 16; i++)
+        {
+            for(int k = 0; k < 3; k++)
+            {
+                mean[k] += b.c[k][i] / 16.0f;
+                lo[k] = fminf(lo[k], b.c[k][i]);
+                hi[k] = fmaxf(hi[k], b.c[k][i]);
+            }
+        }
+
+        float cov[6] = {};
+        for(int i = 0; i < 16; i++)
+        {
+            float d[3] = { b.c[0][i] - mean[0], b.c[1][i] - mean[1], b.c[2][i] - mean[2] };
+            cov[0] += d[0] * d[0];
+            cov[1] += d[0] * d[1];
+            cov[2] += d[0] * d[2];
+            cov[3] += d[1] * d[1];
+            cov[4] += d[1] * d[2];
+            cov[5] += d[2] * d[2];
+        }
+
+        //Power iteration, starting from the bounding box diagonal
+        float axis[3] = { hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2] };
+        for(int iteration = 0; iteration < 8; iteration++)
+        {
+            float x = (cov[0] * axis[0]) + (cov[1] * axis[1]) + (cov[2] * axis[2]);
+            float y = (cov[1] * axis[0]) + (cov[3] * axis[1]) + (cov[4] * axis[2]);
+            float z = (cov[2] * axis[0]) + (cov[4] * axis[1]) + (cov[5] * axis[2]);
+
+            float len = fmaxf(fabsf(x), fmaxf(fabsf(y), fabsf(z)));
+            if(len < 1e-6f)
+                break;
+
+            axis[0] = x / len;
+            axis[1] = y / len;
+            axis[2] = z / len;
+        }
+
+        float t_min = 1e30f, t_max = -1e30f;
+        for(int i = 0; i < 16; i++)
+        {
+            float t = ((b.c[0][i] - mean[0]) * axis[0]) + ((b.c[1][i] - mean[1]) * axis[1]) + ((b.c[2][i] - mean[2]) * axis[2]);
+            t_min = fminf(t_min, t);
+            t_max = fmaxf(t_max, t);
+        }
+
+        float len2 = (axis[0] * axis[0]) + (axis[1] * axis[1]) + (axis[2] * axis[2]);
+        float inset = (t_max - t_min) / 16.0f;
+
+        float e0[3], e1[3];
+        for(int k = 0; k < 3; k++)
+        {
+            float scale = len2 > 0.0f ? axis[k] / len2 : 0.0f;
+            e0[k] = mean[k] + (scale * (t_max - inset));
+            e1[k] = mean[k] + (scale * (t_min + inset));
+        }
+
+        uint16_t c0 = pack_565(e0);
+        uint16_t c1 = pack_565(e1);
+        uint32_t indices = 0;
+        float error = bc1_select(b, c0, c1, indices);
+
+        for(int iteration = 0; iteration < 2 && error > 0.0f; iteration++)
+        {
+            if(!bc1_refit(b, indices, e0, e1))
+                break;
+
+            uint16_t r0 = pack_565(e0);
+            uint16_t r1 = pack_565(e1);
+            uint32_t refit_indices = 0;
+            float refit_error = bc1_select(b, r0, r1, refit_indices);
+
+            if(refit_error >= error)
+                break;
+
+            c0 = r0;
+            c1 = r1;
+            indices = refit_indices;
+            error = refit_error;
+        }
+
+        //Keep the 4 color mode: c0 > c1. Swapping the endpoints swaps indices 0 <-> 1 and 2 <-> 3.
+        if(c0 < c1)
+        {
+            uint16_t tmp = c0;
+            c0 = c1;
+            c1 = tmp;
+            indices ^= 0x55555555u;
+        }
+        else if(c0 == c1)
+        {
+            indices = 0;
+        }
+
+        write_u16(out, c0);
+        write_u16(out + 2, c1);
+        out[4] = (uint8_t)indices;
+        out[5] = (uint8_t)(indices >> 8);
+        out[6] = (uint8_t)(indices >> 16);
+        out[7] = (uint8_t)(indices >> 24);
+    }
+
+    //Single channel block, 8 value mode between the channel's min and max
+    static void encode_bc4(const float* values, uint8_t* out)
+    {
+        float lo = 255.0f, hi = 0.0f;
+        for(int i = 0; i < 16; i++)
+        {
+            lo = fminf(lo, values[i]);
+            hi = fmaxf(hi, values[i]);
+        }
+
+        uint32_t a0 = clamp_byte(hi);
+        uint32_t a1 = clamp_byte(lo);
+
+        out[0] = (uint8_t)a0;
+        out[1] = (uint8_t)a1;
+
+        uint64_t bits = 0;
+
+        //a0 == a1 decodes index 0 as a0 in either mode
+        if(a0 > a1)
+        {
+            f32x4 top = f32x4_splat((float)a0);
+            f32x4 scale = f32x4_splat(7.0f / (float)(a0 - a1));
+            f32x4 half = f32x4_splat(0.5f);
+            i32x4 zero = i32x4_splat(0);
+            i32x4 seven = i32x4_splat(7);
+
+            for(int group = 0; group < 4; group++)
+            {
+                //Step from a0 towards a1, then map steps 0..7 to the index order a0, a1, 6 in between
+                f32x4 steps = clamp((top - f32x4_load(&values[group * 4])) * scale + half, f32x4_splat(0.0f), f32x4_splat(7.49f));
+                i32x4 k = to_int(steps);
+                i32x4 index = select(k == zero, zero, select(k == seven, i32x4_splat(1), k + i32x4_splat(1)));
+
+                int32_t idx[4];
+                i32x4_store(idx, index);
+                for(int j = 0; j < 4; j++)
+                {
+                    bits |= (uint64_t)idx[j] << (((group * 4) + j) * 3);
+                }
+            }
+        }
+
+        for(int i = 0; i < 6; i++)
+        {
+            out[2 + i] = (uint8_t)(bits >> (i * 8));
+        }
+    }
+
+    //Encodes one 4x4 block
+    //@param texels 16 RGBA8 texels, row by row
+    //@param out bc_block_bytes(format) bytes
+    void encode_bc_block(bc_format format, const uint32_t* texels, uint8_t* out)
+    {
+        block_channels b;
+        split_channels(texels, b);
+
+        switch(format)
+        {
+            case BC1:
+                encode_bc1_color(b, out);
+                break;
+
+            case BC3:
+                encode_bc4(b.c[3], out);
+                encode_bc1_color(b, out + 8);
+                break;
+
+            case BC5:
+                encode_bc4(b.c[0], out);
+                encode_bc4(b.c[1], out + 8);
+                break;
+        }
+    }
+
+    //--------------------------------------------------------------- Decoder ---------------------------------------------------------------
+
+    static inline uint32_t bc1_index(const uint8_t* block, uint32_t texel)
+    {
+        return (block[4 + (texel >> 2)] >> ((texel & 3) * 2)) & 3;
+    }
+
+    static inline uint32_t bc4_index(const uint8_t* block, uint32_t texel)
+    {
+        uint64_t bits = 0;
+        for(int i = 0; i < 6; i++)
+        {
+            bits |= (uint64_t)block[2 + i] << (i * 8);
+        }
+
+        return (uint32_t)(bits >> (texel * 3)) & 7;
+    }
+
+    static uint32_t decode_texel(bc_format format, const uint8_t* block, uint32_t texel)
+    {
+        uint32_t palette[8];
+
+        switch(format)
+        {
+            case BC1:
+                bc1_palette(read_u16(block), read_u16(block + 2), false, palette);
+                return palette[bc1_index(block, texel)];
+
+            case BC3:
+            {
+                bc1_palette(read_u16(block + 8), read_u16(block + 10), true, palette);
+                uint32_t color = palette[bc1_index(block + 8, texel)] & 0x00FFFFFFu;
+
+                bc4_palette(block[0], block[1], palette);
+                return color | (palette[bc4_index(block, texel)] << 24);
+            }
+
+            case BC5:
+            {
+                bc4_palette(block[0], block[1], palette);
+                uint32_t r = palette[bc4_index(block, texel)];
+
+                bc4_palette(block[8], block[9], palette);
+                uint32_t g = palette[bc4_index(block + 8, texel)];
+
+                return r | (g << 8) | 0xFF000000u;
+            }
+        }
+
+        return 0;
+    }
+
+    //Decodes one 4x4 block into 16 RGBA8 texels, row by row
+    void decode_bc_block(bc_format format, const uint8_t* block, uint32_t* texels)
+    {
+        for(uint32_t i = 0; i < 16; i++)
+        {
+            texels[i] = decode_texel(format, block, i);
+        }
+    }
+
+    //--------------------------------------------------------------- Textures ---------------------------------------------------------------
+
+    //Compresses every level of a texture. Blocks are independent so rows of blocks are spread over the job system.
+    //@param js optional job system, null encodes on the calling thread
+    void compress_texture(compressed_texture& out, const texture& t, bc_format format, job_system* js)
+    {
+        uint32_t block_bytes = bc_block_bytes(format);
+
+        out.format = format;
+        out.levels.clear();
+
+        uint32_t offset = 0;
+        for(const texture_level& l : t.levels)
+        {
+            bc_level level;
+            level.width = l.width;
+            level.height = l.height;
+            level.blocks_x = (l.width + 3) / 4;
+            level.blocks_y = (l.height + 3) / 4;
+            level.offset = offset;
+            out.levels.push_back(level);
+
+            offset += level.blocks_x * level.blocks_y * block_bytes;
+        }
+
+        out.data.assign(offset, 0);
+
+        std::vector<uint32_t> pixels;
+        for(uint32_t level = 0; level < out.levels.size(); level++)
+        {
+            const bc_level& l = out.levels[level];
+            texture_read_level(t, level, pixels);
+
+            uint32_t chunk = l.blocks_y / (job_thread_count(js) * 4);
+
+            parallel_for(js, l.blocks_y, chunk > 0 ? chunk : 1, [&](uint32_t begin, uint32_t end)
+            {
+                uint32_t block[16];
+
+                for(uint32_t by = begin; by < end; by++)
+                {
+                    for(uint32_t bx = 0; bx < l.blocks_x; bx++)
+                    {
+                        //Partial blocks at the right / bottom edge repeat the last row / column
+                        for(uint32_t i = 0; i < 16; i++)
+                        {
+                            uint32_t x = (bx * 4) + (i & 3);
+                            uint32_t y = (by * 4) + (i >> 2);
+                            x = x < l.width ? x : l.width - 1;
+                            y = y < l.height ? y : l.height - 1;
+                            block[i] = pixels[(size_t)y * l.width + x];
+                        }
+
+                        encode_bc_block(format, block, &out.data[l.offset + (((by * l.blocks_x) + bx) * block_bytes)]);
+                    }
+                }
+            });
+        }
+    }
+
+    //Decodes a whole level to linear RGBA8 rows
+    void decompress_level(const compressed_texture& t, uint32_t level, std::vector<uint32_t>& out)
+    {
+        const bc_level& l = t.levels[level];
+        uint32_t block_bytes = bc_block_bytes(t.format);
+        uint32_t block[16];
+
+        out.resize((size_t)l.width * l.height);
+
+        for(uint32_t by = 0; by < l.blocks_y; by++)
+        {
+            for(uint32_t bx = 0; bx < l.blocks_x; bx++)
+            {
+                decode_bc_block(t.format, &t.data[l.offset + (((by * l.blocks_x) + bx) * block_bytes)], block);
+
+                for(uint32_t i = 0; i < 16; i++)
+                {
+                    uint32_t x = (bx * 4) + (i & 3);
+                    uint32_t y = (by * 4) + (i >> 2);
+
+                    if(x < l.width && y < l.height)
+                        out[(size_t)y * l.width + x] = block[i];
+                }
+            }
+        }
+    }
+
+    //Decodes the single texel at (x, y) without decoding the rest of its block
+    uint32_t bc_fetch(const compressed_texture& t, uint32_t level, uint32_t x, uint32_t y)
+    {
+        const bc_level& l = t.levels[level];
+        const uint8_t* block = &t.data[l.offset + ((((y >> 2) * l.blocks_x) + (x >> 2)) * bc_block_bytes(t.format))];
+        return decode_texel(t.format, block, ((y & 3) * 4) + (x & 3));
+    }
+
+    static inline uint32_t wrap(int32_t i, uint32_t size)
+    {
+        int32_t r = i % (int32_t)size;
+        return (uint32_t)(r < 0 ? r + (int32_t)size : r);
+    }
+
+    //Same filtering as the uncompressed samplers, reading straight from the compressed blocks
+    //@param out rgba in [0, 1]
+    void sample_bilinear(const compressed_texture& t, uint32_t level, float u, float v, float* out)
+    {
+        const bc_level& l = t.levels[level];
+
+        float x = (u * l.width) - 0.5f;
+        float y = (v * l.height) - 0.5f;
+        float fx = floorf(x);
+        float fy = floorf(y);
+        float wx = x - fx;
+        float wy = y - fy;
+
+        uint32_t x0 = wrap((int32_t)fx, l.width);
+        uint32_t y0 = wrap((int32_t)fy, l.height);
+        uint32_t x1 = x0 + 1 == l.width ? 0 : x0 + 1;
+        uint32_t y1 = y0 + 1 == l.height ? 0 : y0 + 1;
+
+        uint32_t t00 = bc_fetch(t, level, x0, y0);
+        uint32_t t10 = bc_fetch(t, level, x1, y0);
+        uint32_t t01 = bc_fetch(t, level, x0, y1);
+        uint32_t t11 = bc_fetch(t, level, x1, y1);
+
+        for(int k = 0; k < 4; k++)
+        {
+            float c00 = (float)((t00 >> (k * 8)) & 0xFF);
+            float c10 = (float)((t10 >> (k * 8)) & 0xFF);
+            float c01 = (float)((t01 >> (k * 8)) & 0xFF);
+            float c11 = (float)((t11 >> (k * 8)) & 0xFF);
+
+            float top = c00 + ((c10 - c00) * wx);
+            float bottom = c01 + ((c11 - c01) * wx);
+            out[k] = (top + ((bottom - top) * wy)) * (1.0f / 255.0f);
+        }
+    }
+
+    void sample_trilinear(const compressed_texture& t, float u, float v, float lod, float* out)
+    {
+        float max_level = (float)(t.levels.size() - 1);
+        lod = lod < 0.0f ? 0.0f : (lod > max_level ? max_level : lod);
+
+        uint32_t l0 = (uint32_t)lod;
+        uint32_t l1 = l0 + 1 < t.levels.size() ? l0 + 1 : l0;
+        float f = lod - (float)l0;
+
+        sample_bilinear(t, l0, u, v, out);
+
+        if(l1 == l0 || f == 0.0f)
+            return;
+
+        float second[4];
+        sample_bilinear(t, l1, u, v, second);
+
+        for(int k = 0; k < 4; k++)
+        {
+            out[k] += (second[k] - out[k]) * f;
+        }
+    }
+
+    uint64_t compressed_texture_bytes(const compressed_texture& t)
+    {
+        return (uint64_t)t.data.capacity() + ((uint64_t)t.levels.capacity() * sizeof(bc_level));
+    }
+
+    void write_compressed_texture(byte_writer& w, const compressed_texture& t)
+    {
+        write_pod(w, (uint32_t)t.format);
+        write_vector(w, t.levels);
+        write_vector(w, t.data);
+    }
+
+    //@return false if the data is truncated or inconsistent
+    bool read_compressed_texture(byte_reader& r, compressed_texture& t)
+    {
+        uint32_t format = 0;
+        read_pod(r, format);
+        read_vector(r, t.levels);
+        read_vector(r, t.data);
+
+        if(!r.ok || format > BC5)
+            return false;
+
+        t.format = (bc_format)format;
+
+        //Every level has to fit in the data so sampling can't read out of bounds
+        uint32_t block_bytes = bc_block_bytes(t.format);
+        for(const bc_level& l : t.levels)
+        {
+            if(l.blocks_x != (l.width + 3) / 4 || l.blocks_y != (l.height + 3) / 4 || l.width == 0 || l.height == 0)
+                return false;
+
+            if((uint64_t)l.offset + ((uint64_t)l.blocks_x * l.blocks_y * block_bytes) > t.data.size())
+                return false;
+        }
+
+        return !t.levels.empty();
+    }
+}
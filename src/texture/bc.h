@@ -0,0 +1,69 @@
+#pragma once
+
+#include "texture.h"
+#include "../core/job.h"
+#include "../asset/serialize.h"
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    //Block compressed formats. Every format stores 4x4 texel blocks.
+    enum bc_format : uint32_t
+    {
+        BC1,    //RGB, 8 bytes per block (4 bpp). Alpha is always 1.
+        BC3,    //RGBA, 16 bytes per block (8 bpp): BC1 color + BC4 alpha
+        BC5     //RG, 16 bytes per block (8 bpp): two BC4 channels, for normal maps. Decodes with B = 0, A = 1.
+    };
+
+    struct bc_level
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t blocks_x;
+        uint32_t blocks_y;
+
+        //First byte of the level in compressed_texture::data
+        uint32_t offset;
+    };
+
+    //Mip chain of a texture in a block compressed format. Addressing wraps (repeat) like texture.
+    struct compressed_texture
+    {
+        bc_format format = BC1;
+        std::vector<bc_level> levels;
+        std::vector<uint8_t> data;
+    };
+
+    uint32_t bc_block_bytes(bc_format format);
+
+    //Encodes one 4x4 block
+    //@param texels 16 RGBA8 texels, row by row
+    //@param out bc_block_bytes(format) bytes
+    void encode_bc_block(bc_format format, const uint32_t* texels, uint8_t* out);
+
+    //Decodes one 4x4 block into 16 RGBA8 texels, row by row
+    void decode_bc_block(bc_format format, const uint8_t* block, uint32_t* texels);
+
+    //Compresses every level of a texture. Blocks are independent so rows of blocks are spread over the job system.
+    //@param js optional job system, null encodes on the calling thread
+    void compress_texture(compressed_texture& out, const texture& t, bc_format format, job_system* js = nullptr);
+
+    //Decodes a whole level to linear RGBA8 rows
+    void decompress_level(const compressed_texture& t, uint32_t level, std::vector<uint32_t>& out);
+
+    //Decodes the single texel at (x, y) without decoding the rest of its block
+    uint32_t bc_fetch(const compressed_texture& t, uint32_t level, uint32_t x, uint32_t y);
+
+    //Same filtering as the uncompressed samplers, reading straight from the compressed blocks
+    //@param out rgba in [0, 1]
+    void sample_bilinear(const compressed_texture& t, uint32_t level, float u, float v, float* out);
+    void sample_trilinear(const compressed_texture& t, float u, float v, float lod, float* out);
+
+    uint64_t compressed_texture_bytes(const compressed_texture& t);
+
+    void write_compressed_texture(byte_writer& w, const compressed_texture& t);
+
+    //@return false if the data is truncated or inconsistent
+    bool read_compressed_texture(byte_reader& r, compressed_texture& t);
+}
@@ -0,0 +1,560 @@
+/* -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+                Textures for the CPU rasterizer: storage layout, mip generation and filtered sampling.
+
+
+    Tiled Layout -
+        With plain rows, two texels that are vertical neighbors are a whole row apart in memory. A bilinear footprint always touches two rows and a
+        triangle that is rotated on screen walks through the texture diagonally, so nearly every sample pulls in new cache lines and most of each line
+        is never used.
+
+        Tiled textures store 8x8 blocks of texels contiguously (64 texels * 4 bytes = 256 bytes = 4 cache lines) and order the texels inside a block
+        along a Morton curve (interleaved x and y bits):
+
+            x bits: x2 x1 x0     y bits: y2 y1 y0     index in tile: y2 x2 y1 x1 y0 x0
+
+        so any 2x2 footprint that doesn't cross a tile boundary sits in one cache line, independent of the direction the texture is walked in. Levels
+        are padded up to whole tiles so any size works.
+
+
+    Mip Chains -
+        Each level is half the size of the previous one (rounded down, at least 1) and is filtered from the previous level in float.
+            Box     2x2 average.
+            Kaiser  Separable windowed sinc, 3 destination texels of support on each side (12 source taps), alpha = 4. Keeps more detail than the box
+                    filter without the ringing of a plain truncated sinc. The negative lobes can overshoot, so results are clamped.
+
+
+    Sampling -
+        Bilinear / trilinear with repeat addressing and texel centers at +0.5 (same convention as GL). The 4 wide versions do the coordinate, wrap,
+        address and blend math on all 4 lanes at once. SSE2 has no gather, so the 16 texel loads per bilinear sample are still scalar.
+
+
+    References -
+        Kaiser window - https://en.wikipedia.org/wiki/Kaiser_window
+        Mipmapping (Ignacio Castano) - https://www.ludicon.com/castano/blog/articles/filtering-for-mipmaps/
+
+------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- */
+
+#include "texture.h"
+#include "../math/lnal.h"
+#include <cmath>
+#include <utility>
+
+namespace br
+{
+    static const float KAISER_RADIUS = 3.0f;
+    static const float KAISER_ALPHA = 4.0f;
+
+    //Index of (x, y) inside an 8x8 tile
+    static inline uint32_t morton8(uint32_t x, uint32_t y)
+    {
+        return (x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2) | ((x & 4) << 2) | ((y & 4) << 3);
+    }
+
+    static inline uint32_t texel_index(const texture& t, const texture_level& l, uint32_t x, uint32_t y)
+    {
+        if(t.layout == TEXTURE_LINEAR)
+            return l.offset + (y * l.width) + x;
+
+        return l.offset + ((((y >> 3) * l.tiles_x) + (x >> 3)) << 6) + morton8(x & 7, y & 7);
+    }
+
+    static inline void unpack_texel(uint32_t p, float* out)
+    {
+        out[0] = (float)(p & 0xFF);
+        out[1] = (float)((p >> 8) & 0xFF);
+        out[2] = (float)((p >> 16) & 0xFF);
+        out[3] = (float)(p >> 24);
+    }
+
+    static inline uint32_t pack_texel(const float* c)
+    {
+        uint32_t p = 0;
+        for(int k = 0; k < 4; k++)
+        {
+            float v = c[k] < 0.0f ? 0.0f : (c[k] > 255.0f ? 255.0f : c[k]);
+            p |= (uint32_t)(v + 0.5f) << (k * 8);
+        }
+
+        return p;
+    }
+
+    //--------------------------------------------------------------- Mip generation ---------------------------------------------------------------
+
+    static void downsample_box(const std::vector<float>& src, uint32_t w, uint32_t h, std::vector<float>& dst, uint32_t dw, uint32_t dh)
+    {
+        dst.resize((size_t)dw * dh * 4);
+
+        for(uint32_t y = 0; y < dh; y++)
+        {
+            uint32_t y0 = (y * 2) < h ? (y * 2) : h - 1;
+            uint32_t y1 = (y * 2) + 1 < h ? (y * 2) + 1 : h - 1;
+
+            for(uint32_t x = 0; x < dw; x++)
+            {
+                uint32_t x0 = (x * 2) < w ? (x * 2) : w - 1;
+                uint32_t x1 = (x * 2) + 1 < w ? (x * 2) + 1 : w - 1;
+
+                for(int k = 0; k < 4; k++)
+                {
+                    dst[(((size_t)y * dw + x) * 4) + k] = 0.25f * (src[(((size_t)y0 * w + x0) * 4) + k] + src[(((size_t)y0 * w + x1) * 4) + k] +
+                                                                   src[(((size_t)y1 * w + x0) * 4) + k] + src[(((size_t)y1 * w + x1) * 4) + k]);
+                }
+            }
+        }
+    }
+
+    //Zeroth order modified Bessel function of the first kind (power series)
+    static double bessel_i0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        double q = (x * x) / 4.0;
+
+        for(int k = 1; k < 32; k++)
+        {
+            term *= q / (double)(k * k);
+            sum += term;
+
+            if(term < sum * 1e-12)
+                break;
+        }
+
+        return sum;
+    }
+
+    static double kaiser_sinc(double x)
+    {
+        double t = x / KAISER_RADIUS;
+        if(t <= -1.0 || t >= 1.0)
+            return 0.0;
+
+        double sinc = x == 0.0 ? 1.0 : sin(PI * x) / (PI * x);
+        return sinc * bessel_i0(KAISER_ALPHA * sqrt(1.0 - (t * t))) / bessel_i0(KAISER_ALPHA);
+    }
+
+    //Source texels (already wrapped) and normalized weights for every destination texel along one axis
+    static void kaiser_taps(uint32_t src, uint32_t dst, std::vector<std::vector<std::pair<uint32_t, float>>>& taps)
+    {
+        taps.assign(dst, {});
+
+        double scale = (double)src / dst;
+        double support = KAISER_RADIUS * scale;
+
+        for(uint32_t d = 0; d < dst; d++)
+        {
+            double center = (d + 0.5) * scale;
+            int32_t first = (int32_t)floor(center - support);
+            int32_t last = (int32_t)ceil(center + support);
+
+            double sum = 0.0;
+            for(int32_t j = first; j <= last; j++)
+            {
+                double w = kaiser_sinc(((j + 0.5) - center) / scale);
+                if(w == 0.0)
+                    continue;
+
+                int32_t wrapped = ((j % (int32_t)src) + (int32_t)src) % (int32_t)src;
+                taps[d].push_back({ (uint32_t)wrapped, (float)w });
+                sum += w;
+            }
+
+            for(std::pair<uint32_t, float>& tap : taps[d])
+            {
+                tap.second = (float)(tap.second / sum);
+            }
+        }
+    }
+
+    static void downsample_kaiser(const std::vector<float>& src, uint32_t w, uint32_t h, std::vector<float>& dst, uint32_t dw, uint32_t dh)
+    {
+        std::vector<std::vector<std::pair<uint32_t, float>>> taps_x, taps_y;
+        kaiser_taps(w, dw, taps_x);
+        kaiser_taps(h, dh, taps_y);
+
+        //Horizontal pass into a dw x h buffer, then vertical into dw x dh
+        std::vector<float> rows((size_t)dw * h * 4, 0.0f);
+
+        for(uint32_t y = 0; y < h; y++)
+        {
+            for(uint32_t x = 0; x < dw; x++)
+            {
+                float* out = &rows[((size_t)y * dw + x) * 4];
+                for(const std::pair<uint32_t, float>& tap : taps_x[x])
+                {
+                    const float* in = &src[((size_t)y * w + tap.first) * 4];
+                    for(int k = 0; k < 4; k++)
+                    {
+                        out[k] += in[k] * tap.second;
+                    }
+                }
+            }
+        }
+
+        dst.assign((size_t)dw * dh * 4, 0.0f);
+
+        for(uint32_t y = 0; y < dh; y++)
+        {
+            for(const std::pair<uint32_t, float>& tap : taps_y[y])
+            {
+                const float* in = &rows[(size_t)tap.first * dw * 4];
+                float* out = &dst[(size_t)y * dw * 4];
+
+                for(uint32_t i = 0; i < dw * 4; i++)
+                {
+                    out[i] += in[i] * tap.second;
+                }
+            }
+        }
+    }
+
+    static void store_level(texture& t, uint32_t level, const std::vector<float>& pixels)
+    {
+        const texture_level& l = t.levels[level];
+
+        for(uint32_t y = 0; y < l.height; y++)
+        {
+            for(uint32_t x = 0; x < l.width; x++)
+            {
+                t.texels[texel_index(t, l, x, y)] = pack_texel(&pixels[((size_t)y * l.width + x) * 4]);
+            }
+        }
+    }
+
+    //Builds a texture and its mip chain from linear RGBA8 pixels
+    //@param layout memory order of the stored levels
+    //@param filter how the mip levels are generated
+    void texture_create(texture& t, uint32_t width, uint32_t height, const uint32_t* pixels, texture_layout layout, mip_filter filter)
+    {
+        t.layout = layout;
+        t.levels.clear();
+
+        uint32_t w = width;
+        uint32_t h = height;
+        uint32_t offset = 0;
+
+        while(true)
+        {
+            texture_level l;
+            l.width = w;
+            l.height = h;
+            l.tiles_x = (w + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+            l.offset = offset;
+            t.levels.push_back(l);
+
+            uint32_t tiles_y = (h + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+            offset += layout == TEXTURE_LINEAR ? w * h : l.tiles_x * tiles_y * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE;
+
+            if(filter == MIP_NONE || (w == 1 && h == 1))
+                break;
+
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+
+        t.texels.assign(offset, 0);
+
+        std::vector<float> current((size_t)width * height * 4);
+        for(size_t i = 0; i < (size_t)width * height; i++)
+        {
+            unpack_texel(pixels[i], &current[i * 4]);
+        }
+
+        store_level(t, 0, current);
+
+        std::vector<float> next;
+        for(uint32_t level = 1; level < t.levels.size(); level++)
+        {
+            const texture_level& src = t.levels[level - 1];
+            const texture_level& dst = t.levels[level];
+
+            if(filter == MIP_KAISER)
+                downsample_kaiser(current, src.width, src.height, next, dst.width, dst.height);
+            else
+                downsample_box(current, src.width, src.height, next, dst.width, dst.height);
+
+            store_level(t, level, next);
+            current.swap(next);
+        }
+    }
+
+    //Raw texel at integer coordinates (must be inside the level)
+    uint32_t texture_fetch(const texture& t, uint32_t level, uint32_t x, uint32_t y)
+    {
+        return t.texels[texel_index(t, t.levels[level], x, y)];
+    }
+
+    //Copies a level out as linear rows, e.g. for GL upload or writing it to an image
+    void texture_read_level(const texture& t, uint32_t level, std::vector<uint32_t>& out)
+    {
+        const texture_level& l = t.levels[level];
+        out.resize((size_t)l.width * l.height);
+
+        for(uint32_t y = 0; y < l.height; y++)
+        {
+            for(uint32_t x = 0; x < l.width; x++)
+            {
+                out[(size_t)y * l.width + x] = t.texels[texel_index(t, l, x, y)];
+            }
+        }
+    }
+
+    //Mip level of detail from screen space derivatives of the (normalized) texture coordinates
+    float texture_lod(const texture& t, float dudx, float dvdx, float dudy, float dvdy)
+    {
+        float w = (float)t.levels[0].width;
+        float h = (float)t.levels[0].height;
+
+        float x = ((dudx * w) * (dudx * w)) + ((dvdx * h) * (dvdx * h));
+        float y = ((dudy * w) * (dudy * w)) + ((dvdy * h) * (dvdy * h));
+
+        //log2(sqrt(a)) = 0.5 * log2(a)
+        float rho2 = x > y ? x : y;
+        return rho2 > 0.0f ? 0.5f * log2f(rho2) : 0.0f;
+    }
+
+    //--------------------------------------------------------------- Scalar sampling ---------------------------------------------------------------
+
+    static inline uint32_t wrap(int32_t i, uint32_t size)
+    {
+        int32_t r = i % (int32_t)size;
+        return (uint32_t)(r < 0 ? r + (int32_t)size : r);
+    }
+
+    //Bilinear sample of one level
+    //@param out rgba in [0, 1]
+    void sample_bilinear(const texture& t, uint32_t level, float u, float v, float* out)
+    {
+        const texture_level& l = t.levels[level];
+
+        float x = (u * l.width) - 0.5f;
+        float y = (v * l.height) - 0.5f;
+        float fx = floorf(x);
+        float fy = floorf(y);
+        float wx = x - fx;
+        float wy = y - fy;
+
+        uint32_t x0 = wrap((int32_t)fx, l.width);
+        uint32_t y0 = wrap((int32_t)fy, l.height);
+        uint32_t x1 = x0 + 1 == l.width ? 0 : x0 + 1;
+        uint32_t y1 = y0 + 1 == l.height ? 0 : y0 + 1;
+
+        float c00[4], c10[4], c01[4], c11[4];
+        unpack_texel(t.texels[texel_index(t, l, x0, y0)], c00);
+        unpack_texel(t.texels[texel_index(t, l, x1, y0)], c10);
+        unpack_texel(t.texels[texel_index(t, l, x0, y1)], c01);
+        unpack_texel(t.texels[texel_index(t, l, x1, y1)], c11);
+
+        for(int k = 0; k < 4; k++)
+        {
+            float top = c00[k] + ((c10[k] - c00[k]) * wx);
+            float bottom = c01[k] + ((c11[k] - c01[k]) * wx);
+            out[k] = (top + ((bottom - top) * wy)) * (1.0f / 255.0f);
+        }
+    }
+
+    //Bilinear samples of the two nearest levels blended by the fractional part of lod
+    void sample_trilinear(const texture& t, float u, float v, float lod, float* out)
+    {
+        float max_level = (float)(t.levels.size() - 1);
+        lod = lod < 0.0f ? 0.0f : (lod > max_level ? max_level : lod);
+
+        uint32_t l0 = (uint32_t)lod;
+        uint32_t l1 = l0 + 1 < t.levels.size() ? l0 + 1 : l0;
+        float f = lod - (float)l0;
+
+        sample_bilinear(t, l0, u, v, out);
+
+        if(l1 == l0 || f == 0.0f)
+            return;
+
+        float second[4];
+        sample_bilinear(t, l1, u, v, second);
+
+        for(int k = 0; k < 4; k++)
+        {
+            out[k] += (second[k] - out[k]) * f;
+        }
+    }
+
+    //--------------------------------------------------------------- 4 wide sampling ---------------------------------------------------------------
+
+    using namespace lnal;
+
+    //Level parameters for each lane (lanes can be on different levels in trilinear sampling)
+    struct level4
+    {
+        f32x4 width;
+        f32x4 height;
+        i32x4 iwidth;
+        i32x4 iheight;
+        i32x4 tiles_x;
+        i32x4 offset;
+    };
+
+    static level4 level4_splat(const texture_level& l)
+    {
+        return { f32x4_splat((float)l.width), f32x4_splat((float)l.height), i32x4_splat((int32_t)l.width), i32x4_splat((int32_t)l.height),
+                 i32x4_splat((int32_t)l.tiles_x), i32x4_splat((int32_t)l.offset) };
+    }
+
+    static level4 level4_gather(const texture& t, i32x4 level)
+    {
+        int32_t lv[4];
+        i32x4_store(lv, level);
+
+        const texture_level* l[4] = { &t.levels[lv[0]], &t.levels[lv[1]], &t.levels[lv[2]], &t.levels[lv[3]] };
+
+        return { f32x4_set((float)l[0]->width, (float)l[1]->width, (float)l[2]->width, (float)l[3]->width),
+                 f32x4_set((float)l[0]->height, (float)l[1]->height, (float)l[2]->height, (float)l[3]->height),
+                 i32x4_set((int32_t)l[0]->width, (int32_t)l[1]->width, (int32_t)l[2]->width, (int32_t)l[3]->width),
+                 i32x4_set((int32_t)l[0]->height, (int32_t)l[1]->height, (int32_t)l[2]->height, (int32_t)l[3]->height),
+                 i32x4_set((int32_t)l[0]->tiles_x, (int32_t)l[1]->tiles_x, (int32_t)l[2]->tiles_x, (int32_t)l[3]->tiles_x),
+                 i32x4_set((int32_t)l[0]->offset, (int32_t)l[1]->offset, (int32_t)l[2]->offset, (int32_t)l[3]->offset) };
+    }
+
+    //Repeat addressing in float, then fix the lanes that rounding pushed one period off
+    static inline i32x4 wrap4(f32x4 i, f32x4 size, i32x4 isize)
+    {
+        f32x4 wrapped = i - (size * lnal::floor(i / size));
+        i32x4 r = to_int(wrapped);
+
+        r = select(r < i32x4_splat(0), r + isize, r);
+        r = select(r > isize - i32x4_splat(1), r - isize, r);
+        return r;
+    }
+
+    static inline i32x4 morton8_4(i32x4 x, i32x4 y)
+    {
+        i32x4 one = i32x4_splat(1), two = i32x4_splat(2), four = i32x4_splat(4);
+        return (x & one) | ((y & one) << 1) | ((x & two) << 1) | ((y & two) << 2) | ((x & four) << 2) | ((y & four) << 3);
+    }
+
+    static inline i32x4 texel_index4(const texture& t, const level4& l, i32x4 x, i32x4 y)
+    {
+        if(t.layout == TEXTURE_LINEAR)
+            return l.offset + (y * l.iwidth) + x;
+
+        i32x4 seven = i32x4_splat(7);
+        return l.offset + ((((y >> 3) * l.tiles_x) + (x >> 3)) << 6) + morton8_4(x & seven, y & seven);
+    }
+
+    static inline void gather4(const texture& t, i32x4 index, i32x4& texels)
+    {
+        int32_t idx[4];
+        i32x4_store(idx, index);
+
+        texels = i32x4_set((int32_t)t.texels[idx[0]], (int32_t)t.texels[idx[1]], (int32_t)t.texels[idx[2]], (int32_t)t.texels[idx[3]]);
+    }
+
+    static inline f32x4 channel(i32x4 texels, int shift)
+    {
+        return to_float(shift_right_logical(texels, shift) & i32x4_splat(0xFF));
+    }
+
+    static texel4 bilinear4(const texture& t, const level4& l, f32x4 u, f32x4 v)
+    {
+        f32x4 half = f32x4_splat(0.5f);
+        f32x4 x = (u * l.width) - half;
+        f32x4 y = (v * l.height) - half;
+        f32x4 fx = lnal::floor(x);
+        f32x4 fy = lnal::floor(y);
+        f32x4 wx = x - fx;
+        f32x4 wy = y - fy;
+
+        i32x4 zero = i32x4_splat(0);
+        i32x4 one = i32x4_splat(1);
+
+        i32x4 x0 = wrap4(fx, l.width, l.iwidth);
+        i32x4 y0 = wrap4(fy, l.height, l.iheight);
+        i32x4 x1 = x0 + one;
+        i32x4 y1 = y0 + one;
+        x1 = select(x1 == l.iwidth, zero, x1);
+        y1 = select(y1 == l.iheight, zero, y1);
+
+        i32x4 t00, t10, t01, t11;
+        gather4(t, texel_index4(t, l, x0, y0), t00);
+        gather4(t, texel_index4(t, l, x1, y0), t10);
+        gather4(t, texel_index4(t, l, x0, y1), t01);
+        gather4(t, texel_index4(t, l, x1, y1), t11);
+
+        f32x4 scale = f32x4_splat(1.0f / 255.0f);
+        f32x4 result[4];
+
+        for(int k = 0; k < 4; k++)
+        {
+            f32x4 top = lerp(channel(t00, k * 8), channel(t10, k * 8), wx);
+            f32x4 bottom = lerp(channel(t01, k * 8), channel(t11, k * 8), wx);
+            result[k] = lerp(top, bottom, wy) * scale;
+        }
+
+        return { result[0], result[1], result[2], result[3] };
+    }
+
+    texel4 sample_bilinear4(const texture& t, uint32_t level, f32x4 u, f32x4 v)
+    {
+        return bilinear4(t, level4_splat(t.levels[level]), u, v);
+    }
+
+    texel4 sample_trilinear4(const texture& t, f32x4 u, f32x4 v, f32x4 lod)
+    {
+        int32_t last = (int32_t)t.levels.size() - 1;
+        lod = clamp(lod, f32x4_splat(0.0f), f32x4_splat((float)last));
+
+        f32x4 base = lnal::floor(lod);
+        f32x4 f = lod - base;
+        i32x4 l0 = to_int(base);
+        i32x4 l1 = l0 + i32x4_splat(1);
+        l1 = select(l1 > i32x4_splat(last), i32x4_splat(last), l1);
+
+        //Pixels in a quad almost always share their levels, which saves the per lane level lookups
+        int32_t first[4];
+        i32x4_store(first, l0);
+        bool uniform = all(l0 == i32x4_splat(first[0]));
+
+        texel4 a = uniform ? bilinear4(t, level4_splat(t.levels[first[0]]), u, v) : bilinear4(t, level4_gather(t, l0), u, v);
+
+        if(!any(f > f32x4_splat(0.0f)))
+            return a;
+
+        texel4 b = uniform ? bilinear4(t, level4_splat(t.levels[first[0] < last ? first[0] + 1 : last]), u, v) : bilinear4(t, level4_gather(t, l1), u, v);
+
+        return { lerp(a.r, b.r, f), lerp(a.g, b.g, f), lerp(a.b, b.b, f), lerp(a.a, b.a, f) };
+    }
+
+    //Binary form of a texture for the asset cache
+    void write_texture(byte_writer& w, const texture& t)
+    {
+        write_pod(w, (uint32_t)t.layout);
+        write_vector(w, t.levels);
+        write_vector(w, t.texels);
+    }
+
+    //@return false if the data is truncated or inconsistent
+    bool read_texture(byte_reader& r, texture& t)
+    {
+        uint32_t layout = 0;
+        read_pod(r, layout);
+        read_vector(r, t.levels);
+        read_vector(r, t.texels);
+
+        if(!r.ok || layout > TEXTURE_TILED || t.levels.empty())
+            return false;
+
+        t.layout = (texture_layout)layout;
+
+        //Every level has to fit in the texels so sampling can't read out of bounds
+        for(const texture_level& l : t.levels)
+        {
+            uint32_t tiles_y = (l.height + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+            if(l.width == 0 || l.height == 0 || l.tiles_x != (l.width + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE)
+                return false;
+
+            uint64_t size = t.layout == TEXTURE_LINEAR ? (uint64_t)l.width * l.height : (uint64_t)l.tiles_x * tiles_y * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE;
+            if((uint64_t)l.offset + size > t.texels.size())
+                return false;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "../math/simd.h"
+#include "../asset/serialize.h"
+#include <cstdint>
+#include <vector>
+
+namespace br
+{
+    //How texels of a level are ordered in memory
+    enum texture_layout
+    {
+        //Plain rows, what image files and glTexImage2D use
+        TEXTURE_LINEAR,
+
+        //8x8 texel tiles stored one after another, Morton (Z) order inside a tile. Neighbors in both x and y share cache lines.
+        TEXTURE_TILED
+    };
+
+    enum mip_filter
+    {
+        //Only the base level
+        MIP_NONE,
+
+        //2x2 average, cheap but blurs and aliases a little
+        MIP_BOX,
+
+        //Kaiser windowed sinc, sharper mips with less aliasing at a higher build cost
+        MIP_KAISER
+    };
+
+    static const uint32_t TEXTURE_TILE_SIZE = 8;
+
+    struct texture_level
+    {
+        uint32_t width;
+        uint32_t height;
+
+        //Number of tiles per row (tiled layout only)
+        uint32_t tiles_x;
+
+        //First texel of the level in texture::texels
+        uint32_t offset;
+    };
+
+    //RGBA8 texture (R in the lowest byte, same as framebuffer colors) with its whole mip chain in one allocation. Addressing always wraps (repeat).
+    struct texture
+    {
+        texture_layout layout = TEXTURE_TILED;
+        std::vector<texture_level> levels;
+        std::vector<uint32_t> texels;
+    };
+
+    //Four filtered samples, one per lane, with channels in [0, 1]
+    struct texel4
+    {
+        lnal::f32x4 r;
+        lnal::f32x4 g;
+        lnal::f32x4 b;
+        lnal::f32x4 a;
+    };
+
+    //Builds a texture and its mip chain from linear RGBA8 pixels
+    //@param layout memory order of the stored levels
+    //@param filter how the mip levels are generated
+    void texture_create(texture& t, uint32_t width, uint32_t height, const uint32_t* pixels, texture_layout layout = TEXTURE_TILED, mip_filter filter = MIP_BOX);
+
+    //Raw texel at integer coordinates (must be inside the level)
+    uint32_t texture_fetch(const texture& t, uint32_t level, uint32_t x, uint32_t y);
+
+    //Copies a level out as linear rows, e.g. for GL upload or writing it to an image
+    void texture_read_level(const texture& t, uint32_t level, std::vector<uint32_t>& out);
+
+    //Mip level of detail from screen space derivatives of the (normalized) texture coordinates
+    float texture_lod(const texture& t, float dudx, float dvdx, float dudy, float dvdy);
+
+    //Bilinear sample of one level
+    //@param out rgba in [0, 1]
+    void sample_bilinear(const texture& t, uint32_t level, float u, float v, float* out);
+
+    //Bilinear samples of the two nearest levels blended by the fractional part of lod
+    void sample_trilinear(const texture& t, float u, float v, float lod, float* out);
+
+    //4 wide versions of the samplers. All the address and filter math is vectorized, only the texel loads are done one at a time.
+    texel4 sample_bilinear4(const texture& t, uint32_t level, lnal::f32x4 u, lnal::f32x4 v);
+    texel4 sample_trilinear4(const texture& t, lnal::f32x4 u, lnal::f32x4 v, lnal::f32x4 lod);
+
+    //Binary form of a texture for the asset cache
+    void write_texture(byte_writer& w, const texture& t);
+
+    //@return false if the data is truncated or inconsistent
+    bool read_texture(byte_reader& r, texture& t);
+}
@@ -0,0 +1,227 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../src/core/job.h"
+#include "../src/image/image_io.h"
+#include "../src/asset/asset_load.h"
+#include "../src/texture/atlas.h"
+
+//Writes an OBJ with one quad per material and a small texture of its own per material, in assorted (not only power of two) sizes, then
+//packs them into an atlas at a few gutter depths and reports how well the pages are used. Half the textures are patterned and checked
+//against the originals at the base level, the other half are solid colors: any other color showing up in them at a kept mip level is
+//bleeding from a neighbour. Last, the atlased import goes through the asset cache twice.
+
+static const char* DIRECTORY = "./cache/atlas_report";
+static const uint32_t MATERIALS = 96;
+static const uint32_t SIZES[] = { 16, 24, 32, 40, 48, 64, 96, 128 };
+static const uint32_t SAMPLES = 33;     //Per side of each texture, edges included
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static bool solid(uint32_t material) { return material % 2 == 1; }
+
+static uint32_t texture_width(uint32_t material) { return SIZES[(material * 5) % 8]; }
+static uint32_t texture_height(uint32_t material) { return SIZES[(material * 3 + 1) % 8]; }
+
+static uint32_t base_color(uint32_t material)
+{
+    uint32_t r = 40 + ((material * 67) % 200), g = 40 + ((material * 131) % 200), b = 40 + ((material * 29) % 200);
+    return 0xFF000000 | (b << 16) | (g << 8) | r;
+}
+
+static void write_assets()
+{
+    std::ofstream mtl(std::string(DIRECTORY) + "/quads.mtl");
+    std::ofstream obj(std::string(DIRECTORY) + "/quads.obj");
+    obj << "mtllib quads.mtl\nvt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvn 0 0 1\n";
+
+    for(uint32_t m = 0; m < MATERIALS; m++)
+    {
+        uint32_t w = texture_width(m), h = texture_height(m);
+        std::vector<uint32_t> pixels((size_t)w * h, base_color(m));
+        if(!solid(m))
+        {
+            for(uint32_t y = 0; y < h; y++)
+            {
+                for(uint32_t x = 0; x < w; x++)
+                {
+                    pixels[((size_t)y * w) + x] = ((x / 4) + (y / 4)) % 2 ? 0xFFFFFFFF : 0xFF000000 | (x * 255 / w) | ((y * 255 / h) << 8);
+                }
+            }
+        }
+
+        std::string image = "tex" + std::to_string(m) + ".ppm";
+        br::write_ppm((std::string(DIRECTORY) + "/" + image).c_str(), w, h, pixels.data());
+        mtl << "newmtl mat" << m << "\nKd 1 1 1\nmap_Kd " << image << "\n\n";
+
+        float x = (float)(m % 12) * 1.5f, y = (float)(m / 12) * 1.5f;
+        obj << "v " << x << " " << y << " 0\nv " << x + 1 << " " << y << " 0\nv " << x + 1 << " " << y + 1 << " 0\nv " << x << " " << y + 1 << " 0\n";
+        obj << "usemtl mat" << m << "\n";
+        uint32_t v = (m * 4) + 1;
+        obj << "f " << v << "/1/1 " << v + 1 << "/2/1 " << v + 2 << "/3/1 " << v + 3 << "/4/1\n";
+    }
+}
+
+int main()
+{
+    std::error_code error;
+    std::filesystem::remove_all(DIRECTORY, error);
+    std::filesystem::create_directories(DIRECTORY, error);
+    write_assets();
+
+    std::string obj = std::string(DIRECTORY) + "/quads.obj";
+
+    br::job_system js;
+    br::job_system_init(js);
+
+    br::mesh source;
+    br::material_library source_lib;
+    if(!br::load_obj(source, obj.c_str(), &source_lib))
+    {
+        std::cout << "couldn't load " << obj << std::endl;
+        return 1;
+    }
+    br::load_material_textures(source_lib, &js);
+
+    std::set<std::pair<uint32_t, uint32_t>> sizes;
+    for(const br::material_texture& t : source_lib.textures)
+    {
+        sizes.insert({ t.width, t.height });
+    }
+
+    std::cout << MATERIALS << " materials with a texture each in " << sizes.size() << " sizes: a texture array per size (only "
+              << br::MATERIAL_MAX_ARRAYS << " fit), or " << MATERIALS << " texture binds when drawn one material at a time" << std::endl << std::endl;
+    std::cout << "  levels  gutter   pages        packed   texels    gutters   efficiency   pack ms   base error   bleed" << std::endl;
+
+    for(uint32_t levels : { 1u, 2u, 4u })
+    {
+        br::atlas_settings settings;
+        settings.mip_levels = levels;
+
+        br::mesh m = source;
+        br::material_library lib = source_lib;
+        br::atlas_layout layout;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        uint32_t moved = br::build_material_atlas(lib, m, settings, &layout);
+        double pack_ms = elapsed_ms(start);
+
+        //Patterned textures against the originals at the base level, solid ones against their color at every kept level
+        float base_error = 0.0f, bleed = 0.0f;
+        for(uint32_t v = 0; v < br::mesh_vertex_count(m); v += 4)
+        {
+            //Library ids start after the default material
+            uint32_t material = m.materials[v];
+            uint32_t quad = material - 1;
+            uint32_t slot = lib.params[material].textures[br::MATERIAL_DIFFUSE_MAP];
+            const br::texture& page = lib.textures[lib.arrays[slot >> 16].layers[slot & 0xFFFF]].image;
+            const br::texture& original = source_lib.textures[source_lib.texture_refs[material * br::MATERIAL_TEXTURE_SLOTS]].image;
+
+            //The quad's corners before and after give the transform: on each axis one corner was at 0, another at 1
+            float scale[2], offset[2];
+            for(int k = 0; k < 2; k++)
+            {
+                float at_zero = 0.0f, at_one = 0.0f;
+                for(uint32_t c = v; c < v + 4; c++)
+                {
+                    float before = source.uvs[(c * 2) + k], after = m.uvs[(c * 2) + k];
+                    at_zero = before == 0.0f ? after : at_zero;
+                    at_one = before == 1.0f ? after : at_one;
+                }
+
+                scale[k] = at_one - at_zero;
+                offset[k] = at_zero;
+            }
+
+            uint32_t color = base_color(quad);
+            float expected[3] = { (float)(color & 0xFF) / 255.0f, (float)((color >> 8) & 0xFF) / 255.0f, (float)((color >> 16) & 0xFF) / 255.0f };
+
+            for(uint32_t i = 0; i < SAMPLES; i++)
+            {
+                for(uint32_t j = 0; j < SAMPLES; j++)
+                {
+                    float u = (float)i / (float)(SAMPLES - 1), t = (float)j / (float)(SAMPLES - 1);
+                    float au = (u * scale[0]) + offset[0], at = (t * scale[1]) + offset[1];
+
+                    if(!solid(quad))
+                    {
+                        float a[4], b[4];
+                        br::sample_bilinear(original, 0, u, t, a);
+                        br::sample_bilinear(page, 0, au, at, b);
+                        for(int k = 0; k < 3; k++)
+                        {
+                            base_error = fmaxf(base_error, fabsf(a[k] - b[k]));
+                        }
+                        continue;
+                    }
+
+                    for(uint32_t level = 0; level < page.levels.size(); level++)
+                    {
+                        float b[4];
+                        br::sample_bilinear(page, level, au, at, b);
+                        for(int k = 0; k < 3; k++)
+                        {
+                            bleed = fmaxf(bleed, fabsf(b[k] - expected[k]));
+                        }
+                    }
+                }
+            }
+        }
+
+        std::cout << std::fixed << std::setw(8) << levels << std::setw(8) << br::atlas_gutter(settings) << std::setw(5) << layout.page_count << " x "
+                  << std::setw(4) << layout.page_width << "x" << std::setw(4) << std::left << layout.page_height << std::right << std::setw(5) << moved
+                  << std::setprecision(1) << std::setw(8) << 100.0 * (double)layout.texture_area / (double)layout.page_area << "%"
+                  << std::setw(9) << 100.0 * (double)(layout.padded_area - layout.texture_area) / (double)layout.page_area << "%"
+                  << std::setw(12) << 100.0f * br::atlas_efficiency(layout) << "%" << std::setprecision(2) << std::setw(10) << pack_ms
+                  << std::setprecision(4) << std::setw(13) << base_error << std::setw(8) << bleed << std::endl;
+    }
+
+    std::cout << "  (texels / gutters: share of the pages holding texture texels / gutter and alignment texels)" << std::endl << std::endl;
+
+    //Atlased import through the cache, the pages are part of the entry
+    br::asset_cache cache;
+    cache.directory = std::string(DIRECTORY) + "/cache";
+    br::atlas_settings settings;
+
+    br::mesh_asset imported, cached;
+    auto start = std::chrono::high_resolution_clock::now();
+    bool ok = br::load_mesh_asset(imported, obj.c_str(), &cache, &js, &settings);
+    double import_ms = elapsed_ms(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    ok = ok && br::load_mesh_asset(cached, obj.c_str(), &cache, &js, &settings);
+    double cached_ms = elapsed_ms(start);
+
+    br::job_system_shutdown(js);
+
+    if(!ok)
+    {
+        std::cout << "couldn't import " << obj << std::endl;
+        return 1;
+    }
+
+    //Arrays aren't part of the entry, they're rebuilt when the remaining textures load
+    br::load_material_textures(cached.materials);
+
+    bool same = imported.m.uvs == cached.m.uvs && imported.materials.texture_refs == cached.materials.texture_refs &&
+                imported.materials.textures.size() == cached.materials.textures.size();
+    for(size_t t = 0; same && t < imported.materials.textures.size(); t++)
+    {
+        same = imported.materials.textures[t].image.texels == cached.materials.textures[t].image.texels;
+    }
+
+    std::cout << std::setprecision(2) << "  import with atlas " << import_ms << " ms, cached " << cached_ms << " ms" << (same ? "" : " (MISMATCH)") << ", "
+              << imported.materials.textures.size() << " textures left in " << imported.materials.arrays.size() << " arrays" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <vector>
+
+#include "../src/core/job.h"
+#include "../src/texture/texture.h"
+#include "../src/texture/bc.h"
+#include "../src/asset/asset_load.h"
+
+//Compresses procedural color / alpha / normal map textures to BC1, BC3 and BC5 and reports quality (PSNR of the channels each format stores),
+//encode throughput on one thread and on the job system, and the compression ratio. Then imports a PPM through the asset cache twice to
+//show the cached load time. Run from the repo root so the image path resolves.
+
+static const uint32_t TEXTURE_SIZE = 1024;
+static const char* CACHED_IMAGE = "./test/golden/teapot.ppm";
+static const char* CACHE_DIRECTORY = "./cache/bc_report";
+
+static uint32_t hash(uint32_t x, uint32_t y)
+{
+    uint32_t h = (x * 73856093u) ^ (y * 19349663u);
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    return h;
+}
+
+//Smooth gradients, hard checker edges and a little noise: the mix real albedo textures have. Alpha is a soft circle pattern.
+static void make_color(std::vector<uint32_t>& pixels)
+{
+    pixels.resize(TEXTURE_SIZE * TEXTURE_SIZE);
+
+    for(uint32_t y = 0; y < TEXTURE_SIZE; y++)
+    {
+        for(uint32_t x = 0; x < TEXTURE_SIZE; x++)
+        {
+            uint32_t noise = hash(x, y) & 0xF;
+            uint32_t checker = ((x >> 6) ^ (y >> 6)) & 1 ? 180 : 70;
+            uint32_t r = checker + noise;
+            uint32_t g = ((x * 255) / TEXTURE_SIZE + noise) & 0xFF;
+            uint32_t b = (uint32_t)(127.5f + 127.5f * sinf((float)(x + y) * 0.02f));
+
+            float dx = (float)(x & 127) - 64.0f;
+            float dy = (float)(y & 127) - 64.0f;
+            float d = sqrtf((dx * dx) + (dy * dy)) / 64.0f;
+            uint32_t a = (uint32_t)(255.0f * fminf(1.0f, fmaxf(0.0f, 1.5f - d)));
+
+            pixels[(size_t)y * TEXTURE_SIZE + x] = r | (g << 8) | (b << 16) | (a << 24);
+        }
+    }
+}
+
+//Tangent space normals of a bumpy height field, X / Y in R / G
+static void make_normals(std::vector<uint32_t>& pixels)
+{
+    pixels.resize(TEXTURE_SIZE * TEXTURE_SIZE);
+
+    for(uint32_t y = 0; y < TEXTURE_SIZE; y++)
+    {
+        for(uint32_t x = 0; x < TEXTURE_SIZE; x++)
+        {
+            float dhdx = 0.6f * cosf((float)x * 0.05f) * sinf((float)y * 0.03f);
+            float dhdy = 0.6f * sinf((float)x * 0.05f) * cosf((float)y * 0.03f);
+            float len = sqrtf((dhdx * dhdx) + (dhdy * dhdy) + 1.0f);
+
+            uint32_t r = (uint32_t)(((-dhdx / len) * 0.5f + 0.5f) * 255.0f + 0.5f);
+            uint32_t g = (uint32_t)(((-dhdy / len) * 0.5f + 0.5f) * 255.0f + 0.5f);
+            pixels[(size_t)y * TEXTURE_SIZE + x] = r | (g << 8) | 0xFF000000u;
+        }
+    }
+}
+
+static double psnr(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b, uint32_t channel_mask)
+{
+    double error = 0.0;
+    uint64_t count = 0;
+
+    for(size_t i = 0; i < a.size(); i++)
+    {
+        for(uint32_t k = 0; k < 4; k++)
+        {
+            if(!(channel_mask & (1u << k)))
+                continue;
+
+            double d = (double)((a[i] >> (k * 8)) & 0xFF) - (double)((b[i] >> (k * 8)) & 0xFF);
+            error += d * d;
+            count++;
+        }
+    }
+
+    double mse = error / (double)count;
+    return mse > 0.0 ? 10.0 * log10((255.0 * 255.0) / mse) : 99.0;
+}
+
+static double encode_ms(br::compressed_texture& out, const br::texture& t, br::bc_format format, br::job_system* js)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    br::compress_texture(out, t, format, js);
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//Random texel fetches have to agree with the whole level decode
+static bool fetch_matches(const br::compressed_texture& t, const std::vector<uint32_t>& decoded)
+{
+    const br::bc_level& l = t.levels[0];
+    for(uint32_t i = 0; i < 4096; i++)
+    {
+        uint32_t x = hash(i, 1) % l.width;
+        uint32_t y = hash(i, 2) % l.height;
+        if(br::bc_fetch(t, 0, x, y) != decoded[(size_t)y * l.width + x])
+            return false;
+    }
+
+    return true;
+}
+
+struct format_case
+{
+    const char* name;
+    br::bc_format format;
+    bool normals;
+    uint32_t channel_mask;
+};
+
+static const format_case CASES[] =
+{
+    { "BC1 color", br::BC1, false, 0x7 },
+    { "BC3 color", br::BC3, false, 0x7 },
+    { "BC3 alpha", br::BC3, false, 0x8 },
+    { "BC5 normal", br::BC5, true, 0x3 },
+};
+
+int main()
+{
+    br::job_system js;
+    br::job_system_init(js);
+
+    std::vector<uint32_t> color, normals;
+    make_color(color);
+    make_normals(normals);
+
+    br::texture color_texture, normal_texture;
+    br::texture_create(color_texture, TEXTURE_SIZE, TEXTURE_SIZE, color.data(), br::TEXTURE_LINEAR, br::MIP_BOX);
+    br::texture_create(normal_texture, TEXTURE_SIZE, TEXTURE_SIZE, normals.data(), br::TEXTURE_LINEAR, br::MIP_BOX);
+
+    double source_mb = (double)br::texture_bytes(color_texture) / (1024.0 * 1024.0);
+
+    std::cout << TEXTURE_SIZE << "x" << TEXTURE_SIZE << " with mips, " << br::job_thread_count(&js) << " threads" << std::endl << std::endl;
+    std::cout << "  format        PSNR dB   1 thread ms   jobs ms    MB/s   ratio   fetch" << std::endl;
+
+    std::vector<uint32_t> decoded;
+    for(const format_case& c : CASES)
+    {
+        const br::texture& source = c.normals ? normal_texture : color_texture;
+        const std::vector<uint32_t>& original = c.normals ? normals : color;
+
+        br::compressed_texture single, parallel;
+        double single_ms = encode_ms(single, source, c.format, nullptr);
+        double parallel_ms = encode_ms(parallel, source, c.format, &js);
+
+        br::decompress_level(parallel, 0, decoded);
+
+        bool same = single.data == parallel.data;
+        bool fetch = fetch_matches(parallel, decoded);
+
+        std::cout << "  " << std::left << std::setw(12) << c.name << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(9) << psnr(original, decoded, c.channel_mask)
+                  << std::setprecision(1) << std::setw(14) << single_ms
+                  << std::setw(10) << parallel_ms
+                  << std::setw(8) << source_mb / (parallel_ms / 1000.0)
+                  << std::setw(7) << (double)br::texture_bytes(source) / (double)parallel.data.size() << ":1"
+                  << "   " << (fetch && same ? "ok" : "MISMATCH") << std::endl;
+    }
+
+    //Cached import: the first load filters and encodes, the second only reads the entry back
+    std::error_code error;
+    std::filesystem::remove_all(CACHE_DIRECTORY, error);
+
+    br::asset_cache cache;
+    cache.directory = CACHE_DIRECTORY;
+
+    br::compressed_texture imported, cached;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    bool ok = br::load_compressed_texture_asset(imported, CACHED_IMAGE, br::BC1, &cache, &js);
+    double import_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    ok = ok && br::load_compressed_texture_asset(cached, CACHED_IMAGE, br::BC1, &cache, &js);
+    double cached_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    br::job_system_shutdown(js);
+
+    std::cout << std::endl;
+    if(!ok)
+    {
+        std::cout << "  couldn't load " << CACHED_IMAGE << std::endl;
+        return 1;
+    }
+
+    std::cout << "  " << CACHED_IMAGE << " as BC1: import " << import_ms << " ms, cached " << cached_ms << " ms"
+              << (imported.data == cached.data ? "" : " (MISMATCH)") << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../src/core/range_allocator.h"
+
+//Simulates what gl_mesh_pool sees while meshes stream in and out: a working set of meshes of very different sizes where every frame a few
+//are evicted and new ones loaded. The vertex and index ranges come from range_allocators that double when full, like the pool's buffers,
+//and the buffers themselves are mirrored in CPU memory with every mesh filled with its own id so the defragmentation moves can be checked.
+//Runs without defragmenting, with a per frame copy budget and with full compaction every frame, then prints fragmentation, bytes in use
+//and the cost of each against giving every mesh its own buffers.
+//Usage: buffer_report [resident meshes] [frames]
+
+static const uint32_t STRIDE = 24;                  //Quantized layout: unorm16 position, oct16 normal, half uv, snorm8 tangent, material id
+static const uint32_t CHURN = 8;                    //Meshes evicted and loaded per frame
+static const uint64_t FRAME_BUDGET = 4 << 20;       //Bytes of copies per frame for the budgeted run
+static const float DEFRAG_THRESHOLD = 0.25f;
+
+struct sim_mesh
+{
+    uint32_t id;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    br::range_handle vertices;
+    br::range_handle indices;
+};
+
+//One range allocator with the buffer it manages
+struct sim_buffer
+{
+    br::range_allocator ranges;
+    std::vector<uint32_t> data;     //One word per unit, a unit's value is the id of the mesh in it
+    uint32_t grows = 0;
+};
+
+struct run_result
+{
+    br::range_stats vertices;
+    br::range_stats indices;
+    uint64_t bytes_moved = 0;
+    uint32_t defrag_frames = 0;
+    uint32_t grows = 0;
+    double alloc_ns = 0.0;          //Per range_alloc / range_free
+    double defrag_us = 0.0;         //Per range_defragment call that ran, without the copies
+    float worst_fragmentation = 0.0f;
+    bool intact = true;
+};
+
+//Only the allocator calls are timed, not growing the mirrored buffer
+static br::range_handle alloc_growing(sim_buffer& b, uint32_t count, double& seconds)
+{
+    auto start = std::chrono::steady_clock::now();
+    br::range_handle h = br::range_alloc(b.ranges, count);
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if(h != br::RANGE_NONE)
+        return h;
+
+    uint32_t capacity = std::max(b.ranges.capacity * 2, b.ranges.capacity + count);
+    br::range_grow(b.ranges, capacity);
+    b.data.resize(capacity);
+    b.grows++;
+    return br::range_alloc(b.ranges, count);
+}
+
+//memmove stands in for the scratch buffer round trip of the GL pool
+static void apply_moves(sim_buffer& b, const std::vector<br::range_move>& moves)
+{
+    for(const br::range_move& m : moves)
+    {
+        memmove(&b.data[m.to], &b.data[m.from], sizeof(uint32_t) * m.size);
+    }
+}
+
+static bool check(const sim_buffer& b, br::range_handle h, uint32_t id)
+{
+    uint32_t offset = br::range_offset(b.ranges, h);
+    uint32_t size = br::range_size(b.ranges, h);
+    for(uint32_t i = 0; i < size; i++)
+    {
+        if(b.data[offset + i] != id)
+            return false;
+    }
+
+    return true;
+}
+
+//Log uniform sizes from small props to a hero mesh with all its LODs, about two triangles per vertex
+static void random_mesh(std::mt19937& rng, sim_mesh& m, uint32_t id)
+{
+    std::uniform_real_distribution<float> log_size(5.0f, 15.0f);
+    m.id = id;
+    m.vertex_count = (uint32_t)std::exp2(log_size(rng));
+    m.index_count = m.vertex_count * 6 - (m.vertex_count * 6) % 3;
+}
+
+//@param budget bytes of copies per frame, 0 for full compaction, ~0 to never defragment
+static run_result run(uint32_t resident, uint32_t frames, uint64_t budget)
+{
+    run_result r;
+    std::mt19937 rng(1234);
+    std::vector<br::range_move> moves;
+    std::vector<uint32_t> scratch;
+
+    sim_buffer vertices, indices;
+    br::range_allocator_init(vertices.ranges, 1 << 16);
+    br::range_allocator_init(indices.ranges, 1 << 18);
+    vertices.data.resize(vertices.ranges.capacity);
+    indices.data.resize(indices.ranges.capacity);
+
+    std::vector<sim_mesh> meshes(resident);
+    uint32_t next_id = 1;
+    uint64_t ops = 0, defrags = 0;
+    double alloc_seconds = 0.0, defrag_seconds = 0.0;
+
+    auto load = [&](sim_mesh& m)
+    {
+        random_mesh(rng, m, next_id++);
+
+        m.vertices = alloc_growing(vertices, m.vertex_count, alloc_seconds);
+        m.indices = alloc_growing(indices, m.index_count, alloc_seconds);
+        ops += 2;
+
+        std::fill_n(&vertices.data[br::range_offset(vertices.ranges, m.vertices)], m.vertex_count, m.id);
+        std::fill_n(&indices.data[br::range_offset(indices.ranges, m.indices)], m.index_count, m.id);
+    };
+
+    for(sim_mesh& m : meshes)
+    {
+        load(m);
+    }
+
+    std::uniform_int_distribution<uint32_t> pick(0, resident - 1);
+    for(uint32_t frame = 0; frame < frames; frame++)
+    {
+        for(uint32_t c = 0; c < CHURN; c++)
+        {
+            sim_mesh& m = meshes[pick(rng)];
+
+            auto start = std::chrono::steady_clock::now();
+            br::range_free(vertices.ranges, m.vertices);
+            br::range_free(indices.ranges, m.indices);
+            alloc_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            ops += 2;
+
+            load(m);
+        }
+
+        br::range_stats vs = br::range_allocator_stats(vertices.ranges);
+        br::range_stats is = br::range_allocator_stats(indices.ranges);
+        r.worst_fragmentation = std::max(r.worst_fragmentation, std::max(vs.fragmentation, is.fragmentation));
+
+        if(budget == ~0ull || (vs.fragmentation <= DEFRAG_THRESHOLD && is.fragmentation <= DEFRAG_THRESHOLD))
+            continue;
+
+        //Same split as gl_mesh_pool_defragment: vertices first, indices get what's left of the budget
+        auto start = std::chrono::steady_clock::now();
+        uint32_t vertex_budget = budget ? (uint32_t)(budget / STRIDE) : 0;
+        uint64_t moved = (uint64_t)br::range_defragment(vertices.ranges, moves, scratch, vertex_budget) * STRIDE;
+        defrag_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        apply_moves(vertices, moves);
+
+        if(!budget || moved + sizeof(uint32_t) <= budget)
+        {
+            start = std::chrono::steady_clock::now();
+            uint32_t index_budget = budget ? (uint32_t)((budget - moved) / sizeof(uint32_t)) : 0;
+            moved += (uint64_t)br::range_defragment(indices.ranges, moves, scratch, index_budget) * sizeof(uint32_t);
+            defrag_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            apply_moves(indices, moves);
+        }
+
+        r.bytes_moved += moved;
+        r.defrag_frames++;
+        defrags++;
+    }
+
+    for(const sim_mesh& m : meshes)
+    {
+        r.intact = r.intact && check(vertices, m.vertices, m.id) && check(indices, m.indices, m.id);
+    }
+
+    r.vertices = br::range_allocator_stats(vertices.ranges);
+    r.indices = br::range_allocator_stats(indices.ranges);
+    r.grows = vertices.grows + indices.grows;
+    r.alloc_ns = (alloc_seconds * 1e9) / (double)ops;
+    r.defrag_us = defrags ? (defrag_seconds * 1e6) / (double)defrags : 0.0;
+    return r;
+}
+
+static double mb(uint64_t bytes)
+{
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+static void print(const char* name, const run_result& r, uint32_t frames)
+{
+    uint64_t used = ((uint64_t)r.vertices.used * STRIDE) + (sizeof(uint32_t) * (uint64_t)r.indices.used);
+    uint64_t capacity = ((uint64_t)r.vertices.capacity * STRIDE) + (sizeof(uint32_t) * (uint64_t)r.indices.capacity);
+
+    std::cout << std::setw(14) << std::left << name << std::right << std::fixed
+              << std::setw(9) << std::setprecision(1) << mb(used) << std::setw(10) << mb(capacity)
+              << std::setw(9) << std::setprecision(3) << r.vertices.fragmentation << std::setw(9) << r.indices.fragmentation
+              << std::setw(9) << r.worst_fragmentation
+              << std::setw(8) << r.vertices.free_blocks + r.indices.free_blocks
+              << std::setw(10) << std::setprecision(1) << mb(r.vertices.largest_free * (uint64_t)STRIDE)
+              << std::setw(7) << r.grows
+              << std::setw(10) << std::setprecision(2) << mb(r.bytes_moved) / frames
+              << std::setw(8) << r.defrag_frames
+              << std::setw(9) << std::setprecision(1) << r.alloc_ns << std::setw(10) << r.defrag_us
+              << (r.intact ? "   ok" : "   CORRUPT") << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t resident = argc > 1 ? (uint32_t)atoi(argv[1]) : 512;
+    uint32_t frames = argc > 2 ? (uint32_t)atoi(argv[2]) : 2000;
+    if(resident == 0 || frames == 0)
+    {
+        std::cerr << "resident meshes and frames must be positive" << std::endl;
+        return 1;
+    }
+
+    std::cout << resident << " resident meshes, " << CHURN << " replaced per frame for " << frames << " frames, " << STRIDE << " byte vertices" << std::endl;
+    std::cout << "Defragmenting runs on frames where either buffer's fragmentation (1 - largest hole / free space) is over " << DEFRAG_THRESHOLD << std::endl << std::endl;
+
+    std::cout << std::setw(14) << std::left << "" << std::right << std::setw(9) << "used MB" << std::setw(10) << "cap MB" << std::setw(9) << "v frag"
+              << std::setw(9) << "i frag" << std::setw(9) << "worst" << std::setw(8) << "holes" << std::setw(10) << "v hole MB" << std::setw(7) << "grows"
+              << std::setw(10) << "MB/frame" << std::setw(8) << "defrags" << std::setw(9) << "ns/op" << std::setw(10) << "us/defrag" << std::endl;
+
+    run_result none = run(resident, frames, ~0ull);
+    run_result budgeted = run(resident, frames, FRAME_BUDGET);
+    run_result full = run(resident, frames, 0);
+
+    print("none", none, frames);
+    print("4MB / frame", budgeted, frames);
+    print("full", full, frames);
+
+    //Per mesh buffers: a VBO, an EBO and a VAO each, a VAO bind per mesh drawn. Pooled: two buffers and a VAO per layout, one bind and one
+    //glMultiDrawElementsBaseVertex for every mesh in it.
+    std::cout << std::endl << "GL objects: " << resident * 3 << " with a VBO, EBO and VAO per mesh, 3 (+1 scratch) pooled" << std::endl;
+    std::cout << "VAO binds per frame drawing everything: " << resident << " per mesh, 1 pooled" << std::endl;
+
+    return (none.intact && budgeted.intact && full.intact) ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "../src/core/job.h"
+#include "../src/mesh/mesh.h"
+#include "../src/raster/framebuffer.h"
+#include "../src/raster/pipeline.h"
+#include "../src/raster/shaders.h"
+#include "../src/raster/deferred.h"
+#include "../src/scene/light.h"
+#include "../src/scene/cluster.h"
+
+//Light count scaling of the CPU deferred and clustered forward+ paths. Draws a floor with a grid of spheres into the G-buffer once, then lights
+//it with 16 - 1024 point lights, tiled (per tile light lists) against every light at every pixel. The forward+ column is the whole frame
+//(light assignment, raster and shading) since it has no separate geometry pass. Reports the time of each pass and how many lights the
+//tiles / clusters ended up with. Run from the repo root so the model path resolves.
+//Usage: deferred_bench [width] [height]
+
+static const uint32_t GRID = 6;
+static const float SPACING = 3.0f;
+static const float LIGHT_RADIUS = 2.5f;
+static const uint32_t TIMED_FRAMES = 5;
+static const uint32_t LIGHT_COUNTS[] = { 16, 64, 256, 1024 };
+
+static const float ALBEDO[][3] =
+{
+    { 0.6f, 0.6f, 0.6f },     //Floor
+    { 0.8f, 0.4f, 0.3f },
+    { 0.3f, 0.6f, 0.8f },
+};
+
+//A flat square on y = 0 facing up
+static void make_floor(br::mesh& m, float half_size)
+{
+    const float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+
+    for(const auto& c : corners)
+    {
+        m.positions.insert(m.positions.end(), { c[0] * half_size, 0.0f, c[1] * half_size });
+        m.normals.insert(m.normals.end(), { 0.0f, 1.0f, 0.0f });
+    }
+
+    m.indices = { 0, 2, 1, 0, 3, 2 };
+    m.lods.push_back({ 0, 6, 0.0f });
+    br::compute_bounds(m);
+}
+
+static float random01()
+{
+    return (float)rand() / (float)RAND_MAX;
+}
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t width = argc > 1 ? (uint32_t)atoi(argv[1]) : 640;
+    uint32_t height = argc > 2 ? (uint32_t)atoi(argv[2]) : 360;
+
+    br::mesh sphere;
+    if(!br::load_obj(sphere, "./ico-sphere.obj"))
+    {
+        std::cerr << "Failed to load ./ico-sphere.obj" << std::endl;
+        return 1;
+    }
+
+    float extent = GRID * SPACING * 0.5f;
+
+    br::mesh floor_mesh;
+    make_floor(floor_mesh, extent + SPACING);
+
+    br::job_system js;
+    br::job_system_init(js);
+
+    lnal::mat4 view;
+    lnal::lookat(view, lnal::vec3(0.0f, extent * 0.9f, extent * 1.6f), lnal::vec3(0.0f, 0.0f, -1.0f), lnal::vec3(0.0f, 1.0f, 0.0f));
+
+    lnal::mat4 projection;
+    lnal::gen_perspective_proj(projection, lnal::radians(70.0f), (float)width / (float)height, 0.5f, extent * 5.0f);
+
+    br::framebuffer gbuffer;
+    br::framebuffer_init(gbuffer, width, height);
+
+    //Calls draw(mesh, model, material) for every object: the floor, then the spheres in alternating materials
+    auto for_each_object = [&](const auto& draw)
+    {
+        draw(floor_mesh, lnal::mat4(1.0f), 0);
+
+        float sphere_scale = 0.8f / sphere.radius;
+        for(uint32_t z = 0; z < GRID; z++)
+        {
+            for(uint32_t x = 0; x < GRID; x++)
+            {
+                lnal::vec3 position(((float)x + 0.5f) * SPACING - extent, 0.8f, ((float)z + 0.5f) * SPACING - extent);
+                lnal::vec3 center(sphere.center[0] * sphere_scale, sphere.center[1] * sphere_scale, sphere.center[2] * sphere_scale);
+
+                lnal::mat4 model(1.0f);
+                lnal::scale(model, lnal::vec3(sphere_scale, sphere_scale, sphere_scale));
+                lnal::translate_relative(model, position - center);
+                draw(sphere, model, 1 + ((x + z) & 1));
+            }
+        }
+    };
+
+    br::raster_scratch scratch;
+
+    //Geometry pass: view space normals into the packed G-buffer
+    auto draw_geometry = [&]()
+    {
+        br::framebuffer_clear(gbuffer, 0);
+
+        for_each_object([&](const br::mesh& m, const lnal::mat4& model, uint32_t material)
+        {
+            lnal::mat4 model_view = view * model;
+            lnal::mat4 mvp = projection * model_view;
+
+            br::lambert_vertex_shader vs = { model_view, mvp };
+            br::gbuffer_fragment_shader fs = { material };
+            br::draw_shaded(gbuffer, m, &m.indices[m.lods[0].index_offset], m.lods[0].index_count, vs, fs, true, nullptr, &scratch);
+        });
+    };
+
+    draw_geometry();
+
+    double geometry_ms = 1e30;
+    for(uint32_t i = 0; i < TIMED_FRAMES; i++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        draw_geometry();
+        geometry_ms = fmin(geometry_ms, elapsed_ms(start));
+    }
+
+    std::cout << "Deferred light scaling, " << width << " x " << height << ", " << br::DEFERRED_TILE_SIZE << " px tiles, " << js.workers.size() + 1 << " threads" << std::endl;
+    std::cout << "G-buffer: " << (sizeof(uint32_t) + sizeof(float)) * width * height / 1024 << " KB (packed normal + material, depth), geometry pass "
+              << std::fixed << std::setprecision(2) << geometry_ms << " ms" << std::endl << std::endl;
+
+    std::cout << "  lights   avg/tile   max/tile   evals/px   tiled ms   all lights ms   speedup   fwd+ ms   avg/cluster" << std::endl;
+
+    br::framebuffer lit;
+    br::framebuffer_init(lit, width, height);
+    br::light_tiles tiles;
+
+    br::framebuffer forward;
+    br::framebuffer_init(forward, width, height);
+    br::light_clusters clusters;
+
+    //Clustered forward+: light assignment, then one shading pass straight from the geometry (no G-buffer)
+    auto draw_forward = [&](const std::vector<br::point_light>& view_lights)
+    {
+        br::framebuffer_clear(forward, 0xFF000000);
+        br::assign_lights(clusters, view_lights.data(), (uint32_t)view_lights.size(), projection, width, height, &js);
+
+        for_each_object([&](const br::mesh& m, const lnal::mat4& model, uint32_t material)
+        {
+            lnal::mat4 model_view = view * model;
+            lnal::mat4 mvp = projection * model_view;
+
+            br::phong_vertex_shader vs = { model_view, mvp };
+            br::clustered_fragment_shader fs = { &clusters, view_lights.data(), { ALBEDO[material][0], ALBEDO[material][1], ALBEDO[material][2] } };
+            br::draw_shaded(forward, m, &m.indices[m.lods[0].index_offset], m.lods[0].index_count, vs, fs, true, nullptr, &scratch);
+        });
+    };
+
+    srand(1);
+
+    for(uint32_t light_count : LIGHT_COUNTS)
+    {
+        std::vector<br::point_light> lights(light_count);
+        for(br::point_light& l : lights)
+        {
+            l.position[0] = (random01() * 2.0f - 1.0f) * extent;
+            l.position[1] = 0.2f + random01() * 2.0f;
+            l.position[2] = (random01() * 2.0f - 1.0f) * extent;
+            l.radius = LIGHT_RADIUS;
+            l.color[0] = 0.2f + random01() * 0.8f;
+            l.color[1] = 0.2f + random01() * 0.8f;
+            l.color[2] = 0.2f + random01() * 0.8f;
+        }
+
+        std::vector<br::point_light> view_lights(light_count);
+        br::transform_lights(view, lights.data(), light_count, view_lights.data());
+
+        br::deferred_lighting lighting;
+        lighting.projection = projection;
+        lighting.lights = view_lights.data();
+        lighting.light_count = light_count;
+        lighting.albedo = &ALBEDO[0][0];
+        lighting.material_count = sizeof(ALBEDO) / sizeof(ALBEDO[0]);
+
+        double times[2] = { 1e30, 1e30 };
+        br::deferred_stats stats;
+
+        for(uint32_t mode = 0; mode < 2; mode++)
+        {
+            lighting.tiled = mode == 0;
+
+            for(uint32_t i = 0; i < TIMED_FRAMES; i++)
+            {
+                br::deferred_stats frame_stats;
+                auto start = std::chrono::high_resolution_clock::now();
+                br::deferred_shade(lit, gbuffer, lighting, tiles, &js, &frame_stats);
+                times[mode] = fmin(times[mode], elapsed_ms(start));
+
+                if(mode == 0)
+                    stats = frame_stats;
+            }
+        }
+
+        double forward_ms = 1e30;
+        for(uint32_t i = 0; i < TIMED_FRAMES; i++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            draw_forward(view_lights);
+            forward_ms = fmin(forward_ms, elapsed_ms(start));
+        }
+
+        uint32_t tile_count = tiles.tiles_x * tiles.tiles_y;
+        double cluster_count = (double)clusters.offsets.size() - 1.0;
+        double pixels = stats.pixels_shaded > 0 ? (double)stats.pixels_shaded : 1.0;
+
+        std::cout << std::setw(8) << light_count
+                  << std::setw(11) << std::setprecision(1) << (double)stats.tile_lights / tile_count
+                  << std::setw(11) << stats.max_tile_lights
+                  << std::setw(11) << std::setprecision(2) << (double)stats.light_evaluations * 4.0 / pixels
+                  << std::setw(11) << times[0]
+                  << std::setw(16) << times[1]
+                  << std::setw(9) << std::setprecision(1) << times[1] / times[0] << "x"
+                  << std::setw(10) << std::setprecision(2) << forward_ms
+                  << std::setw(14) << (double)clusters.indices.size() / cluster_count << std::endl;
+    }
+
+    br::job_system_shutdown(js);
+
+    return 0;
+}
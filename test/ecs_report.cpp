@@ -0,0 +1,158 @@
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+#include "../src/core/job.h"
+#include "../src/scene/ecs.h"
+#include "../src/scene/scene_graph.h"
+
+//Exercises the ECS from outside ecs.cpp: entity create / destroy with generations, component add / remove / overwrite, pool_sort_like,
+//ecs_each single threaded and over the job system, and the two built in systems against a scene graph. Every check prints ok or FAIL and
+//the exit code is the number of failures. Ends with the time of an ecs_each pass over every transform.
+//Usage: ecs_report [entities]
+
+static uint32_t failures = 0;
+
+static void check(const char* name, bool ok)
+{
+    std::cout << std::setw(44) << std::left << name << (ok ? " ok" : " FAIL") << std::endl;
+    failures += ok ? 0 : 1;
+}
+
+//Every entity gets a transform, every second a mesh, every third bounds
+static void build(br::ecs_world& world, std::vector<br::entity>& entities, uint32_t count)
+{
+    for(uint32_t i = 0; i < count; i++)
+    {
+        br::entity e = br::ecs_create(world);
+        entities.push_back(e);
+
+        br::transform_component t;
+        t.world = lnal::mat4(1.0f);
+        lnal::translate_absolute(t.world, lnal::vec3((float)i, 0.0f, 0.0f));
+        br::pool_add(world.transforms, e, t);
+
+        if(i % 2 == 0)
+            br::pool_add(world.meshes, e, br::mesh_component{ i, 0 });
+
+        if(i % 3 == 0)
+            br::pool_add(world.bounds, e, br::bounds_component{ { 0.0f, 1.0f, 0.0f }, 2.0f, { 0.0f, 0.0f, 0.0f }, 0.0f });
+    }
+}
+
+//Visits every entity with a mesh and a transform and checks each one is seen exactly once with its own components
+static bool each_visits(br::ecs_world& world, br::job_system* js, uint32_t count)
+{
+    std::vector<std::atomic<uint32_t>> seen(count);
+    std::atomic<uint32_t> wrong{0};
+
+    br::ecs_each(js, 64, [&](br::entity e, br::mesh_component& m, br::transform_component& t)
+    {
+        uint32_t index = br::entity_index(e);
+        if(m.mesh != index || t.world.data()[12] != (float)index)
+            wrong++;
+
+        seen[index]++;
+    }, world.meshes, world.transforms);
+
+    bool ok = wrong == 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        ok = ok && seen[i] == (i % 2 == 0 ? 1u : 0u);
+    }
+
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000;
+    if(count < 16 || count > br::ENTITY_INDEX_MASK)
+    {
+        std::cerr << "entities must be between 16 and " << br::ENTITY_INDEX_MASK << std::endl;
+        return 1;
+    }
+
+    br::job_system js;
+    br::job_system_init(js);
+
+    br::ecs_world world;
+    std::vector<br::entity> entities;
+    build(world, entities, count);
+
+    check("create", world.alive == count && br::ecs_alive(world, entities.back()));
+    check("pool sizes", world.transforms.dense.size() == count && world.meshes.dense.size() == (count + 1) / 2
+                        && world.bounds.dense.size() == (count + 2) / 3);
+    check("pool_has / pool_get", br::pool_has(world.meshes, entities[2]) && !br::pool_has(world.meshes, entities[1])
+                                 && br::pool_get(world.meshes, entities[4])->mesh == 4 && br::pool_get(world.meshes, entities[3]) == nullptr);
+
+    br::pool_add(world.meshes, entities[0], br::mesh_component{ 0, 3 });
+    check("add overwrites", world.meshes.dense.size() == (count + 1) / 2 && br::pool_get(world.meshes, entities[0])->lod == 3);
+
+    check("each, single threaded", each_visits(world, nullptr, count));
+    check("each, job system", each_visits(world, &js, count));
+
+    //Sorting lines the mesh entities up at the front of the transforms without changing what each entity has
+    br::pool_sort_like(world.transforms, world.meshes);
+    bool aligned = true;
+    for(size_t i = 0; i < world.meshes.dense.size(); i++)
+    {
+        aligned = aligned && world.transforms.dense[i] == world.meshes.dense[i];
+    }
+    check("pool_sort_like", aligned && each_visits(world, &js, count));
+
+    //Removing swaps the last component into the hole, the moved entity has to stay reachable
+    br::entity moved = world.meshes.dense.back();
+    br::pool_remove(world.meshes, world.meshes.dense[0]);
+    check("pool_remove", world.meshes.dense.size() == (count + 1) / 2 - 1 && br::pool_has(world.meshes, moved)
+                         && !br::pool_has(world.meshes, entities[0]));
+    br::pool_add(world.meshes, entities[0], br::mesh_component{ 0, 0 });
+
+    //Destroyed slots come back with a new generation, the old handle stays dead
+    br::entity dead = entities[5];
+    br::ecs_destroy(world, dead);
+    br::entity reused = br::ecs_create(world);
+    check("destroy / reuse", !br::ecs_alive(world, dead) && br::ecs_alive(world, reused) && br::entity_index(reused) == br::entity_index(dead)
+                             && !br::pool_has(world.transforms, dead) && !br::pool_has(world.transforms, reused));
+    br::ecs_destroy(world, reused);
+
+    //Built in systems: every third entity follows a scene node moved 10 up
+    br::scene_graph graph;
+    lnal::mat4 up(1.0f);
+    lnal::translate_absolute(up, lnal::vec3(0.0f, 10.0f, 0.0f));
+    for(uint32_t i = 0; i < count; i += 3)
+    {
+        if(!br::ecs_alive(world, entities[i]))
+            continue;
+
+        br::pool_add(world.scene_nodes, entities[i], br::scene_add_node(graph, -1, up));
+    }
+    br::scene_update(graph, &js);
+    br::ecs_sync_transforms(world, graph, &js);
+    br::ecs_update_bounds(world, &js);
+
+    bool bounds_ok = true;
+    for(const br::bounds_component& b : world.bounds.data)
+    {
+        bounds_ok = bounds_ok && b.world_center[1] == 11.0f && b.world_radius == 2.0f;
+    }
+    check("sync_transforms / update_bounds", bounds_ok && !world.bounds.data.empty());
+
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<uint32_t> visited{0};
+    br::ecs_each(&js, 2048, [&visited](br::entity, br::transform_component& t)
+    {
+        t.world.data()[14] += 1.0f;
+        visited.fetch_add(1, std::memory_order_relaxed);
+    }, world.transforms);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::endl << visited << " transforms in " << std::fixed << std::setprecision(3) << ms << " ms on " << br::job_thread_count(&js)
+              << " threads" << std::endl;
+
+    br::job_system_shutdown(js);
+    return (int)failures;
+}
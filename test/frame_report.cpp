@@ -0,0 +1,414 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "../src/core/arena.h"
+#include "../src/core/job.h"
+#include "../src/mesh/mesh.h"
+#include "../src/raster/framebuffer.h"
+#include "../src/raster/raster.h"
+#include "../src/scene/ecs.h"
+#include "../src/scene/frustum.h"
+#include "../src/scene/scene_graph.h"
+
+//Runs a small CPU frame loop twice: animate a scene graph, copy it into the ECS, frustum cull into per thread visible lists, sort them by
+//mesh, material and depth, cut the sorted list into draw bins, fill per draw constants and rasterize. The first run keeps its transient
+//lists in std::vectors made every frame, the second in frame arenas. A replaced global operator new counts every heap allocation on every
+//thread; after warm up the arena run shouldn't make any. The constants of each frame are checked again one frame later, while the next
+//frame is built, to show the double buffered arenas keep them intact. Run from the repo root so the model path resolves.
+//Usage: frame_report [objects] [frames]
+
+static const uint32_t WIDTH = 480;
+static const uint32_t HEIGHT = 270;
+static const uint32_t GROUPS = 128;
+static const uint32_t MATERIALS = 8;
+static const uint32_t WARM_UP = 10;     //Frames allowed to allocate while every list and arena finds its size
+
+static std::atomic<uint64_t> heap_allocations{0};
+
+void* operator new(size_t size)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void* p = malloc(size ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+//What a GPU backend would upload for each draw
+struct draw_constants
+{
+    lnal::mat4 model;
+    float color[4];
+};
+
+//Consecutive sorted draws of one mesh
+struct draw_bin
+{
+    uint32_t mesh;
+    uint32_t first;
+    uint32_t count;
+};
+
+struct scene
+{
+    br::scene_graph graph;
+    br::ecs_world world;
+    std::vector<uint32_t> roots;
+    std::vector<lnal::vec3> root_positions;
+    const br::mesh* meshes[2];
+
+    lnal::mat4 projection;
+    lnal::mat4 view_proj;
+    br::framebuffer fb;
+    br::raster_scratch raster;
+    br::job_system* js;
+};
+
+//Transient lists on the heap, new ones every frame
+struct heap_lists
+{
+    template<typename T>
+    std::vector<T> make(uint32_t) { return std::vector<T>(); }
+};
+
+//Transient lists in the current frame's arena of the thread that fills them
+struct arena_lists
+{
+    br::frame_allocator* fa;
+
+    template<typename T>
+    br::arena_vector<T> make(uint32_t thread) { return br::arena_vector<T>(br::arena_allocator<T>(br::frame_arena(*fa, thread))); }
+};
+
+struct frame_result
+{
+    uint32_t visible;
+    uint32_t bins;
+    const draw_constants* constants;    //Left for "the GPU", valid until the frame's memory is reused
+    uint32_t constant_count;
+    uint64_t checksum;
+};
+
+static uint64_t checksum(const draw_constants* constants, uint32_t count)
+{
+    uint64_t sum = 1469598103934665603ull;
+    const uint8_t* bytes = (const uint8_t*)constants;
+    for(size_t i = 0; i < sizeof(draw_constants) * count; i++)
+    {
+        sum = (sum ^ bytes[i]) * 1099511628211ull;
+    }
+
+    return sum;
+}
+
+//Unit cube around the origin, counter clockwise from outside
+static void make_box(br::mesh& m)
+{
+    m.positions =
+    {
+        -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f, 0.5f, -0.5f,   -0.5f, 0.5f, -0.5f,
+        -0.5f, -0.5f, 0.5f,    0.5f, -0.5f, 0.5f,    0.5f, 0.5f, 0.5f,    -0.5f, 0.5f, 0.5f,
+    };
+
+    m.indices =
+    {
+        4, 5, 6, 4, 6, 7,       //+z
+        1, 0, 3, 1, 3, 2,       //-z
+        5, 1, 2, 5, 2, 6,       //+x
+        0, 4, 7, 0, 7, 3,       //-x
+        7, 6, 2, 7, 2, 3,       //+y
+        0, 1, 5, 0, 5, 4,       //-y
+    };
+
+    m.lods.push_back({ 0, 36, 0.0f });
+    br::compute_bounds(m);
+}
+
+//GROUPS spinning groups on a ring, each with its objects orbiting around it
+static void build_scene(scene& s, uint32_t object_count)
+{
+    uint32_t per_group = (object_count + GROUPS - 1) / GROUPS;
+    srand(5);
+
+    for(uint32_t g = 0; g < GROUPS; g++)
+    {
+        float angle = (2.0f * PI * g) / GROUPS;
+        lnal::vec3 position(cosf(angle) * 40.0f, 0.0f, sinf(angle) * 40.0f);
+
+        lnal::mat4 local(1.0f);
+        lnal::translate_absolute(local, position);
+        s.roots.push_back(br::scene_add_node(s.graph, -1, local));
+        s.root_positions.push_back(position);
+
+        for(uint32_t i = 0; i < per_group && (g * per_group) + i < object_count; i++)
+        {
+            float a = (2.0f * PI * i) / per_group;
+            float r = 2.0f + ((float)rand() / (float)RAND_MAX) * 4.0f;
+
+            lnal::mat4 child(1.0f);
+            lnal::scale(child, lnal::vec3(0.6f, 0.6f, 0.6f));
+            lnal::translate_absolute(child, lnal::vec3(cosf(a) * r, ((float)rand() / (float)RAND_MAX) * 4.0f - 2.0f, sinf(a) * r));
+            uint32_t node = br::scene_add_node(s.graph, (int32_t)s.roots.back(), child);
+
+            uint32_t mesh = rand() % 2;
+            const br::mesh& m = *s.meshes[mesh];
+
+            br::entity e = br::ecs_create(s.world);
+            br::pool_add(s.world.scene_nodes, e, node);
+            br::pool_add(s.world.transforms, e, { child });
+            br::pool_add(s.world.meshes, e, { mesh, 0 });
+            br::pool_add(s.world.materials, e, { (uint32_t)rand() % MATERIALS });
+            br::pool_add(s.world.bounds, e, { { m.center[0], m.center[1], m.center[2] }, m.radius, { 0.0f, 0.0f, 0.0f }, 0.0f });
+        }
+    }
+
+    br::pool_sort_like(s.world.transforms, s.world.scene_nodes);
+    br::pool_sort_like(s.world.bounds, s.world.scene_nodes);
+    br::pool_sort_like(s.world.meshes, s.world.bounds);
+    br::pool_sort_like(s.world.materials, s.world.bounds);
+    br::scene_update(s.graph);
+}
+
+template<typename Lists>
+static frame_result render_frame(scene& s, uint32_t frame, Lists& lists)
+{
+    //Spin every group, which dirties the whole graph
+    for(uint32_t g = 0; g < GROUPS; g++)
+    {
+        lnal::mat4 local(1.0f);
+        lnal::vec3 axis(0.0f, 1.0f, 0.0f);
+        lnal::rotate(local, axis, (float)frame * 0.02f * (float)((g % 3) + 1));
+        lnal::translate_absolute(local, s.root_positions[g]);
+        br::scene_set_local(s.graph, s.roots[g], local);
+    }
+
+    br::scene_update(s.graph, s.js);
+    br::ecs_sync_transforms(s.world, s.graph, s.js);
+    br::ecs_update_bounds(s.world, s.js);
+
+    br::frustum f;
+    br::extract_frustum(f, s.view_proj);
+
+    //Each thread appends to its own list. How the chunks land on threads changes every frame, so every list gets room for all objects.
+    uint32_t threads = br::job_thread_count(s.js);
+    auto visible = lists.template make<decltype(lists.template make<br::entity>(0))>(0);
+    visible.reserve(threads);
+    for(uint32_t t = 0; t < threads; t++)
+    {
+        visible.push_back(lists.template make<br::entity>(t));
+        visible.back().reserve(s.world.bounds.dense.size());
+    }
+
+    br::ecs_each(s.js, 1024, [&](br::entity e, br::bounds_component& b)
+    {
+        if(br::sphere_in_frustum(f, b.world_center, b.world_radius))
+            visible[br::job_thread_index()].push_back(e);
+    }, s.world.bounds);
+
+    //Sort keys: mesh, material, then front to back depth, with the entity index in the low bits
+    uint32_t visible_count = 0;
+    for(const auto& list : visible)
+    {
+        visible_count += (uint32_t)list.size();
+    }
+
+    auto keys = lists.template make<uint64_t>(0);
+    keys.reserve(visible_count);
+    for(const auto& list : visible)
+    {
+        for(br::entity e : list)
+        {
+            const br::bounds_component& b = *br::pool_get(s.world.bounds, e);
+            lnal::vec3 clip = lnal::transform_point(s.view_proj, lnal::vec3(b.world_center[0], b.world_center[1], b.world_center[2]));
+            uint32_t depth = (uint32_t)std::min(std::max(clip[2], 0.0f), 1023.0f);
+
+            uint64_t key = ((uint64_t)br::pool_get(s.world.meshes, e)->mesh << 48) | ((uint64_t)br::pool_get(s.world.materials, e)->material << 40) |
+                           ((uint64_t)depth << 24) | br::entity_index(e);
+            keys.push_back(key);
+        }
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    auto bins = lists.template make<draw_bin>(0);
+    auto constants = lists.template make<draw_constants>(0);
+    constants.resize(keys.size());
+
+    for(uint32_t i = 0; i < keys.size(); i++)
+    {
+        uint32_t mesh = (uint32_t)(keys[i] >> 48);
+        if(bins.empty() || bins.back().mesh != mesh)
+            bins.push_back({ mesh, i, 0 });
+        bins.back().count++;
+
+        br::entity e = (br::entity)(keys[i] & 0xFFFFFF);
+        e |= (uint32_t)s.world.generations[e] << br::ENTITY_GENERATION_SHIFT;
+
+        uint32_t material = (uint32_t)(keys[i] >> 40) & 0xFF;
+        constants[i].model = br::pool_get(s.world.transforms, e)->world;
+        constants[i].color[0] = 0.3f + 0.1f * (float)(material % 4);
+        constants[i].color[1] = 0.3f + 0.08f * (float)material;
+        constants[i].color[2] = 0.8f - 0.09f * (float)material;
+        constants[i].color[3] = 1.0f;
+    }
+
+    br::framebuffer_clear(s.fb, br::pack_color(0.1f, 0.1f, 0.12f));
+
+    br::draw_state state;
+    state.view_proj = s.view_proj;
+    lnal::vec3 light(0.4f, 0.8f, 0.45f);
+    light.normalize();
+    state.light_dir[0] = light[0]; state.light_dir[1] = light[1]; state.light_dir[2] = light[2];
+
+    for(const draw_bin& bin : bins)
+    {
+        const br::mesh& m = *s.meshes[bin.mesh];
+        for(uint32_t i = bin.first; i < bin.first + bin.count; i++)
+        {
+            state.model = constants[i].model;
+            memcpy(state.color, constants[i].color, sizeof(state.color));
+            br::draw_mesh(s.fb, m, &m.indices[m.lods[0].index_offset], m.lods[0].index_count, state, nullptr, &s.raster);
+        }
+    }
+
+    return { visible_count, (uint32_t)bins.size(), constants.data(), (uint32_t)constants.size(), checksum(constants.data(), (uint32_t)constants.size()) };
+}
+
+struct run_result
+{
+    uint64_t first_frame;       //Heap allocations in the first frame
+    uint64_t warm_up;           //... in the warm up frames
+    uint64_t steady;            //... in every frame after them
+    uint32_t steady_frames;
+    double frame_ms;
+    uint32_t visible;
+    uint32_t bins;
+    bool previous_intact;
+};
+
+template<typename Lists>
+static run_result run(scene& s, uint32_t frames, Lists& lists, br::frame_allocator* fa)
+{
+    run_result result = {};
+    result.previous_intact = true;
+    frame_result previous = {};
+    double total_ms = 0.0;
+
+    for(uint32_t f = 0; f < frames; f++)
+    {
+        uint64_t before = heap_allocations.load();
+        auto start = std::chrono::high_resolution_clock::now();
+
+        if(fa)
+            br::frame_begin(*fa);
+
+        frame_result current = render_frame(s, f, lists);
+
+        //The previous frame is still "in flight", its constants must not have been touched by this one
+        if(fa && f > 0)
+            result.previous_intact &= checksum(previous.constants, previous.constant_count) == previous.checksum;
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        uint64_t made = heap_allocations.load() - before;
+
+        if(f == 0)
+            result.first_frame = made;
+
+        if(f < WARM_UP)
+        {
+            result.warm_up += made;
+        }
+        else
+        {
+            result.steady += made;
+            result.steady_frames++;
+            total_ms += ms;
+        }
+
+        result.visible = current.visible;
+        result.bins = current.bins;
+        previous = current;
+    }
+
+    result.frame_ms = result.steady_frames ? total_ms / result.steady_frames : 0.0;
+    return result;
+}
+
+static void print(const char* name, const run_result& r)
+{
+    std::cout << std::fixed << std::setprecision(2) << "  " << std::setw(8) << std::left << name << std::right << std::setw(12) << r.first_frame
+              << std::setw(15) << r.warm_up << std::setw(15) << r.steady << std::setw(14)
+              << (r.steady_frames ? (double)r.steady / r.steady_frames : 0.0) << std::setw(11) << r.frame_ms << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t object_count = argc > 1 ? (uint32_t)atoi(argv[1]) : 8192;
+    uint32_t frames = argc > 2 ? (uint32_t)atoi(argv[2]) : 60;
+    if(object_count == 0 || object_count > br::ENTITY_INDEX_MASK || frames <= WARM_UP)
+    {
+        std::cerr << "objects must be positive and frames more than " << WARM_UP << std::endl;
+        return 1;
+    }
+
+    br::mesh sphere, box;
+    if(!br::load_obj(sphere, "./ico-sphere.obj"))
+    {
+        std::cerr << "Failed to load ./ico-sphere.obj" << std::endl;
+        return 1;
+    }
+    make_box(box);
+
+    br::job_system js;
+    br::job_system_init(js);
+
+    scene s;
+    s.meshes[0] = &sphere;
+    s.meshes[1] = &box;
+    s.js = &js;
+    build_scene(s, object_count);
+
+    lnal::mat4 view;
+    lnal::gen_perspective_proj(s.projection, lnal::radians(70.0f), (float)WIDTH / (float)HEIGHT, 0.5f, 200.0f);
+    lnal::lookat(view, lnal::vec3(0.0f, 25.0f, 70.0f), lnal::vec3(0.0f, 0.0f, 0.0f), lnal::vec3(0.0f, 1.0f, 0.0f));
+    s.view_proj = s.projection * view;
+    br::framebuffer_init(s.fb, WIDTH, HEIGHT);
+
+    heap_lists heap;
+    run_result vectors = run(s, frames, heap, (br::frame_allocator*)nullptr);
+
+    //Small on purpose, the arenas grow to what the frames need during warm up
+    br::frame_allocator fa;
+    br::frame_allocator_init(fa, br::job_thread_count(&js), 4096);
+    arena_lists arenas = { &fa };
+    run_result arena = run(s, frames, arenas, &fa);
+    br::arena_stats stats = br::frame_allocator_stats(fa);
+
+    uint32_t threads = br::job_thread_count(&js);
+    br::job_system_shutdown(js);
+
+    std::cout << object_count << " objects in " << GROUPS << " spinning groups, " << arena.visible << " visible in " << arena.bins << " bins, " << frames
+              << " frames of " << WIDTH << "x" << HEIGHT << " on " << threads << " threads" << std::endl << std::endl;
+    std::cout << "  heap allocations   first frame   first " << std::setw(2) << WARM_UP << " frames   after that     per frame   frame ms" << std::endl;
+    print("vectors", vectors);
+    print("arena", arena);
+
+    std::cout << std::endl << "  arenas: " << fa.arenas.size() << " (" << fa.frames_in_flight << " frames in flight x " << fa.thread_count << " threads), "
+              << stats.allocations << " allocations and " << stats.bytes / 1024 << " KB in the last frame, peak " << stats.peak / 1024
+              << " KB per arena, " << stats.overflows << " overflows and " << stats.heap_allocations << " arena heap blocks in all" << std::endl;
+    std::cout << "  previous frame's constants intact while the next frame is built: " << (arena.previous_intact ? "yes" : "NO") << std::endl;
+
+    br::frame_allocator_release(fa);
+    return arena.steady == 0 && arena.previous_intact ? 0 : 1;
+}
@@ -0,0 +1,576 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "../src/mesh/mesh.h"
+#include "../src/raster/framebuffer.h"
+#include "../src/raster/raster.h"
+#include "../src/raster/pipeline.h"
+#include "../src/raster/shaders.h"
+#include "../src/raster/deferred.h"
+#include "../src/raster/msaa.h"
+#include "../src/raster/shadow.h"
+#include "../src/scene/light.h"
+#include "../src/scene/cluster.h"
+#include "../src/image/image_io.h"
+#include "../src/image/image_diff.h"
+
+//Renders the bundled scenes headlessly, compares them against the golden images in test/golden and records frame times
+//Usage: golden_test [--update] [--json timings.json]
+//  --json defaults to ./cache/golden_timings.json, next to the other generated files and out of the tree
+//  --update rewrites the golden images from the current renderer (check the new images before committing them)
+//Run from the repo root so the model and golden paths resolve. Returns non zero if any scene fails.
+
+static const uint32_t WIDTH = 256;
+static const uint32_t HEIGHT = 256;
+static const uint32_t WARMUP_FRAMES = 2;
+static const uint32_t TIMED_FRAMES = 20;
+
+//A pixel matches if every channel is within PIXEL_TOLERANCE. A scene passes if almost every pixel matches and the images look structurally the same.
+static const uint32_t PIXEL_TOLERANCE = 8;
+static const double MAX_FRACTION_OVER_TOLERANCE = 0.001;
+static const double MIN_MEAN_SSIM = 0.99;
+
+//Point lights of the deferred / clustered scenes, spread over a shell around the model
+static const uint32_t DEFERRED_LIGHTS = 48;
+
+//Sample count of the multisampled scenes
+static const uint32_t MSAA_SAMPLES = 4;
+
+//Shadow maps of the shadowed scenes (per cascade for the directional light)
+static const uint32_t SHADOW_CASCADES = 3;
+static const uint32_t SHADOW_MAP_SIZE = 512;
+
+//draw_mesh's facet shading, one of the shader catalog pairs through draw_shaded, the G-buffer + tiled lighting path, clustered forward+,
+//Phong into a multisampled target or the model over a floor lit by a shadowed directional (cascades) or spot light
+enum golden_shading
+{
+    SHADE_FACETED,
+    SHADE_FLAT,
+    SHADE_LAMBERT,
+    SHADE_PHONG,
+    SHADE_DEFERRED,
+    SHADE_CLUSTERED,
+    SHADE_PHONG_MSAA,
+    SHADE_SHADOW_CASCADED,
+    SHADE_SHADOW_SPOT
+};
+
+struct golden_scene
+{
+    const char* name;
+    const char* model_path;
+
+    //Camera orbit around the model's bounding sphere in degrees
+    float yaw;
+    float pitch;
+
+    //0 puts the near plane in front of the model. Otherwise the near plane is this many bounding radii in front of the model's center so it
+    //cuts through the model (exercises near plane clipping), and back faces are drawn so the inside shows through the cut.
+    float near_cut;
+
+    golden_shading shading;
+    float color[3];
+};
+
+static const golden_scene SCENES[] =
+{
+    { "teapot", "./utah_teapot.obj", 35.0f, 20.0f, 0.0f, SHADE_FACETED, { 0.8f, 0.5f, 0.3f } },
+    { "ico_sphere", "./ico-sphere.obj", 20.0f, 30.0f, 0.0f, SHADE_FACETED, { 0.4f, 0.6f, 0.8f } },
+    { "teapot_cut", "./utah_teapot.obj", 60.0f, 25.0f, 0.3f, SHADE_FACETED, { 0.8f, 0.5f, 0.3f } },
+    { "teapot_flat", "./utah_teapot.obj", 35.0f, 20.0f, 0.0f, SHADE_FLAT, { 0.5f, 0.3f, 0.5f } },
+    { "ico_sphere_lambert", "./ico-sphere.obj", 20.0f, 30.0f, 0.0f, SHADE_LAMBERT, { 0.4f, 0.6f, 0.8f } },
+    { "ico_sphere_phong", "./ico-sphere.obj", 20.0f, 30.0f, 0.0f, SHADE_PHONG, { 0.4f, 0.6f, 0.8f } },
+    { "ico_sphere_deferred", "./ico-sphere.obj", 20.0f, 30.0f, 0.0f, SHADE_DEFERRED, { 0.8f, 0.8f, 0.8f } },
+    { "ico_sphere_clustered", "./ico-sphere.obj", 20.0f, 30.0f, 0.0f, SHADE_CLUSTERED, { 0.8f, 0.8f, 0.8f } },
+    { "ico_sphere_msaa", "./ico-sphere.obj", 20.0f, 30.0f, 0.0f, SHADE_PHONG_MSAA, { 0.4f, 0.6f, 0.8f } },
+    { "ico_sphere_shadow", "./ico-sphere.obj", 20.0f, 30.0f, 0.0f, SHADE_SHADOW_CASCADED, { 0.4f, 0.6f, 0.8f } },
+    { "ico_sphere_spot", "./ico-sphere.obj", 20.0f, 30.0f, 0.0f, SHADE_SHADOW_SPOT, { 0.4f, 0.6f, 0.8f } },
+};
+
+//Camera of a scene, kept apart for the passes that need view and projection separately
+struct golden_camera
+{
+    lnal::mat4 view;
+    lnal::mat4 projection;
+    float eye[3];
+};
+
+struct scene_result
+{
+    const golden_scene* scene;
+    bool loaded = false;
+    bool has_golden = false;
+    bool passed = false;
+    br::image_diff diff;
+
+    double min_ms = 0.0;
+    double median_ms = 0.0;
+    double mean_ms = 0.0;
+};
+
+static void setup_draw(const golden_scene& scene, const br::mesh& m, br::draw_state& state, golden_camera& camera)
+{
+    float fovx = lnal::radians(50.0f);
+    float distance = (m.radius / sinf(fovx * 0.5f)) * 1.05f;
+
+    float yaw = lnal::radians(scene.yaw);
+    float pitch = lnal::radians(scene.pitch);
+
+    lnal::vec3 center(m.center[0], m.center[1], m.center[2]);
+    lnal::vec3 eye = center + lnal::vec3(sinf(yaw) * cosf(pitch) * distance, sinf(pitch) * distance, cosf(yaw) * cosf(pitch) * distance);
+
+    lnal::mat4 view;
+    lnal::lookat(view, eye, center, lnal::vec3(0.0f, 1.0f, 0.0f));
+
+    lnal::mat4 projection;
+    float near_plane = distance - m.radius * 1.5f > 0.01f ? distance - m.radius * 1.5f : 0.01f;
+    if(scene.near_cut > 0.0f)
+        near_plane = distance - m.radius * scene.near_cut;
+
+    lnal::gen_perspective_proj(projection, fovx, (float)WIDTH / (float)HEIGHT, near_plane, distance + m.radius * 1.5f);
+
+    state.model = lnal::mat4(1.0f);
+    state.view_proj = projection * view;
+    state.cull_backfaces = scene.near_cut == 0.0f;
+    state.color[0] = scene.color[0];
+    state.color[1] = scene.color[1];
+    state.color[2] = scene.color[2];
+
+    lnal::vec3 light(0.4f, 0.8f, 0.45f);
+    light.normalize();
+    state.light_dir[0] = light[0];
+    state.light_dir[1] = light[1];
+    state.light_dir[2] = light[2];
+
+    camera.view = view;
+    camera.projection = projection;
+    camera.eye[0] = eye[0];
+    camera.eye[1] = eye[1];
+    camera.eye[2] = eye[2];
+}
+
+//Fibonacci spiral over a shell 1.2 radii out with hues around the color wheel, the same every run
+static void make_lights(const br::mesh& m, std::vector<br::point_light>& lights)
+{
+    lights.resize(DEFERRED_LIGHTS);
+
+    for(uint32_t i = 0; i < DEFERRED_LIGHTS; i++)
+    {
+        float y = 1.0f - (2.0f * ((float)i + 0.5f) / DEFERRED_LIGHTS);
+        float ring = sqrtf(1.0f - (y * y));
+        float angle = (float)i * 2.39996323f;
+
+        br::point_light& l = lights[i];
+        l.position[0] = m.center[0] + cosf(angle) * ring * m.radius * 1.2f;
+        l.position[1] = m.center[1] + y * m.radius * 1.2f;
+        l.position[2] = m.center[2] + sinf(angle) * ring * m.radius * 1.2f;
+        l.radius = m.radius * 0.8f;
+
+        float hue = (float)i / DEFERRED_LIGHTS * 6.2831853f;
+        l.color[0] = 0.6f + 0.6f * cosf(hue);
+        l.color[1] = 0.6f + 0.6f * cosf(hue - 2.0943951f);
+        l.color[2] = 0.6f + 0.6f * cosf(hue + 2.0943951f);
+    }
+}
+
+//The shadowed scenes shrink the model around its center so the floor and the shadow fit in the frame
+static const float SHADOW_MODEL_SCALE = 0.5f;
+
+//A square floor facing up just below the (shrunk) model, for the shadows to land on
+static void make_floor(const br::mesh& m, br::mesh& floor_mesh)
+{
+    const float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+    float half_size = m.radius * 1.4f;
+    float y = m.center[1] - (m.radius * SHADOW_MODEL_SCALE * 1.05f);
+
+    floor_mesh = br::mesh();
+    for(const auto& c : corners)
+    {
+        floor_mesh.positions.insert(floor_mesh.positions.end(), { m.center[0] + c[0] * half_size, y, m.center[2] + c[1] * half_size });
+        floor_mesh.normals.insert(floor_mesh.normals.end(), { 0.0f, 1.0f, 0.0f });
+    }
+
+    floor_mesh.indices = { 0, 2, 1, 0, 3, 2 };
+    floor_mesh.lods.push_back({ 0, 6, 0.0f });
+    br::compute_bounds(floor_mesh);
+}
+
+//Draws the shrunk model and the floor, draw(mesh, model matrix, indices, index_count, color) per object
+template<typename Draw>
+static void draw_with_floor(const br::mesh& m, const golden_scene& scene, const Draw& draw)
+{
+    static br::mesh floor_mesh;
+    make_floor(m, floor_mesh);
+
+    float s = SHADOW_MODEL_SCALE;
+    lnal::mat4 model(1.0f);
+    lnal::scale(model, lnal::vec3(s, s, s));
+    lnal::translate_relative(model, lnal::vec3(m.center[0] * (1.0f - s), m.center[1] * (1.0f - s), m.center[2] * (1.0f - s)));
+
+    static const float FLOOR_COLOR[3] = { 0.7f, 0.7f, 0.7f };
+    draw(m, model, &m.indices[m.lods[0].index_offset], m.lods[0].index_count, scene.color);
+    draw(floor_mesh, lnal::mat4(1.0f), floor_mesh.indices.data(), (uint32_t)floor_mesh.indices.size(), FLOOR_COLOR);
+}
+
+static void render(br::framebuffer& fb, const br::mesh& m, const golden_scene& scene, const br::draw_state& state, const golden_camera& camera)
+{
+    br::framebuffer_clear(fb, br::pack_color(0.1f, 0.1f, 0.12f));
+
+    const uint32_t* indices = &m.indices[m.lods[0].index_offset];
+    uint32_t index_count = m.lods[0].index_count;
+
+    lnal::mat4 view_proj = state.view_proj;
+    lnal::mat4 mvp = view_proj * state.model;
+
+    switch(scene.shading)
+    {
+        case SHADE_FACETED:
+            br::draw_mesh(fb, m, indices, index_count, state);
+            break;
+
+        case SHADE_FLAT:
+        {
+            br::flat_vertex_shader vs = { mvp };
+            br::flat_fragment_shader fs = { br::pack_color(state.color[0], state.color[1], state.color[2]) };
+            br::draw_shaded(fb, m, indices, index_count, vs, fs, state.cull_backfaces);
+            break;
+        }
+
+        case SHADE_LAMBERT:
+        {
+            br::lambert_vertex_shader vs = { state.model, mvp };
+            br::lambert_fragment_shader fs;
+            std::copy(state.color, state.color + 3, fs.color);
+            std::copy(state.light_dir, state.light_dir + 3, fs.light_dir);
+            br::draw_shaded(fb, m, indices, index_count, vs, fs, state.cull_backfaces);
+            break;
+        }
+
+        case SHADE_PHONG:
+        {
+            br::phong_vertex_shader vs = { state.model, mvp };
+            br::phong_fragment_shader<32> fs;
+            std::copy(state.color, state.color + 3, fs.color);
+            std::copy(state.light_dir, state.light_dir + 3, fs.light_dir);
+            std::copy(camera.eye, camera.eye + 3, fs.eye);
+            br::draw_shaded(fb, m, indices, index_count, vs, fs, state.cull_backfaces);
+            break;
+        }
+
+        case SHADE_DEFERRED:
+        {
+            //Kept between frames like the rasterizer's own scratch
+            static br::framebuffer gbuffer;
+            static br::light_tiles tiles;
+            static std::vector<br::point_light> lights, view_lights;
+
+            if(gbuffer.width != fb.width || gbuffer.height != fb.height)
+                br::framebuffer_init(gbuffer, fb.width, fb.height);
+
+            br::framebuffer_clear(gbuffer, 0);
+
+            lnal::mat4 view = camera.view;
+            lnal::mat4 projection = camera.projection;
+            lnal::mat4 model_view = view * state.model;
+
+            br::lambert_vertex_shader vs = { model_view, mvp };
+            br::gbuffer_fragment_shader fs = { 0 };
+            br::draw_shaded(gbuffer, m, indices, index_count, vs, fs, state.cull_backfaces);
+
+            make_lights(m, lights);
+            view_lights.resize(lights.size());
+            br::transform_lights(view, lights.data(), (uint32_t)lights.size(), view_lights.data());
+
+            br::deferred_lighting lighting;
+            lighting.projection = projection;
+            lighting.lights = view_lights.data();
+            lighting.light_count = (uint32_t)view_lights.size();
+            lighting.albedo = state.color;
+            lighting.background = br::pack_color(0.1f, 0.1f, 0.12f);
+            br::deferred_shade(fb, gbuffer, lighting, tiles);
+            break;
+        }
+
+        case SHADE_CLUSTERED:
+        {
+            static br::light_clusters clusters;
+            static std::vector<br::point_light> lights, view_lights;
+
+            lnal::mat4 view = camera.view;
+            lnal::mat4 model_view = view * state.model;
+
+            make_lights(m, lights);
+            view_lights.resize(lights.size());
+            br::transform_lights(view, lights.data(), (uint32_t)lights.size(), view_lights.data());
+            br::assign_lights(clusters, view_lights.data(), (uint32_t)view_lights.size(), camera.projection, fb.width, fb.height);
+
+            br::phong_vertex_shader vs = { model_view, mvp };
+            br::clustered_fragment_shader fs;
+            fs.clusters = &clusters;
+            fs.lights = view_lights.data();
+            std::copy(state.color, state.color + 3, fs.color);
+            br::draw_shaded(fb, m, indices, index_count, vs, fs, state.cull_backfaces);
+            break;
+        }
+
+        case SHADE_PHONG_MSAA:
+        {
+            static br::msaa_framebuffer target;
+            if(target.width != fb.width || target.height != fb.height)
+                br::msaa_init(target, fb.width, fb.height, MSAA_SAMPLES);
+
+            br::msaa_clear(target, br::pack_color(0.1f, 0.1f, 0.12f));
+
+            br::phong_vertex_shader vs = { state.model, mvp };
+            br::phong_fragment_shader<32> fs;
+            std::copy(state.color, state.color + 3, fs.color);
+            std::copy(state.light_dir, state.light_dir + 3, fs.light_dir);
+            std::copy(camera.eye, camera.eye + 3, fs.eye);
+            br::draw_shaded(target, m, indices, index_count, vs, fs, state.cull_backfaces);
+
+            br::msaa_resolve(target, fb);
+            break;
+        }
+
+        case SHADE_SHADOW_CASCADED:
+        {
+            //Light from behind on the right so the shadow falls towards the camera
+            lnal::vec3 light_dir(0.6f, 0.7f, -0.4f);
+            light_dir.normalize();
+            float light[3] = { light_dir[0], light_dir[1], light_dir[2] };
+
+            static br::shadow_cascades cascades;
+            cascades.count = SHADOW_CASCADES;
+            cascades.size = SHADOW_MAP_SIZE;
+            cascades.caster_distance = m.radius * 2.0f;
+            br::fit_cascades(cascades, camera.view, camera.projection, light);
+
+            for(uint32_t i = 0; i < cascades.count; i++)
+            {
+                br::shadow_map& map = cascades.maps[i];
+                draw_with_floor(m, scene, [&](const br::mesh& object, lnal::mat4 model, const uint32_t* object_indices, uint32_t count, const float*)
+                {
+                    lnal::mat4 light_view_proj = map.view_proj;
+                    br::draw_depth(map.depth, object, object_indices, count, light_view_proj * model);
+                });
+            }
+
+            draw_with_floor(m, scene, [&](const br::mesh& object, lnal::mat4 model, const uint32_t* object_indices, uint32_t count, const float* color)
+            {
+                br::phong_vertex_shader vs = { model, view_proj * model };
+                br::shadowed_fragment_shader fs;
+                fs.cascades = &cascades;
+                std::copy(color, color + 3, fs.color);
+                std::copy(light, light + 3, fs.light_dir);
+                br::draw_shaded(fb, object, object_indices, count, vs, fs, state.cull_backfaces);
+            });
+            break;
+        }
+
+        case SHADE_SHADOW_SPOT:
+        {
+            //Above and to the right of the model, aimed at the floor just past it
+            static br::shadow_map map;
+            if(map.depth.width != SHADOW_MAP_SIZE)
+                br::shadow_map_init(map, SHADOW_MAP_SIZE);
+
+            br::spot_light light;
+            lnal::vec3 position(m.center[0] + m.radius * 1.3f, m.center[1] + m.radius * 1.6f, m.center[2] - m.radius * 0.4f);
+            lnal::vec3 direction = lnal::vec3(m.center[0] - m.radius * 0.3f, m.center[1] - m.radius * 0.5f, m.center[2] + m.radius * 0.2f) - position;
+            direction.normalize();
+
+            for(int k = 0; k < 3; k++)
+            {
+                light.position[k] = position[k];
+                light.direction[k] = direction[k];
+                light.color[k] = 1.6f;
+            }
+
+            light.range = m.radius * 4.0f;
+            light.cos_inner = cosf(lnal::radians(30.0f));
+            light.cos_outer = cosf(lnal::radians(40.0f));
+
+            br::fit_spot_shadow(map, light);
+            draw_with_floor(m, scene, [&](const br::mesh& object, lnal::mat4 model, const uint32_t* object_indices, uint32_t count, const float*)
+            {
+                lnal::mat4 light_view_proj = map.view_proj;
+                br::draw_depth(map.depth, object, object_indices, count, light_view_proj * model);
+            });
+
+            draw_with_floor(m, scene, [&](const br::mesh& object, lnal::mat4 model, const uint32_t* object_indices, uint32_t count, const float* color)
+            {
+                br::phong_vertex_shader vs = { model, view_proj * model };
+                br::spot_fragment_shader fs;
+                fs.light = &light;
+                fs.shadow = &map;
+                std::copy(color, color + 3, fs.color);
+                br::draw_shaded(fb, object, object_indices, count, vs, fs, state.cull_backfaces);
+            });
+            break;
+        }
+    }
+}
+
+static scene_result run_scene(const golden_scene& scene, bool update)
+{
+    scene_result result;
+    result.scene = &scene;
+
+    br::mesh m;
+    if(!br::load_obj(m, scene.model_path))
+    {
+        std::cerr << "Failed to load " << scene.model_path << std::endl;
+        return result;
+    }
+
+    result.loaded = true;
+
+    br::draw_state state;
+    golden_camera camera;
+    setup_draw(scene, m, state, camera);
+
+    br::framebuffer fb;
+    br::framebuffer_init(fb, WIDTH, HEIGHT);
+
+    for(uint32_t i = 0; i < WARMUP_FRAMES; i++)
+    {
+        render(fb, m, scene, state, camera);
+    }
+
+    std::vector<double> times;
+    for(uint32_t i = 0; i < TIMED_FRAMES; i++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        render(fb, m, scene, state, camera);
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+    }
+
+    std::sort(times.begin(), times.end());
+    result.min_ms = times.front();
+    result.median_ms = times[times.size() / 2];
+    for(double t : times)
+    {
+        result.mean_ms += t / times.size();
+    }
+
+    std::string golden_path = std::string("./test/golden/") + scene.name + ".ppm";
+
+    if(update)
+    {
+        result.has_golden = br::write_ppm(golden_path.c_str(), fb.width, fb.height, fb.color.data());
+        result.passed = result.has_golden;
+        return result;
+    }
+
+    uint32_t golden_width = 0, golden_height = 0;
+    std::vector<uint32_t> golden;
+    result.has_golden = br::read_ppm(golden_path.c_str(), golden_width, golden_height, golden) && golden_width == fb.width && golden_height == fb.height;
+
+    if(!result.has_golden)
+    {
+        std::cerr << "Missing or mismatched golden image " << golden_path << " (run with --update to create it)" << std::endl;
+        return result;
+    }
+
+    std::vector<uint32_t> diff_image;
+    br::compare_images(fb.width, fb.height, fb.color.data(), golden.data(), PIXEL_TOLERANCE, result.diff, &diff_image);
+
+    result.passed = result.diff.fraction_over_tolerance <= MAX_FRACTION_OVER_TOLERANCE && result.diff.mean_ssim >= MIN_MEAN_SSIM;
+
+    //Leave the evidence next to the binary so a failure can be inspected
+    if(!result.passed)
+    {
+        br::write_ppm((std::string(scene.name) + "_actual.ppm").c_str(), fb.width, fb.height, fb.color.data());
+        br::write_ppm((std::string(scene.name) + "_diff.ppm").c_str(), fb.width, fb.height, diff_image.data());
+    }
+
+    return result;
+}
+
+static bool write_json(const char* path, const std::vector<scene_result>& results)
+{
+    std::error_code error;
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if(!parent.empty())
+        std::filesystem::create_directories(parent, error);
+
+    std::ofstream out(path);
+    if(!out)
+        return false;
+
+    out << std::setprecision(6);
+    out << "{\n";
+    out << "  \"width\": " << WIDTH << ",\n";
+    out << "  \"height\": " << HEIGHT << ",\n";
+    out << "  \"timed_frames\": " << TIMED_FRAMES << ",\n";
+    out << "  \"scenes\": [\n";
+
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const scene_result& r = results[i];
+
+        out << "    {\n";
+        out << "      \"name\": \"" << r.scene->name << "\",\n";
+        out << "      \"passed\": " << (r.passed ? "true" : "false") << ",\n";
+        out << "      \"max_channel_error\": " << r.diff.max_channel_error << ",\n";
+        out << "      \"fraction_over_tolerance\": " << r.diff.fraction_over_tolerance << ",\n";
+        out << "      \"mean_ssim\": " << r.diff.mean_ssim << ",\n";
+        out << "      \"min_ssim\": " << r.diff.min_ssim << ",\n";
+        out << "      \"frame_ms\": { \"min\": " << r.min_ms << ", \"median\": " << r.median_ms << ", \"mean\": " << r.mean_ms << " }\n";
+        out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    out << "  ]\n";
+    out << "}\n";
+
+    return (bool)out;
+}
+
+int main(int argc, char** argv)
+{
+    bool update = false;
+    const char* json_path = "./cache/golden_timings.json";
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--update") == 0)
+            update = true;
+        else if(strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            json_path = argv[++i];
+    }
+
+    std::vector<scene_result> results;
+    bool all_passed = true;
+
+    std::cout << "  scene                 result   max err   over tol    mean ssim   min ssim   median ms" << std::endl;
+
+    for(const golden_scene& scene : SCENES)
+    {
+        scene_result r = run_scene(scene, update);
+        all_passed = all_passed && r.passed;
+        results.push_back(r);
+
+        std::cout << "  " << std::left << std::setw(22) << scene.name << std::setw(9) << (update ? (r.passed ? "updated" : "FAILED") : (r.passed ? "ok" : "FAILED")) << std::right
+                  << std::setw(7) << r.diff.max_channel_error
+                  << std::setw(10) << std::fixed << std::setprecision(3) << r.diff.fraction_over_tolerance * 100.0 << "%"
+                  << std::setw(13) << std::setprecision(5) << r.diff.mean_ssim
+                  << std::setw(11) << r.diff.min_ssim
+                  << std::setw(12) << std::setprecision(3) << r.median_ms << std::endl;
+    }
+
+    if(!write_json(json_path, results))
+    {
+        std::cerr << "Failed to write " << json_path << std::endl;
+        all_passed = false;
+    }
+
+    return all_passed ? 0 : 1;
+}
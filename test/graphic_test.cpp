@@ -10,28 +10,70 @@
 #include <SDL2/SDL.h>
 
 #include "../src/math/lnal.h"
+#include "../src/core/job.h"
+#include "../src/scene/scene_graph.h"
+#include "../src/mesh/mesh.h"
+#include "../src/mesh/simplify.h"
+#include "../src/mesh/meshlet.h"
+#include "../src/mesh/vertex_format.h"
+#include "../src/scene/frustum.h"
+#include "../src/asset/stream.h"
+#include "../src/scene/light.h"
+#include "../src/gl/gl_deferred.h"
+#include "../src/gl/gl_program.h"
+#include "../src/gl/gl_shader_library.h"
+#include "../src/gl/gl_mesh_pool.h"
 #include <cassert>
 #include <cmath>
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
+//Forward shader library. LIGHTING shades with the vertex normals against a fixed directional light, NORMAL_OCT16 decodes the compact
+//normal format. Without LIGHTING (or while that variant compiles) everything is one flat color.
+enum forward_features : uint32_t
+{
+    FORWARD_LIGHTING = 1 << 0,
+    FORWARD_NORMAL_OCT16 = 1 << 1
+};
 
-const char* vertex_shader_source = "#version 330 core\n"
+const char* forward_vertex_body =
 "layout(location = 0) in vec3 a_pos;\n"
+"#ifdef LIGHTING\n"
+"#ifdef NORMAL_OCT16\n"
+"layout(location = 1) in vec2 a_normal;\n"
+"#else\n"
+"layout(location = 1) in vec3 a_normal;\n"
+"#endif\n"
+"out vec3 v_normal;\n"
+"#endif\n"
 "uniform mat4 projection;\n"
 "uniform mat4 model;\n"
 "uniform mat4 view;\n"
 "void main()\n"
 "{\n"
+"#ifdef LIGHTING\n"
+"#ifdef NORMAL_OCT16\n"
+"vec3 n = oct_decode(a_normal);\n"
+"#else\n"
+"vec3 n = a_normal;\n"
+"#endif\n"
+"v_normal = transpose(inverse(mat3(model))) * n;\n"
+"#endif\n"
 "gl_Position = projection * view * model * vec4(a_pos, 1.0);\n"
-"}\n\0";
+"}\n";
 
-const char* fragment_shader_source = "#version 330 core\n"
+const char* forward_fragment_body =
 "out vec4 color;\n"
+"#ifdef LIGHTING\n"
+"in vec3 v_normal;\n"
+"#endif\n"
 "void main()\n"
 "{\n"
-"color = vec4(0.5, 0.3, 0.5, 1.0);\n"
-"}\n\0";
+"vec3 base = vec3(0.5, 0.3, 0.5);\n"
+"#ifdef LIGHTING\n"
+"float diffuse = max(dot(normalize(v_normal), normalize(vec3(0.4, 0.8, 0.6))), 0.0);\n"
+"base *= 0.25 + (diffuse * 0.75);\n"
+"#endif\n"
+"color = vec4(base, 1.0);\n"
+"}\n";
 
 /*
 - Textures
@@ -72,60 +114,6 @@ static void (*keydown_callback)(void* save_data) = keydown;
 int main()
 {
 
-    //Load OBJ model
-
-    tinyobj::ObjReader reader;
-    tinyobj::ObjReaderConfig reader_config;
-    reader_config.mtl_search_path = "./";
-    reader_config.triangulate = true;
-
-    //Read OBJ in
-    if(!reader.ParseFromFile("./utah_teapot.obj", reader_config))
-    {
-        if(!reader.Error().empty())
-        {
-            std::cerr << reader.Error();
-        }
-
-        exit(1);
-    }
-
-    if(!reader.Warning().empty())
-    {
-        std::cout << reader.Warning();
-    }
-
-    auto& attrib = reader.GetAttrib();
-    auto& shapes = reader.GetShapes();
-    auto& materials = reader.GetMaterials();
-
-    std::vector<float> shape_vertices{};
-
-    size_t num_vertices = 0;
-
-    for(size_t s = 0; s < shapes.size(); s++)
-    {
-        const tinyobj::mesh_t &mesh = shapes[s].mesh;
-        for(int i = 0; i < mesh.indices.size(); i++)
-        {
-            tinyobj::index_t index = mesh.indices[i];
-
-            //Positions
-            shape_vertices.push_back(attrib.vertices[index.vertex_index * 3]);
-            shape_vertices.push_back(attrib.vertices[(index.vertex_index * 3) + 1]);
-            shape_vertices.push_back(attrib.vertices[(index.vertex_index * 3) + 2]);
-            
-            //Normals
-            //Need if statement here because some might not have normals
-            //shape_vertices.push_back(attrib.normals[(index.normal_index * 3)]);
-            //shape_vertices.push_back(attrib.normals[(index.normal_index * 3) + 1]);
-            //shape_vertices.push_back(attrib.normals[(index.normal_index * 3) + 2]);
-
-            num_vertices++;
-        }
-    }
-
-
     //Init Stage of Engine
     SDL_Init(SDL_INIT_EVERYTHING);
 
@@ -146,109 +134,75 @@ int main()
 
     //OpenGL stuff now
 
-    float vertices[] = 
-    {
-        -0.5, -0.5, 0.0,
-        0.5, -0.5, 0.0,
-        0.5, 0.5, 0.0,
-        -0.5, 0.5, 0.0,
-
-        //-0.5, -0.5, -2.0,
-        //0.5, -0.5, -2.0,
-        //0.5, 0.5, -2.0,
-        //-0.5, 0.5, -2.0
-    };
-
-    unsigned int indices[] = 
-    {
-        0, 1, 2,
-        2, 3, 0
-    };
-
-    uint32_t vao, vbo, ebo;
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    //glGenBuffers(1, &ebo);
-
-    glBindVertexArray(vao);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * shape_vertices.size(), shape_vertices.data(), GL_STATIC_DRAW);
-
-    //glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    //glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    //The teapot streams in on the job system while the window is already up. The upload callback copies it into the GL mesh pool.
+    br::job_system jobs;
+    br::job_system_init(jobs);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    //Imported meshes (with their generated normals and tangents) are cached in ./cache after the first run
+    br::asset_cache import_cache;
 
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    //glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    br::streamer assets;
+    assets.js = &jobs;
+    assets.cache = &import_cache;
 
+    //Streamed meshes share the buffers of one pool and draw with base vertex offsets instead of a VAO each. The pool takes the layout of the
+    //first mesh, meshes in another layout are turned away.
+    br::gl_mesh_pool mesh_pool;
 
-    //Error checking variables
-    char buffer[255];
-    int success;
-
-    unsigned int v_shader_source = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(v_shader_source, 1, &vertex_shader_source, nullptr);
-    glCompileShader(v_shader_source);
-
-    glGetShaderiv(v_shader_source, GL_COMPILE_STATUS, &success);
-    if(!success)
+    assets.upload = [&mesh_pool](br::stream_asset& a)
     {
-        int length;
-        glGetShaderiv(v_shader_source, GL_INFO_LOG_LENGTH, &length);
-        char* buffer = new char[length];
-        glGetShaderInfoLog(v_shader_source, length,nullptr, buffer);
-        std::cout << buffer << std::endl;
-        delete[] buffer;
-    }
-
-    unsigned int f_shader_source = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(f_shader_source, 1, &fragment_shader_source, nullptr);
-    glCompileShader(f_shader_source);
+        const br::mesh_asset& m = a.mesh_data;
+        const br::vertex_layout& layout = m.vertices.layout;
+        uint32_t vertex_count = (uint32_t)(m.vertices.data.size() / layout.stride);
+
+        if(mesh_pool.vao == 0)
+            br::gl_mesh_pool_init(mesh_pool, layout, 1 << 16, 1 << 18);
+        else if(mesh_pool.layout.format != layout.format || mesh_pool.layout.stride != layout.stride)
+            return false;
+
+        //Every LOD lives in the same index range, the draw call picks the meshlet ranges
+        br::gl_pool_mesh pooled;
+        if(!br::gl_mesh_pool_add(mesh_pool, pooled, m.vertices.data.data(), vertex_count, m.cluster_indices.data(), (uint32_t)m.cluster_indices.size()))
+            return false;
+
+        a.gpu_names[0] = pooled.vertices;
+        a.gpu_names[1] = pooled.indices;
+        return true;
+    };
 
-    glGetShaderiv(f_shader_source, GL_COMPILE_STATUS, &success);
-    if(!success)
+    assets.release = [&mesh_pool](br::stream_asset& a)
     {
-        int length;
-        glGetShaderiv(f_shader_source, GL_INFO_LOG_LENGTH, &length);
-        char* buffer = new char[length];
-        glGetShaderInfoLog(f_shader_source, length,nullptr, buffer);
-        std::cout << buffer << std::endl;
-        delete[] buffer;
-    }
-
-    unsigned int program = glCreateProgram();
-    glAttachShader(program, v_shader_source);
-    glAttachShader(program, f_shader_source);
-    glLinkProgram(program);
+        br::gl_pool_mesh pooled = { a.gpu_names[0], a.gpu_names[1] };
+        br::gl_mesh_pool_remove(mesh_pool, pooled);
+    };
 
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if(!success)
-    {
-        int length;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
-        char* buffer = new char[length];
-        glGetProgramInfoLog(program, length, nullptr, buffer);
-        std::cout << buffer << std::endl;
-        delete[] buffer;
-    }
+    br::asset_handle teapot_handle = br::stream_register(assets, "./utah_teapot.obj", br::ASSET_MESH);
 
-    glDetachShader(program ,v_shader_source);
-    glDetachShader(program, f_shader_source);
 
-    glDeleteShader(v_shader_source);
-    glDeleteShader(f_shader_source);
+    //Linked programs come from the binary cache in ./cache/programs after the first run
+    br::gl_program_cache programs;
+    br::gl_program_cache_init(programs, &jobs);
 
-    glUseProgram(program);
+    //The base variant loads now, the lit ones compile in the background once the teapot shows which normal format it has
+    br::gl_shader_library forward;
+    std::string forward_vertex = std::string(br::OCT_DECODE_GLSL) + forward_vertex_body;
+    br::gl_shader_library_init(forward, programs, "#version 330 core", forward_vertex.c_str(), forward_fragment_body, { "LIGHTING", "NORMAL_OCT16" });
 
     lnal::mat4 projection;
 
     lnal::gen_perspective_proj(projection, PI / 2, (float)(1920.0f/1080.0f), 0.1, 10.0);
 
-    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, projection.data());
+    //Deferred path with a ring of colored point lights circling the teapot. Tab switches between it and the forward shader.
+    int drawable_width = 0, drawable_height = 0;
+    SDL_GL_GetDrawableSize(window, &drawable_width, &drawable_height);
+
+    br::gl_deferred deferred;
+    bool deferred_mode = br::gl_deferred_init(deferred, (uint32_t)drawable_width, (uint32_t)drawable_height, &programs);
+
+    const uint32_t LIGHT_COUNT = 128;
+    std::vector<br::point_light> lights(LIGHT_COUNT), view_lights(LIGHT_COUNT);
+    br::light_tiles light_tiles;
+    const float albedo[3] = { 0.8f, 0.8f, 0.8f };
 
     //End of OpenGL stuff
 
@@ -263,14 +217,27 @@ int main()
     lnal::vec3 axis(0.0, -1.0, 0.0);
     lnal::rotation_matrix(rotation, axis, PI / 1000);
 
+    br::scene_graph scene;
+    uint32_t teapot_node = br::scene_add_node(scene, -1, model);
+
     float x = 0.0;
 
+    //Per frame meshlet draw lists (kept outside the loop so they don't reallocate)
+    br::frustum view_frustum;
+    std::vector<uint32_t> visible_meshlets;
+    std::vector<GLsizei> draw_counts;
+    std::vector<const void*> draw_offsets;
+    std::vector<GLint> draw_base_vertices;
+
     //Main Loop of engine
     while(!quit)
     {
         SDL_Event event;
         while(SDL_PollEvent(&event))
         {
+            if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_TAB && deferred.lighting_program != 0)
+                deferred_mode = !deferred_mode;
+
             switch(event.type)
             {
                 case SDL_QUIT:
@@ -293,33 +260,148 @@ int main()
             }
         }
 
-        model = rotation * model;
+        br::scene_set_local(scene, teapot_node, rotation * scene.local[teapot_node]);
+        br::scene_update(scene, &jobs);
 
         x += 0.001;
 
+        lnal::vec3 cam_pos(0.0, 0.0, 3.0);
         lnal::mat4 view(1.0);
-        lnal::lookat(view, lnal::vec3(0.0, 0.0, 3.0), lnal::vec3(0.0, 0.0, 0.0), lnal::vec3(0.0, 1.0, 0.0));
+        lnal::lookat(view, cam_pos, lnal::vec3(0.0, 0.0, 0.0), lnal::vec3(0.0, 1.0, 0.0));
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glClearColor(0.3, 0.3, 0.3, 1.0);
+
+        //Nothing to draw until the teapot has streamed in
+        const br::stream_asset* teapot_asset = br::stream_request(assets, teapot_handle);
+
+        GLuint program = 0;
+        if(deferred_mode)
+        {
+            br::gl_deferred_begin_geometry(deferred, view, projection);
+        }
+        else
+        {
+            uint32_t features = 0;
+            if(teapot_asset && teapot_asset->mesh_data.vertices.layout.normal_offset >= 0)
+            {
+                features |= FORWARD_LIGHTING;
+                if(teapot_asset->mesh_data.vertices.layout.format & br::VERTEX_NORMAL_OCT16)
+                    features |= FORWARD_NORMAL_OCT16;
+            }
 
+            program = br::gl_shader_library_get(forward, features);
+            glUseProgram(program);
+            glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, projection.data());
+            glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, view.data());
+        }
 
-        glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, model.data());
+        if(teapot_asset)
+        {
+            const br::mesh_asset& teapot = teapot_asset->mesh_data;
 
-        glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, view.data());
+            //Pick the LOD from how big its error would be on screen
+            const lnal::mat4& teapot_world = scene.world[teapot_node];
+            lnal::vec3 teapot_center = lnal::transform_point(teapot_world, lnal::vec3(teapot.m.center[0], teapot.m.center[1], teapot.m.center[2]));
+            float distance = (teapot_center - cam_pos).len();
+            uint32_t lod = br::select_lod(teapot.m, projection, 720.0f, distance, lnal::max_scale(teapot_world));
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glClearColor(0.3, 0.3, 0.3, 1.0);
+            //Skip meshlets that are off screen or facing away, then merge neighbouring ranges into as few draws as possible
+            br::extract_frustum(view_frustum, projection * view);
+            visible_meshlets.clear();
+            br::cull_meshlets(teapot.meshlets[lod], teapot_world, view_frustum, cam_pos, visible_meshlets);
+
+            draw_counts.clear();
+            draw_offsets.clear();
+            draw_base_vertices.clear();
+            uint32_t last_end = 0xFFFFFFFF;
+
+            br::gl_pool_mesh pooled = { teapot_asset->gpu_names[0], teapot_asset->gpu_names[1] };
+            GLint base_vertex = br::gl_pool_base_vertex(mesh_pool, pooled);
+
+            for(uint32_t m : visible_meshlets)
+            {
+                const br::meshlet& ml = teapot.meshlets[lod].meshlets[m];
+                uint32_t start = teapot.lod_index_base[lod] + ml.index_offset;
+
+                if(start == last_end)
+                {
+                    draw_counts.back() += ml.triangle_count * 3;
+                }
+                else
+                {
+                    draw_counts.push_back(ml.triangle_count * 3);
+                    draw_offsets.push_back(br::gl_pool_index_offset(mesh_pool, pooled, start));
+                    draw_base_vertices.push_back(base_vertex);
+                }
+
+                last_end = start + (ml.triangle_count * 3);
+            }
+
+            //The dequantize matrix folds the compact vertex positions back into object space
+            lnal::mat4 model_dequantized = scene.world[teapot_node] * br::position_dequantize_matrix(teapot.vertices);
+            if(deferred_mode)
+                br::gl_deferred_set_object(deferred, model_dequantized, 0);
+            else
+                glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, model_dequantized.data());
+
+            glBindVertexArray(mesh_pool.vao);
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, draw_counts.data(), GL_UNSIGNED_INT, draw_offsets.data(), (GLsizei)draw_counts.size(),
+                                          draw_base_vertices.data());
+        }
+
+        if(deferred_mode)
+        {
+            //Three rings at different heights turning in opposite directions
+            for(uint32_t i = 0; i < LIGHT_COUNT; i++)
+            {
+                uint32_t ring = i % 3;
+                float angle = ((float)i / LIGHT_COUNT) * 2.0f * PI + (ring == 1 ? -x : x) * 20.0f;
+                float distance = 0.9f + 0.3f * ring;
+
+                br::point_light& l = lights[i];
+                l.position[0] = cosf(angle) * distance;
+                l.position[1] = -0.8f + 0.4f * ring;
+                l.position[2] = sinf(angle) * distance;
+                l.radius = 0.6f;
+                l.color[0] = 0.5f + 0.5f * cosf(angle);
+                l.color[1] = 0.5f + 0.5f * cosf(angle - 2.1f);
+                l.color[2] = 0.5f + 0.5f * cosf(angle + 2.1f);
+            }
+
+            br::transform_lights(view, lights.data(), LIGHT_COUNT, view_lights.data());
+
+            br::deferred_lighting lighting;
+            lighting.projection = projection;
+            lighting.lights = view_lights.data();
+            lighting.light_count = LIGHT_COUNT;
+            lighting.albedo = albedo;
+            lighting.background = br::pack_color(0.3f, 0.3f, 0.3f);
+            br::gl_deferred_light(deferred, lighting, light_tiles);
+        }
+
+        br::stream_update(assets);
+        br::gl_program_cache_update(programs);
+
+        //Close the holes evicted meshes leave a little at a time, 1MB of copies at most per frame
+        if(mesh_pool.vao != 0)
+        {
+            br::gl_mesh_pool_stats pool_stats = br::gl_mesh_pool_get_stats(mesh_pool);
+            if(pool_stats.vertices.fragmentation > 0.25f || pool_stats.indices.fragmentation > 0.25f)
+                br::gl_mesh_pool_defragment(mesh_pool, 1 << 20);
+        }
 
-        glBindVertexArray(vao);
-        //glDrawElements(GL_TRIANGLES, sizeof(indices) / sizeof(unsigned int), GL_UNSIGNED_INT, nullptr);
-        glDrawArrays(GL_TRIANGLES, 0, num_vertices);
         SDL_GL_SwapWindow(window);
     }
 
     //Cleanup
 
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &ebo);
-    glDeleteVertexArrays(1, &vao);
-    glDeleteProgram(program);
+    br::stream_shutdown(assets);
+    br::gl_mesh_pool_release(mesh_pool);
+    br::gl_deferred_shutdown(deferred);
+    br::gl_program_cache_shutdown(programs);
+    br::job_system_shutdown(jobs);
+
 
     //SDL_GL_DeleteContext(window);
     SDL_DestroyWindow(window);
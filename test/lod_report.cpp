@@ -0,0 +1,139 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+
+#include "../src/mesh/mesh.h"
+#include "../src/mesh/simplify.h"
+
+//Builds the LOD chain for each bundled model and prints triangle count vs error. The measured column is the largest distance from a full
+//resolution vertex to the nearest triangle of the LOD (brute force), the stored error has to be at least that for select_lod to be safe.
+//Run from the repo root so the model paths resolve
+
+static double dot(const double* a, const double* b)
+{
+    return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+}
+
+//Squared distance from p to triangle abc (closest point by Voronoi region, Real-Time Collision Detection 5.1.5)
+static double triangle_distance2(const double* p, const double* a, const double* b, const double* c)
+{
+    double ab[3], ac[3], ap[3], q[3];
+    for(int i = 0; i < 3; i++)
+    {
+        ab[i] = b[i] - a[i];
+        ac[i] = c[i] - a[i];
+        ap[i] = p[i] - a[i];
+    }
+
+    double d1 = dot(ab, ap), d2 = dot(ac, ap);
+    double bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+    double d3 = dot(ab, bp), d4 = dot(ac, bp);
+    double cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+    double d5 = dot(ab, cp), d6 = dot(ac, cp);
+
+    double vc = (d1 * d4) - (d3 * d2);
+    double vb = (d5 * d2) - (d1 * d6);
+    double va = (d3 * d6) - (d5 * d4);
+
+    double v = 0.0, w = 0.0;
+    if(d1 <= 0.0 && d2 <= 0.0)
+        v = w = 0.0;
+    else if(d3 >= 0.0 && d4 <= d3)
+        v = 1.0, w = 0.0;
+    else if(vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+        v = d1 / (d1 - d3), w = 0.0;
+    else if(d6 >= 0.0 && d5 <= d6)
+        v = 0.0, w = 1.0;
+    else if(vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+        v = 0.0, w = d2 / (d2 - d6);
+    else if(va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+        w = (d4 - d3) / ((d4 - d3) + (d5 - d6)), v = 1.0 - w;
+    else
+    {
+        double denom = 1.0 / (va + vb + vc);
+        v = vb * denom;
+        w = vc * denom;
+    }
+
+    for(int i = 0; i < 3; i++)
+    {
+        q[i] = a[i] + (ab[i] * v) + (ac[i] * w) - p[i];
+    }
+
+    return dot(q, q);
+}
+
+//Largest distance from a vertex used by lods[0] to the nearest triangle of the LOD
+static double measured_error(const br::mesh& m, const br::mesh_lod& lod)
+{
+    auto position = [&m](uint32_t v, double* out)
+    {
+        out[0] = m.positions[v * 3];
+        out[1] = m.positions[(v * 3) + 1];
+        out[2] = m.positions[(v * 3) + 2];
+    };
+
+    double worst = 0.0;
+    for(uint32_t i = 0; i < m.lods[0].index_count; i++)
+    {
+        double p[3];
+        position(m.indices[m.lods[0].index_offset + i], p);
+
+        double nearest = 1e300;
+        for(uint32_t t = 0; t < lod.index_count && nearest > worst; t += 3)
+        {
+            double a[3], b[3], c[3];
+            position(m.indices[lod.index_offset + t], a);
+            position(m.indices[lod.index_offset + t + 1], b);
+            position(m.indices[lod.index_offset + t + 2], c);
+
+            double d = triangle_distance2(p, a, b, c);
+            nearest = d < nearest ? d : nearest;
+        }
+
+        worst = nearest > worst ? nearest : worst;
+    }
+
+    return sqrt(worst);
+}
+
+static void report(const char* path)
+{
+    br::mesh m;
+    if(!br::load_obj(m, path))
+    {
+        std::cerr << "Failed to load " << path << std::endl;
+        return;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    br::generate_lods(m);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << path << " (" << br::mesh_vertex_count(m) << " vertices, radius " << m.radius << ", "
+              << std::chrono::duration<double, std::milli>(end - start).count() << " ms)" << std::endl;
+
+    std::cout << "  LOD   triangles   % of LOD0       error   error / radius    measured" << std::endl;
+
+    for(size_t i = 0; i < m.lods.size(); i++)
+    {
+        const br::mesh_lod& lod = m.lods[i];
+        double measured = measured_error(m, lod);
+
+        std::cout << std::setw(5) << i
+                  << std::setw(12) << lod.index_count / 3
+                  << std::setw(11) << std::fixed << std::setprecision(1) << (100.0 * lod.index_count) / m.lods[0].index_count << "%"
+                  << std::setw(12) << std::setprecision(5) << lod.error
+                  << std::setw(17) << lod.error / m.radius
+                  << std::setw(12) << measured << (measured <= lod.error + 1e-5 ? "" : "   UNDER") << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+int main()
+{
+    report("./utah_teapot.obj");
+    report("./ico-sphere.obj");
+}
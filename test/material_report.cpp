@@ -0,0 +1,208 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../src/core/job.h"
+#include "../src/image/image_io.h"
+#include "../src/asset/asset_load.h"
+#include "../src/scene/material.h"
+#include "../src/raster/deferred.h"
+
+//Writes an OBJ with a grid of quads using many materials, some of them textured with images of a few sizes, imports it through the asset
+//cache and shows how the materials end up: one parameter block, a handful of texture arrays and one draw for the whole mesh instead of a
+//draw and texture bind per material. Also imports ico-sphere.obj to show its .mtl. Run from the repo root so the model path resolves.
+
+static const char* DIRECTORY = "./cache/material_report";
+static const char* SPHERE_MODEL = "./ico-sphere.obj";
+static const uint32_t GRID = 32;
+static const uint32_t MATERIALS = 48;
+static const uint32_t TEXTURE_SIZES[] = { 64, 128, 256 };
+static const uint32_t TEXTURES_PER_SIZE = 5;
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static std::string texture_name(uint32_t size, uint32_t i)
+{
+    return "tex_" + std::to_string(size) + "_" + std::to_string(i) + ".ppm";
+}
+
+static void write_textures()
+{
+    for(uint32_t size : TEXTURE_SIZES)
+    {
+        for(uint32_t i = 0; i < TEXTURES_PER_SIZE; i++)
+        {
+            std::vector<uint32_t> pixels((size_t)size * size);
+            for(uint32_t y = 0; y < size; y++)
+            {
+                for(uint32_t x = 0; x < size; x++)
+                {
+                    uint32_t checker = ((x / 8) + (y / 8) + i) & 1 ? 0xFF : 0x40;
+                    pixels[(size_t)y * size + x] = 0xFF000000 | (checker << (8 * (i % 3)));
+                }
+            }
+
+            br::write_ppm((std::string(DIRECTORY) + "/" + texture_name(size, i)).c_str(), size, size, pixels.data());
+        }
+    }
+}
+
+//Material m uses a texture on every other material, cycling through all of them. Relative paths, resolved next to the .mtl.
+static void write_mtl(const std::string& path)
+{
+    std::ofstream out(path);
+    uint32_t texture_count = (uint32_t)(sizeof(TEXTURE_SIZES) / sizeof(TEXTURE_SIZES[0])) * TEXTURES_PER_SIZE;
+
+    for(uint32_t m = 0; m < MATERIALS; m++)
+    {
+        out << "newmtl mat" << m << "\n";
+        out << "Ns " << 10 + m << "\n";
+        out << "Kd " << (m % 4) / 3.0f << " " << (m % 5) / 4.0f << " " << (m % 7) / 6.0f << "\n";
+        out << "Ks 0.5 0.5 0.5\n";
+        out << "d 1.0\nillum 2\n";
+
+        if(m % 2 == 0)
+        {
+            uint32_t t = (m / 2) % texture_count;
+            out << "map_Kd " << texture_name(TEXTURE_SIZES[t / TEXTURES_PER_SIZE], t % TEXTURES_PER_SIZE) << "\n";
+        }
+        out << "\n";
+    }
+}
+
+//GRID x GRID quads in the xz plane, quad q uses material q % MATERIALS
+static void write_obj(const std::string& path)
+{
+    std::ofstream out(path);
+    out << "mtllib grid.mtl\n";
+
+    for(uint32_t j = 0; j <= GRID; j++)
+    {
+        for(uint32_t i = 0; i <= GRID; i++)
+        {
+            out << "v " << i << " 0 " << j << "\n";
+            out << "vt " << (float)i / GRID << " " << (float)j / GRID << "\n";
+        }
+    }
+    out << "vn 0 1 0\n";
+
+    for(uint32_t j = 0; j < GRID; j++)
+    {
+        for(uint32_t i = 0; i < GRID; i++)
+        {
+            uint32_t q = (j * GRID) + i;
+            uint32_t a = (j * (GRID + 1)) + i + 1, b = a + 1, c = a + GRID + 1, d = c + 1;
+            out << "usemtl mat" << q % MATERIALS << "\n";
+            out << "f " << a << "/" << a << "/1 " << c << "/" << c << "/1 " << d << "/" << d << "/1 " << b << "/" << b << "/1\n";
+        }
+    }
+}
+
+int main()
+{
+    std::error_code error;
+    std::filesystem::remove_all(DIRECTORY, error);
+    std::filesystem::create_directories(DIRECTORY, error);
+
+    write_textures();
+    write_mtl(std::string(DIRECTORY) + "/grid.mtl");
+    std::string obj = std::string(DIRECTORY) + "/grid.obj";
+    write_obj(obj);
+
+    br::job_system js;
+    br::job_system_init(js);
+
+    br::asset_cache cache;
+    cache.directory = std::string(DIRECTORY) + "/cache";
+
+    br::mesh_asset imported, cached;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    bool ok = br::load_mesh_asset(imported, obj.c_str(), &cache, &js);
+    double import_ms = elapsed_ms(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    ok = ok && br::load_mesh_asset(cached, obj.c_str(), &cache, &js);
+    double cached_ms = elapsed_ms(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    br::load_material_textures(imported.materials, &js);
+    double texture_ms = elapsed_ms(start);
+
+    br::job_system_shutdown(js);
+
+    if(!ok)
+    {
+        std::cout << "couldn't load " << obj << std::endl;
+        return 1;
+    }
+
+    const br::material_library& lib = imported.materials;
+    const br::mesh& m = imported.m;
+
+    //What a renderer without the shared block would do, even with its triangles sorted by material: a draw per material and a texture bind
+    //per distinct diffuse map
+    std::set<uint32_t> used(m.materials.begin(), m.materials.end());
+    std::set<uint32_t> diffuse_maps;
+    for(uint32_t material : used)
+    {
+        uint32_t slot = lib.params[material].textures[br::MATERIAL_DIFFUSE_MAP];
+        if(slot != br::MATERIAL_NO_TEXTURE)
+            diffuse_maps.insert(slot);
+    }
+
+    std::cout << obj << ": " << br::mesh_vertex_count(m) << " vertices, " << m.lods[0].index_count / 3 << " triangles, " << used.size()
+              << " materials used (" << br::material_count(lib) << " in the library with the default)" << std::endl;
+    std::cout << "  parameter block " << br::material_block_bytes(lib) << " bytes (" << sizeof(br::material_params) << " per material), "
+              << imported.vertices.layout.stride << " byte vertices with the material id at offset " << imported.vertices.layout.material_offset
+              << std::endl;
+
+    std::cout << "  " << lib.textures.size() << " textures in " << lib.arrays.size() << " texture arrays:";
+    for(const br::material_texture_array& array : lib.arrays)
+    {
+        std::cout << "  " << array.width << "x" << array.height << " x " << array.layers.size();
+    }
+    std::cout << std::endl;
+
+    std::cout << "  sorted by material: " << used.size() << " draws and " << diffuse_maps.size() << " texture binds, with the block and arrays: 1 draw, "
+              << lib.arrays.size() << " array binds" << std::endl;
+
+    //The deferred pass reads its albedo straight out of the block
+    br::deferred_lighting lighting;
+    lighting.albedo = lib.params[0].diffuse;
+    lighting.albedo_stride = br::MATERIAL_PARAMS_FLOATS;
+    lighting.material_count = br::material_count(lib);
+    bool albedo_ok = true;
+    for(uint32_t i = 0; i < lighting.material_count; i++)
+    {
+        albedo_ok &= memcmp(&lighting.albedo[i * lighting.albedo_stride], lib.params[i].diffuse, sizeof(float) * 3) == 0;
+    }
+
+    bool same = cached.m.materials == m.materials && cached.materials.names == lib.names && cached.materials.texture_refs == lib.texture_refs;
+    std::cout << std::fixed << std::setprecision(2) << "  import " << import_ms << " ms, cached " << cached_ms << " ms" << (same ? "" : " (MISMATCH)")
+              << ", textures " << texture_ms << " ms, deferred albedo through the block " << (albedo_ok ? "ok" : "WRONG") << std::endl;
+
+    br::mesh_asset sphere;
+    if(br::load_mesh_asset(sphere, SPHERE_MODEL))
+    {
+        std::cout << std::endl << SPHERE_MODEL << ":" << std::endl;
+        for(uint32_t i = 0; i < br::material_count(sphere.materials); i++)
+        {
+            const br::material_params& p = sphere.materials.params[i];
+            std::cout << "  " << i << " " << std::setw(8) << std::left << sphere.materials.names[i] << std::right << " Kd " << p.diffuse[0] << " "
+                      << p.diffuse[1] << " " << p.diffuse[2] << "  Ks " << p.specular[0] << " " << p.specular[1] << " " << p.specular[2]
+                      << "  Ns " << p.specular[3] << "  d " << p.diffuse[3] << "  illum " << p.illum << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,244 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "../src/mesh/mesh.h"
+#include "../src/raster/framebuffer.h"
+#include "../src/raster/raster.h"
+#include "../src/raster/msaa.h"
+#include "../src/image/image_diff.h"
+
+//Cost and quality of anti aliased thumbnails: no AA, MSAA 2x / 4x / 8x and 4x supersampling (2x2 the resolution, box filtered) against an
+//8x8 supersampled reference. Reports frame time, color memory and the error left on the edges.
+//Usage: msaa_report [model.obj]
+//Run from the repo root so the default model path resolves.
+
+static const uint32_t WIDTH = 192;
+static const uint32_t HEIGHT = 144;
+static const uint32_t REFERENCE_SCALE = 8;
+static const uint32_t TIMED_FRAMES = 20;
+
+static const uint32_t CLEAR_COLOR = 0xFF1F1A1A;
+
+//Turntable camera like render_batch, a few angles so the numbers don't hinge on one silhouette
+static void make_state(const br::mesh& m, float angle, br::draw_state& state)
+{
+    float aspect = (float)WIDTH / (float)HEIGHT;
+    float fovx = lnal::radians(60.0f);
+    float half_fov = atanf(tanf(fovx * 0.5f) / (aspect > 1.0f ? aspect : 1.0f));
+    float distance = (m.radius / sinf(half_fov)) * 1.1f;
+
+    lnal::mat4 projection;
+    lnal::gen_perspective_proj(projection, fovx, aspect, distance - (m.radius * 1.5f) > 0.01f ? distance - (m.radius * 1.5f) : 0.01f, distance + (m.radius * 1.5f));
+
+    lnal::vec3 center(m.center[0], m.center[1], m.center[2]);
+    lnal::vec3 eye = center + lnal::vec3(sinf(angle) * distance, m.radius * 0.5f, cosf(angle) * distance);
+
+    lnal::mat4 view;
+    lnal::lookat(view, eye, center, lnal::vec3(0.0f, 1.0f, 0.0f));
+
+    state.model = lnal::mat4(1.0f);
+    state.view_proj = projection * view;
+    state.color[0] = 0.8f; state.color[1] = 0.5f; state.color[2] = 0.3f;
+
+    lnal::vec3 light(0.4f, 0.8f, 0.45f);
+    light.normalize();
+    state.light_dir[0] = light[0]; state.light_dir[1] = light[1]; state.light_dir[2] = light[2];
+}
+
+//Box filters a framebuffer scale times the size of out
+static void downsample(const br::framebuffer& big, uint32_t scale, br::framebuffer& out)
+{
+    for(uint32_t y = 0; y < out.height; y++)
+    {
+        for(uint32_t x = 0; x < out.width; x++)
+        {
+            uint32_t sum[4] = {};
+            for(uint32_t sy = 0; sy < scale; sy++)
+            {
+                for(uint32_t sx = 0; sx < scale; sx++)
+                {
+                    uint32_t c = big.color[((size_t)(y * scale + sy) * big.width) + (x * scale + sx)];
+                    for(uint32_t k = 0; k < 4; k++)
+                    {
+                        sum[k] += (c >> (k * 8)) & 0xFF;
+                    }
+                }
+            }
+
+            uint32_t n = scale * scale;
+            uint32_t c = 0;
+            for(uint32_t k = 0; k < 4; k++)
+            {
+                c |= ((sum[k] + (n / 2)) / n) << (k * 8);
+            }
+
+            out.color[((size_t)y * out.width) + x] = c;
+        }
+    }
+}
+
+//Root mean square channel error over the pixels that differ from the reference at all (the edges), so the flat interior doesn't dilute it
+static double edge_rms(const br::framebuffer& image, const br::framebuffer& reference)
+{
+    double sum = 0.0;
+    uint64_t count = 0;
+
+    for(size_t i = 0; i < image.color.size(); i++)
+    {
+        uint32_t a = image.color[i];
+        uint32_t b = reference.color[i];
+        if(a == b)
+            continue;
+
+        for(uint32_t k = 0; k < 3; k++)
+        {
+            double d = (double)((a >> (k * 8)) & 0xFF) - (double)((b >> (k * 8)) & 0xFF);
+            sum += d * d;
+        }
+
+        count += 3;
+    }
+
+    return count ? sqrt(sum / (double)count) : 0.0;
+}
+
+struct method
+{
+    const char* name;
+    uint32_t samples;       //MSAA samples, 0 for supersampling
+    uint32_t scale;         //Supersampling factor per axis
+};
+
+static const method METHODS[] =
+{
+    { "no AA", 1, 1 },
+    { "MSAA 2x", 2, 1 },
+    { "MSAA 4x", 4, 1 },
+    { "MSAA 8x", 8, 1 },
+    { "SSAA 4x", 0, 2 },
+};
+
+static const float ANGLES[] = { 0.3f, 1.9f, 4.1f };
+
+int main(int argc, char** argv)
+{
+    const char* model_path = argc > 1 ? argv[1] : "./utah_teapot.obj";
+
+    br::mesh m;
+    if(!br::load_obj(m, model_path))
+    {
+        std::cerr << "Failed to load " << model_path << std::endl;
+        return 1;
+    }
+
+    const uint32_t* indices = &m.indices[m.lods[0].index_offset];
+    uint32_t index_count = m.lods[0].index_count;
+
+    std::cout << model_path << " thumbnails at " << WIDTH << "x" << HEIGHT << ", reference " << REFERENCE_SCALE << "x" << REFERENCE_SCALE << " supersampled" << std::endl;
+    std::cout << "  method       ms/frame   color KB   uncompressed KB   in use   expanded tiles   edge rms   max err   mean ssim" << std::endl;
+
+    //References, one per angle
+    std::vector<br::framebuffer> references(sizeof(ANGLES) / sizeof(ANGLES[0]));
+    {
+        br::framebuffer big;
+        br::framebuffer_init(big, WIDTH * REFERENCE_SCALE, HEIGHT * REFERENCE_SCALE);
+
+        for(size_t a = 0; a < references.size(); a++)
+        {
+            br::draw_state state;
+            make_state(m, ANGLES[a], state);
+
+            br::framebuffer_clear(big, CLEAR_COLOR);
+            br::draw_mesh(big, m, indices, index_count, state);
+
+            br::framebuffer_init(references[a], WIDTH, HEIGHT);
+            downsample(big, REFERENCE_SCALE, references[a]);
+        }
+    }
+
+    for(const method& mt : METHODS)
+    {
+        br::framebuffer out;
+        br::framebuffer_init(out, WIDTH, HEIGHT);
+
+        br::framebuffer big;
+        br::msaa_framebuffer msaa;
+        if(mt.samples == 0)
+            br::framebuffer_init(big, WIDTH * mt.scale, HEIGHT * mt.scale);
+        else
+            br::msaa_init(msaa, WIDTH, HEIGHT, mt.samples);
+
+        double ms = 0.0;
+        double rms = 0.0;
+        double ssim = 0.0;
+        uint32_t max_error = 0;
+        uint32_t expanded = 0;
+        size_t color_bytes = 0;
+        size_t uncompressed_bytes = 0;
+        br::raster_scratch scratch;
+
+        for(size_t a = 0; a < references.size(); a++)
+        {
+            br::draw_state state;
+            make_state(m, ANGLES[a], state);
+
+            double best = 1e30;
+            for(uint32_t i = 0; i < TIMED_FRAMES; i++)
+            {
+                auto start = std::chrono::high_resolution_clock::now();
+
+                if(mt.samples == 0)
+                {
+                    br::framebuffer_clear(big, CLEAR_COLOR);
+                    br::draw_mesh(big, m, indices, index_count, state, nullptr, &scratch);
+                    downsample(big, mt.scale, out);
+                }
+                else
+                {
+                    br::msaa_clear(msaa, CLEAR_COLOR);
+                    br::draw_mesh(msaa, m, indices, index_count, state, nullptr, &scratch);
+                    br::msaa_resolve(msaa, out);
+                }
+
+                best = fmin(best, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+            }
+
+            ms += best;
+
+            if(mt.samples == 0)
+            {
+                color_bytes += big.color.size() * sizeof(uint32_t);
+                uncompressed_bytes += big.color.size() * sizeof(uint32_t);
+            }
+            else
+            {
+                br::msaa_stats memory = br::msaa_memory(msaa);
+                color_bytes += memory.color_bytes;
+                uncompressed_bytes += memory.uncompressed_color_bytes;
+                expanded += memory.tiles_expanded;
+            }
+
+            br::image_diff diff;
+            br::compare_images(WIDTH, HEIGHT, out.color.data(), references[a].color.data(), 0, diff);
+            max_error = diff.max_channel_error > max_error ? diff.max_channel_error : max_error;
+            ssim += diff.mean_ssim;
+            rms += edge_rms(out, references[a]);
+        }
+
+        double n = (double)references.size();
+        std::cout << std::fixed << "  " << std::left << std::setw(11) << mt.name << std::right
+                  << std::setw(10) << std::setprecision(3) << ms / n
+                  << std::setw(11) << (double)color_bytes / n / 1024.0
+                  << std::setw(18) << std::setprecision(1) << (double)uncompressed_bytes / n / 1024.0
+                  << std::setw(8) << std::setprecision(0) << (100.0 * color_bytes) / uncompressed_bytes << "%"
+                  << std::setw(17) << std::setprecision(1) << (double)expanded / n
+                  << std::setw(11) << std::setprecision(2) << rms / n
+                  << std::setw(10) << max_error
+                  << std::setw(12) << std::setprecision(5) << ssim / n << std::endl;
+    }
+
+    return 0;
+}
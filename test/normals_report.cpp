@@ -0,0 +1,242 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include "../src/core/job.h"
+#include "../src/mesh/mesh.h"
+#include "../src/mesh/normals.h"
+#include "../src/asset/asset_load.h"
+
+//Generates normals and tangents for a large procedural heightfield and compares them with the analytic ones, on one thread and on the job
+//system. The heightfield has a uv seam down the middle to check both sides get the same normal. Then imports a model through the asset
+//cache twice to show the cached load time. Run from the repo root so the model path resolves.
+
+static const uint32_t GRID = 1024;
+static const float GRID_SIZE = 10.0f;
+static const float AMPLITUDE = 0.6f;
+static const float FREQUENCY = 1.3f;
+static const char* CACHED_MODEL = "./utah_teapot.obj";
+static const char* CACHE_DIRECTORY = "./cache/normals_report";
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static float height(float x, float z)
+{
+    return AMPLITUDE * sinf(x * FREQUENCY) * cosf(z * FREQUENCY * 0.7f);
+}
+
+//Unit surface normal and the unit direction of increasing u (x) at a point of the heightfield
+static void analytic_frame(float x, float z, float* normal, float* tangent)
+{
+    float dx = AMPLITUDE * FREQUENCY * cosf(x * FREQUENCY) * cosf(z * FREQUENCY * 0.7f);
+    float dz = -AMPLITUDE * FREQUENCY * 0.7f * sinf(x * FREQUENCY) * sinf(z * FREQUENCY * 0.7f);
+
+    float n_length = sqrtf((dx * dx) + 1.0f + (dz * dz));
+    normal[0] = -dx / n_length;
+    normal[1] = 1.0f / n_length;
+    normal[2] = -dz / n_length;
+
+    float t_length = sqrtf(1.0f + (dx * dx));
+    tangent[0] = 1.0f / t_length;
+    tangent[1] = dx / t_length;
+    tangent[2] = 0.0f;
+}
+
+//GRID x GRID quads, u along x and v along z. The columns right of the middle use their own copy of the middle column's vertices with u
+//shifted by 1, like a uv seam in a modelled mesh.
+static void make_heightfield(br::mesh& m)
+{
+    uint32_t row = GRID + 1;
+    uint32_t seam = GRID / 2;
+    float step = GRID_SIZE / (float)GRID;
+
+    auto add_vertex = [&](uint32_t i, uint32_t j, float u_offset)
+    {
+        float x = (float)i * step;
+        float z = (float)j * step;
+        m.positions.insert(m.positions.end(), { x, height(x, z), z });
+        m.uvs.insert(m.uvs.end(), { ((float)i / (float)GRID) + u_offset, (float)j / (float)GRID });
+    };
+
+    for(uint32_t i = 0; i <= GRID; i++)
+    {
+        for(uint32_t j = 0; j <= GRID; j++)
+        {
+            add_vertex(i, j, i > seam ? 1.0f : 0.0f);
+        }
+    }
+
+    for(uint32_t j = 0; j <= GRID; j++)
+    {
+        add_vertex(seam, j, 1.0f);
+    }
+
+    auto id = [&](uint32_t i, uint32_t j, bool right_side)
+    {
+        return (i == seam && right_side) ? (row * row) + j : (i * row) + j;
+    };
+
+    for(uint32_t i = 0; i < GRID; i++)
+    {
+        bool right_side = i >= seam;
+        for(uint32_t j = 0; j < GRID; j++)
+        {
+            uint32_t a = id(i, j, right_side), b = id(i, j + 1, right_side);
+            uint32_t c = id(i + 1, j, right_side), d = id(i + 1, j + 1, right_side);
+            m.indices.insert(m.indices.end(), { a, b, c, c, b, d });
+        }
+    }
+
+    m.lods.push_back({ 0, (uint32_t)m.indices.size(), 0.0f });
+    br::compute_bounds(m);
+}
+
+static double degrees_between(const float* a, const float* b)
+{
+    double c = (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+    c = c > 1.0 ? 1.0 : (c < -1.0 ? -1.0 : c);
+    return acos(c) * 180.0 / PI;
+}
+
+static float max_difference(const std::vector<float>& a, const std::vector<float>& b)
+{
+    float result = a.size() == b.size() ? 0.0f : INFINITY;
+    for(size_t i = 0; i < a.size() && i < b.size(); i++)
+    {
+        result = fmaxf(result, fabsf(a[i] - b[i]));
+    }
+    return result;
+}
+
+int main()
+{
+    br::job_system js;
+    br::job_system_init(js);
+
+    br::mesh source;
+    make_heightfield(source);
+    uint32_t vertex_count = br::mesh_vertex_count(source);
+
+    std::cout << "Heightfield: " << vertex_count << " vertices, " << source.indices.size() / 3 << " triangles, "
+              << br::job_thread_count(&js) << " threads" << std::endl;
+
+    br::mesh serial = source, parallel = source;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    br::generate_normals(serial, br::NORMALS_SMOOTH);
+    double serial_normals_ms = elapsed_ms(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    br::generate_tangents(serial);
+    double serial_tangents_ms = elapsed_ms(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    br::generate_normals(parallel, br::NORMALS_SMOOTH, &js);
+    double parallel_normals_ms = elapsed_ms(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    br::generate_tangents(parallel, &js);
+    double parallel_tangents_ms = elapsed_ms(start);
+
+    //Against the analytic frame. Border vertices only see the triangles on one side, so they are left out of the error.
+    double normal_max = 0.0, normal_mean = 0.0, tangent_max = 0.0, tangent_mean = 0.0;
+    uint32_t measured = 0, sign_errors = 0;
+
+    for(uint32_t v = 0; v < vertex_count; v++)
+    {
+        const float* p = &serial.positions[v * 3];
+        if(p[0] <= 0.0f || p[2] <= 0.0f || p[0] >= GRID_SIZE * 0.999f || p[2] >= GRID_SIZE * 0.999f)
+            continue;
+
+        float normal[3], tangent[3];
+        analytic_frame(p[0], p[2], normal, tangent);
+
+        double n_error = degrees_between(&serial.normals[v * 3], normal);
+        double t_error = degrees_between(&serial.tangents[v * 4], tangent);
+        normal_max = fmax(normal_max, n_error);
+        tangent_max = fmax(tangent_max, t_error);
+        normal_mean += n_error;
+        tangent_mean += t_error;
+        measured++;
+
+        //v runs along +z, so the bitangent sign is the sign of cross(n, t).z
+        const float* n = &serial.normals[v * 3];
+        const float* t = &serial.tangents[v * 4];
+        float expected_sign = ((n[0] * t[1]) - (n[1] * t[0])) < 0.0f ? -1.0f : 1.0f;
+        sign_errors += serial.tangents[(v * 4) + 3] != expected_sign;
+    }
+
+    //Both copies of the seam column have to end up with the same normal
+    uint32_t seam_row = GRID + 1;
+    float seam_difference = 0.0f;
+    for(uint32_t j = 0; j <= GRID; j++)
+    {
+        const float* left = &serial.normals[(((GRID / 2) * seam_row) + j) * 3];
+        const float* right = &serial.normals[((seam_row * seam_row) + j) * 3];
+        for(int k = 0; k < 3; k++)
+        {
+            seam_difference = fmaxf(seam_difference, fabsf(left[k] - right[k]));
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "                 1 thread    job system" << std::endl;
+    std::cout << "  normals   " << std::setw(10) << serial_normals_ms << " ms" << std::setw(10) << parallel_normals_ms << " ms   "
+              << serial_normals_ms / parallel_normals_ms << "x" << std::endl;
+    std::cout << "  tangents  " << std::setw(10) << serial_tangents_ms << " ms" << std::setw(10) << parallel_tangents_ms << " ms   "
+              << serial_tangents_ms / parallel_tangents_ms << "x" << std::endl;
+
+    std::cout << std::setprecision(4);
+    std::cout << "  normal error:  max " << normal_max << " deg, mean " << normal_mean / measured << " deg" << std::endl;
+    std::cout << "  tangent error: max " << tangent_max << " deg, mean " << tangent_mean / measured << " deg, " << sign_errors << " wrong signs"
+              << std::endl;
+    std::cout << std::setprecision(7);
+    std::cout << "  seam normal difference " << seam_difference << ", 1 thread vs job system: normals " << max_difference(serial.normals, parallel.normals)
+              << ", tangents " << max_difference(serial.tangents, parallel.tangents) << std::endl;
+
+    br::mesh flat = source;
+    start = std::chrono::high_resolution_clock::now();
+    br::generate_normals(flat, br::NORMALS_FLAT, &js);
+    double flat_ms = elapsed_ms(start);
+    std::cout << std::setprecision(2) << "  flat normals: " << br::mesh_vertex_count(flat) << " vertices, " << flat_ms << " ms" << std::endl;
+
+    //Cached import: the first load runs every import step, the second only reads the entry back
+    std::error_code error;
+    std::filesystem::remove_all(CACHE_DIRECTORY, error);
+
+    br::asset_cache cache;
+    cache.directory = CACHE_DIRECTORY;
+
+    br::mesh_asset imported, cached;
+
+    start = std::chrono::high_resolution_clock::now();
+    bool ok = br::load_mesh_asset(imported, CACHED_MODEL, &cache, &js);
+    double import_ms = elapsed_ms(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    ok = ok && br::load_mesh_asset(cached, CACHED_MODEL, &cache, &js);
+    double cached_ms = elapsed_ms(start);
+
+    br::job_system_shutdown(js);
+
+    std::cout << std::endl;
+    if(!ok)
+    {
+        std::cout << "  couldn't load " << CACHED_MODEL << std::endl;
+        return 1;
+    }
+
+    bool same = imported.vertices.data == cached.vertices.data && imported.cluster_indices == cached.cluster_indices && imported.m.tangents == cached.m.tangents;
+    std::cout << "  " << CACHED_MODEL << " (" << br::mesh_vertex_count(imported.m) << " vertices, " << imported.m.lods.size() << " LODs, "
+              << imported.vertices.layout.stride << " byte vertices): import " << import_ms << " ms, cached " << cached_ms << " ms"
+              << (same ? "" : " (MISMATCH)") << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../src/mesh/mesh.h"
+#include "../src/raster/framebuffer.h"
+#include "../src/raster/raster.h"
+#include "../src/raster/occlusion.h"
+#include "../src/scene/frustum.h"
+
+//Occlusion culling on a city block grid: box buildings are the occluders, teapots and spheres scattered through the streets and yards are the
+//objects. For a few camera positions it reports how many objects the frustum and the occlusion pass cull, the time of each step, and checks
+//every culled object against a full resolution depth buffer of the buildings (an object that would have written a pixel there was culled
+//wrongly). Run from the repo root so the model paths resolve.
+//Usage: occlusion_report [occlusion width] [occlusion height]
+
+static const uint32_t WIDTH = 1280;
+static const uint32_t HEIGHT = 720;
+static const uint32_t BLOCKS = 10;
+static const float BLOCK_SIZE = 10.0f;
+static const float STREET_WIDTH = 4.0f;
+static const uint32_t OBJECT_COUNT = 1500;
+static const uint32_t TIMED_FRAMES = 20;
+
+struct object
+{
+    const br::mesh* m;
+    lnal::mat4 model;
+    float center[3];        //World space bounding sphere
+    float radius;
+};
+
+struct view
+{
+    const char* name;
+    float eye[3];
+    float target[3];
+};
+
+static float random01()
+{
+    return (float)rand() / (float)RAND_MAX;
+}
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//Unit cube around the origin, counter clockwise from outside
+static void make_box(br::mesh& m)
+{
+    m.positions =
+    {
+        -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f, 0.5f, -0.5f,   -0.5f, 0.5f, -0.5f,
+        -0.5f, -0.5f, 0.5f,    0.5f, -0.5f, 0.5f,    0.5f, 0.5f, 0.5f,    -0.5f, 0.5f, 0.5f,
+    };
+
+    m.indices =
+    {
+        4, 5, 6, 4, 6, 7,       //+z
+        1, 0, 3, 1, 3, 2,       //-z
+        5, 1, 2, 5, 2, 6,       //+x
+        0, 4, 7, 0, 7, 3,       //-x
+        7, 6, 2, 7, 2, 3,       //+y
+        0, 1, 5, 0, 5, 4,       //-y
+    };
+
+    m.lods.push_back({ 0, 36, 0.0f });
+    br::compute_bounds(m);
+}
+
+//World space bounding sphere of a mesh under a translate * uniform scale model
+static void place(object& o, const br::mesh& m, const lnal::vec3& position, const lnal::vec3& size)
+{
+    o.m = &m;
+    o.model = lnal::mat4(1.0f);
+    lnal::scale(o.model, size);
+    lnal::translate_relative(o.model, position);
+
+    float s = fmaxf(size[0], fmaxf(size[1], size[2]));
+    for(int i = 0; i < 3; i++)
+    {
+        o.center[i] = (m.center[i] * size[i]) + position[i];
+    }
+    o.radius = m.radius * s;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t occlusion_width = argc > 1 ? (uint32_t)atoi(argv[1]) : WIDTH / 4;
+    uint32_t occlusion_height = argc > 2 ? (uint32_t)atoi(argv[2]) : HEIGHT / 4;
+
+    br::mesh teapot, sphere, box;
+    if(!br::load_obj(teapot, "./utah_teapot.obj") || !br::load_obj(sphere, "./ico-sphere.obj"))
+    {
+        std::cerr << "Failed to load ./utah_teapot.obj or ./ico-sphere.obj" << std::endl;
+        return 1;
+    }
+    make_box(box);
+
+    //One building per block, streets in between. The city is centered on the origin.
+    float pitch = BLOCK_SIZE + STREET_WIDTH;
+    float extent = (BLOCKS * pitch) * 0.5f;
+    srand(11);
+
+    std::vector<object> buildings(BLOCKS * BLOCKS);
+    for(uint32_t z = 0; z < BLOCKS; z++)
+    {
+        for(uint32_t x = 0; x < BLOCKS; x++)
+        {
+            float height = 6.0f + (random01() * 18.0f);
+            lnal::vec3 position((x * pitch) - extent + (pitch * 0.5f), height * 0.5f, (z * pitch) - extent + (pitch * 0.5f));
+            place(buildings[(z * BLOCKS) + x], box, position, lnal::vec3(BLOCK_SIZE, height, BLOCK_SIZE));
+        }
+    }
+
+    //Objects anywhere on the ground that isn't a building
+    std::vector<object> objects;
+    while(objects.size() < OBJECT_COUNT)
+    {
+        float x = (random01() * 2.0f - 1.0f) * extent;
+        float z = (random01() * 2.0f - 1.0f) * extent;
+        float in_block_x = fmodf(x + extent, pitch) - (STREET_WIDTH * 0.5f);
+        float in_block_z = fmodf(z + extent, pitch) - (STREET_WIDTH * 0.5f);
+        if(in_block_x > -0.5f && in_block_x < BLOCK_SIZE + 0.5f && in_block_z > -0.5f && in_block_z < BLOCK_SIZE + 0.5f)
+            continue;
+
+        const br::mesh& m = (objects.size() & 1) ? sphere : teapot;
+        float size = (0.4f + (random01() * 0.6f)) / m.radius;
+
+        object o;
+        place(o, m, lnal::vec3(x - (m.center[0] * size), (m.radius - m.center[1]) * size, z - (m.center[2] * size)), lnal::vec3(size, size, size));
+        objects.push_back(o);
+    }
+
+    float street = -extent + pitch;
+    const view views[] =
+    {
+        { "down a street", { street, 1.7f, extent }, { street, 1.7f, -extent } },
+        { "at a crossing", { street, 1.7f, street }, { extent, 1.0f, extent * 0.3f } },
+        { "over the roofs", { -extent, 30.0f, extent }, { 0.0f, 0.0f, 0.0f } },
+    };
+
+    lnal::mat4 projection;
+    lnal::gen_perspective_proj(projection, lnal::radians(75.0f), (float)WIDTH / (float)HEIGHT, 0.1f, extent * 3.0f);
+
+    br::occlusion_buffer ob;
+    br::occlusion_init(ob, occlusion_width, occlusion_height);
+    br::raster_scratch raster;
+
+    br::depth_buffer reference, scratch;
+    br::depth_buffer_init(reference, WIDTH, HEIGHT);
+    br::depth_buffer_init(scratch, WIDTH, HEIGHT);
+
+    std::cout << BLOCKS * BLOCKS << " buildings (occluders), " << objects.size() << " objects, occlusion buffer " << ob.width << "x" << ob.height
+              << ", reference " << WIDTH << "x" << HEIGHT << std::endl;
+    std::cout << "  view              in frustum   occluded   drawn tris (of)        frustum ms   clear ms   occluders ms   tests ms   total ms"
+              << "   wrongly culled   missed" << std::endl;
+
+    for(const view& v : views)
+    {
+        lnal::mat4 camera;
+        lnal::lookat(camera, lnal::vec3(v.eye[0], v.eye[1], v.eye[2]), lnal::vec3(v.target[0], v.target[1], v.target[2]), lnal::vec3(0.0f, 1.0f, 0.0f));
+        lnal::mat4 view_proj = projection * camera;
+
+        br::frustum f;
+        br::extract_frustum(f, view_proj);
+
+        std::vector<uint32_t> in_frustum, visible;
+        double frustum_ms = 1e30, clear_ms = 1e30, occluder_ms = 1e30, test_ms = 1e30;
+
+        for(uint32_t frame = 0; frame < TIMED_FRAMES; frame++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            in_frustum.clear();
+            for(uint32_t i = 0; i < objects.size(); i++)
+            {
+                if(br::sphere_in_frustum(f, objects[i].center, objects[i].radius))
+                    in_frustum.push_back(i);
+            }
+            frustum_ms = fmin(frustum_ms, elapsed_ms(start));
+
+            start = std::chrono::high_resolution_clock::now();
+            br::occlusion_clear(ob);
+            clear_ms = fmin(clear_ms, elapsed_ms(start));
+
+            start = std::chrono::high_resolution_clock::now();
+            for(const object& b : buildings)
+            {
+                if(!br::sphere_in_frustum(f, b.center, b.radius))
+                    continue;
+
+                lnal::mat4 mvp = view_proj * b.model;
+                br::draw_occluder(ob, box, box.indices.data(), (uint32_t)box.indices.size(), mvp, true, nullptr, &raster);
+            }
+            occluder_ms = fmin(occluder_ms, elapsed_ms(start));
+
+            start = std::chrono::high_resolution_clock::now();
+            visible.clear();
+            for(uint32_t i : in_frustum)
+            {
+                const object& o = objects[i];
+                lnal::mat4 mvp = view_proj * o.model;
+                if(br::occlusion_test_box(ob, o.m->bounds_min, o.m->bounds_max, mvp))
+                    visible.push_back(i);
+            }
+            test_ms = fmin(test_ms, elapsed_ms(start));
+        }
+
+        //Ground truth: an object is visible if drawing it over the buildings' full resolution depth writes a pixel
+        br::depth_buffer_clear(reference);
+        for(const object& b : buildings)
+        {
+            lnal::mat4 mvp = view_proj * b.model;
+            br::draw_depth(reference, box, box.indices.data(), (uint32_t)box.indices.size(), mvp, true, nullptr, &raster);
+        }
+
+        uint32_t wrongly_culled = 0, missed = 0;
+        uint64_t drawn_triangles = 0, frustum_triangles = 0;
+        size_t v_index = 0;
+        for(uint32_t i : in_frustum)
+        {
+            const object& o = objects[i];
+            bool kept = v_index < visible.size() && visible[v_index] == i;
+            v_index += kept;
+
+            uint32_t triangles = o.m->lods[0].index_count / 3;
+            frustum_triangles += triangles;
+            drawn_triangles += kept ? triangles : 0;
+
+            memcpy(scratch.depth.data(), reference.depth.data(), reference.depth.size() * sizeof(float));
+            br::raster_stats stats;
+            lnal::mat4 mvp = view_proj * o.model;
+            br::draw_depth(scratch, *o.m, &o.m->indices[o.m->lods[0].index_offset], o.m->lods[0].index_count, mvp, false, &stats, &raster);
+
+            bool really_visible = stats.pixels_written > 0;
+            wrongly_culled += !kept && really_visible;
+            missed += kept && !really_visible;
+        }
+
+        uint32_t occluded = (uint32_t)(in_frustum.size() - visible.size());
+        double total_ms = frustum_ms + clear_ms + occluder_ms + test_ms;
+
+        std::cout << std::fixed << std::setprecision(3) << "  " << std::left << std::setw(16) << v.name << std::right
+                  << std::setw(12) << in_frustum.size() << std::setw(11) << occluded
+                  << std::setw(11) << drawn_triangles << " (" << std::setw(7) << frustum_triangles << ")"
+                  << std::setw(15) << frustum_ms << std::setw(11) << clear_ms << std::setw(15) << occluder_ms << std::setw(11) << test_ms
+                  << std::setw(11) << total_ms << std::setw(17) << wrongly_culled << std::setw(9) << missed << std::endl;
+    }
+
+    return 0;
+}
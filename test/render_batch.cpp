@@ -0,0 +1,183 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+#include "../src/core/job.h"
+#include "../src/mesh/mesh.h"
+#include "../src/mesh/meshlet.h"
+#include "../src/raster/framebuffer.h"
+#include "../src/raster/raster.h"
+#include "../src/raster/msaa.h"
+#include "../src/image/image_writer.h"
+#include "../src/scene/frustum.h"
+
+//Renders a turntable of a model with the CPU rasterizer and writes every frame to disk. No window or display server is needed.
+//The model is split into meshlets and every frame only draws the ones cull_meshlets keeps, the first frame is also drawn whole with
+//draw_mesh to check the culled image matches.
+//Usage: render_batch [model.obj] [frames] [width] [height] [output prefix] [ppm|png] [samples]
+//  samples 2, 4 or 8 renders through the multisampled target and resolves each frame (default 1, no AA)
+//  output prefix defaults to ./cache/frame, out of the tree, its directory is created if missing
+//Run from the repo root so the default model path resolves
+
+int main(int argc, char** argv)
+{
+    const char* model_path = argc > 1 ? argv[1] : "./utah_teapot.obj";
+    uint32_t frame_count = argc > 2 ? (uint32_t)atoi(argv[2]) : 36;
+    uint32_t width = argc > 3 ? (uint32_t)atoi(argv[3]) : 640;
+    uint32_t height = argc > 4 ? (uint32_t)atoi(argv[4]) : 360;
+    std::string prefix = argc > 5 ? argv[5] : "./cache/frame";
+    br::image_format format = (argc > 6 && strcmp(argv[6], "ppm") == 0) ? br::IMAGE_PPM : br::IMAGE_PNG;
+    uint32_t samples = argc > 7 ? (uint32_t)atoi(argv[7]) : 1;
+
+    if(frame_count == 0 || width == 0 || height == 0)
+    {
+        std::cerr << "frames, width and height must be positive" << std::endl;
+        return 1;
+    }
+
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::path(prefix).parent_path();
+    if(!directory.empty())
+        std::filesystem::create_directories(directory, error);
+
+    br::mesh m;
+    if(!br::load_obj(m, model_path))
+    {
+        std::cerr << "Failed to load " << model_path << std::endl;
+        return 1;
+    }
+
+    br::job_system js;
+    br::job_system_init(js);
+
+    br::image_writer writer;
+    writer.js = &js;
+
+    br::framebuffer fb;
+    br::framebuffer_init(fb, width, height);
+
+    br::msaa_framebuffer msaa;
+    if(samples > 1 && !br::msaa_init(msaa, width, height, samples))
+    {
+        std::cerr << "samples must be 1, 2, 4 or 8" << std::endl;
+        return 1;
+    }
+
+    //Frame the bounding sphere with a 60 degree horizontal fov, keeping it inside the vertical fov for tall images too
+    float aspect = (float)width / (float)height;
+    float fovx = lnal::radians(60.0f);
+    float half_fov = atanf(tanf(fovx * 0.5f) / (aspect > 1.0f ? aspect : 1.0f));
+    float distance = (m.radius / sinf(half_fov)) * 1.1f;
+
+    lnal::mat4 projection;
+    lnal::gen_perspective_proj(projection, fovx, aspect, distance - (m.radius * 1.5f) > 0.01f ? distance - (m.radius * 1.5f) : 0.01f, distance + (m.radius * 1.5f));
+
+    lnal::vec3 center(m.center[0], m.center[1], m.center[2]);
+
+    br::draw_state state;
+    state.model = lnal::mat4(1.0f);
+    state.color[0] = 0.8f; state.color[1] = 0.5f; state.color[2] = 0.3f;
+
+    lnal::vec3 light(0.4f, 0.8f, 0.45f);
+    light.normalize();
+    state.light_dir[0] = light[0]; state.light_dir[1] = light[1]; state.light_dir[2] = light[2];
+
+    br::meshlet_set meshlets;
+    br::build_meshlets(meshlets, m, &m.indices[m.lods[0].index_offset], m.lods[0].index_count);
+
+    br::frustum view_frustum;
+    std::vector<uint32_t> visible;
+    uint64_t meshlets_drawn = 0;
+    uint64_t culled_pixels_differing = 0;
+
+    br::raster_stats stats;
+    br::raster_scratch scratch;
+    double render_ms = 0.0;
+    const char* extension = format == br::IMAGE_PNG ? ".png" : ".ppm";
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for(uint32_t f = 0; f < frame_count; f++)
+    {
+        auto frame_start = std::chrono::high_resolution_clock::now();
+
+        float angle = (2.0f * PI * f) / frame_count;
+        lnal::vec3 eye = center + lnal::vec3(sinf(angle) * distance, m.radius * 0.5f, cosf(angle) * distance);
+
+        lnal::mat4 view;
+        lnal::lookat(view, eye, center, lnal::vec3(0.0f, 1.0f, 0.0f));
+        state.view_proj = projection * view;
+
+        //Skip the clusters that are off screen or facing away
+        br::extract_frustum(view_frustum, state.view_proj);
+        visible.clear();
+        br::cull_meshlets(meshlets, state.model, view_frustum, eye, visible);
+        meshlets_drawn += visible.size();
+
+        if(samples > 1)
+        {
+            br::msaa_clear(msaa, br::pack_color(0.1f, 0.1f, 0.12f));
+            br::draw_meshlets(msaa, m, meshlets, visible, state, &stats, &scratch);
+            br::msaa_resolve(msaa, fb, &js);
+        }
+        else
+        {
+            br::framebuffer_clear(fb, br::pack_color(0.1f, 0.1f, 0.12f));
+            br::draw_meshlets(fb, m, meshlets, visible, state, &stats, &scratch);
+        }
+
+        render_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frame_start).count();
+
+        //Cluster culling is conservative, drawing everything has to give the same image
+        if(f == 0 && samples == 1)
+        {
+            br::framebuffer full;
+            br::framebuffer_init(full, width, height);
+            br::framebuffer_clear(full, br::pack_color(0.1f, 0.1f, 0.12f));
+            br::draw_mesh(full, m, &m.indices[m.lods[0].index_offset], m.lods[0].index_count, state);
+
+            for(size_t p = 0; p < full.color.size(); p++)
+            {
+                culled_pixels_differing += full.color[p] != fb.color[p];
+            }
+        }
+
+        char number[16];
+        snprintf(number, sizeof(number), "_%04u", f);
+        br::image_writer_submit(writer, prefix + number + extension, format, fb);
+    }
+
+    bool ok = br::image_writer_flush(writer);
+    double total_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    uint32_t threads = br::job_thread_count(&js);
+    br::job_system_shutdown(js);
+
+    std::cout << model_path << ": " << frame_count << " frames at " << width << "x" << height << " -> " << prefix << "_####" << extension << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  render " << render_ms / frame_count << " ms/frame, total (with encoding) " << total_ms / frame_count << " ms/frame on "
+              << threads << " threads" << std::endl;
+    uint64_t meshlets_total = (uint64_t)meshlets.meshlets.size() * frame_count;
+    uint64_t triangles_total = (uint64_t)(m.lods[0].index_count / 3) * frame_count;
+    std::cout << "  " << meshlets_total - meshlets_drawn << " of " << meshlets_total << " meshlets culled ("
+              << (100.0 * (meshlets_total - meshlets_drawn)) / meshlets_total << "%), " << triangles_total - stats.triangles_submitted << " of "
+              << triangles_total << " triangles skipped with them" << std::endl;
+    std::cout << "  " << stats.triangles_rasterized << " of " << stats.triangles_submitted << " triangles rasterized, " << stats.pixels_written << " pixels written" << std::endl;
+    if(samples == 1)
+        std::cout << "  first frame: " << culled_pixels_differing << " pixels differ from drawing every triangle" << std::endl;
+    if(samples > 1)
+    {
+        br::msaa_stats memory = br::msaa_memory(msaa);
+        std::cout << "  " << samples << "x MSAA, last frame " << memory.tiles_expanded << " of " << msaa.tiles_x * msaa.tiles_y << " tiles expanded, color "
+                  << memory.color_bytes / 1024 << " KB (" << memory.uncompressed_color_bytes / 1024 << " KB uncompressed)" << std::endl;
+    }
+    std::cout << "  " << writer.written.load() << " written, " << writer.failed.load() << " failed" << std::endl;
+
+    return ok && culled_pixels_differing == 0 ? 0 : 1;
+}
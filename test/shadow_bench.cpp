@@ -0,0 +1,346 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "../src/mesh/mesh.h"
+#include "../src/raster/framebuffer.h"
+#include "../src/raster/raster.h"
+#include "../src/raster/pipeline.h"
+#include "../src/raster/shaders.h"
+#include "../src/raster/shadow.h"
+
+//Shadow map costs. Renders a floor with a grid of teapots and spheres into a shadow map through the general pipeline (a flat shader with no
+//varyings, and the Lambert shader a lit pass would use) and through draw_depth, checks the depth-only path writes the same depths, then times
+//the same three paths on a fill bound pass (full map quads, almost no setup), a full cascade set and the PCF lookups (4 wide row compares
+//against a scalar 16 tap loop).
+//Run from the repo root so the model paths resolve.
+
+static const uint32_t MAP_SIZE = 2048;
+static const uint32_t GRID = 5;
+static const float SPACING = 3.0f;
+static const uint32_t TIMED_FRAMES = 10;
+static const uint32_t PCF_LOOKUPS = 1 << 20;
+static const uint32_t FILL_LAYERS = 8;
+
+//A flat square on y = 0 facing up
+static void make_floor(br::mesh& m, float half_size)
+{
+    const float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+
+    for(const auto& c : corners)
+    {
+        m.positions.insert(m.positions.end(), { c[0] * half_size, 0.0f, c[1] * half_size });
+        m.normals.insert(m.normals.end(), { 0.0f, 1.0f, 0.0f });
+    }
+
+    m.indices = { 0, 2, 1, 0, 3, 2 };
+    m.lods.push_back({ 0, 6, 0.0f });
+    br::compute_bounds(m);
+}
+
+//Two triangles covering the whole of clip space x, y at z = 0, facing the viewer
+static void make_screen_quad(br::mesh& m)
+{
+    const float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+
+    for(const auto& c : corners)
+    {
+        m.positions.insert(m.positions.end(), { c[0], c[1], 0.0f });
+        m.normals.insert(m.normals.end(), { 0.0f, 0.0f, 1.0f });
+    }
+
+    m.indices = { 0, 1, 2, 0, 2, 3 };
+    m.lods.push_back({ 0, 6, 0.0f });
+    br::compute_bounds(m);
+}
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//Same filter as shadow_pcf, one texel at a time
+static float pcf_scalar(const br::depth_buffer& db, float u, float v, float z)
+{
+    float tu = fminf(fmaxf(u - 0.5f, 0.0f), (float)(db.width - 1));
+    float tv = fminf(fmaxf(v - 0.5f, 0.0f), (float)(db.height - 1));
+    int x0 = (int)tu;
+    int y0 = (int)tv;
+    float fx = tu - (float)x0;
+    float fy = tv - (float)y0;
+
+    float wx[4] = { 1.0f - fx, 1.0f, 1.0f, fx };
+    float wy[4] = { 1.0f - fy, 1.0f, 1.0f, fy };
+    float lit = 0.0f;
+
+    for(int r = 0; r < 4; r++)
+    {
+        const float* row = br::depth_buffer_row(db, y0 - 1 + r);
+        for(int c = 0; c < 4; c++)
+        {
+            if(z <= row[x0 - 1 + c])
+                lit += wx[c] * wy[r];
+        }
+    }
+
+    return lit * (1.0f / 9.0f);
+}
+
+int main()
+{
+    br::mesh teapot, sphere, floor_mesh;
+    if(!br::load_obj(teapot, "./utah_teapot.obj") || !br::load_obj(sphere, "./ico-sphere.obj"))
+    {
+        std::cerr << "Failed to load ./utah_teapot.obj or ./ico-sphere.obj" << std::endl;
+        return 1;
+    }
+
+    float extent = GRID * SPACING * 0.5f;
+    make_floor(floor_mesh, extent + SPACING);
+
+    //Calls draw(mesh, model) for every object: the floor, then teapots and spheres in a checkerboard
+    auto for_each_object = [&](const auto& draw)
+    {
+        draw(floor_mesh, lnal::mat4(1.0f));
+
+        for(uint32_t z = 0; z < GRID; z++)
+        {
+            for(uint32_t x = 0; x < GRID; x++)
+            {
+                const br::mesh& m = ((x + z) & 1) ? sphere : teapot;
+                float s = 1.0f / m.radius;
+
+                lnal::vec3 position(((float)x + 0.5f) * SPACING - extent, 1.0f, ((float)z + 0.5f) * SPACING - extent);
+                lnal::vec3 center(m.center[0] * s, m.center[1] * s, m.center[2] * s);
+
+                lnal::mat4 model(1.0f);
+                lnal::scale(model, lnal::vec3(s, s, s));
+                lnal::translate_relative(model, position - center);
+                draw(m, model);
+            }
+        }
+    };
+
+    //Directional light map over the whole grid
+    lnal::vec3 light_dir(0.5f, 0.8f, 0.3f);
+    light_dir.normalize();
+
+    lnal::mat4 light_view;
+    lnal::lookat(light_view, light_dir * (extent * 3.0f), lnal::vec3(0.0f, 0.0f, 0.0f), lnal::vec3(0.0f, 1.0f, 0.0f));
+
+    lnal::mat4 ortho;
+    float half = extent + SPACING;
+    lnal::gen_orthographic_proj(ortho, -half * 1.5f, half * 1.5f, -half * 1.5f, half * 1.5f, extent, extent * 6.0f);
+    lnal::mat4 light_view_proj = ortho * light_view;
+
+    std::cout << "Shadow map " << MAP_SIZE << " x " << MAP_SIZE << ", " << GRID * GRID << " casters on a floor" << std::endl;
+
+    //General pipeline into a framebuffer of the map's size
+    br::framebuffer fb;
+    br::framebuffer_init(fb, MAP_SIZE, MAP_SIZE);
+    br::raster_stats stats;
+    br::raster_scratch scratch;
+
+    auto draw_flat = [&]()
+    {
+        br::framebuffer_clear(fb, 0);
+        for_each_object([&](const br::mesh& m, lnal::mat4 model)
+        {
+            br::flat_vertex_shader vs = { light_view_proj * model };
+            br::flat_fragment_shader fs = { 0xFFFFFFFF };
+            br::draw_shaded(fb, m, &m.indices[m.lods[0].index_offset], m.lods[0].index_count, vs, fs, false, nullptr, &scratch);
+        });
+    };
+
+    auto draw_lambert = [&]()
+    {
+        br::framebuffer_clear(fb, 0);
+        for_each_object([&](const br::mesh& m, lnal::mat4 model)
+        {
+            br::lambert_vertex_shader vs = { model, light_view_proj * model };
+            br::lambert_fragment_shader fs = { { 1.0f, 1.0f, 1.0f }, { light_dir[0], light_dir[1], light_dir[2] } };
+            br::draw_shaded(fb, m, &m.indices[m.lods[0].index_offset], m.lods[0].index_count, vs, fs, false, nullptr, &scratch);
+        });
+    };
+
+    br::shadow_map map;
+    br::shadow_map_init(map, MAP_SIZE);
+
+    auto draw_depth_only = [&]()
+    {
+        br::depth_buffer_clear(map.depth);
+        for_each_object([&](const br::mesh& m, lnal::mat4 model)
+        {
+            br::draw_depth(map.depth, m, &m.indices[m.lods[0].index_offset], m.lods[0].index_count, light_view_proj * model, false, &stats, &scratch);
+        });
+    };
+
+    auto best_of = [](const auto& pass)
+    {
+        double best = 1e30;
+        for(uint32_t i = 0; i < TIMED_FRAMES; i++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            pass();
+            best = fmin(best, elapsed_ms(start));
+        }
+        return best;
+    };
+
+    double flat_ms = best_of(draw_flat);
+    double lambert_ms = best_of(draw_lambert);
+    double depth_ms = best_of(draw_depth_only);
+
+    //Both paths run the same setup and coverage rules, so the depths have to match exactly
+    draw_flat();
+    draw_depth_only();
+    uint64_t mismatches = 0;
+    for(uint32_t y = 0; y < MAP_SIZE; y++)
+    {
+        const float* row = br::depth_buffer_row(map.depth, (int)y);
+        for(uint32_t x = 0; x < MAP_SIZE; x++)
+        {
+            mismatches += row[x] != fb.depth[((size_t)y * MAP_SIZE) + x];
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  general, flat shader      " << std::setw(8) << flat_ms << " ms" << std::endl;
+    std::cout << "  general, Lambert shader   " << std::setw(8) << lambert_ms << " ms" << std::endl;
+    std::cout << "  depth only (draw_depth)   " << std::setw(8) << depth_ms << " ms   " << flat_ms / depth_ms << "x / " << lambert_ms / depth_ms
+              << "x faster, " << mismatches << " depths differ from the general path" << std::endl;
+
+    //Fill bound: quads over the whole map drawn back to front so every layer passes the depth test, a handful of triangles and millions
+    //of texels. This is where skipping the color write and the varyings shows, the caster grid above is mostly triangle setup.
+    br::mesh quad;
+    make_screen_quad(quad);
+
+    auto for_each_layer = [&](const auto& draw)
+    {
+        for(uint32_t i = 0; i < FILL_LAYERS; i++)
+        {
+            lnal::mat4 layer(1.0f);
+            lnal::translate_absolute(layer, lnal::vec3(0.0f, 0.0f, 0.8f - (1.6f * i) / FILL_LAYERS));
+            draw(layer);
+        }
+    };
+
+    const uint32_t* quad_indices = &quad.indices[quad.lods[0].index_offset];
+    uint32_t quad_index_count = quad.lods[0].index_count;
+
+    double fill_flat_ms = best_of([&]()
+    {
+        br::framebuffer_clear(fb, 0);
+        for_each_layer([&](const lnal::mat4& layer)
+        {
+            br::flat_vertex_shader vs = { layer };
+            br::flat_fragment_shader fs = { 0xFFFFFFFF };
+            br::draw_shaded(fb, quad, quad_indices, quad_index_count, vs, fs, false, nullptr, &scratch);
+        });
+    });
+
+    double fill_lambert_ms = best_of([&]()
+    {
+        br::framebuffer_clear(fb, 0);
+        for_each_layer([&](const lnal::mat4& layer)
+        {
+            br::lambert_vertex_shader vs = { lnal::mat4(1.0f), layer };
+            br::lambert_fragment_shader fs = { { 1.0f, 1.0f, 1.0f }, { light_dir[0], light_dir[1], light_dir[2] } };
+            br::draw_shaded(fb, quad, quad_indices, quad_index_count, vs, fs, false, nullptr, &scratch);
+        });
+    });
+
+    double fill_depth_ms = best_of([&]()
+    {
+        br::depth_buffer_clear(map.depth);
+        for_each_layer([&](const lnal::mat4& layer)
+        {
+            br::draw_depth(map.depth, quad, quad_indices, quad_index_count, layer, false, nullptr, &scratch);
+        });
+    });
+
+    std::cout << "  fill bound, " << FILL_LAYERS << " full map quads:" << std::endl;
+    std::cout << "    general, flat shader    " << std::setw(8) << fill_flat_ms << " ms" << std::endl;
+    std::cout << "    general, Lambert shader " << std::setw(8) << fill_lambert_ms << " ms" << std::endl;
+    std::cout << "    depth only (draw_depth) " << std::setw(8) << fill_depth_ms << " ms   " << fill_flat_ms / fill_depth_ms << "x / "
+              << fill_lambert_ms / fill_depth_ms << "x faster" << std::endl;
+
+    //A cascade set for a camera standing at the edge of the grid
+    lnal::mat4 view;
+    lnal::lookat(view, lnal::vec3(-extent, 4.0f, extent + 4.0f), lnal::vec3(0.0f, 0.0f, 0.0f), lnal::vec3(0.0f, 1.0f, 0.0f));
+    lnal::mat4 projection;
+    lnal::gen_perspective_proj(projection, lnal::radians(70.0f), 16.0f / 9.0f, 0.1f, extent * 4.0f);
+
+    float light[3] = { light_dir[0], light_dir[1], light_dir[2] };
+    br::shadow_cascades cascades;
+    cascades.caster_distance = extent;
+
+    double cascade_ms = best_of([&]()
+    {
+        br::fit_cascades(cascades, view, projection, light);
+        for(uint32_t i = 0; i < cascades.count; i++)
+        {
+            lnal::mat4 cascade_view_proj = cascades.maps[i].view_proj;
+            for_each_object([&](const br::mesh& m, lnal::mat4 model)
+            {
+                br::draw_depth(cascades.maps[i].depth, m, &m.indices[m.lods[0].index_offset], m.lods[0].index_count, cascade_view_proj * model, false, nullptr,
+                               &scratch);
+            });
+        }
+    });
+
+    std::cout << "  " << cascades.count << " cascades of " << cascades.size << " x " << cascades.size << ", splits";
+    for(uint32_t i = 0; i <= cascades.count; i++)
+    {
+        std::cout << " " << cascades.splits[i];
+    }
+    std::cout << ": " << cascade_ms << " ms" << std::endl;
+
+    //PCF over random points of the map, at depths around the stored ones so both outcomes happen
+    std::vector<float> lookups(PCF_LOOKUPS * 3);
+    srand(7);
+    for(uint32_t i = 0; i < PCF_LOOKUPS; i++)
+    {
+        float u = ((float)rand() / (float)RAND_MAX) * MAP_SIZE;
+        float v = ((float)rand() / (float)RAND_MAX) * MAP_SIZE;
+        float stored = br::depth_buffer_row(map.depth, (int)fminf(v, MAP_SIZE - 1.0f))[(int)fminf(u, MAP_SIZE - 1.0f)];
+        lookups[i * 3] = u;
+        lookups[i * 3 + 1] = v;
+        lookups[i * 3 + 2] = stored + (((float)rand() / (float)RAND_MAX) - 0.5f) * 0.01f;
+    }
+
+    float vector_sum = 0.0f, scalar_sum = 0.0f, max_difference = 0.0f;
+    double vector_ms = best_of([&]()
+    {
+        vector_sum = 0.0f;
+        for(uint32_t i = 0; i < PCF_LOOKUPS; i++)
+        {
+            vector_sum += br::shadow_pcf(map.depth, lookups[i * 3], lookups[i * 3 + 1], lookups[i * 3 + 2]);
+        }
+    });
+
+    double scalar_ms = best_of([&]()
+    {
+        scalar_sum = 0.0f;
+        for(uint32_t i = 0; i < PCF_LOOKUPS; i++)
+        {
+            scalar_sum += pcf_scalar(map.depth, lookups[i * 3], lookups[i * 3 + 1], lookups[i * 3 + 2]);
+        }
+    });
+
+    for(uint32_t i = 0; i < PCF_LOOKUPS; i += 97)
+    {
+        float a = br::shadow_pcf(map.depth, lookups[i * 3], lookups[i * 3 + 1], lookups[i * 3 + 2]);
+        float b = pcf_scalar(map.depth, lookups[i * 3], lookups[i * 3 + 1], lookups[i * 3 + 2]);
+        max_difference = fmaxf(max_difference, fabsf(a - b));
+    }
+
+    std::cout << "  PCF 4x4 tent, " << PCF_LOOKUPS << " lookups: row compares " << vector_ms << " ms (" << PCF_LOOKUPS / vector_ms / 1000.0
+              << " M/s), scalar taps " << scalar_ms << " ms, " << scalar_ms / vector_ms << "x, max difference " << std::setprecision(6)
+              << max_difference << " (sums " << vector_sum << " / " << scalar_sum << ")" << std::endl;
+
+    return 0;
+}
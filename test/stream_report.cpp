@@ -0,0 +1,131 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/core/job.h"
+#include "../src/asset/stream.h"
+
+//Streams the bundled models and golden images through a simulated camera walk with a memory budget smaller than the whole set
+//and reports stall time, uploads, evictions and bytes resident. Run from the repo root so the asset paths resolve.
+
+static const char* MESH_PATHS[] = { "./utah_teapot.obj", "./ico-sphere.obj" };
+static const char* TEXTURE_PATHS[] = { "./test/golden/teapot.ppm", "./test/golden/ico_sphere.ppm" };
+
+//Each file is registered this many times to stand in for a bigger level
+static const uint32_t COPIES = 6;
+
+//Assets in view at once, sliding along the catalog as the camera moves
+static const uint32_t VISIBLE = 6;
+static const uint32_t FRAMES = 240;
+static const uint32_t FRAMES_PER_STEP = 10;
+
+//Stand in for the rest of the frame (rendering) so the workers get time to decode
+static const std::chrono::milliseconds FRAME_WORK(4);
+
+static double mb(uint64_t bytes)
+{
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+int main()
+{
+    std::vector<std::pair<std::string, br::asset_type>> catalog;
+    for(uint32_t c = 0; c < COPIES; c++)
+    {
+        for(const char* path : MESH_PATHS)
+            catalog.push_back({ path, br::ASSET_MESH });
+
+        for(const char* path : TEXTURE_PATHS)
+            catalog.push_back({ path, br::ASSET_TEXTURE });
+    }
+
+    //What main() used to do: load everything before the first frame
+    auto start = std::chrono::high_resolution_clock::now();
+    uint64_t total_bytes = 0;
+    for(const auto& entry : catalog)
+    {
+        if(entry.second == br::ASSET_MESH)
+        {
+            br::mesh_asset m;
+            br::load_mesh_asset(m, entry.first.c_str());
+            total_bytes += br::mesh_asset_bytes(m);
+        }
+        else
+        {
+            br::texture t;
+            br::load_texture_asset(t, entry.first.c_str());
+            total_bytes += br::texture_bytes(t);
+        }
+    }
+    double sync_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::cout << catalog.size() << " assets, " << std::fixed << std::setprecision(2) << mb(total_bytes) << " MB total" << std::endl;
+    std::cout << "  synchronous load before first frame: " << sync_ms << " ms" << std::endl;
+
+    br::job_system js;
+    br::job_system_init(js);
+
+    br::streamer s;
+    s.js = &js;
+    s.memory_budget = total_bytes / 2;
+    s.upload_budget_ms = 1.0;
+
+    //Uploads are simulated: the CPU rasterizer uses the decoded data directly
+    for(const auto& entry : catalog)
+    {
+        br::stream_register(s, entry.first, entry.second);
+    }
+
+    std::cout << "  streaming with a " << mb(s.memory_budget) << " MB budget on " << br::job_thread_count(&js) << " threads" << std::endl << std::endl;
+    std::cout << "  frame   visible   resident MB   loads   uploads   evictions   stall ms" << std::endl;
+
+    start = std::chrono::high_resolution_clock::now();
+    double first_frame_ms = -1.0;
+    uint64_t visible_frames = 0;
+
+    for(uint32_t frame = 0; frame < FRAMES; frame++)
+    {
+        uint32_t first = (frame / FRAMES_PER_STEP) % (uint32_t)catalog.size();
+
+        //The asset under the camera is required (stall if it isn't there), the rest of the view draws whatever is resident
+        br::stream_wait(s, first);
+
+        uint32_t drawn = 0;
+        for(uint32_t i = 0; i < VISIBLE; i++)
+        {
+            if(br::stream_request(s, (first + i) % (uint32_t)catalog.size()))
+                drawn++;
+        }
+
+        visible_frames += drawn;
+
+        std::this_thread::sleep_for(FRAME_WORK);
+        br::stream_update(s);
+
+        if(first_frame_ms < 0.0)
+            first_frame_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        if(frame % 20 == 0 || frame + 1 == FRAMES)
+        {
+            std::cout << std::setw(7) << frame << std::setw(7) << drawn << "/" << VISIBLE
+                      << std::setw(14) << mb(s.stats.bytes_resident)
+                      << std::setw(8) << s.stats.loads
+                      << std::setw(10) << s.stats.uploads
+                      << std::setw(12) << s.stats.evictions
+                      << std::setw(11) << s.stats.stall_ms << std::endl;
+        }
+    }
+
+    br::stream_shutdown(s);
+    br::job_system_shutdown(js);
+
+    std::cout << std::endl;
+    std::cout << "  first frame after " << first_frame_ms << " ms (vs " << sync_ms << " ms synchronous)" << std::endl;
+    std::cout << "  total stall " << s.stats.stall_ms << " ms over " << FRAMES << " frames, peak resident " << mb(s.stats.peak_bytes_resident)
+              << " MB (budget " << mb(s.memory_budget) << " MB), streamed " << mb(s.stats.bytes_streamed) << " MB" << std::endl;
+    std::cout << "  " << s.stats.held_loads << " of " << s.stats.loads << " loads waited in the queue for memory" << std::endl;
+    std::cout << "  " << std::setprecision(1) << (100.0 * visible_frames) / (FRAMES * VISIBLE) << "% of visible assets were resident when drawn" << std::endl;
+}
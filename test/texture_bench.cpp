@@ -0,0 +1,205 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "../src/math/lnal.h"
+#include "../src/texture/texture.h"
+
+//Measures texture sampling throughput for linear vs tiled storage and scalar vs 4 wide samplers, plus mip chain build times.
+//Samples are taken in scanline order over a rotated, scaled "screen", the access pattern a rasterizer produces for a rotated textured surface.
+
+static const uint32_t TEXTURE_SIZE = 2048;
+static const uint32_t SCREEN_SIZE = 1024;
+
+//Linear rows do fine when the screen walks along texture rows, the interesting cases are the rotated ones
+static const float ROTATIONS_DEGREES[] = { 0.0f, 45.0f, 90.0f };
+
+//Procedural RGBA8 content with detail at every frequency so the mip filters have something to do
+static void make_pixels(std::vector<uint32_t>& pixels)
+{
+    pixels.resize(TEXTURE_SIZE * TEXTURE_SIZE);
+
+    for(uint32_t y = 0; y < TEXTURE_SIZE; y++)
+    {
+        for(uint32_t x = 0; x < TEXTURE_SIZE; x++)
+        {
+            uint32_t h = (x * 73856093u) ^ (y * 19349663u);
+            h ^= h >> 13;
+            h *= 0x5bd1e995u;
+            h ^= h >> 15;
+
+            uint32_t checker = ((x >> 5) ^ (y >> 5)) & 1 ? 200 : 60;
+            uint32_t r = (checker + (h & 0x1F)) & 0xFF;
+            uint32_t g = (x * 255) / TEXTURE_SIZE;
+            uint32_t b = (y * 255) / TEXTURE_SIZE;
+            pixels[(size_t)y * TEXTURE_SIZE + x] = r | (g << 8) | (b << 16) | 0xFF000000u;
+        }
+    }
+}
+
+struct walk
+{
+    float scale;    //Texels per screen pixel
+    float c;
+    float s;
+};
+
+static inline void walk_uv(const walk& w, uint32_t x, uint32_t y, float& u, float& v)
+{
+    float fx = (float)x * w.scale;
+    float fy = (float)y * w.scale;
+    u = ((w.c * fx) - (w.s * fy)) / TEXTURE_SIZE + 0.37f;
+    v = ((w.s * fx) + (w.c * fy)) / TEXTURE_SIZE + 0.21f;
+}
+
+static double bench_scalar(const br::texture& t, const walk& w, bool trilinear, float lod, float& checksum)
+{
+    float sum = 0.0f;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for(uint32_t y = 0; y < SCREEN_SIZE; y++)
+    {
+        for(uint32_t x = 0; x < SCREEN_SIZE; x++)
+        {
+            float u, v, out[4];
+            walk_uv(w, x, y, u, v);
+
+            if(trilinear)
+                br::sample_trilinear(t, u, v, lod, out);
+            else
+                br::sample_bilinear(t, 0, u, v, out);
+
+            sum += out[0] + out[1] + out[2];
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    checksum = sum;
+    return ((double)SCREEN_SIZE * SCREEN_SIZE) / seconds / 1e6;
+}
+
+static double bench_simd(const br::texture& t, const walk& w, bool trilinear, float lod, float& checksum)
+{
+    lnal::f32x4 sum = lnal::f32x4_splat(0.0f);
+    lnal::f32x4 lod4 = lnal::f32x4_splat(lod);
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for(uint32_t y = 0; y < SCREEN_SIZE; y++)
+    {
+        for(uint32_t x = 0; x < SCREEN_SIZE; x += 4)
+        {
+            float u[4], v[4];
+            for(uint32_t i = 0; i < 4; i++)
+            {
+                walk_uv(w, x + i, y, u[i], v[i]);
+            }
+
+            lnal::f32x4 u4 = lnal::f32x4_load(u);
+            lnal::f32x4 v4 = lnal::f32x4_load(v);
+            br::texel4 c = trilinear ? br::sample_trilinear4(t, u4, v4, lod4) : br::sample_bilinear4(t, 0, u4, v4);
+
+            sum = sum + c.r + c.g + c.b;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    float lanes[4];
+    lnal::f32x4_store(lanes, sum);
+    checksum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return ((double)SCREEN_SIZE * SCREEN_SIZE) / seconds / 1e6;
+}
+
+//Largest difference between the scalar and 4 wide samplers (and between the two layouts) over a grid of coordinates, including negative and > 1 ones
+static float max_sampler_error(const br::texture& tiled, const br::texture& linear)
+{
+    float worst = 0.0f;
+
+    for(int i = 0; i < 4096; i++)
+    {
+        float u[4], v[4], lod[4];
+        for(int k = 0; k < 4; k++)
+        {
+            u[k] = -2.0f + (float)((i * 4 + k) * 37 % 4001) / 1000.0f;
+            v[k] = -1.5f + (float)((i * 4 + k) * 91 % 3989) / 1000.0f;
+            lod[k] = (float)((i + k) % 13) * 0.9f - 1.0f;
+        }
+
+        br::texel4 c = br::sample_trilinear4(tiled, lnal::f32x4_load(u), lnal::f32x4_load(v), lnal::f32x4_load(lod));
+        float r[4], g[4];
+        lnal::f32x4_store(r, c.r);
+        lnal::f32x4_store(g, c.g);
+
+        for(int k = 0; k < 4; k++)
+        {
+            float a[4], b[4];
+            br::sample_trilinear(tiled, u[k], v[k], lod[k], a);
+            br::sample_trilinear(linear, u[k], v[k], lod[k], b);
+
+            worst = fmaxf(worst, fmaxf(fabsf(a[0] - r[k]), fabsf(a[1] - g[k])));
+            worst = fmaxf(worst, fmaxf(fabsf(a[0] - b[0]), fabsf(a[2] - b[2])));
+        }
+    }
+
+    return worst;
+}
+
+int main()
+{
+    std::vector<uint32_t> pixels;
+    make_pixels(pixels);
+
+    std::cout << "Texture " << TEXTURE_SIZE << "x" << TEXTURE_SIZE << ", " << SCREEN_SIZE << "x" << SCREEN_SIZE << " samples per run" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    br::texture linear, tiled, kaiser;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    br::texture_create(tiled, TEXTURE_SIZE, TEXTURE_SIZE, pixels.data(), br::TEXTURE_TILED, br::MIP_BOX);
+    auto mid = std::chrono::high_resolution_clock::now();
+    br::texture_create(kaiser, TEXTURE_SIZE, TEXTURE_SIZE, pixels.data(), br::TEXTURE_TILED, br::MIP_KAISER);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    br::texture_create(linear, TEXTURE_SIZE, TEXTURE_SIZE, pixels.data(), br::TEXTURE_LINEAR, br::MIP_BOX);
+
+    std::cout << "  mip chain build: box " << std::chrono::duration<double, std::milli>(mid - start).count() << " ms, kaiser "
+              << std::chrono::duration<double, std::milli>(end - mid).count() << " ms (" << tiled.levels.size() << " levels)" << std::endl;
+
+    std::cout << "  max sampler difference (scalar vs 4 wide, tiled vs linear): " << std::scientific << max_sampler_error(tiled, linear) << std::fixed << std::endl;
+
+    std::cout << std::endl << "  rotation   sampler     layout    scalar Ms/s   4 wide Ms/s" << std::endl;
+
+    float checksum = 0.0f;
+    float total = 0.0f;
+
+    for(float degrees : ROTATIONS_DEGREES)
+    {
+        float angle = lnal::radians(degrees);
+
+        //Magnified enough to stay on level 0 for bilinear, minified ~1.7x for trilinear so it blends levels 0 and 1
+        walk base = { 1.0f, cosf(angle), sinf(angle) };
+        walk minified = { 1.7f, cosf(angle), sinf(angle) };
+        float lod = log2f(minified.scale);
+
+        for(int trilinear = 0; trilinear < 2; trilinear++)
+        {
+            for(const br::texture* t : { &linear, &tiled })
+            {
+                const walk& w = trilinear ? minified : base;
+                double scalar = bench_scalar(*t, w, trilinear, lod, checksum);
+                total += checksum;
+                double simd = bench_simd(*t, w, trilinear, lod, checksum);
+                total += checksum;
+
+                std::cout << std::setw(10) << std::setprecision(0) << degrees << "   " << std::setprecision(2)
+                          << std::left << std::setw(12) << (trilinear ? "trilinear" : "bilinear") << std::setw(10) << (t == &tiled ? "tiled" : "linear") << std::right
+                          << std::setw(11) << scalar << std::setw(14) << simd << std::endl;
+            }
+        }
+    }
+
+    //Printed so the sampling loops can't be optimized away
+    std::cout << std::endl << "  checksum " << total << std::endl;
+}
@@ -0,0 +1,120 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+#include "../src/mesh/mesh.h"
+#include "../src/mesh/vertex_format.h"
+
+//Compares the float and compact vertex formats for each bundled model: memory, fetch bandwidth and the error the quantization introduces
+//Run from the repo root so the model paths resolve
+
+static const double FRAMES_PER_SECOND = 60.0;
+
+struct format_error
+{
+    double position_max;
+    double position_mean;
+    double normal_max_degrees;
+    double normal_mean_degrees;
+    double uv_max;
+};
+
+static format_error measure_error(const br::mesh& m, const br::packed_vertices& packed)
+{
+    format_error e = {};
+    uint32_t count = br::mesh_vertex_count(m);
+
+    for(uint32_t v = 0; v < count; v++)
+    {
+        float p[3], n[3], uv[2];
+        br::unpack_vertex(packed, v, p, n, uv);
+
+        double dx = p[0] - m.positions[v * 3];
+        double dy = p[1] - m.positions[(v * 3) + 1];
+        double dz = p[2] - m.positions[(v * 3) + 2];
+        double d = sqrt((dx * dx) + (dy * dy) + (dz * dz));
+        e.position_max = d > e.position_max ? d : e.position_max;
+        e.position_mean += d / count;
+
+        if(!m.normals.empty())
+        {
+            const float* ref = &m.normals[v * 3];
+            double len = sqrt((ref[0] * ref[0]) + (ref[1] * ref[1]) + (ref[2] * ref[2]));
+            double c = ((n[0] * ref[0]) + (n[1] * ref[1]) + (n[2] * ref[2])) / len;
+            c = c > 1.0 ? 1.0 : c;
+            double degrees = acos(c) * 180.0 / PI;
+            e.normal_max_degrees = degrees > e.normal_max_degrees ? degrees : e.normal_max_degrees;
+            e.normal_mean_degrees += degrees / count;
+        }
+
+        if(!m.uvs.empty())
+        {
+            double du = fabs(uv[0] - m.uvs[v * 2]);
+            double dv = fabs(uv[1] - m.uvs[(v * 2) + 1]);
+            e.uv_max = du > e.uv_max ? du : e.uv_max;
+            e.uv_max = dv > e.uv_max ? dv : e.uv_max;
+        }
+    }
+
+    return e;
+}
+
+static void report(const char* path)
+{
+    br::mesh m;
+    if(!br::load_obj(m, path))
+    {
+        std::cerr << "Failed to load " << path << std::endl;
+        return;
+    }
+
+    uint32_t vertex_count = br::mesh_vertex_count(m);
+    uint32_t index_count = m.lods[0].index_count;
+
+    br::packed_vertices full;
+    br::packed_vertices compact;
+    br::pack_vertices(full, m, br::VERTEX_FORMAT_FLOAT);
+    br::pack_vertices(compact, m, br::VERTEX_FORMAT_COMPACT);
+
+    double diagonal = 0.0;
+    for(int k = 0; k < 3; k++)
+    {
+        diagonal += (m.bounds_max[k] - m.bounds_min[k]) * (m.bounds_max[k] - m.bounds_min[k]);
+    }
+    diagonal = sqrt(diagonal);
+
+    std::cout << path << " (" << vertex_count << " vertices, " << index_count / 3 << " triangles"
+              << (m.normals.empty() ? "" : ", normals") << (m.uvs.empty() ? "" : ", uvs") << ")" << std::endl;
+
+    std::cout << "  format     bytes/vertex   vertex buffer   fetch MB/s @60fps (worst case, no post-transform cache)" << std::endl;
+
+    for(const br::packed_vertices* p : { &full, &compact })
+    {
+        double fetch = (double)index_count * p->layout.stride * FRAMES_PER_SECOND / (1024.0 * 1024.0);
+
+        std::cout << "  " << std::left << std::setw(10) << (p == &full ? "float" : "compact") << std::right
+                  << std::setw(13) << p->layout.stride
+                  << std::setw(14) << p->data.size() << " B"
+                  << std::setw(18) << std::fixed << std::setprecision(2) << fetch << std::endl;
+    }
+
+    std::cout << "  savings: " << std::setprecision(1) << 100.0 * (1.0 - (double)compact.data.size() / full.data.size()) << "%" << std::endl;
+
+    format_error e = measure_error(m, compact);
+    std::cout << std::scientific << std::setprecision(3);
+    std::cout << "  position error: max " << e.position_max << " mean " << e.position_mean << " (max / bounds diagonal " << e.position_max / diagonal << ")" << std::endl;
+
+    if(!m.normals.empty())
+        std::cout << "  normal error:   max " << e.normal_max_degrees << " deg, mean " << e.normal_mean_degrees << " deg" << std::endl;
+
+    if(!m.uvs.empty())
+        std::cout << "  uv error:       max " << e.uv_max << std::endl;
+
+    std::cout << std::defaultfloat << std::endl;
+}
+
+int main()
+{
+    report("./utah_teapot.obj");
+    report("./ico-sphere.obj");
+}